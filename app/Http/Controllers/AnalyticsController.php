@@ -70,36 +70,22 @@ public function getTrend30Days()
         $thirtyDaysAgo = Carbon::now()->subDays(30);
         $now = Carbon::now();
         
-        // Get historical data from Firestore (optimized limit)
-        // For 30 days: 1 record per 4 hours = 180 records total
-        $historyData = $this->firebaseService->getHistoricalData($thirtyDaysAgo, $now, 'timestamp', 180);
+        // Daily stats from hourly ESP32 aggregates (~720 reads for 30 days)
+        // Fallback to raw history: 1 record per 4 hours = 180 records total
+        $dailyData = $this->firebaseService->getAggregatedDailyData($thirtyDaysAgo, $now, 180);
         
-        if (empty($historyData)) {
+        if (empty($dailyData)) {
             return response()->json($this->generateDummyTrendData(30));
         }
         
-        // Group by date and calculate averages
-        $groupedData = collect($historyData)
-            ->groupBy(function($item) {
-                return Carbon::parse($item['timestamp'])->format('Y-m-d');
-            })
-            ->sortKeys()  // Sort by date ascending (oldest to newest)
-            ->map(function($group) {
-                return [
-                    'score' => round(collect($group)->avg('water_quality_score'), 2),
-                    'ph_avg' => round(collect($group)->avg('ph_value'), 2),
-                    'tds_avg' => round(collect($group)->avg('tds_value'), 2),
-                    'turbidity_avg' => round(collect($group)->avg('turbidity'), 2),
-                ];
-            });
-        
-        $labels = $groupedData->keys()->map(function($key) {
-            return Carbon::parse($key)->format('d M');
+        $groupedData = collect($dailyData);
+        $labels = $groupedData->map(function($day) {
+            return Carbon::parse($day['date'])->format('d M');
         })->values()->toArray();
 
         return response()->json([
             'labels' => $labels,
-            'scores' => $groupedData->pluck('score')->values()->toArray(),
+            'scores' => $groupedData->pluck('score_avg')->values()->toArray(),
             'ph_data' => $groupedData->pluck('ph_avg')->values()->toArray(),
             'tds_data' => $groupedData->pluck('tds_avg')->values()->toArray(),
             'turbidity_data' => $groupedData->pluck('turbidity_avg')->values()->toArray(),
@@ -96,6 +96,9 @@ public function getLatestSensorData()
                 'timestamp' => $data['updateTime'] ?? now()->toDateTimeString(),
             ];
             
+            // Device trace (ESP32 stamps every upload with seq + capture time)
+            $result = array_merge($result, $this->extractTrace($fields, $data['updateTime'] ?? null));
+            
             // Cache the result for 30 minutes (reduced Firebase reads)
             Cache::put($cacheKey, $result, now()->addMinutes(30));
             
@@ -189,6 +192,36 @@ private function extractValue($fields, $fieldName)
         return null;
     }
 
+    /**
+     * Extract the ESP32 trace fields from sensorRead/dataSensor and split latency per hop:
+     * sensor_to_cloud_ms = Firestore updateTime - device capturedAt,
+     * cloud_to_dashboard_ms = now - updateTime (backend read + processing).
+     * Gaps in seq within the same boot_id are readings that never reached Firestore.
+     */
+    private function extractTrace($fields, $updateTime)
+    {
+        $trace = [
+            'seq' => $this->extractValue($fields, 'seq'),
+            'boot_id' => $this->extractValue($fields, 'bootId'),
+            'captured_at' => $this->extractValue($fields, 'capturedAt'),
+            'uploaded_at' => $this->extractValue($fields, 'uploadedAt'),
+            'ack_seq' => $this->extractValue($fields, 'ackSeq'),
+            'ack_at' => $this->extractValue($fields, 'ackAt'),
+            'sensor_to_cloud_ms' => null,
+            'cloud_to_dashboard_ms' => null,
+        ];
+        
+        if ($updateTime) {
+            $updatedMs = (int) Carbon::parse($updateTime)->getPreciseTimestamp(3);
+            $trace['cloud_to_dashboard_ms'] = (int) now()->getPreciseTimestamp(3) - $updatedMs;
+            if ($trace['captured_at']) {
+                $trace['sensor_to_cloud_ms'] = $updatedMs - (int) Carbon::parse($trace['captured_at'])->getPreciseTimestamp(3);
+            }
+        }
+        
+        return $trace;
+    }
+
     /**
      * Save fuzzy decision result to Firestore via REST API
      * Collection: FuzzyAction > Document: FuzzyData
@@ -395,13 +428,163 @@ public function getHistoricalData($startDate, $endDate, $orderBy = 'timestamp',
         }
     }
     
+    /**
+     * Get window aggregates written by the ESP32
+     * Collections: sensorAggregate1h (default), sensorAggregate15m, sensorAggregate1m
+     * One document per window: count, weight_sec, and {mean, std, min, max} per channel
+     */
+    public function getAggregateData($startDate, $endDate, $collection = 'sensorAggregate1h', $limit = 800)
+    {
+        $cacheKey = "aggregate_data_{$collection}_{$startDate}_{$endDate}_{$limit}";
+
+        if (Cache::has($cacheKey)) {
+            return Cache::get($cacheKey);
+        }
+
+        try {
+            if (is_string($startDate)) {
+                $startDate = Carbon::parse($startDate);
+            }
+            if (is_string($endDate)) {
+                $endDate = Carbon::parse($endDate);
+            }
+
+            $query = [
+                'structuredQuery' => [
+                    'from' => [['collectionId' => $collection]],
+                    'where' => [
+                        'compositeFilter' => [
+                            'op' => 'AND',
+                            'filters' => [
+                                [
+                                    'fieldFilter' => [
+                                        'field' => ['fieldPath' => 'timestamp'],
+                                        'op' => 'GREATER_THAN_OR_EQUAL',
+                                        'value' => ['timestampValue' => $startDate->toIso8601String()]
+                                    ]
+                                ],
+                                [
+                                    'fieldFilter' => [
+                                        'field' => ['fieldPath' => 'timestamp'],
+                                        'op' => 'LESS_THAN_OR_EQUAL',
+                                        'value' => ['timestampValue' => $endDate->toIso8601String()]
+                                    ]
+                                ]
+                            ]
+                        ]
+                    ],
+                    'orderBy' => [
+                        [
+                            'field' => ['fieldPath' => 'timestamp'],
+                            'direction' => 'ASCENDING'
+                        ]
+                    ],
+                    'limit' => $limit
+                ]
+            ];
+
+            $url = "https://firestore.googleapis.com/v1/projects/{$this->projectId}/databases/(default)/documents:runQuery";
+            $response = Http::timeout(15)->post($url, $query);
+
+            if (!$response->successful()) {
+                Log::error('Failed to fetch aggregate data: ' . $response->status());
+                return [];
+            }
+
+            $data = [];
+            foreach ($response->json() as $result) {
+                if (isset($result['document']['fields'])) {
+                    $fields = $result['document']['fields'];
+                    $data[] = [
+                        'timestamp' => $this->extractValue($fields, 'timestamp'),
+                        'count' => (int) $this->extractValue($fields, 'count'),
+                        'weight_sec' => (float) $this->extractValue($fields, 'weight_sec'),
+                        'ph_value' => $this->extractStats($fields, 'ph_value'),
+                        'tds_value' => $this->extractStats($fields, 'tds_value'),
+                        'turbidity' => $this->extractStats($fields, 'turbidity'),
+                        'water_level' => $this->extractStats($fields, 'water_level'),
+                        'water_quality_score' => $this->extractStats($fields, 'water_quality_score'),
+                    ];
+                }
+            }
+
+            if (!empty($data)) {
+                Cache::put($cacheKey, $data, now()->addMinutes(60));
+            }
+
+            return $data;
+
+        } catch (\Exception $e) {
+            Log::error('Error fetching aggregate data: ' . $e->getMessage());
+            return [];
+        }
+    }
+
+    /**
+     * Extract {mean, std, min, max} map written by the ESP32 aggregator
+     */
+    private function extractStats($fields, $fieldName)
+    {
+        if (!isset($fields[$fieldName]['mapValue']['fields'])) {
+            return null;
+        }
+
+        $map = $fields[$fieldName]['mapValue']['fields'];
+        return [
+            'mean' => $this->extractValue($map, 'mean'),
+            'std' => $this->extractValue($map, 'std'),
+            'min' => $this->extractValue($map, 'min'),
+            'max' => $this->extractValue($map, 'max'),
+        ];
+    }
+
+    /**
+     * Pool window stats of one channel: weighted mean, variance within
+     * windows plus spread of window means, overall min/max
+     */
+    private function poolStats($windows, $channel)
+    {
+        $weight = 0;
+        $sum = 0;
+        $min = null;
+        $max = null;
+        foreach ($windows as $window) {
+            $stats = $window[$channel];
+            if (!$stats || $window['weight_sec'] <= 0) {
+                continue;
+            }
+            $weight += $window['weight_sec'];
+            $sum += $window['weight_sec'] * $stats['mean'];
+            $min = $min === null ? $stats['min'] : min($min, $stats['min']);
+            $max = $max === null ? $stats['max'] : max($max, $stats['max']);
+        }
+
+        if ($weight <= 0) {
+            return null;
+        }
+
+        $mean = $sum / $weight;
+        $m2 = 0;
+        foreach ($windows as $window) {
+            $stats = $window[$channel];
+            if (!$stats || $window['weight_sec'] <= 0) {
+                continue;
+            }
+            $m2 += $window['weight_sec'] * ($stats['std'] ** 2 + ($stats['mean'] - $mean) ** 2);
+        }
+
+        return ['mean' => $mean, 'std' => sqrt($m2 / $weight), 'min' => $min, 'max' => $max];
+    }
+
     /**
      * Get aggregated daily data (1 record per day) for charts
-     * Much more efficient than fetching all raw data
+     * Built from hourly ESP32 aggregates (30 days = ~720 reads); days without
+     * aggregates (e.g. before the firmware wrote them) are filled by grouping
+     * raw sensorHistory over just the range of those days
      */
-    public function getAggregatedDailyData($startDate, $endDate)
+    public function getAggregatedDailyData($startDate, $endDate, $rawLimit = 500)
     {
-        $cacheKey = "daily_aggregated_{$startDate}_{$endDate}";
+        $cacheKey = "daily_aggregated_{$startDate}_{$endDate}_{$rawLimit}";
         
         // Check cache first (cached for 2 hours)
         if (Cache::has($cacheKey)) {
@@ -410,31 +593,87 @@ public function getAggregatedDailyData($startDate, $endDate)
         }
         
         try {
-            // Get raw data with limit
-            $rawData = $this->getHistoricalData($startDate, $endDate, 'timestamp', 500);
-            
-            if (empty($rawData)) {
-                return [];
+            if (is_string($startDate)) {
+                $startDate = Carbon::parse($startDate);
             }
-            
-            // Group by date and aggregate
-            $aggregated = collect($rawData)
+            if (is_string($endDate)) {
+                $endDate = Carbon::parse($endDate);
+            }
+
+            $hourly = $this->getAggregateData($startDate, $endDate);
+
+            $daily = collect($hourly)
                 ->groupBy(function($item) {
                     return Carbon::parse($item['timestamp'])->format('Y-m-d');
                 })
                 ->map(function($group) {
+                    $windows = $group->all();
+                    $ph = $this->poolStats($windows, 'ph_value');
+                    $tds = $this->poolStats($windows, 'tds_value');
+                    $turbidity = $this->poolStats($windows, 'turbidity');
+                    $waterLevel = $this->poolStats($windows, 'water_level');
+                    $score = $this->poolStats($windows, 'water_quality_score');
                     return [
                         'date' => $group->first()['timestamp'],
-                        'ph_avg' => round($group->avg('ph_value'), 2),
-                        'tds_avg' => round($group->avg('tds_value'), 2),
-                        'turbidity_avg' => round($group->avg('turbidity'), 2),
-                        'water_level_avg' => round($group->avg('water_level'), 2),
-                        'score_avg' => round($group->avg('water_quality_score'), 2),
-                        'score_min' => round($group->min('water_quality_score'), 2),
-                        'score_max' => round($group->max('water_quality_score'), 2),
-                        'count' => $group->count(),
+                        'ph_avg' => $ph ? round($ph['mean'], 2) : null,
+                        'ph_std' => $ph ? round($ph['std'], 2) : null,
+                        'tds_avg' => $tds ? round($tds['mean'], 2) : null,
+                        'tds_std' => $tds ? round($tds['std'], 2) : null,
+                        'turbidity_avg' => $turbidity ? round($turbidity['mean'], 2) : null,
+                        'turbidity_std' => $turbidity ? round($turbidity['std'], 2) : null,
+                        'water_level_avg' => $waterLevel ? round($waterLevel['mean'], 2) : null,
+                        'score_avg' => $score ? round($score['mean'], 2) : null,
+                        'score_min' => $score ? round($score['min'], 2) : null,
+                        'score_max' => $score ? round($score['max'], 2) : null,
+                        'count' => $group->sum('count'),
                     ];
-                })
+                });
+
+            // Days in range that have no hourly aggregate
+            $missingDays = [];
+            for ($day = $startDate->copy()->startOfDay(); $day->lte($endDate); $day->addDay()) {
+                $key = $day->format('Y-m-d');
+                if (!$daily->has($key)) {
+                    $missingDays[] = $key;
+                }
+            }
+
+            if (!empty($missingDays)) {
+                $rawStart = Carbon::parse(reset($missingDays))->startOfDay()->max($startDate);
+                $rawEnd = Carbon::parse(end($missingDays))->endOfDay()->min($endDate);
+                $rawData = $this->getHistoricalData($rawStart, $rawEnd, 'timestamp', $rawLimit);
+
+                $fromRaw = collect($rawData)
+                    ->groupBy(function($item) {
+                        return Carbon::parse($item['timestamp'])->format('Y-m-d');
+                    })
+                    ->only($missingDays)
+                    ->map(function($group) {
+                        return [
+                            'date' => $group->first()['timestamp'],
+                            'ph_avg' => round($group->avg('ph_value'), 2),
+                            'ph_std' => null,
+                            'tds_avg' => round($group->avg('tds_value'), 2),
+                            'tds_std' => null,
+                            'turbidity_avg' => round($group->avg('turbidity'), 2),
+                            'turbidity_std' => null,
+                            'water_level_avg' => round($group->avg('water_level'), 2),
+                            'score_avg' => round($group->avg('water_quality_score'), 2),
+                            'score_min' => round($group->min('water_quality_score'), 2),
+                            'score_max' => round($group->max('water_quality_score'), 2),
+                            'count' => $group->count(),
+                        ];
+                    });
+
+                $daily = $daily->union($fromRaw);
+            }
+
+            if ($daily->isEmpty()) {
+                return [];
+            }
+
+            $aggregated = $daily
+                ->sortKeys()
                 ->values()
                 ->toArray();
             
@@ -2,6 +2,22 @@
 #include <Firebase_ESP_Client.h>
 #include "addons/TokenHelper.h"
 #include "time.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_sntp.h"
+#include <Preferences.h>
+#include <LittleFS.h>
+#include "esp_adc/adc_continuous.h"
+#include "lwip/sockets.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/base64.h"
+#include "mqtt_client.h"
+#include "esp_crt_bundle.h"
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <atomic>
+#include <vector>
+#include "spsc_queue.h"
 
 // --------------------------------------------------------------
 // WIFI & FIREBASE
@@ -17,6 +33,25 @@
 #define USER_EMAIL "YOUR_ESP32_EMAIL"
 #define USER_PASSWORD "YOUR_ESP32_PASSWORD"
 
+// --------------------------------------------------------------
+// PERAN PERANGKAT (build flag, lihat bagian ESP-NOW)
+// --------------------------------------------------------------
+#define PERAN_MANDIRI 0   // satu ESP32 per kolam, langsung ke Firestore
+#define PERAN_LEAF 1      // hanya sensor, reading ke gateway lewat ESP-NOW
+#define PERAN_GATEWAY 2   // mandiri + batch reading leaf ke sensorRead/kolam-<id>
+#ifndef TAMBAQ_PERAN
+#define TAMBAQ_PERAN PERAN_MANDIRI
+#endif
+#ifndef KOLAM_ID
+#define KOLAM_ID 1                  // leaf: nomor kolam yang diukur
+#endif
+#ifndef ESPNOW_CHANNEL
+#define ESPNOW_CHANNEL 1            // leaf: harus sama dengan channel AP gateway
+#endif
+#ifndef ESPNOW_GATEWAY_MAC
+#define ESPNOW_GATEWAY_MAC "FF:FF:FF:FF:FF:FF"   // leaf: MAC STA gateway (broadcast = tanpa ack)
+#endif
+
 // --------------------------------------------------------------
 // PIN SENSOR
 // --------------------------------------------------------------
@@ -26,20 +61,517 @@
 #define TRIG_PIN 5
 #define ECHO_PIN 18
 
+// Relay aktuator (lihat KONTROL AKTUATOR LOKAL)
+#define AERATOR_PIN 25
+#define POMPA_PIN 26
+#define RELAY_AKTIF_TINGGI 1        // 0 = modul relay aktif LOW
+
 FirebaseData fbdo;
 FirebaseAuth auth;
 FirebaseConfig config;
 
+// TCP keep-alive untuk koneksi TLS Firestore yang dipakai ulang
+#define TCP_KEEPALIVE_IDLE_SEC 5
+#define TCP_KEEPALIVE_INTERVAL_SEC 5
+#define TCP_KEEPALIVE_COUNT 1
+
 unsigned long previousMillis = 0;
-const long uploadInterval = 10000;
+const long uploadInterval = 10000;   // interval dasar (laju tetap); lihat KONTROL LAJU ADAPTIF
 
 bool firebaseReady = false;
 
+// Timestamp retry non-blocking (pengganti delay di loop)
+unsigned long lastWifiRetryMillis = 0;
+unsigned long lastFirebaseWaitLog = 0;
+const unsigned long wifiRetryInterval = 5000;
+const unsigned long firebaseWaitInterval = 2000;
+
+// Latensi loop() terbesar sejak log terakhir (mikrodetik)
+unsigned long loopMaxMicros = 0;
+
+// Prototipe fungsi yang didefinisikan setelah setup()
+void initKalibrasi();
+void initAkuisisi();
+uint16_t crc16(const uint8_t* data, size_t len);
+void initRiwayat();
+void initAgregat();
+void initJurnal();
+void initPipeline();
+void cetakTrace();
+void initEspNow();
+void langkahLeaf(unsigned long now);
+void langkahGateway(unsigned long now, bool cloudReady);
+void cetakEspNow();
+void initAktuator();
+
+// --------------------------------------------------------------
+// LOGGER ASINKRON (RING BINER, LEVEL DIBUANG SAAT KOMPILASI)
+// --------------------------------------------------------------
+// Serial.printf memblokir pemanggil selama UART 115200 mengirim
+// (~87 us/byte, blok data per reading ~1 KB = puluhan ms). Makro LOGx
+// hanya menyalin pointer format + argumen mentah ke ring lock-free;
+// task "log" prioritas rendah yang memformat dan menulis ke UART.
+// - level di bawah LOG_LEVEL dibuang saat kompilasi (string format dan
+//   argumen tidak ikut ter-link), cek format printf tetap berjalan
+// - multi-producer (semua task + setup): slot dipesan dengan CAS, word
+//   header ditulis terakhir (release) sebagai tanda record lengkap
+// - ring penuh -> record dibuang dan dihitung, pemanggil tidak menunggu
+// - mode biner: frame [0xFE jenis panjang payload CRC16], format string
+//   dikirim sekali sebagai kamus (ID 16 bit), didekode di PC dengan
+//   tambaq-sim --dekode-log. 0xFE tidak pernah muncul di UTF-8, jadi
+//   teks Serial biasa di antara frame tetap terbaca.
+// Argumen: integer 4 byte, long/size_t selebar long, (u)int64_t 8 byte,
+// float/double -> float 4 byte, string (char*) = panjang 1 byte + isi
+// maks LOG_STR_MAX. Format yang didukung: %d %i %u %x %X %c %f %e %g %s
+// %% (flag, lebar, presisi, l, ll, z).
+// Jawaban perintah serial (kal, metrik, ...) tetap Serial langsung.
+// --------------------------------------------------------------
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO   // build flag: level terendah yang di-compile
+#endif
+#define LOG_BINER_DEFAULT 0         // 1 = frame biner sejak boot
+#define LOG_RING_WORDS 1024         // 4 KB, pangkat 2
+#define LOG_ARG_MAX 96              // byte argumen per record
+#define LOG_STR_MAX 47
+#define LOG_KAMUS_MAX 160           // format berbeda yang bisa diberi ID frame
+#define LOG_TEKS_MAX 512
+#define LOG_TASK_CORE 0
+#define LOG_POLL_MS 20
+#define LOG_FRAME_SYNC 0xFE
+#define LOG_FRAME_RECORD 'R'        // id16, level, tag, ms32, argumen
+#define LOG_FRAME_KAMUS 'K'         // id16, string format
+#define LOG_FRAME_TAG 'G'           // tag, nama
+#define LOG_FRAME_HILANG 'H'        // jumlah record dibuang (u32)
+#define LOG_FRAME_LEBAR 'W'         // sizeof(long) di perangkat (ESP32: 4, host LP64: 8)
+#define LOG_MODE_TEKS 0
+#define LOG_MODE_BINER 1
+
+enum LogTag : uint8_t {
+  TAG_BOOT = 0,
+  TAG_WIFI,
+  TAG_CLOUD,
+  TAG_SENSOR,
+  TAG_JURNAL,
+  TAG_MQTT,
+  TAG_LAN,
+  TAG_ESPNOW,
+  TAG_AKTUATOR,
+  NUM_LOG_TAG
+};
+
+const char* const LOG_TAG_LABEL[NUM_LOG_TAG] = { "BOOT", "WIFI", "CLOUD", "SENSOR", "JURNAL", "MQTT", "LAN", "ESPNOW", "AKTUATOR" };
+const char LOG_LEVEL_HURUF[] = "DIWE";
+
+// Header word 0: jumlah word | level << 8 | tag << 16 (tidak pernah 0)
+// word 1: millis(), lalu pointer format, lalu argumen (byte, dibulatkan)
+#define LOG_PTR_WORDS ((sizeof(const char*) + 3) / 4)
+#define LOG_HEADER_WORDS (2 + LOG_PTR_WORDS)
+#define LOG_RECORD_MAX_WORDS (LOG_HEADER_WORDS + (LOG_ARG_MAX + 3) / 4)
+
+// strnlen tanpa peringatan bound > ukuran literal dari GCC
+inline size_t panjangLog(const char* s, size_t maks) {
+  size_t n = 0;
+  while (n < maks && s[n]) n++;
+  return n;
+}
+
+struct LogArgs {
+  uint8_t buf[LOG_ARG_MAX];
+  uint8_t len;
+
+  LogArgs() : len(0) {}
+
+  // Argumen yang tidak muat dibuang (dicetak "?")
+  void kata(uint32_t v) {
+    if (len + 4 > LOG_ARG_MAX) return;
+    memcpy(buf + len, &v, 4);
+    len += 4;
+  }
+
+  // Nilai 64-bit: dua word (little endian), tidak ditulis setengah
+  void kata64(uint64_t v) {
+    if (len + 8 > LOG_ARG_MAX) return;
+    memcpy(buf + len, &v, 8);
+    len += 8;
+  }
+
+  void teks(const char* s) {
+    size_t n = s ? panjangLog(s, LOG_STR_MAX) : 0;
+    if (len + 1 + n > LOG_ARG_MAX) return;
+    buf[len++] = (uint8_t)n;
+    memcpy(buf + len, s, n);
+    len += n;
+  }
+};
+
+inline void logArg(LogArgs& a, int v) { a.kata((uint32_t)v); }
+inline void logArg(LogArgs& a, unsigned v) { a.kata(v); }
+// long selebar sizeof(long): 1 word di ESP32, 2 word di host LP64 (%l di formatLog)
+inline void logArg(LogArgs& a, long v) {
+  if (sizeof(long) == 8) a.kata64((uint64_t)v);
+  else a.kata((uint32_t)v);
+}
+inline void logArg(LogArgs& a, unsigned long v) {
+  if (sizeof(long) == 8) a.kata64(v);
+  else a.kata((uint32_t)v);
+}
+inline void logArg(LogArgs& a, long long v) { a.kata64((uint64_t)v); }
+inline void logArg(LogArgs& a, unsigned long long v) { a.kata64(v); }
+inline void logArg(LogArgs& a, double v) {
+  float f = (float)v;
+  uint32_t bits;
+  memcpy(&bits, &f, 4);
+  a.kata(bits);
+}
+inline void logArg(LogArgs& a, const char* s) { a.teks(s); }
+
+// Rekursi argumen (C++11, tanpa fold expression)
+inline void logArgs(LogArgs&) {}
+
+template <typename T, typename... R>
+void logArgs(LogArgs& a, const T& v, const R&... sisa) {
+  logArg(a, v);
+  logArgs(a, sisa...);
+}
+
+// Ring word MPSC: producer memesan [pesan, pesan + n) dengan CAS,
+// consumer tunggal mengosongkan word lalu memajukan baca.
+class LogRing {
+public:
+  LogRing() : pesan(0), baca(0), hilang(0) {
+    for (uint32_t i = 0; i < LOG_RING_WORDS; i++) kata[i].store(0, std::memory_order_relaxed);
+  }
+
+  void tulis(uint8_t level, uint8_t tag, const char* fmt, const LogArgs& a) {
+    uint32_t n = LOG_HEADER_WORDS + (a.len + 3) / 4;
+    uint32_t p = pesan.load(std::memory_order_relaxed);
+    do {
+      if (p + n - baca.load(std::memory_order_acquire) > LOG_RING_WORDS) {
+        hilang.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    } while (!pesan.compare_exchange_weak(p, p + n, std::memory_order_relaxed));
+
+    uint32_t isi[LOG_RECORD_MAX_WORDS];
+    isi[n - 1] = 0;   // padding argumen
+    isi[1] = (uint32_t)millis();
+    memcpy(&isi[2], &fmt, sizeof(fmt));
+    memcpy(&isi[LOG_HEADER_WORDS], a.buf, a.len);
+    for (uint32_t i = 1; i < n; i++) kata[(p + i) & (LOG_RING_WORDS - 1)].store(isi[i], std::memory_order_relaxed);
+    kata[p & (LOG_RING_WORDS - 1)].store(n | (uint32_t)level << 8 | (uint32_t)tag << 16, std::memory_order_release);
+  }
+
+  // Consumer: salin satu record lengkap ke out; 0 jika kosong / belum selesai ditulis
+  uint32_t ambil(uint32_t out[LOG_RECORD_MAX_WORDS]) {
+    uint32_t b = baca.load(std::memory_order_relaxed);
+    if (b == pesan.load(std::memory_order_acquire)) return 0;
+    uint32_t h = kata[b & (LOG_RING_WORDS - 1)].load(std::memory_order_acquire);
+    if (h == 0) return 0;
+    uint32_t n = h & 0xFF;
+    out[0] = h;
+    for (uint32_t i = 1; i < n; i++) out[i] = kata[(b + i) & (LOG_RING_WORDS - 1)].load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < n; i++) kata[(b + i) & (LOG_RING_WORDS - 1)].store(0, std::memory_order_relaxed);
+    baca.store(b + n, std::memory_order_release);
+    return n;
+  }
+
+  uint32_t terpakai() const {
+    return pesan.load(std::memory_order_acquire) - baca.load(std::memory_order_acquire);
+  }
+
+  uint32_t jumlahHilang() const { return hilang.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint32_t> kata[LOG_RING_WORDS];
+  std::atomic<uint32_t> pesan;   // word yang sudah dipesan producer
+  std::atomic<uint32_t> baca;    // word yang sudah diambil consumer
+  std::atomic<uint32_t> hilang;  // record dibuang karena ring penuh
+};
+
+LogRing logRing;
+
+template <typename... A>
+void logTulis(uint8_t level, uint8_t tag, const char* fmt, const A&... args) {
+  LogArgs a;
+  logArgs(a, args...);
+  logRing.tulis(level, tag, fmt, a);
+}
+
+// Hanya untuk cek format oleh compiler, tidak pernah dipanggil
+inline void logCekFormat(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void logCekFormat(const char*, ...) {}
+
+#define LOG_PANGGIL(level, tag, fmt, ...)                  \
+  do {                                                     \
+    if (0) logCekFormat(fmt, ##__VA_ARGS__);               \
+    logTulis(level, tag, fmt, ##__VA_ARGS__);              \
+  } while (0)
+#define LOG_BUANG(fmt, ...)                                \
+  do {                                                     \
+    if (0) logCekFormat(fmt, ##__VA_ARGS__);               \
+  } while (0)
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOGD(tag, fmt, ...) LOG_PANGGIL(LOG_LEVEL_DEBUG, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGD(tag, fmt, ...) LOG_BUANG(fmt, ##__VA_ARGS__)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOGI(tag, fmt, ...) LOG_PANGGIL(LOG_LEVEL_INFO, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGI(tag, fmt, ...) LOG_BUANG(fmt, ##__VA_ARGS__)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOGW(tag, fmt, ...) LOG_PANGGIL(LOG_LEVEL_WARN, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGW(tag, fmt, ...) LOG_BUANG(fmt, ##__VA_ARGS__)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOGE(tag, fmt, ...) LOG_PANGGIL(LOG_LEVEL_ERROR, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGE(tag, fmt, ...) LOG_BUANG(fmt, ##__VA_ARGS__)
+#endif
+
+// Format ulang record: tiap konversi fmt memakai satu argumen mentah.
+// Bilangan bulat 4 byte, %ll 8 byte, %l/%z selebar long perangkat
+// penulis (lebarLong; dekoder host membacanya dari frame 'W').
+// C++ murni, dipakai task log dan dekoder host. Return panjang teks.
+size_t formatLog(const char* fmt, const uint8_t* arg, size_t argLen, char* out, size_t cap,
+                 size_t lebarLong = sizeof(long)) {
+  size_t n = 0;
+  size_t pos = 0;
+  if (cap == 0) return 0;
+  while (*fmt && n + 1 < cap) {
+    if (*fmt != '%') {
+      out[n++] = *fmt++;
+      continue;
+    }
+    if (fmt[1] == '%') {
+      out[n++] = '%';
+      fmt += 2;
+      continue;
+    }
+    // Salin flag/lebar/presisi, modifier panjang menentukan lebar argumen
+    char spec[20];
+    size_t s = 0;
+    spec[s++] = *fmt++;
+    while (*fmt && strchr("-+ #0123456789.", *fmt) && s < sizeof(spec) - 4) spec[s++] = *fmt++;
+    size_t lebar = 4;
+    int jumlahL = 0;
+    while (*fmt == 'l' || *fmt == 'h' || *fmt == 'z') {
+      if (*fmt == 'l') jumlahL++;
+      if (*fmt == 'z') lebar = lebarLong;
+      fmt++;
+    }
+    if (jumlahL >= 2) lebar = 8;
+    else if (jumlahL == 1) lebar = lebarLong;
+    char konv = *fmt;
+    if (konv == '\0') break;
+    fmt++;
+    bool pecahan = strchr("fFeEgG", konv) != nullptr;
+    if (pecahan) lebar = 4;   // double dikirim sebagai float
+    if (lebar == 8 && konv != 's') {
+      spec[s++] = 'l';
+      spec[s++] = 'l';
+    }
+    spec[s++] = konv;
+    spec[s] = '\0';
+
+    int tulis = 0;
+    size_t sisa = cap - n;
+    if (konv == 's') {
+      char str[LOG_STR_MAX + 1];
+      size_t len = pos < argLen ? arg[pos] : 0;
+      if (pos + 1 + len > argLen) len = 0;
+      memcpy(str, arg + pos + 1, len);
+      str[len] = '\0';
+      pos += 1 + len;
+      tulis = snprintf(out + n, sisa, spec, str);
+    } else if (lebar == 8 && pos + 8 <= argLen) {
+      uint64_t v;
+      memcpy(&v, arg + pos, 8);
+      pos += 8;
+      if (konv == 'd' || konv == 'i') {
+        tulis = snprintf(out + n, sisa, spec, (long long)(int64_t)v);
+      } else {
+        tulis = snprintf(out + n, sisa, spec, (unsigned long long)v);
+      }
+    } else if (lebar == 4 && pos + 4 <= argLen) {
+      uint32_t v;
+      memcpy(&v, arg + pos, 4);
+      pos += 4;
+      if (pecahan) {
+        float f;
+        memcpy(&f, &v, 4);
+        tulis = snprintf(out + n, sisa, spec, (double)f);
+      } else if (konv == 'd' || konv == 'i' || konv == 'c') {
+        tulis = snprintf(out + n, sisa, spec, (int)(int32_t)v);
+      } else {
+        tulis = snprintf(out + n, sisa, spec, (unsigned)v);
+      }
+    } else {
+      tulis = snprintf(out + n, sisa, "?");
+    }
+    if (tulis > 0) n += (size_t)tulis < sisa ? (size_t)tulis : sisa - 1;
+  }
+  out[n] = '\0';
+  return n;
+}
+
+// Task log: satu-satunya consumer ring dan penulis frame/teks log ke UART
+struct LogStatistik {
+  uint32_t record;
+  uint32_t bytesUart;
+  uint32_t hilangDilaporkan;
+  uint16_t jumlahKamus;
+  bool biner;
+};
+
+LogStatistik logStat = { 0, 0, 0, 0, LOG_BINER_DEFAULT != 0 };
+const char* logKamus[LOG_KAMUS_MAX];   // index = ID frame
+std::atomic<bool> logSibuk(false);
+std::atomic<int> logModeDiminta(-1);   // diterapkan consumer (perintah "log")
+TaskHandle_t logTaskHandle = nullptr;
+
+void kirimFrameLog(uint8_t jenis, const uint8_t* payload, size_t len) {
+  uint8_t frame[3 + 255 + 2];
+  if (len > 255) len = 255;
+  frame[0] = LOG_FRAME_SYNC;
+  frame[1] = jenis;
+  frame[2] = (uint8_t)len;
+  memcpy(frame + 3, payload, len);
+  uint16_t crc = crc16(frame + 1, len + 2);
+  frame[3 + len] = (uint8_t)crc;
+  frame[4 + len] = (uint8_t)(crc >> 8);
+  Serial.write(frame, len + 5);
+  logStat.bytesUart += len + 5;
+}
+
+void kirimTagLog() {
+  for (uint8_t t = 0; t < NUM_LOG_TAG; t++) {
+    uint8_t p[16];
+    size_t n = panjangLog(LOG_TAG_LABEL[t], sizeof(p) - 1);
+    p[0] = t;
+    memcpy(p + 1, LOG_TAG_LABEL[t], n);
+    kirimFrameLog(LOG_FRAME_TAG, p, n + 1);
+  }
+  uint8_t lebarLong = sizeof(long);
+  kirimFrameLog(LOG_FRAME_LEBAR, &lebarLong, 1);
+}
+
+// ID kamus untuk fmt; format baru dikirim dulu sebagai frame kamus
+int idKamusLog(const char* fmt) {
+  for (uint16_t i = 0; i < logStat.jumlahKamus; i++) {
+    if (logKamus[i] == fmt) return i;
+  }
+  if (logStat.jumlahKamus >= LOG_KAMUS_MAX) return -1;
+  if (logStat.jumlahKamus == 0) kirimTagLog();
+  uint16_t id = logStat.jumlahKamus++;
+  logKamus[id] = fmt;
+  uint8_t p[255];
+  size_t n = panjangLog(fmt, sizeof(p) - 2);
+  p[0] = (uint8_t)id;
+  p[1] = (uint8_t)(id >> 8);
+  memcpy(p + 2, fmt, n);
+  kirimFrameLog(LOG_FRAME_KAMUS, p, n + 2);
+  return id;
+}
+
+void keluarkanRecordLog(const uint32_t* w, uint32_t n) {
+  uint8_t level = (w[0] >> 8) & 0xFF;
+  uint8_t tag = (w[0] >> 16) & 0xFF;
+  const char* fmt;
+  memcpy(&fmt, &w[2], sizeof(fmt));
+  const uint8_t* arg = (const uint8_t*)&w[LOG_HEADER_WORDS];
+  size_t argLen = (n - LOG_HEADER_WORDS) * 4;   // padding diabaikan formatLog
+
+  int id = logStat.biner ? idKamusLog(fmt) : -1;
+  if (id < 0) {
+    // Mode teks (atau kamus penuh): format di sini, di luar jalur panas
+    char teks[LOG_TEKS_MAX];
+    size_t len = formatLog(fmt, arg, argLen, teks, sizeof(teks));
+    Serial.print(teks);
+    logStat.bytesUart += len;
+    return;
+  }
+  uint8_t p[8 + LOG_ARG_MAX];
+  uint32_t ms = w[1];
+  p[0] = (uint8_t)id;
+  p[1] = (uint8_t)(id >> 8);
+  p[2] = level;
+  p[3] = tag;
+  memcpy(p + 4, &ms, 4);
+  memcpy(p + 8, arg, argLen);
+  kirimFrameLog(LOG_FRAME_RECORD, p, 8 + argLen);
+}
+
+// Ambil maks `maks` record; aman dipanggil dari mana saja (consumer dikunci)
+uint32_t kurasLog(uint32_t maks) {
+  if (logSibuk.exchange(true, std::memory_order_acquire)) return 0;
+  int mode = logModeDiminta.exchange(-1, std::memory_order_relaxed);
+  if (mode >= 0) {
+    logStat.biner = mode == LOG_MODE_BINER;
+    logStat.jumlahKamus = 0;   // kamus & tag dikirim ulang
+  }
+  uint32_t w[LOG_RECORD_MAX_WORDS];
+  uint32_t jumlah = 0;
+  while (jumlah < maks) {
+    uint32_t n = logRing.ambil(w);
+    if (n == 0) break;
+    keluarkanRecordLog(w, n);
+    jumlah++;
+  }
+  logStat.record += jumlah;
+
+  uint32_t hilang = logRing.jumlahHilang();
+  if (hilang != logStat.hilangDilaporkan) {
+    uint32_t baru = hilang - logStat.hilangDilaporkan;
+    logStat.hilangDilaporkan = hilang;
+    if (logStat.biner) {
+      kirimFrameLog(LOG_FRAME_HILANG, (const uint8_t*)&baru, 4);
+    } else {
+      Serial.printf("⚠ %lu log dibuang (ring penuh)\n", (unsigned long)baru);
+    }
+  }
+  logSibuk.store(false, std::memory_order_release);
+  return jumlah;
+}
+
+// Sebelum ESP.restart(): tunggu ring kosong (maks timeoutMs)
+void flushLog(unsigned long timeoutMs) {
+  unsigned long mulai = millis();
+  while (logRing.terpakai() > 0 && millis() - mulai < timeoutMs) {
+    kurasLog(UINT32_MAX);
+    delay(1);
+  }
+}
+
+void langkahLog() {
+  kurasLog(UINT32_MAX);
+}
+
+void logTask(void* arg) {
+  for (;;) {
+    langkahLog();
+    vTaskDelay(pdMS_TO_TICKS(LOG_POLL_MS));
+  }
+}
+
+// Dipanggil pertama di setup(); record sebelum task jalan tetap di ring
+void initLog() {
+  xTaskCreatePinnedToCore(logTask, "log", 3072, nullptr, 0, &logTaskHandle, LOG_TASK_CORE);
+}
+
 // --------------------------------------------------------------
 // NTP UNTUK SSL - VERSI LEBIH AGRESIF
 // --------------------------------------------------------------
 void initNTP() {
-  Serial.println("\n=== SINKRONISASI WAKTU NTP ===");
+  LOGI(TAG_BOOT, "\n=== SINKRONISASI WAKTU NTP ===\n");
   
   // Coba beberapa NTP server berbeda
   const char* ntpServers[][3] = {
@@ -51,10 +583,8 @@ void initNTP() {
   bool ntpSuccess = false;
   
   for (int serverSet = 0; serverSet < 3 && !ntpSuccess; serverSet++) {
-    Serial.printf("\nMencoba NTP Server Set %d:\n", serverSet + 1);
-    Serial.printf("  - %s\n", ntpServers[serverSet][0]);
-    Serial.printf("  - %s\n", ntpServers[serverSet][1]);
-    Serial.printf("  - %s\n", ntpServers[serverSet][2]);
+    LOGI(TAG_BOOT, "\nMencoba NTP Server Set %d:\n  - %s\n  - %s\n  - %s\n", serverSet + 1,
+         ntpServers[serverSet][0], ntpServers[serverSet][1], ntpServers[serverSet][2]);
     
     // Configure NTP dengan 3 server
     configTime(7 * 3600, 0, 
@@ -62,96 +592,283 @@ void initNTP() {
                ntpServers[serverSet][1], 
                ntpServers[serverSet][2]);
     
-    Serial.print("Menunggu sinkronisasi");
+    LOGI(TAG_BOOT, "Menunggu sinkronisasi");
     
     // Retry lebih lama (30 detik)
     for (int i = 0; i < 60; i++) {
       time_t now = time(nullptr);
       if (now > 100000) {
         ntpSuccess = true;
-        Serial.println(" ✓ BERHASIL!");
-        Serial.print("Waktu saat ini: ");
-        Serial.println(ctime(&now));
+        LOGI(TAG_BOOT, " ✓ BERHASIL!\nWaktu saat ini: %s\n", ctime(&now));
         break;
       }
-      Serial.print(".");
+      LOGI(TAG_BOOT, ".");
       delay(500);
     }
     
     if (ntpSuccess) break;
     
-    Serial.println(" ✗ Gagal, coba server lain...");
+    LOGW(TAG_BOOT, " ✗ Gagal, coba server lain...\n");
     delay(1000);
   }
   
   if (!ntpSuccess) {
-    Serial.println("\n✗✗✗ NTP GAGAL TOTAL! ✗✗✗");
-    Serial.println("Kemungkinan masalah:");
-    Serial.println("1. Firewall memblokir port 123 (NTP)");
-    Serial.println("2. Koneksi internet tidak stabil");
-    Serial.println("3. Router tidak mengizinkan NTP");
-    Serial.println("\nESP32 akan restart dalam 10 detik...");
+    LOGE(TAG_BOOT, "\n✗✗✗ NTP GAGAL TOTAL! ✗✗✗\n"
+                   "Kemungkinan masalah:\n"
+                   "1. Firewall memblokir port 123 (NTP)\n"
+                   "2. Koneksi internet tidak stabil\n"
+                   "3. Router tidak mengizinkan NTP\n"
+                   "\nESP32 akan restart dalam 10 detik...\n");
     delay(10000);
+    flushLog(1000);
     ESP.restart();
   }
   
-  Serial.println("=================================\n");
+  LOGI(TAG_BOOT, "=================================\n\n");
+}
+
+// --------------------------------------------------------------
+// FAST BOOT (cache NVS: BSSID/channel, token, epoch terakhir)
+// --------------------------------------------------------------
+// Restart watchdog tidak perlu mengulang scan WiFi, NTP blocking, dan
+// sign in. Waktu sistem ESP32 tetap berjalan di RTC timer saat software
+// reset, jadi cukup dicek; setelah power-on dipakai epoch terakhir dari
+// NVS (cukup untuk validasi sertifikat TLS) sampai NTP di background
+// selesai. Riwayat hanya dicatat dengan waktu RTC/NTP.
+// --------------------------------------------------------------
+#define FASTBOOT_NAMESPACE "fastboot"
+
+const unsigned long wifiFastConnectTimeout = 4000;   // BSSID/channel cache
+const unsigned long wifiFullConnectTimeout = 20000;  // scan penuh
+const uint32_t tokenMinSisaSec = 300;                // token hampir expired -> sign in
+const unsigned long epochSaveInterval = 3600000UL;   // batasi wear NVS
+
+enum SumberWaktu : uint8_t {
+  WAKTU_KOSONG = 0,
+  WAKTU_PERKIRAAN,   // epoch terakhir dari NVS, bisa tertinggal jam-an
+  WAKTU_RTC,         // waktu sistem bertahan dari software reset
+  WAKTU_NTP
+};
+
+const char* const SUMBER_WAKTU_LABEL[] = { "kosong", "nvs", "rtc", "ntp" };
+
+struct BootTimings {
+  unsigned long wifiMs;
+  unsigned long waktuMs;
+  unsigned long authMs;
+  unsigned long setupMs;
+  unsigned long firstUploadMs;
+  bool wifiCache;
+  bool tokenCache;
+};
+
+Preferences bootPrefs;
+BootTimings bootTimings = {};
+volatile SumberWaktu sumberWaktu = WAKTU_KOSONG;
+volatile bool tokenPerluDisimpan = false;
+unsigned long lastEpochSaveMillis = 0;
+uint32_t bootId = 0;   // penghitung boot di NVS, pembeda seq reading antar boot
+
+uint8_t cachedBssid[6];
+int32_t cachedChannel = 0;
+
+// Dipanggil task SNTP setiap sinkronisasi berhasil
+void waktuSinkronCallback(struct timeval* tv) {
+  sumberWaktu = WAKTU_NTP;
+}
+
+// Token baru (sign in / refresh) disimpan oleh task jaringan, bukan di sini
+void tokenStatusFastBoot(TokenInfo info) {
+  tokenStatusCallback(info);
+  if (info.status == token_status_ready) tokenPerluDisimpan = true;
+}
+
+void bacaCacheBoot() {
+  bootPrefs.begin(FASTBOOT_NAMESPACE, false);
+  bootId = bootPrefs.getUInt("bootId", 0) + 1;
+  bootPrefs.putUInt("bootId", bootId);
+  cachedChannel = 0;
+  if (bootPrefs.getBytes("bssid", cachedBssid, sizeof(cachedBssid)) == sizeof(cachedBssid)) {
+    cachedChannel = bootPrefs.getInt("channel", 0);
+  }
+}
+
+void pulihkanWaktu() {
+  time_t now = time(nullptr);
+  if (now > 100000) {
+    sumberWaktu = WAKTU_RTC;
+    return;
+  }
+
+  uint32_t epoch = bootPrefs.getUInt("epoch", 0);
+  if (epoch > 100000) {
+    struct timeval tv = { (time_t)epoch, 0 };
+    settimeofday(&tv, nullptr);
+    sumberWaktu = WAKTU_PERKIRAAN;
+  }
+}
+
+// WiFi.begin tidak blocking; asosiasi berjalan selagi sensor & flash diinisialisasi
+void mulaiWiFi() {
+  WiFi.mode(WIFI_STA);
+  if (cachedChannel > 0) {
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, cachedChannel, cachedBssid, true);
+    bootTimings.wifiCache = true;
+  } else {
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  }
+}
+
+bool tungguWiFi(unsigned long timeoutMs) {
+  unsigned long start = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - start < timeoutMs) {
+    delay(10);
+  }
+  return WiFi.status() == WL_CONNECTED;
+}
+
+// Cache AP tidak valid (AP pindah channel / diganti): ulangi dengan scan penuh
+bool hubungkanWiFi() {
+  if (bootTimings.wifiCache) {
+    if (tungguWiFi(wifiFastConnectTimeout)) return true;
+    LOGW(TAG_WIFI, "Cache BSSID/channel gagal, scan penuh...\n");
+    bootTimings.wifiCache = false;
+    WiFi.disconnect();
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  }
+  return tungguWiFi(wifiFullConnectTimeout);
+}
+
+void simpanCacheWiFi() {
+  const uint8_t* bssid = WiFi.BSSID();
+  int32_t channel = WiFi.channel();
+  if (bssid == nullptr) return;
+  if (channel == cachedChannel && memcmp(bssid, cachedBssid, sizeof(cachedBssid)) == 0) return;
+
+  memcpy(cachedBssid, bssid, sizeof(cachedBssid));
+  cachedChannel = channel;
+  bootPrefs.putBytes("bssid", cachedBssid, sizeof(cachedBssid));
+  bootPrefs.putInt("channel", cachedChannel);
+}
+
+// SNTP berjalan di background; callback menandai waktu sudah akurat
+void mulaiNTPBackground() {
+  sntp_set_time_sync_notification_cb(waktuSinkronCallback);
+  configTime(7 * 3600, 0, "pool.ntp.org", "time.google.com", "id.pool.ntp.org");
+}
+
+// Dipanggil setelah Firebase.begin(); true jika token NVS masih berlaku
+bool pulihkanToken() {
+  if (sumberWaktu < WAKTU_RTC) return false;  // sisa umur token tidak bisa dihitung
+
+  uint32_t expires = bootPrefs.getUInt("tokExp", 0);
+  uint32_t now = (uint32_t)time(nullptr);
+  if (expires <= now + tokenMinSisaSec) return false;
+
+  String idToken = bootPrefs.getString("idToken");
+  String refreshToken = bootPrefs.getString("refresh");
+  if (idToken.length() == 0) return false;
+
+  Firebase.setIdToken(&config, idToken.c_str(), expires - now, refreshToken.c_str());
+  return true;
+}
+
+void simpanToken() {
+  bootPrefs.putString("idToken", config.signer.tokens.id_token.c_str());
+  bootPrefs.putString("refresh", config.signer.tokens.refresh_token.c_str());
+  bootPrefs.putUInt("tokExp", (uint32_t)config.signer.tokens.expires);
+}
+
+// Dipanggil task jaringan; semua tulis NVS setelah setup() lewat sini
+void rawatCacheBoot(unsigned long now) {
+  simpanCacheWiFi();  // reconnect bisa pindah AP
+
+  if (tokenPerluDisimpan) {
+    tokenPerluDisimpan = false;
+    simpanToken();
+  }
+
+  if (sumberWaktu == WAKTU_NTP &&
+      (lastEpochSaveMillis == 0 || now - lastEpochSaveMillis >= epochSaveInterval)) {
+    lastEpochSaveMillis = now;
+    bootPrefs.putUInt("epoch", (uint32_t)time(nullptr));
+  }
+}
+
+void cetakWaktuBoot() {
+  LOGI(TAG_BOOT, "⏱ Boot: WiFi %lu ms (%s), waktu %lu ms (%s), auth %lu ms (%s), setup %lu ms\n",
+       bootTimings.wifiMs, bootTimings.wifiCache ? "cache" : "scan",
+       bootTimings.waktuMs - bootTimings.wifiMs, SUMBER_WAKTU_LABEL[sumberWaktu],
+       bootTimings.authMs - bootTimings.waktuMs, bootTimings.tokenCache ? "token NVS" : "sign in",
+       bootTimings.setupMs);
 }
 
 // --------------------------------------------------------------
 void setup() {
   Serial.begin(115200);
-  delay(2000);
-  
-  Serial.println("\n\n=== ESP32 FIRESTORE SENSOR ===\n");
+  initLog();
+
+  LOGI(TAG_BOOT, "\n\n=== ESP32 FIRESTORE SENSOR ===\n\n");
+
+  // WiFi & waktu dimulai dulu, berjalan paralel dengan inisialisasi sensor
+  bacaCacheBoot();
+#if TAMBAQ_PERAN != PERAN_LEAF
+  mulaiWiFi();
+  pulihkanWaktu();
+#endif
 
   // Pin ultrasonic
   pinMode(TRIG_PIN, OUTPUT);
   pinMode(ECHO_PIN, INPUT);
+  // Relay ke keadaan aman (mati) sedini mungkin
+  initAktuator();
+  initKalibrasi();
+  initAkuisisi();
 
-  // WiFi dengan retry lebih agresif
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-  Serial.print("Menghubungkan ke WiFi");
-  
-  int wifiRetry = 0;
-  while (WiFi.status() != WL_CONNECTED && wifiRetry < 40) {
-    Serial.print(".");
-    delay(500);
-    wifiRetry++;
-  }
+#if TAMBAQ_PERAN == PERAN_LEAF
+  // Leaf: tanpa asosiasi WiFi, NTP, TLS dan sign in; reading ke gateway
+  initEspNow();
+  bootTimings.setupMs = millis();
+  LOGI(TAG_BOOT, "\n=== SETUP LEAF SELESAI (kolam %u, %lu ms) ===\n\n", (unsigned)KOLAM_ID,
+       bootTimings.setupMs);
+  initPipeline();
+  return;
+#endif
+
+  initRiwayat();
+  initAgregat();
+  initJurnal();
+
+  LOGI(TAG_WIFI, "Menghubungkan ke WiFi...\n");
+  bool wifiOk = hubungkanWiFi();
+  bootTimings.wifiMs = millis();
   
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\n✓ WiFi Terhubung!");
-    Serial.print("SSID: ");
-    Serial.println(WiFi.SSID());
-    Serial.print("IP: ");
-    Serial.println(WiFi.localIP());
-    Serial.print("Gateway: ");
-    Serial.println(WiFi.gatewayIP());
-    Serial.print("DNS: ");
-    Serial.println(WiFi.dnsIP());
-    Serial.print("Signal: ");
-    Serial.print(WiFi.RSSI());
-    Serial.println(" dBm");
+  if (wifiOk) {
+    simpanCacheWiFi();
+    LOGI(TAG_WIFI, "\n✓ WiFi Terhubung!\nSSID: %s\nIP: %s\nGateway: %s\nDNS: %s\nSignal: %d dBm\n",
+         WiFi.SSID().c_str(), WiFi.localIP().toString().c_str(), WiFi.gatewayIP().toString().c_str(),
+         WiFi.dnsIP().toString().c_str(), (int)WiFi.RSSI());
   } else {
-    Serial.println("\n✗ WiFi GAGAL! Restart ESP32...");
+    LOGE(TAG_WIFI, "\n✗ WiFi GAGAL! Restart ESP32...\n");
     delay(5000);
+    flushLog(1000);
     ESP.restart();
   }
 
-  // Tampilkan info koneksi
-  Serial.println("\n=== INFO KONEKSI ===");
-  Serial.println("WiFi terhubung, siap untuk NTP sync");
-
-  // WAJIB: NTP untuk SSL
-  initNTP();
+  // WAJIB: waktu valid untuk SSL. NTP selalu jalan di background;
+  // hanya cold boot tanpa cache yang menunggu sinkronisasi
+  mulaiNTPBackground();
+  if (sumberWaktu == WAKTU_KOSONG) {
+    initNTP();
+    sumberWaktu = WAKTU_NTP;
+  }
+  bootTimings.waktuMs = millis();
 
   // Firebase Config dengan timeout lebih besar
   config.api_key = API_KEY;
   auth.user.email = USER_EMAIL;
   auth.user.password = USER_PASSWORD;
-  config.token_status_callback = tokenStatusCallback;
+  config.token_status_callback = tokenStatusFastBoot;
   
   // Timeout lebih besar untuk koneksi lambat
   config.timeout.serverResponse = 15 * 1000;
@@ -167,183 +884,5595 @@ void setup() {
   fbdo.setBSSLBufferSize(8192, 2048); // 8KB RX, 2KB TX
   fbdo.setResponseSize(4096);
 
-  Serial.println("\n=== FIREBASE AUTHENTICATION ===");
-  Serial.println("Memulai Sign In...");
-  Serial.println("(Proses ini bisa memakan waktu 30-60 detik)");
+  // Koneksi TLS dipertahankan antar upload (lihat KONEKSI HTTPS PERSISTEN)
+  fbdo.keepAlive(TCP_KEEPALIVE_IDLE_SEC, TCP_KEEPALIVE_INTERVAL_SEC, TCP_KEEPALIVE_COUNT);
+
+  LOGI(TAG_CLOUD, "\n=== FIREBASE AUTHENTICATION ===\n");
   
   // Begin Firebase dulu (penting!)
   Firebase.begin(&config, &auth);
   
+  // Warm boot: pakai token tersimpan, sign in hanya jika tidak ada/expired
+  bool authSuccess = pulihkanToken();
+  bootTimings.tokenCache = authSuccess;
+  if (authSuccess) {
+    LOGI(TAG_CLOUD, "✓ Token NVS dipakai ulang\n");
+    firebaseReady = true;
+  } else {
+    LOGI(TAG_CLOUD, "Memulai Sign In...\n(Proses ini bisa memakan waktu 30-60 detik)\n");
+  }
+  
   // Sign in dengan retry
   int authRetry = 0;
-  bool authSuccess = false;
   
   while (authRetry < 3 && !authSuccess) {
-    Serial.printf("\nPercobaan %d/3...\n", authRetry + 1);
+    LOGI(TAG_CLOUD, "\nPercobaan %d/3...\n", authRetry + 1);
     
     // Coba sign in (bukan sign up)
     // Kosongkan parameter ke-3 dan ke-4 untuk existing user
     if (Firebase.signUp(&config, &auth, "", "")) {
-      Serial.println("✓ Authentication BERHASIL!");
+      LOGI(TAG_CLOUD, "✓ Authentication BERHASIL!\n");
       firebaseReady = true;
       authSuccess = true;
     } else {
-      Serial.print("✗ Authentication GAGAL: ");
-      Serial.println(config.signer.signupError.message.c_str());
+      LOGE(TAG_CLOUD, "✗ Authentication GAGAL: %s\n", config.signer.signupError.message.c_str());
       authRetry++;
       
       if (authRetry < 3) {
-        Serial.println("Retry dalam 5 detik...");
+        LOGI(TAG_CLOUD, "Retry dalam 5 detik...\n");
         delay(5000);
       }
     }
   }
   
   if (!authSuccess) {
-    Serial.println("\n✗✗✗ FIREBASE AUTH GAGAL TOTAL! ✗✗✗");
-    Serial.println("\nPastikan di Firebase Console:");
-    Serial.println("1. Authentication > Sign-in method > Email/Password = ENABLED");
-    Serial.println("2. Authentication > Users > User sudah ada:");
-    Serial.println("   Email: esp32@example.com");
-    Serial.println("   Password: password123");
-    Serial.println("3. Project Settings > Web API Key sudah benar");
-    Serial.println("4. Firestore Database sudah dibuat");
-    Serial.println("\nESP32 akan tetap berjalan, coba lagi di loop...");
+    LOGE(TAG_CLOUD, "\n✗✗✗ FIREBASE AUTH GAGAL TOTAL! ✗✗✗\n"
+                    "\nPastikan di Firebase Console:\n"
+                    "1. Authentication > Sign-in method > Email/Password = ENABLED\n"
+                    "2. Authentication > Users > User sudah ada:\n"
+                    "   Email: esp32@example.com\n"
+                    "   Password: password123\n"
+                    "3. Project Settings > Web API Key sudah benar\n"
+                    "4. Firestore Database sudah dibuat\n"
+                    "\nESP32 akan tetap berjalan, coba lagi di loop...\n");
     firebaseReady = false;
   }
   
-  Serial.println("\n=== SETUP SELESAI ===\n");
-  delay(2000);
+  bootTimings.authMs = millis();
+  bootTimings.setupMs = millis();
+  cetakWaktuBoot();
+  LOGI(TAG_BOOT, "\n=== SETUP SELESAI ===\n\n");
+
+#if TAMBAQ_PERAN == PERAN_GATEWAY
+  initEspNow();   // setelah WiFi terhubung: ESP-NOW memakai channel AP
+#endif
+  initPipeline();
 }
 
 // --------------------------------------------------------------
-// BACA SENSOR
+// STATISTIK WINDOW (kernel filter, tanpa API Arduino)
 // --------------------------------------------------------------
+// ADC ESP32 terlalu noisy untuk satu kali baca, jadi setiap kanal
+// dibaca sebagai statistik dari window sampel terakhir.
 // --------------------------------------------------------------
-// BACA SENSOR pH (versi kalibrasi Arduino, disesuaikan ESP32)
-// --------------------------------------------------------------
-float bacaPH() {
-  const int numSamples = 5;     // jumlah sampel
-  float PH4 = 2.850;            // tegangan pada pH 4
-  float PH7 = 3.015;            // tegangan pada pH 7
-  
-  float PH_step = (PH7 - PH4) / 3.0;  //  step per 1 pH
+struct WindowStats {
+  uint16_t n;
+  float mean;
+  float trimmedMean;  // rata-rata setelah buang trimFraction atas & bawah
+  float median;
+  float stddev;       // simpangan baku sampel (n - 1)
+};
+
+// Insertion sort: cukup cepat untuk window <= 64 sampel
+void urutkanSampel(uint16_t* data, int n) {
+  for (int i = 1; i < n; i++) {
+    uint16_t v = data[i];
+    int j = i - 1;
+    while (j >= 0 && data[j] > v) {
+      data[j + 1] = data[j];
+      j--;
+    }
+    data[j + 1] = v;
+  }
+}
+
+// Catatan: data diurutkan in-place
+WindowStats hitungStatistik(uint16_t* data, int n, float trimFraction) {
+  WindowStats st = { 0, 0, 0, 0, 0 };
+  if (n <= 0) return st;
+
+  urutkanSampel(data, n);
+  st.n = n;
+
+  // Welford agar stabil numerik
+  float mean = 0, m2 = 0;
+  for (int i = 0; i < n; i++) {
+    float delta = data[i] - mean;
+    mean += delta / (i + 1);
+    m2 += delta * (data[i] - mean);
+  }
+  st.mean = mean;
+  st.stddev = (n > 1) ? sqrtf(m2 / (n - 1)) : 0;
 
+  st.median = (n % 2) ? data[n / 2] : (data[n / 2 - 1] + data[n / 2]) / 2.0f;
+
+  int k = (int)(n * trimFraction);
+  if (2 * k >= n) k = (n - 1) / 2;
   long sum = 0;
-  for (int i = 0; i < numSamples; i++) {
-    sum += analogRead(PH_PIN);
-    delay(10);
+  for (int i = k; i < n - k; i++) sum += data[i];
+  st.trimmedMean = sum / (float)(n - 2 * k);
+
+  return st;
+}
+
+// Burst echo ultrasonic: percikan di permukaan kolam memantulkan echo
+// palsu, jadi echo yang jauh dari median (> 3 sigma, sigma = 1.4826 x
+// MAD) dibuang dan hasilnya median echo yang tersisa.
+#define ECHO_FILTER_MAKS 16
+#define ECHO_MAD_SKALA_X1000 4448   // 3 x 1.4826
+#define ECHO_MAD_MIN_US 12          // lantai ~2 mm: burst identik (MAD 0) tidak ditolak semua
+
+struct HasilEcho {
+  uint16_t durasiUs;  // 0 = echo yang lolos kurang dari minValid
+  uint8_t valid;
+  uint8_t ditolak;
+};
+
+uint16_t medianTerurut(const uint16_t* data, int n) {
+  return (n % 2) ? data[n / 2] : (uint16_t)((data[n / 2 - 1] + data[n / 2] + 1) / 2);
+}
+
+HasilEcho filterEcho(const uint16_t* durasi, int n, int minValid) {
+  HasilEcho h = { 0, 0, 0 };
+  if (n > ECHO_FILTER_MAKS) n = ECHO_FILTER_MAKS;
+  if (n <= 0) return h;
+
+  uint16_t urut[ECHO_FILTER_MAKS];
+  uint16_t deviasi[ECHO_FILTER_MAKS];
+  memcpy(urut, durasi, n * sizeof(uint16_t));
+  urutkanSampel(urut, n);
+  uint16_t median = medianTerurut(urut, n);
+  for (int i = 0; i < n; i++) deviasi[i] = urut[i] > median ? urut[i] - median : median - urut[i];
+  urutkanSampel(deviasi, n);
+  uint32_t batas = (uint32_t)medianTerurut(deviasi, n) * ECHO_MAD_SKALA_X1000 / 1000;
+  if (batas < ECHO_MAD_MIN_US) batas = ECHO_MAD_MIN_US;
+
+  // urut sudah terurut, jadi inlier tetap terurut saat dipadatkan
+  int valid = 0;
+  for (int i = 0; i < n; i++) {
+    uint32_t d = urut[i] > median ? urut[i] - median : median - urut[i];
+    if (d <= batas) urut[valid++] = urut[i];
+  }
+  h.valid = valid;
+  h.ditolak = n - valid;
+  if (valid >= minValid) h.durasiUs = medianTerurut(urut, valid);
+  return h;
+}
+
+// Akumulator streaming memori tetap (agregat jendela): Welford berbobot
+// (West 1979) + min/maks. Tidak ada buffer sampel, dan tidak ada
+// jumlah kuadrat yang saling menghapus seperti rumus E[x^2] - E[x]^2.
+template<typename T>
+struct Welford {
+  uint32_t n;
+  T bobot;     // total bobot (detik)
+  T mean;
+  T m2;        // jumlah bobot x kuadrat selisih terhadap mean
+  T minimum;
+  T maksimum;
+
+  // w > 0
+  void tambah(T x, T w) {
+    if (n == 0) {
+      minimum = maksimum = x;
+    } else {
+      if (x < minimum) minimum = x;
+      if (x > maksimum) maksimum = x;
+    }
+    n++;
+    bobot += w;
+    T d = x - mean;
+    mean += d * w / bobot;
+    m2 += w * d * (x - mean);
   }
 
-  float adcValue = sum / (float)numSamples;
+  // Varians populasi berbobot
+  T varians() const { return bobot > 0 ? m2 / bobot : 0; }
+  T simpangan() const { return (T)sqrt((double)varians()); }
+};
+
+// --------------------------------------------------------------
+// METRIK HOT-PATH (HISTOGRAM LOG2 PER TAHAP)
+// --------------------------------------------------------------
+// Setiap tahap siklus dicatat ke histogram bucket tetap: bucket b
+// berisi nilai dengan bit tertinggi ke-(b - 1), jadi indeks = 32 - clz
+// (satu instruksi NSAU di Xtensa) dan tidak ada pembagian/float.
+// Tahap CPU diukur dalam siklus (esp_cpu_get_cycle_count), tahap yang
+// menunggu I/O dalam mikrodetik. Setiap histogram hanya ditulis satu
+// task (ADC & echo: task esp_timer, kontrol: task sampling, sisanya:
+// task jaringan), jadi
+// tanpa lock; pembaca boleh melihat snapshot yang selisih satu sampel.
+// Nilai kumulatif sejak boot (tidak di-reset) agar tetap single writer.
+// --------------------------------------------------------------
+#define HIST_BUCKETS 32
+
+enum TahapMetrik : uint8_t {
+  TAHAP_ADC,       // drainAdcDma per tick (siklus)
+  TAHAP_ECHO,      // trigger -> falling edge / timeout (us)
+  TAHAP_PAYLOAD,   // serialisasi body + updateMask (siklus)
+  TAHAP_BARU,      // request yang membuka koneksi baru: TCP + TLS + round trip (us)
+  TAHAP_HTTP,      // request lewat koneksi yang dipakai ulang (us)
+  TAHAP_LOG,       // record LOGx per sampel ke ring (siklus)
+  TAHAP_MQTT,      // publish QoS 1 -> PUBACK (us, ditulis task esp-mqtt)
+  TAHAP_ANTRI,     // capture reading -> mulai kirim (us)
+  TAHAP_E2E,       // capture reading -> ack transport (us, ditulis jalur ack)
+  TAHAP_KONTROL,   // akuisisi selesai -> GPIO relay ditulis (us)
+  NUM_TAHAP
+};
+
+const char* const TAHAP_LABEL[NUM_TAHAP] = {
+  "adc", "echo", "payload", "baru", "http", "log", "mqtt", "antri", "e2e", "kontrol"
+};
+const bool TAHAP_SIKLUS[NUM_TAHAP] = { true, false, true, false, false, true, false, false, false, false };
+
+struct HistogramTahap {
+  uint32_t bucket[HIST_BUCKETS];
+  uint32_t jumlah;
+  uint32_t maks;
+  uint64_t total;
+};
 
-  // ESP32 ADC = 12 bit → 0–4095, tegangan referensi = 3.3V
-  float voltage = (3.3 / 4095.0) * adcValue;
+HistogramTahap histogramTahap[NUM_TAHAP];
 
-  // rumus pH hasil porting
-  float pH = 7.00 + ((voltage - PH7) / PH_step);
+struct MetrikPerangkat {
+  uint32_t heapMin;       // low-water mark heap sejak boot
+  int8_t rssiTerakhir;
+  int8_t rssiMin;
+  int8_t rssiMax;
+  uint32_t rssiSampel;
+};
 
-  return pH;
+MetrikPerangkat metrikPerangkat = { 0, 0, 0, 0, 0 };
+
+inline uint32_t siklusSekarang() {
+  return esp_cpu_get_cycle_count();
 }
 
+inline void IRAM_ATTR catatTahap(TahapMetrik tahap, uint32_t nilai) {
+  HistogramTahap& h = histogramTahap[tahap];
+  uint32_t b = nilai ? 32 - __builtin_clz(nilai) : 0;
+  if (b >= HIST_BUCKETS) b = HIST_BUCKETS - 1;
+  h.bucket[b]++;
+  h.jumlah++;
+  h.total += nilai;
+  if (nilai > h.maks) h.maks = nilai;
+}
 
-float bacaTDS() {
-  int adc = analogRead(TDS_PIN);
-  float volt = adc * (3.3 / 4095.0);
-  float tds = (volt * 133.42 * volt * volt - 255.86 * volt * volt + 857.39 * volt) * 0.5;
-  if (tds < 0) tds = 0;
-  return tds;
+inline void catatSiklus(TahapMetrik tahap, uint32_t mulai) {
+  catatTahap(tahap, siklusSekarang() - mulai);
 }
 
-float bacaTurbidity() {
-  int adc = analogRead(TURBIDITY_PIN);
-  float turb = map(adc, 0, 4095, 100, 0);
-  if (turb < 0) turb = 0;
-  return turb;
+// Batas atas bucket untuk kuantil q (0..1); 0 jika histogram kosong
+uint32_t kuantilHistogram(const HistogramTahap& h, float q) {
+  uint32_t n = h.jumlah;
+  if (n == 0) return 0;
+  uint32_t target = (uint32_t)(q * (n - 1)) + 1;
+  uint32_t kumulatif = 0;
+  for (int b = 0; b < HIST_BUCKETS; b++) {
+    kumulatif += h.bucket[b];
+    if (kumulatif >= target) {
+      uint32_t atas = b == 0 ? 0 : (b >= 32 ? 0xFFFFFFFFUL : (uint32_t)((1ULL << b) - 1));
+      return atas < h.maks ? atas : h.maks;
+    }
+  }
+  return h.maks;
 }
 
-float bacaUltrasonic() {
-  digitalWrite(TRIG_PIN, LOW);
-  delayMicroseconds(2);
-  digitalWrite(TRIG_PIN, HIGH);
-  delayMicroseconds(10);
-  digitalWrite(TRIG_PIN, LOW);
+// Kuantil berdasarkan label tahap (host sim); 0 jika label tidak dikenal
+uint32_t kuantilTahap(const char* label, float q) {
+  for (int t = 0; t < NUM_TAHAP; t++) {
+    if (!strcmp(label, TAHAP_LABEL[t])) return kuantilHistogram(histogramTahap[t], q);
+  }
+  return 0;
+}
 
-  long dur = pulseIn(ECHO_PIN, HIGH, 30000);
-  return dur * 0.034 / 2;
+void catatRssi(int8_t rssi) {
+  MetrikPerangkat& m = metrikPerangkat;
+  if (m.rssiSampel == 0 || rssi < m.rssiMin) m.rssiMin = rssi;
+  if (m.rssiSampel == 0 || rssi > m.rssiMax) m.rssiMax = rssi;
+  m.rssiTerakhir = rssi;
+  m.rssiSampel++;
+}
+
+void perbaruiHeapMin() {
+  metrikPerangkat.heapMin = ESP.getMinFreeHeap();
 }
 
 // --------------------------------------------------------------
-void loop() {
-  // Cek WiFi
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi terputus! Reconnecting...");
-    WiFi.reconnect();
-    delay(5000);
-    return;
+// ADC CONTINUOUS (DMA) -> RING BUFFER PER KANAL
+// --------------------------------------------------------------
+// Driver adc_continuous mengisi DMA dengan PH_PIN, TDS_PIN dan
+// TURBIDITY_PIN bergantian (semua ADC1, aman dipakai bersama WiFi).
+// Setiap ADC_DECIMATION sampel mentah dirata-rata menjadi satu sampel
+// di ring buffer kanal (~100 Hz). Ring ditulis oleh task esp_timer dan
+// dibaca loop() tanpa lock: head hanya bertambah, pembaca cek ulang head
+// setelah menyalin window agar data yang tertimpa tidak dipakai.
+// --------------------------------------------------------------
+#define ADC_SAMPLE_FREQ_HZ 20000    // total semua kanal (minimum ESP32)
+#define ADC_FRAME_BYTES 256
+#define ADC_DECIMATION 64
+#define ADC_RING_SIZE 64            // harus pangkat 2
+#define ADC_WINDOW 32               // sampel per statistik (~0.3 s)
+#define ADC_TRIM_FRACTION 0.2f
+
+enum AdcChannelIndex : uint8_t {
+  ADC_IDX_PH,
+  ADC_IDX_TDS,
+  ADC_IDX_TURBIDITY,
+  ADC_NUM_CHANNELS
+};
+
+struct AdcRing {
+  uint16_t buf[ADC_RING_SIZE];
+  std::atomic<uint32_t> head;  // total sampel yang pernah ditulis
+  uint32_t accSum;             // akumulator decimation (hanya producer)
+  uint16_t accCount;
+};
+
+const uint8_t adcPins[ADC_NUM_CHANNELS] = { PH_PIN, TDS_PIN, TURBIDITY_PIN };
+AdcRing adcRings[ADC_NUM_CHANNELS];
+uint8_t adcChannelToIndex[SOC_ADC_MAX_CHANNEL_NUM];
+adc_continuous_handle_t adcHandle = nullptr;
+volatile uint32_t adcOverflowCount = 0;
+
+void adcRingPush(AdcRing& ring, uint16_t value) {
+  uint32_t h = ring.head.load(std::memory_order_relaxed);
+  ring.buf[h & (ADC_RING_SIZE - 1)] = value;
+  ring.head.store(h + 1, std::memory_order_release);
+}
+
+// Salin maksimal n sampel terbaru; return jumlah sampel valid.
+// Slot indeks head bisa sedang ditulis (buf diisi sebelum head naik),
+// jadi window paling banyak ADC_RING_SIZE - 1 dan selama menyalin
+// penulis hanya boleh maju kurang dari sisa ruang ring.
+int adcRingWindow(const AdcRing& ring, uint16_t* out, int n) {
+  if (n > ADC_RING_SIZE - 1) n = ADC_RING_SIZE - 1;
+  for (int attempt = 0; attempt < 3; attempt++) {
+    uint32_t h = ring.head.load(std::memory_order_acquire);
+    uint32_t count = (h < (uint32_t)n) ? h : n;
+    for (uint32_t i = 0; i < count; i++) {
+      out[i] = ring.buf[(h - count + i) & (ADC_RING_SIZE - 1)];
+    }
+    uint32_t h2 = ring.head.load(std::memory_order_acquire);
+    if (h2 - h < ADC_RING_SIZE - count) return count;
   }
+  return 0;
+}
 
-  // Cek Firebase ready
-  if (!Firebase.ready()) {
-    Serial.println("Firebase belum ready, menunggu...");
-    delay(2000);
-    return;
+// Decimation: rata-rata ADC_DECIMATION sampel mentah -> 1 sampel ring
+void adcPushRaw(uint8_t hwChannel, uint16_t raw) {
+  if (hwChannel >= SOC_ADC_MAX_CHANNEL_NUM) return;
+  uint8_t idx = adcChannelToIndex[hwChannel];
+  if (idx >= ADC_NUM_CHANNELS) return;
+
+  AdcRing& ring = adcRings[idx];
+  ring.accSum += raw;
+  if (++ring.accCount >= ADC_DECIMATION) {
+    adcRingPush(ring, ring.accSum / ring.accCount);
+    ring.accSum = 0;
+    ring.accCount = 0;
   }
+}
+
+bool IRAM_ATTR adcPoolOverflow(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata, void* user) {
+  adcOverflowCount++;
+  return false;
+}
 
-  if (millis() - previousMillis >= uploadInterval) {
-    previousMillis = millis();
+void initAdcDma() {
+  memset(adcChannelToIndex, 0xFF, sizeof(adcChannelToIndex));
 
-    // Baca semua sensor
-    float ph = bacaPH();
-    float tds = bacaTDS();
-    float turb = bacaTurbidity();
-    float jarak = bacaUltrasonic();
+  adc_continuous_handle_cfg_t handleCfg = {};
+  handleCfg.max_store_buf_size = ADC_FRAME_BYTES * 4;
+  handleCfg.conv_frame_size = ADC_FRAME_BYTES;
+  adc_continuous_new_handle(&handleCfg, &adcHandle);
 
-    // Serial output
-    Serial.println("\n========== DATA SENSOR ==========");
-    Serial.printf("pH          : %.2f\n", ph);
-    Serial.printf("TDS         : %.2f ppm\n", tds);
-    Serial.printf("Turbidity   : %.2f NTU\n", turb);
-    Serial.printf("Ultrasonic  : %.2f cm\n", jarak);
-    Serial.printf("Free Heap   : %d bytes\n", ESP.getFreeHeap());
-    Serial.println("=================================\n");
+  adc_digi_pattern_config_t pattern[ADC_NUM_CHANNELS] = {};
+  for (int i = 0; i < ADC_NUM_CHANNELS; i++) {
+    adc_unit_t unit;
+    adc_channel_t channel;
+    adc_continuous_io_to_channel(adcPins[i], &unit, &channel);
+    adcChannelToIndex[channel] = i;
 
-    // Buat JSON untuk Firestore
-    FirebaseJson content;
-    content.set("fields/pHValue/doubleValue", ph);
-    content.set("fields/TDSValue/doubleValue", tds);
-    content.set("fields/turbidityValue/doubleValue", turb);
-    content.set("fields/ultrasonicValue/doubleValue", jarak);
+    pattern[i].atten = ADC_ATTEN_DB_12;
+    pattern[i].channel = channel;
+    pattern[i].unit = unit;
+    pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
 
-    Serial.println("📤 Mengirim ke Firestore...");
+  adc_continuous_config_t digCfg = {};
+  digCfg.sample_freq_hz = ADC_SAMPLE_FREQ_HZ;
+  digCfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digCfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  digCfg.pattern_num = ADC_NUM_CHANNELS;
+  digCfg.adc_pattern = pattern;
+  adc_continuous_config(adcHandle, &digCfg);
 
-    String documentPath = "sensorRead/dataSensor";
-    
-    if (Firebase.Firestore.patchDocument(
-          &fbdo,
-          FIREBASE_PROJECT_ID,
-          "",
-          documentPath.c_str(),
-          content.raw(),
-          "pHValue,TDSValue,turbidityValue,ultrasonicValue"
-        )) {
-      
-      Serial.println("✓✓✓ BERHASIL KIRIM KE FIRESTORE! ✓✓✓");
-      Serial.println("📊 Data yang dikirim:");
-      Serial.printf("   - pHValue: %.2f\n", ph);
-      Serial.printf("   - TDSValue: %.2f PPM\n", tds);
-      Serial.printf("   - turbidityValue: %.2f NTU\n", turb);
-      Serial.printf("   - ultrasonicValue: %.2f cm\n", jarak);
-      Serial.println("⚙  salinitasValue akan di-update oleh Laravel backend");
-      
-    } else {
-      Serial.println("✗✗✗ GAGAL KIRIM! ✗✗✗");
-      Serial.print("Error: ");
-      Serial.println(fbdo.errorReason());
-      Serial.print("HTTP Code: ");
-      Serial.println(fbdo.httpCode());
+  adc_continuous_evt_cbs_t cbs = {};
+  cbs.on_pool_ovf = adcPoolOverflow;
+  adc_continuous_register_event_callbacks(adcHandle, &cbs, nullptr);
+
+  adc_continuous_start(adcHandle);
+}
+
+// Ambil semua frame DMA yang sudah siap (timeout 0, tidak pernah menunggu)
+void drainAdcDma() {
+  uint8_t frame[ADC_FRAME_BYTES];
+  uint32_t got = 0;
+
+  // Batasi jumlah frame per tick agar durasi tick tetap terukur
+  for (int f = 0; f < 4; f++) {
+    if (adc_continuous_read(adcHandle, frame, sizeof(frame), &got, 0) != ESP_OK) break;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+      const adc_digi_output_data_t* p = (const adc_digi_output_data_t*)&frame[i];
+      adcPushRaw(p->type1.channel, p->type1.data);
     }
-    
-    Serial.println("\n⏱ Menunggu " + String(uploadInterval/1000) + " detik...\n");
   }
-}
\ No newline at end of file
+}
+
+bool adcWindowPenuh() {
+  for (int i = 0; i < ADC_NUM_CHANNELS; i++) {
+    if (adcRings[i].head.load(std::memory_order_acquire) < ADC_WINDOW) return false;
+  }
+  return true;
+}
+
+WindowStats statistikKanal(AdcChannelIndex idx) {
+  uint16_t window[ADC_WINDOW];
+  int n = adcRingWindow(adcRings[idx], window, ADC_WINDOW);
+  return hitungStatistik(window, n, ADC_TRIM_FRACTION);
+}
+
+// --------------------------------------------------------------
+// PENJADWAL AKUISISI SENSOR (NON-BLOCKING)
+// --------------------------------------------------------------
+// Setiap sensor adalah state machine kecil yang dimajukan oleh
+// esp_timer periodik (ACQ_TICK_US). Tidak ada delay()/pulseIn():
+// - sensor analog: DMA ADC dikuras tiap tick ke ring buffer
+// - ultrasonic   : burst ping, echo diukur oleh interrupt GPIO,
+//                  digabung dengan filterEcho()
+// loop() hanya memulai siklus dan mengambil hasil yang sudah selesai.
+// --------------------------------------------------------------
+#define ACQ_TICK_US 1000UL          // periode esp_timer (1 ms)
+#define ECHO_TIMEOUT_US 30000UL     // sama dengan timeout pulseIn lama
+#define ULTRASONIC_BURST 5          // ping per pembacaan
+#define ULTRASONIC_JEDA_US 60000UL  // trigger ke trigger, siklus minimum HC-SR04 (gema lama mereda)
+#define ULTRASONIC_MIN_ECHO 3       // echo lolos filter minimal (mayoritas burst)
+
+enum AcqState : uint8_t {
+  ACQ_IDLE,
+  ACQ_WAIT_ECHO,  // ultrasonic: menunggu falling edge dari ISR
+  ACQ_JEDA,       // ultrasonic: menunggu ping berikutnya dalam burst
+  ACQ_DONE
+};
+
+struct UltrasonicTask {
+  AcqState state;
+  unsigned long trigUs;
+  volatile unsigned long echoRiseUs;
+  volatile unsigned long echoFallUs;
+  volatile bool echoDone;
+  uint8_t ping;              // ping ke-n dalam burst
+  uint8_t jumlahEcho;
+  uint16_t echoUs[ULTRASONIC_BURST];
+  long durationUs;           // hasil filter, 0 = timeout (sama seperti pulseIn)
+};
+
+struct SensorSample {
+  float ph;
+  float tds;
+  float turbidity;
+  float jarak;
+};
+
+UltrasonicTask ultrasonicTask = {};
+volatile uint32_t echoTimeoutCount = 0;   // ping tanpa echo
+volatile uint32_t echoOutlierCount = 0;   // echo dibuang filter MAD
+
+esp_timer_handle_t acqTimer = nullptr;
+portMUX_TYPE acqMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool acqRequested = false;
+volatile bool acqComplete = false;
+volatile unsigned long acqSelesaiUs = 0;   // micros() saat acqComplete diset
+volatile unsigned long acqMulaiUs = 0;     // micros() saat mulaiAkuisisi
+
+// Kesehatan penjadwal: jarak antar tick esp_timer dan durasi siklus
+// (mulaiAkuisisi -> acqComplete). Ditulis hanya dari callback timer.
+struct MetrikAkuisisi {
+  uint32_t tick;
+  uint32_t jitterMaksUs;   // |jarak antar tick - ACQ_TICK_US| terbesar
+  uint32_t siklus;         // siklus yang selesai
+  uint32_t siklusMaksUs;
+  unsigned long tickTerakhirUs;
+};
+
+MetrikAkuisisi metrikAkuisisi = {};
+
+void IRAM_ATTR echoISR() {
+  unsigned long t = micros();
+  if (digitalRead(ECHO_PIN) == HIGH) {
+    ultrasonicTask.echoRiseUs = t;
+  } else if (ultrasonicTask.echoRiseUs != 0) {
+    ultrasonicTask.echoFallUs = t;
+    ultrasonicTask.echoDone = true;
+  }
+}
+
+void triggerPing(UltrasonicTask& task, unsigned long nowUs) {
+  task.echoRiseUs = 0;
+  task.echoFallUs = 0;
+  task.echoDone = false;
+
+  // Pulsa trigger 12 us saja, jauh di bawah satu tick
+  digitalWrite(TRIG_PIN, LOW);
+  delayMicroseconds(2);
+  digitalWrite(TRIG_PIN, HIGH);
+  delayMicroseconds(10);
+  digitalWrite(TRIG_PIN, LOW);
+
+  task.trigUs = nowUs;
+  task.state = ACQ_WAIT_ECHO;
+}
+
+void startUltrasonicTask(UltrasonicTask& task, unsigned long nowUs) {
+  task.ping = 0;
+  task.jumlahEcho = 0;
+  task.durationUs = 0;
+  triggerPing(task, nowUs);
+}
+
+void selesaiPing(UltrasonicTask& task) {
+  if (++task.ping < ULTRASONIC_BURST) {
+    task.state = ACQ_JEDA;
+    return;
+  }
+  HasilEcho h = filterEcho(task.echoUs, task.jumlahEcho, ULTRASONIC_MIN_ECHO);
+  echoOutlierCount += h.ditolak;
+  task.durationUs = h.durasiUs;
+  task.state = ACQ_DONE;
+}
+
+void stepUltrasonicTask(UltrasonicTask& task, unsigned long nowUs) {
+  if (task.state == ACQ_JEDA) {
+    if (nowUs - task.trigUs >= ULTRASONIC_JEDA_US) triggerPing(task, nowUs);
+    return;
+  }
+  if (task.state != ACQ_WAIT_ECHO) return;
+
+  if (task.echoDone) {
+    unsigned long durasi = task.echoFallUs - task.echoRiseUs;
+    if (durasi < ECHO_TIMEOUT_US) task.echoUs[task.jumlahEcho++] = (uint16_t)durasi;
+    catatTahap(TAHAP_ECHO, task.echoFallUs - task.trigUs);
+    selesaiPing(task);
+  } else if (nowUs - task.trigUs >= ECHO_TIMEOUT_US) {
+    echoTimeoutCount++;
+    catatTahap(TAHAP_ECHO, nowUs - task.trigUs);
+    selesaiPing(task);
+  }
+}
+
+// Dipanggil dari callback esp_timer (dan dari simulasi host)
+void tickAkuisisi(unsigned long nowUs) {
+  portENTER_CRITICAL(&acqMux);
+  bool start = acqRequested;
+  if (start) {
+    acqRequested = false;
+    acqComplete = false;
+  }
+  portEXIT_CRITICAL(&acqMux);
+
+  if (start) startUltrasonicTask(ultrasonicTask, nowUs);
+
+  stepUltrasonicTask(ultrasonicTask, nowUs);
+
+  if (ultrasonicTask.state == ACQ_DONE && adcWindowPenuh()) {
+    portENTER_CRITICAL(&acqMux);
+    bool selesai = !acqRequested && !acqComplete;
+    if (selesai) {
+      acqComplete = true;
+      acqSelesaiUs = nowUs;
+    }
+    portEXIT_CRITICAL(&acqMux);
+    if (selesai) {
+      uint32_t durasi = nowUs - acqMulaiUs;
+      metrikAkuisisi.siklus++;
+      if (durasi > metrikAkuisisi.siklusMaksUs) metrikAkuisisi.siklusMaksUs = durasi;
+    }
+  }
+}
+
+void catatTickAkuisisi(unsigned long nowUs) {
+  MetrikAkuisisi& m = metrikAkuisisi;
+  if (m.tick++ > 0) {
+    uint32_t jarak = nowUs - m.tickTerakhirUs;
+    uint32_t jitter = jarak > ACQ_TICK_US ? jarak - ACQ_TICK_US : ACQ_TICK_US - jarak;
+    if (jitter > m.jitterMaksUs) m.jitterMaksUs = jitter;
+  }
+  m.tickTerakhirUs = nowUs;
+}
+
+void acqTimerCallback(void* arg) {
+  uint32_t mulai = siklusSekarang();
+  catatTickAkuisisi(micros());
+  drainAdcDma();
+  catatSiklus(TAHAP_ADC, mulai);
+  tickAkuisisi(micros());
+}
+
+void initAkuisisi() {
+  initAdcDma();
+  attachInterrupt(digitalPinToInterrupt(ECHO_PIN), echoISR, CHANGE);
+
+  esp_timer_create_args_t args = {};
+  args.callback = &acqTimerCallback;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "akuisisi";
+  esp_timer_create(&args, &acqTimer);
+  esp_timer_start_periodic(acqTimer, ACQ_TICK_US);
+}
+
+void mulaiAkuisisi() {
+  portENTER_CRITICAL(&acqMux);
+  acqComplete = false;
+  acqRequested = true;
+  acqMulaiUs = micros();
+  portEXIT_CRITICAL(&acqMux);
+}
+
+// Hitungan penjadwal per label (driver sim); 0 jika label tidak dikenal
+uint32_t akuisisiHitungan(const char* nama) {
+  if (!strcmp(nama, "tick")) return metrikAkuisisi.tick;
+  if (!strcmp(nama, "jitterMaks")) return metrikAkuisisi.jitterMaksUs;
+  if (!strcmp(nama, "siklus")) return metrikAkuisisi.siklus;
+  if (!strcmp(nama, "siklusMaks")) return metrikAkuisisi.siklusMaksUs;
+  return 0;
+}
+
+bool akuisisiSelesai() {
+  portENTER_CRITICAL(&acqMux);
+  bool done = acqComplete && !acqRequested;
+  portEXIT_CRITICAL(&acqMux);
+  return done;
+}
+
+// --------------------------------------------------------------
+// SALINITAS PSS-78 ON-DEVICE (lihat ppm_to_ppt.txt)
+// --------------------------------------------------------------
+// TDS (ppm, sudah dikompensasi ke 25 C) -> EC25 = TDS x 2 (DFRobot:
+// TDS = EC x 0.5) -> C(T) = EC25 x (1 + alpha (T - 25)) -> Rt = C(T) /
+// (C(35,15,0) x rt(T)) -> polinom PSS-78 pada sqrt(Rt), tekanan 0
+// (permukaan kolam). Di bawah S = 2 dipakai koreksi Hill et al. (1986)
+// karena kolam air payau/tawar umumnya < 2 PPT.
+// Suku yang hanya bergantung suhu (rt(T), f(T)) dihitung sekali saat
+// suhu berubah; per sampel cukup satu sqrtf + dua Horner orde 5.
+// --------------------------------------------------------------
+#define PSS78_C35_US_CM 42914.0f      // C(35, 15, 0) dalam uS/cm
+#define SALINITAS_EC_PER_TDS 2.0f
+
+const float PSS78_A[6] = { 0.0080f, -0.1692f, 25.3851f, 14.0941f, -7.0261f, 2.7081f };
+const float PSS78_B[6] = { 0.0005f, -0.0056f, -0.0066f, -0.0375f, 0.0636f, -0.0144f };
+const float PSS78_K = 0.0162f;
+
+struct KonteksSalinitas {
+  float skalaRt;   // Rt = TDS x skalaRt
+  float fT;        // (T - 15) / (1 + k (T - 15))
+};
+
+// Hanya ditulis dan dibaca task jaringan (perintah serial ikut task jaringan);
+// task lan menerima salinitas yang sudah jadi lewat SampelLan
+KonteksSalinitas konteksSalinitas;
+
+// Dipanggil saat suhu air atau alpha kompensasi berubah
+void aturKonteksSalinitas(float suhuC, float alpha) {
+  float t = suhuC;
+  float rt = 0.6766097f + t * (2.00564e-2f + t * (1.104259e-4f + t * (-6.9698e-7f + t * 1.0031e-9f)));
+  float dt = t - 15.0f;
+  konteksSalinitas.skalaRt = SALINITAS_EC_PER_TDS * (1.0f + alpha * (t - 25.0f)) / (PSS78_C35_US_CM * rt);
+  konteksSalinitas.fT = dt / (1.0f + PSS78_K * dt);
+}
+
+float hitungSalinitas(float tdsPpm) {
+  float rt = tdsPpm * konteksSalinitas.skalaRt;
+  if (rt <= 0) return 0;
+
+  float x = sqrtf(rt);
+  const float* a = PSS78_A;
+  const float* b = PSS78_B;
+  float sa = a[0] + x * (a[1] + x * (a[2] + x * (a[3] + x * (a[4] + x * a[5]))));
+  float sb = b[0] + x * (b[1] + x * (b[2] + x * (b[3] + x * (b[4] + x * b[5]))));
+  float s = sa + konteksSalinitas.fT * sb;
+
+  if (s < 2.0f) {
+    // Hill et al.: X = 400 Rt, Y = 100 Rt, sqrt(Y) = 10 x
+    float bx = 400.0f * rt;
+    float sy = 10.0f * x;
+    float y = 100.0f * rt;
+    s -= a[0] / (1.0f + 1.5f * bx + bx * bx) +
+         b[0] * konteksSalinitas.fT / (1.0f + sy + y + y * sy);
+  }
+  return s < 0 ? 0 : s;
+}
+
+// --------------------------------------------------------------
+// PROFIL KALIBRASI PROBE (NVS) + KERNEL KONVERSI FIXED-POINT
+// --------------------------------------------------------------
+// Satu profil per probe, disimpan di NVS (namespace "kalibrasi",
+// key "p_<probe>"), jadi ganti probe cukup "kal probe <id>":
+// - pH       : 1-5 titik buffer (volt -> pH), interpolasi linear
+// - TDS      : polinom kubik volt -> ppm x faktor K, kompensasi suhu
+//              pada tegangan (1 + alpha (T - 25)) seperti DFRobot
+// - turbidity: kurva 2-6 titik (ADC -> NTU)
+// Profil (float) hanya dipakai saat membangun LUT. Konversi per sampel
+// memakai KernelLut: tabel integer + interpolasi fixed-point, tanpa
+// float/double. Preset "lama" = rumus kodeesp32.cpp, "baru" = rumus
+// kodeesp32baru.cpp (7 + (2.5 - V) / 0.18).
+// --------------------------------------------------------------
+#define KAL_NAMESPACE "kalibrasi"
+#define KAL_MAGIC 0x314C4154UL   // "TAL1"
+#define KAL_VERSI 1
+#define KAL_MAX_PH_POINTS 5
+#define KAL_MAX_TURB_POINTS 6
+#define KAL_PROBE_ID_LEN 12       // key NVS maks 15 karakter ("p_" + id)
+#define KAL_KEY_LEN (2 + KAL_PROBE_ID_LEN + 1)
+
+#define ADC_Q_BITS 4              // input kernel: ADC 12 bit dalam Q4
+#define ADC_VREF 3.3f
+#define ADC_MAX_CODE 4095.0f
+
+struct TitikKalibrasi {
+  float x;   // volt (pH) atau kode ADC (turbidity)
+  float y;   // pH / NTU
+};
+
+struct ProfilKalibrasi {
+  uint32_t magic;
+  uint16_t versi;
+  char probeId[KAL_PROBE_ID_LEN + 1];
+  uint8_t nPh;
+  TitikKalibrasi ph[KAL_MAX_PH_POINTS];   // urut naik berdasarkan volt
+  float phSlope;                          // V/pH, dipakai jika hanya 1 titik
+  float tdsKoef[4];                       // c0 + c1 V + c2 V^2 + c3 V^3
+  float tdsK;
+  float tdsAlpha;                         // per derajat C
+  uint8_t nTurb;
+  TitikKalibrasi turb[KAL_MAX_TURB_POINTS];  // urut naik berdasarkan ADC
+  uint16_t crc;
+};
+
+// Tabel di titik ADC = i << LOG2_LANGKAH; output integer = nilai x SKALA.
+// Nilai tabel dibatasi +-2^21 agar selisih x pecahan (<= 2^9) muat 32 bit.
+template<int LOG2_LANGKAH, int32_t SKALA>
+struct KernelLut {
+  static const int N = (4096 >> LOG2_LANGKAH) + 1;
+  static const int SHIFT = LOG2_LANGKAH + ADC_Q_BITS;
+  static const int32_t BATAS = 1L << 21;
+  static_assert(SHIFT <= 10, "pecahan interpolasi terlalu lebar untuk int32");
+
+  int32_t tabel[N];
+
+  template<typename F>
+  void bangun(F referensi) {
+    for (int i = 0; i < N; i++) {
+      float v = referensi((float)(i << LOG2_LANGKAH)) * SKALA;
+      if (v > BATAS) v = BATAS;
+      if (v < -BATAS) v = -BATAS;
+      tabel[i] = (int32_t)lroundf(v);
+    }
+  }
+
+  int32_t evaluasi(uint32_t adcQ) const {
+    uint32_t i = adcQ >> SHIFT;
+    if (i >= (uint32_t)(N - 1)) return tabel[N - 1];
+    int32_t frac = (int32_t)(adcQ & ((1UL << SHIFT) - 1));
+    int32_t a = tabel[i];
+    return a + (((tabel[i + 1] - a) * frac) >> SHIFT);
+  }
+};
+
+typedef KernelLut<5, 1000> KernelPH;        // milli-pH, langkah 32 kode
+typedef KernelLut<5, 100> KernelTDS;        // 0.01 ppm
+typedef KernelLut<4, 100> KernelTurbidity;  // 0.01 NTU, langkah 16 (kurva bisa menekuk)
+
+struct KernelSet {
+  KernelPH ph;
+  KernelTDS tds;
+  KernelTurbidity turbidity;
+};
+
+ProfilKalibrasi profilKalibrasi;          // hanya diubah task jaringan
+KernelSet kernelBuffer[2];                // double buffer
+std::atomic<const KernelSet*> kernelAktif(nullptr);
+std::atomic<const KernelSet*> kernelDibaca(nullptr);   // dipakai task sampling, nullptr = tidak ada
+std::atomic<uint32_t> tdsKompensasiQ14(1UL << 14);
+std::atomic<uint32_t> jarakPerUsQ20(18164);   // cm per us echo (pulang-pergi / 2) pada 25 C
+float suhuAirC = 25.0f;                   // belum ada sensor suhu: diset via serial
+
+uint32_t adcKeQ(float adc) {
+  if (adc <= 0) return 0;
+  if (adc >= ADC_MAX_CODE) return (uint32_t)ADC_MAX_CODE << ADC_Q_BITS;
+  return (uint32_t)(adc * (1 << ADC_Q_BITS) + 0.5f);
+}
+
+float adcKeVolt(float adc) {
+  return adc * (ADC_VREF / ADC_MAX_CODE);
+}
+
+// Interpolasi piecewise linear, ekstrapolasi memakai segmen ujung
+float interpolasiTitik(const TitikKalibrasi* t, uint8_t n, float x) {
+  uint8_t i = 1;
+  while (i < n - 1 && x > t[i].x) i++;
+  const TitikKalibrasi& a = t[i - 1];
+  const TitikKalibrasi& b = t[i];
+  if (b.x == a.x) return a.y;
+  return a.y + (x - a.x) * (b.y - a.y) / (b.x - a.x);
+}
+
+// Referensi float (dipakai membangun LUT dan uji host)
+float phReferensi(const ProfilKalibrasi& p, float adc) {
+  float volt = adcKeVolt(adc);
+  if (p.nPh == 1) return p.ph[0].y + (volt - p.ph[0].x) / p.phSlope;
+  return interpolasiTitik(p.ph, p.nPh, volt);
+}
+
+// volt sudah dikompensasi suhu
+float tdsReferensi(const ProfilKalibrasi& p, float volt) {
+  const float* c = p.tdsKoef;
+  float tds = (c[0] + volt * (c[1] + volt * (c[2] + volt * c[3]))) * p.tdsK;
+  return tds < 0 ? 0 : tds;
+}
+
+float turbidityReferensi(const ProfilKalibrasi& p, float adc) {
+  float ntu = interpolasiTitik(p.turb, p.nTurb, adc);
+  return ntu < 0 ? 0 : ntu;
+}
+
+void presetKalibrasi(ProfilKalibrasi& p, bool rumusBaru) {
+  memset(&p, 0, sizeof(p));
+  p.magic = KAL_MAGIC;
+  p.versi = KAL_VERSI;
+  strcpy(p.probeId, "default");
+
+  p.nPh = 2;
+  if (rumusBaru) {
+    p.ph[0] = { 2.50f, 7.0f };
+    p.ph[1] = { 3.04f, 4.0f };
+    p.phSlope = -0.18f;
+  } else {
+    p.ph[0] = { 2.850f, 4.0f };
+    p.ph[1] = { 3.015f, 7.0f };
+    p.phSlope = (3.015f - 2.850f) / 3.0f;
+  }
+
+  p.tdsKoef[0] = 0.0f;
+  p.tdsKoef[1] = 857.39f;
+  p.tdsKoef[2] = -255.86f;
+  p.tdsKoef[3] = 133.42f;
+  p.tdsK = 0.5f;
+  p.tdsAlpha = 0.02f;
+
+  // Sama dengan map(adc, 0, 4095, 100, 0)
+  p.nTurb = 2;
+  p.turb[0] = { 0.0f, 100.0f };
+  p.turb[1] = { ADC_MAX_CODE, 0.0f };
+}
+
+bool profilValid(const ProfilKalibrasi& p) {
+  if (p.magic != KAL_MAGIC || p.versi != KAL_VERSI) return false;
+  if (p.nPh < 1 || p.nPh > KAL_MAX_PH_POINTS) return false;
+  if (p.nTurb < 2 || p.nTurb > KAL_MAX_TURB_POINTS) return false;
+  if (p.nPh == 1 && p.phSlope == 0) return false;
+  if (p.probeId[KAL_PROBE_ID_LEN] != '\0') return false;
+  return crc16((const uint8_t*)&p, offsetof(ProfilKalibrasi, crc)) == p.crc;
+}
+
+// Pembaca tunggal (task sampling) mengumumkan buffer yang dipakainya
+// selama satu konversi. Urutan seq_cst: umumkan lalu baca ulang
+// kernelAktif, jadi penulis yang akan menimpa buffer itu melihat
+// pengumumannya, atau pembaca melihat pointer baru dan pindah.
+const KernelSet* pinjamKernel() {
+  const KernelSet* k = kernelAktif.load(std::memory_order_seq_cst);
+  for (;;) {
+    kernelDibaca.store(k, std::memory_order_seq_cst);
+    const KernelSet* ulang = kernelAktif.load(std::memory_order_seq_cst);
+    if (ulang == k) return k;
+    k = ulang;
+  }
+}
+
+void kembalikanKernel() {
+  kernelDibaca.store(nullptr, std::memory_order_release);
+}
+
+// Bangun LUT ke buffer yang tidak aktif lalu tukar pointer. Buffer itu
+// bisa masih dipinjam task sampling (rebuild kedua berturut-turut
+// menimpa buffer yang baru saja dilepas dari kernelAktif): tunggu
+// konversi selesai dulu, jadi pembaca tidak pernah melihat tabel
+// setengah jadi.
+void bangunKernel() {
+  const KernelSet* lama = kernelAktif.load(std::memory_order_acquire);
+  KernelSet* baru = (lama == &kernelBuffer[0]) ? &kernelBuffer[1] : &kernelBuffer[0];
+  while (kernelDibaca.load(std::memory_order_seq_cst) == baru) vTaskDelay(1);
+  const ProfilKalibrasi& p = profilKalibrasi;
+
+  baru->ph.bangun([&p](float adc) { return phReferensi(p, adc); });
+  baru->tds.bangun([&p](float adc) { return tdsReferensi(p, adcKeVolt(adc)); });
+  baru->turbidity.bangun([&p](float adc) { return turbidityReferensi(p, adc); });
+
+  kernelAktif.store(baru, std::memory_order_release);
+}
+
+void aturSuhuAir(float suhuC) {
+  suhuAirC = suhuC;
+  float koef = 1.0f + profilKalibrasi.tdsAlpha * (suhuC - 25.0f);
+  if (koef < 0.5f) koef = 0.5f;   // faktor Q14 maks 2.0 (adcQ x faktor muat 32 bit)
+  tdsKompensasiQ14.store((uint32_t)lroundf((1UL << 14) / koef), std::memory_order_relaxed);
+  // Kecepatan suara di udara di atas kolam, suhu air dipakai sebagai pendekatan
+  float cmPerUs = (331.3f + 0.606f * suhuC) * 1e-4f / 2;
+  jarakPerUsQ20.store((uint32_t)lroundf(cmPerUs * (1UL << 20)), std::memory_order_relaxed);
+  aturKonteksSalinitas(suhuC, profilKalibrasi.tdsAlpha);
+}
+
+// ID dipotong ke KAL_PROBE_ID_LEN: key tidak pernah melebihi batas NVS
+void keyProfil(char* key, size_t len, const char* probeId) {
+  snprintf(key, len, "p_%.*s", KAL_PROBE_ID_LEN, probeId);
+}
+
+bool muatProfil(const char* probeId, ProfilKalibrasi& p) {
+  char key[KAL_KEY_LEN];
+  keyProfil(key, sizeof(key), probeId);
+  Preferences prefs;
+  prefs.begin(KAL_NAMESPACE, true);
+  size_t n = prefs.getBytes(key, &p, sizeof(p));
+  prefs.end();
+  return n == sizeof(p) && profilValid(p);
+}
+
+bool simpanProfil() {
+  ProfilKalibrasi& p = profilKalibrasi;
+  p.crc = crc16((const uint8_t*)&p, offsetof(ProfilKalibrasi, crc));
+
+  char key[KAL_KEY_LEN];
+  keyProfil(key, sizeof(key), p.probeId);
+  Preferences prefs;
+  prefs.begin(KAL_NAMESPACE, false);
+  bool ok = prefs.putBytes(key, &p, sizeof(p)) == sizeof(p);
+  if (ok) prefs.putString("aktif", p.probeId);
+  prefs.end();
+  return ok;
+}
+
+void initKalibrasi() {
+  Preferences prefs;
+  prefs.begin(KAL_NAMESPACE, true);
+  String aktif = prefs.getString("aktif", "default");
+  prefs.end();
+
+  // Nilai NVS dari luar firmware ini (atau rusak) tidak dipercaya:
+  // ID di luar 1..KAL_PROBE_ID_LEN karakter -> preset
+  bool idValid = aktif.length() > 0 && aktif.length() <= KAL_PROBE_ID_LEN;
+  if (!idValid) {
+    LOGW(TAG_BOOT, "✗ ID profil aktif di NVS tidak valid (%u karakter), pakai preset\n", (unsigned)aktif.length());
+  }
+  if (idValid && muatProfil(aktif.c_str(), profilKalibrasi) && !strcmp(profilKalibrasi.probeId, aktif.c_str())) {
+    LOGI(TAG_BOOT, "✓ Profil kalibrasi '%s' dimuat dari NVS\n", profilKalibrasi.probeId);
+  } else {
+    presetKalibrasi(profilKalibrasi, false);
+  }
+  bangunKernel();
+  aturSuhuAir(suhuAirC);
+}
+
+void cetakProfil() {
+  const ProfilKalibrasi& p = profilKalibrasi;
+  Serial.printf("Probe     : %s\n", p.probeId);
+  for (uint8_t i = 0; i < p.nPh; i++) {
+    Serial.printf("pH  #%u    : %.3f V -> pH %.2f\n", i + 1, p.ph[i].x, p.ph[i].y);
+  }
+  Serial.printf("TDS       : (%.3f + %.3f V + %.3f V^2 + %.3f V^3) x %.3f, alpha %.3f\n",
+                p.tdsKoef[0], p.tdsKoef[1], p.tdsKoef[2], p.tdsKoef[3], p.tdsK, p.tdsAlpha);
+  for (uint8_t i = 0; i < p.nTurb; i++) {
+    Serial.printf("Turb #%u   : ADC %.0f -> %.1f NTU\n", i + 1, p.turb[i].x, p.turb[i].y);
+  }
+  Serial.printf("Suhu air  : %.1f C\n", suhuAirC);
+}
+
+// Sisipkan/ganti titik (y yang sama dianggap titik yang sama), jaga urutan x
+bool tambahTitik(TitikKalibrasi* t, uint8_t& n, uint8_t maks, float x, float y, float toleransiY) {
+  int idx = -1;
+  for (uint8_t i = 0; i < n; i++) {
+    if (fabsf(t[i].y - y) < toleransiY) idx = i;
+  }
+  if (idx < 0) {
+    if (n >= maks) return false;
+    idx = n++;
+  }
+  t[idx].x = x;
+  t[idx].y = y;
+
+  // insertion sort, n kecil
+  for (uint8_t i = 1; i < n; i++) {
+    TitikKalibrasi k = t[i];
+    int j = i - 1;
+    while (j >= 0 && t[j].x > k.x) {
+      t[j + 1] = t[j];
+      j--;
+    }
+    t[j + 1] = k;
+  }
+  return true;
+}
+
+// kal info | ph <buffer> | tds <ppm> | turb <ntu> | preset lama|baru |
+// probe <id> | simpan. Titik diambil dari window ADC saat ini.
+void perintahKalibrasi(const char* args) {
+  char sub[12] = "";
+  char arg[KAL_PROBE_ID_LEN + 4] = "";
+  sscanf(args, "%11s %15s", sub, arg);
+  float nilai = atof(arg);
+  ProfilKalibrasi& p = profilKalibrasi;
+
+  if (!strcmp(sub, "ph") || !strcmp(sub, "tds") || !strcmp(sub, "turb")) {
+    if (!adcWindowPenuh()) {
+      Serial.println("✗ Window ADC belum penuh, coba lagi");
+      return;
+    }
+  }
+
+  if (!strcmp(sub, "ph")) {
+    float volt = adcKeVolt(statistikKanal(ADC_IDX_PH).trimmedMean);
+    if (!tambahTitik(p.ph, p.nPh, KAL_MAX_PH_POINTS, volt, nilai, 0.5f)) {
+      Serial.println("✗ Titik pH penuh");
+      return;
+    }
+    Serial.printf("✓ Titik pH %.2f = %.3f V\n", nilai, volt);
+  } else if (!strcmp(sub, "tds")) {
+    float koef = 1.0f + p.tdsAlpha * (suhuAirC - 25.0f);
+    float volt = adcKeVolt(statistikKanal(ADC_IDX_TDS).trimmedMean) / koef;
+    p.tdsK = 1.0f;
+    float mentah = tdsReferensi(p, volt);
+    if (mentah <= 0 || nilai <= 0) {
+      p.tdsK = 0.5f;
+      Serial.println("✗ Pembacaan TDS nol, cek probe");
+      return;
+    }
+    p.tdsK = nilai / mentah;
+    Serial.printf("✓ Faktor K TDS = %.4f\n", p.tdsK);
+  } else if (!strcmp(sub, "turb")) {
+    float adc = statistikKanal(ADC_IDX_TURBIDITY).median;
+    if (!tambahTitik(p.turb, p.nTurb, KAL_MAX_TURB_POINTS, adc, nilai, 0.5f)) {
+      Serial.println("✗ Titik turbidity penuh");
+      return;
+    }
+    Serial.printf("✓ Titik turbidity %.1f NTU = ADC %.0f\n", nilai, adc);
+  } else if (!strcmp(sub, "preset")) {
+    char id[KAL_PROBE_ID_LEN + 1];
+    strcpy(id, p.probeId);
+    presetKalibrasi(p, !strcmp(arg, "baru"));
+    strcpy(p.probeId, id);
+  } else if (!strcmp(sub, "probe")) {
+    if (arg[0] == '\0' || strlen(arg) > KAL_PROBE_ID_LEN) {
+      Serial.printf("✗ ID probe 1-%d karakter\n", KAL_PROBE_ID_LEN);
+      return;
+    }
+    if (muatProfil(arg, p)) {
+      Serial.printf("✓ Profil '%s' dimuat\n", arg);
+    } else {
+      // Probe baru: mulai dari profil sekarang, simpan dengan "kal simpan"
+      strcpy(p.probeId, arg);
+      Serial.printf("Profil baru '%s' (belum disimpan)\n", arg);
+    }
+  } else if (!strcmp(sub, "simpan")) {
+    Serial.println(simpanProfil() ? "✓ Profil disimpan ke NVS" : "✗ Gagal simpan NVS");
+    return;
+  } else if (strcmp(sub, "info") != 0) {
+    Serial.println("kal info|ph <pH>|tds <ppm>|turb <ntu>|preset lama|baru|probe <id>|simpan");
+    return;
+  }
+
+  if (strcmp(sub, "info") != 0) {
+    bangunKernel();
+    aturSuhuAir(suhuAirC);
+  }
+  cetakProfil();
+}
+
+// --------------------------------------------------------------
+// BACA SENSOR (konversi dari hasil akuisisi terakhir)
+// --------------------------------------------------------------
+// Semua konversi lewat kernel profil kalibrasi aktif
+// --------------------------------------------------------------
+float bacaPH(const KernelSet& k) {
+  // trimmed mean dari window DMA (pengganti 5x analogRead + delay)
+  uint32_t adcQ = adcKeQ(statistikKanal(ADC_IDX_PH).trimmedMean);
+  return k.ph.evaluasi(adcQ) * 0.001f;
+}
+
+float bacaTDS(const KernelSet& k) {
+  uint32_t adcQ = adcKeQ(statistikKanal(ADC_IDX_TDS).trimmedMean);
+  adcQ = (adcQ * tdsKompensasiQ14.load(std::memory_order_relaxed)) >> 14;
+  return k.tds.evaluasi(adcQ) * 0.01f;
+}
+
+float bacaTurbidity(const KernelSet& k) {
+  uint32_t adcQ = adcKeQ(statistikKanal(ADC_IDX_TURBIDITY).median);
+  return k.turbidity.evaluasi(adcQ) * 0.01f;
+}
+
+float bacaUltrasonic() {
+  uint32_t q = jarakPerUsQ20.load(std::memory_order_relaxed);
+  return ultrasonicTask.durationUs * (float)q / (1UL << 20);
+}
+
+SensorSample ambilSampel() {
+  const KernelSet& k = *pinjamKernel();
+  SensorSample s;
+  s.ph = bacaPH(k);
+  s.tds = bacaTDS(k);
+  s.turbidity = bacaTurbidity(k);
+  kembalikanKernel();
+  s.jarak = bacaUltrasonic();
+  return s;
+}
+
+// --------------------------------------------------------------
+// FUZZY MAMDANI ON-DEVICE (port FuzzyMamdaniService.php)
+// --------------------------------------------------------------
+// Fungsi keanggotaan trapesium & 27 rule identik dengan Laravel:
+// fuzzifyPh / fuzzifyTds / fuzzifyTurbidity, rule MIN (AND), lalu
+// defuzzifikasi weighted average seperti calculateScore().
+// Semua tabel constexpr (flash), evaluasi tanpa alokasi heap.
+// --------------------------------------------------------------
+struct Trapezoid {
+  float a, b, c, d;
+  float invRise;  // 1 / (b - a), dihitung saat kompilasi
+  float invFall;  // 1 / (d - c)
+
+  constexpr Trapezoid(float a_, float b_, float c_, float d_)
+    : a(a_), b(b_), c(c_), d(d_),
+      invRise(1.0f / ((b_ - a_) > 0.0001f ? (b_ - a_) : 0.0001f)),
+      invFall(1.0f / ((d_ - c_) > 0.0001f ? (d_ - c_) : 0.0001f)) {}
+};
+
+// Index himpunan: 0 = low/clear, 1 = normal/medium/optimal, 2 = high/turbid
+constexpr Trapezoid PH_MF[3] = {
+  Trapezoid(0.0f, 0.0f, 6.5f, 7.2f),      // low (asam)
+  Trapezoid(7.0f, 7.5f, 8.0f, 8.5f),      // normal
+  Trapezoid(8.2f, 9.0f, 14.0f, 14.0f)     // high (basa)
+};
+constexpr Trapezoid TURBIDITY_MF[3] = {
+  Trapezoid(0.0f, 0.0f, 15.0f, 25.0f),    // clear
+  Trapezoid(20.0f, 25.0f, 35.0f, 45.0f),  // optimal
+  Trapezoid(40.0f, 60.0f, 150.0f, 150.0f) // turbid
+};
+constexpr Trapezoid TDS_MF[3] = {
+  Trapezoid(0.0f, 0.0f, 200.0f, 350.0f),      // low
+  Trapezoid(300.0f, 400.0f, 600.0f, 800.0f),  // medium
+  Trapezoid(700.0f, 1000.0f, 3000.0f, 3000.0f) // high
+};
+
+// Skor konsekuen rule 1-27, urutan sama dengan getRuleBase():
+// [pH][turbidity][TDS]
+constexpr uint8_t RULE_SCORE[3][3][3] = {
+  { { 35, 40, 25 }, { 38, 45, 35 }, { 20, 30, 15 } },  // pH low
+  { { 55, 75, 60 }, { 72, 95, 78 }, { 50, 58, 42 } },  // pH normal
+  { { 40, 52, 38 }, { 48, 68, 55 }, { 32, 40, 18 } }   // pH high
+};
+
+enum KategoriAir : uint8_t {
+  KATEGORI_UNKNOWN,
+  KATEGORI_CRITICAL,
+  KATEGORI_POOR,
+  KATEGORI_FAIR,
+  KATEGORI_GOOD,
+  KATEGORI_EXCELLENT
+};
+
+const char* const KATEGORI_LABEL[] = {
+  "Unknown", "Critical", "Poor", "Fair", "Good", "Excellent"
+};
+
+struct FuzzyResult {
+  float score;             // 0-100, dibulatkan 2 desimal
+  KategoriAir category;
+  uint8_t activeRules;
+  uint8_t dominantRule;    // 1-27, 0 jika tidak ada rule aktif
+  float dominantStrength;
+};
+
+// Sama persis dengan trapezoidMF() di PHP, termasuk kasus shoulder
+inline float trapezoidMF(float x, const Trapezoid& t) {
+  if (t.a == t.b) {
+    if (x <= t.c) return 1.0f;
+    if (x >= t.d) return 0.0f;
+    return (t.d - x) * t.invFall;
+  }
+  if (t.c == t.d) {
+    if (x >= t.b) return 1.0f;
+    if (x <= t.a) return 0.0f;
+    return (x - t.a) * t.invRise;
+  }
+  if (x <= t.a || x >= t.d) return 0.0f;
+  if (x >= t.b && x <= t.c) return 1.0f;
+  if (x < t.b) return (x - t.a) * t.invRise;
+  return (t.d - x) * t.invFall;
+}
+
+KategoriAir kategoriDariSkor(float score) {
+  if (score >= 85) return KATEGORI_EXCELLENT;
+  if (score >= 70) return KATEGORI_GOOD;
+  if (score >= 50) return KATEGORI_FAIR;
+  if (score >= 30) return KATEGORI_POOR;
+  return KATEGORI_CRITICAL;
+}
+
+FuzzyResult evaluasiKualitasAir(float ph, float tds, float turbidity) {
+  float muPh[3], muTurb[3], muTds[3];
+  for (int i = 0; i < 3; i++) {
+    muPh[i] = trapezoidMF(ph, PH_MF[i]);
+    muTurb[i] = trapezoidMF(turbidity, TURBIDITY_MF[i]);
+    muTds[i] = trapezoidMF(tds, TDS_MF[i]);
+  }
+
+  FuzzyResult r = { 0.0f, KATEGORI_UNKNOWN, 0, 0, 0.0f };
+  float weightedSum = 0, totalStrength = 0;
+
+  for (int p = 0; p < 3; p++) {
+    if (muPh[p] <= 0) continue;
+    for (int t = 0; t < 3; t++) {
+      if (muTurb[t] <= 0) continue;
+      for (int d = 0; d < 3; d++) {
+        // MIN operator (AND)
+        float strength = muPh[p];
+        if (muTurb[t] < strength) strength = muTurb[t];
+        if (muTds[d] < strength) strength = muTds[d];
+        if (strength <= 0) continue;
+
+        weightedSum += strength * RULE_SCORE[p][t][d];
+        totalStrength += strength;
+        r.activeRules++;
+
+        // Rule dominan: kekuatan terbesar pertama (sama dengan PHP)
+        if (strength > r.dominantStrength) {
+          r.dominantStrength = strength;
+          r.dominantRule = p * 9 + t * 3 + d + 1;
+        }
+      }
+    }
+  }
+
+  if (r.activeRules == 0 || totalStrength <= 0) return r;
+
+  r.score = roundf(weightedSum / totalStrength * 100.0f) / 100.0f;
+  r.category = kategoriDariSkor(r.score);
+  return r;
+}
+
+// Evaluasi per detik di perangkat. Sapuan input melewati semua cabang
+// trapesium (bahu, lereng naik/turun, nol) seperti grid paritas PHP.
+void benchFuzzy(uint32_t n) {
+  if (n == 0) n = 100000;
+  float skor = 0;
+  uint32_t aktif = 0;
+  uint32_t t0 = siklusSekarang();
+  for (uint32_t i = 0; i < n; i++) {
+    FuzzyResult r = evaluasiKualitasAir(6.0f + (i % 41) * 0.08f, (i % 67) * 25.0f, (i % 31) * 2.5f);
+    skor += r.score;
+    aktif += r.activeRules;
+  }
+  uint32_t siklus = siklusSekarang() - t0;
+  double perEval = (double)siklus / n;
+  Serial.printf("\n=== BENCH FUZZY: %lu evaluasi, tabel %u byte ===\n", (unsigned long)n,
+                (unsigned)(sizeof(PH_MF) + sizeof(TURBIDITY_MF) + sizeof(TDS_MF) + sizeof(RULE_SCORE)));
+  Serial.printf("evaluasiKualitasAir: %.0f siklus/evaluasi, %.0f evaluasi/s @ %lu MHz\n", perEval,
+                getCpuFrequencyMhz() * 1e6 / perEval, (unsigned long)getCpuFrequencyMhz());
+  Serial.printf("Rata-rata          : %.2f rule aktif, skor %.2f\n", (double)aktif / n, skor / n);
+}
+
+void perintahFuzzy(char* args) {
+  while (*args == ' ') args++;
+  if (!strncmp(args, "bench", 5) && (args[5] == ' ' || args[5] == '\0')) {
+    benchFuzzy(strtoul(args + 5, nullptr, 10));
+  } else {
+    Serial.println("fuzzy bench <n>");
+  }
+}
+
+// --------------------------------------------------------------
+// KONEKSI HTTPS PERSISTEN + METRIK KONEKSI BARU
+// --------------------------------------------------------------
+// Semua request Firestore lewat satu fbdo dengan TCP keep-alive, jadi
+// koneksi TLS dipakai ulang antar upload dan koneksi baru hanya dibuka
+// setelah koneksi benar-benar putus (idle ditutup server, socket mati,
+// WiFi reconnect, soft reset). Sebelum request dicek
+// fbdo.httpConnected(): jika socket masih terbuka -> reuse, jika tidak
+// -> request ini membuka koneksi baru. Yang diukur adalah durasi
+// seluruh request (TCP + TLS + round trip), bukan handshake saja.
+// Lingkup: session ticket / session ID TIDAK di-cache. Klien TLS
+// (BearSSL) ada di dalam fbdo dan Firebase-ESP-Client tidak membuka
+// parameter sesinya, jadi sesi tidak bisa disimpan ke RTC/NVS tanpa
+// mengganti klien HTTP library. Setiap koneksi baru = handshake penuh;
+// yang dihemat adalah jumlah koneksi baru (uji "koneksi" di tambaq-uji).
+// --------------------------------------------------------------
+struct MetrikKoneksi {
+  uint32_t baru;             // request yang membuka koneksi baru
+  uint32_t reused;           // request lewat koneksi yang masih terbuka
+  uint32_t baruMsTotal;      // durasi request koneksi baru (ms)
+  uint32_t baruMsMax;
+  uint32_t reusedMsTotal;
+};
+
+MetrikKoneksi metrikKoneksi = {};
+
+struct RequestTimer {
+  bool reused;
+  unsigned long startMs;
+  unsigned long startUs;
+};
+
+RequestTimer mulaiRequest() {
+  RequestTimer t;
+  t.reused = fbdo.httpConnected();
+  t.startMs = millis();
+  t.startUs = micros();
+  return t;
+}
+
+void selesaiRequest(const RequestTimer& t) {
+  uint32_t ms = millis() - t.startMs;
+  catatTahap(t.reused ? TAHAP_HTTP : TAHAP_BARU, micros() - t.startUs);
+  if (t.reused) {
+    metrikKoneksi.reused++;
+    metrikKoneksi.reusedMsTotal += ms;
+  } else {
+    metrikKoneksi.baru++;
+    metrikKoneksi.baruMsTotal += ms;
+    if (ms > metrikKoneksi.baruMsMax) metrikKoneksi.baruMsMax = ms;
+  }
+}
+
+bool kirimPatch(const char* documentPath, const char* body, const char* updateMask) {
+  RequestTimer t = mulaiRequest();
+  bool ok = Firebase.Firestore.patchDocument(&fbdo, FIREBASE_PROJECT_ID, "", documentPath, body, updateMask);
+  selesaiRequest(t);
+  return ok;
+}
+
+// Satu vector write untuk semua commit (riwayat, agregat, jurnal,
+// aktuator, kolam). Hanya task jaringan yang memakai fbdo, jadi cukup
+// satu: kapasitas dipesan sekali, tiap commit mulai dari clear().
+// Terbesar: drain jurnal (JOURNAL_DRAIN_BATCH = 20).
+#define COMMIT_WRITES_MAX 20
+
+std::vector<struct firebase_firestore_document_write_t> writesCommit;
+
+std::vector<struct firebase_firestore_document_write_t>& mulaiCommit() {
+  writesCommit.clear();
+  if (writesCommit.capacity() < COMMIT_WRITES_MAX) writesCommit.reserve(COMMIT_WRITES_MAX);
+  return writesCommit;
+}
+
+bool kirimCommit(std::vector<struct firebase_firestore_document_write_t>& writes) {
+  RequestTimer t = mulaiRequest();
+  bool ok = Firebase.Firestore.commitDocument(&fbdo, FIREBASE_PROJECT_ID, "", writes, "");
+  selesaiRequest(t);
+  // Salinan body/path di tiap elemen dilepas sekarang; kapasitas tetap
+  writes.clear();
+  return ok;
+}
+
+void cetakMetrikKoneksi() {
+  uint32_t avgBaru = metrikKoneksi.baru ? metrikKoneksi.baruMsTotal / metrikKoneksi.baru : 0;
+  uint32_t avgReuse = metrikKoneksi.reused ? metrikKoneksi.reusedMsTotal / metrikKoneksi.reused : 0;
+  Serial.printf("Koneksi     : %lu request koneksi baru (rata2 %lu ms, max %lu ms), %lu reuse (rata2 %lu ms)\n",
+                (unsigned long)metrikKoneksi.baru, (unsigned long)avgBaru,
+                (unsigned long)metrikKoneksi.baruMsMax,
+                (unsigned long)metrikKoneksi.reused, (unsigned long)avgReuse);
+}
+
+// --------------------------------------------------------------
+// KONTROL LAJU ADAPTIF (EWMA + CUSUM)
+// --------------------------------------------------------------
+// Task sampling memperbarui detektor pH, TDS dan turbidity tiap sampel
+// lalu memilih interval sampling berikutnya:
+// - EWMA nilai sebagai acuan (konstanta waktu tetap, tidak tergantung
+//   interval), kemiringan EWMA per menit (jendela 1 menit)
+// - CUSUM dua sisi atas residu x - EWMA, alarm jika > h
+// - tren: perkiraan tiba di band kritis FuzzyMamdaniService.php
+//   kurang dari LAJU_HORIZON_MENIT
+// Alarm/tren -> LAJU_MIN_MS dan deadband upload dipersempit; di band
+// kritis tanpa tren -> maks interval dasar; LAJU_STABIL_SAMPEL sampel
+// tenang -> interval x2 s/d LAJU_MAX_MS. Heartbeat upload ikut interval.
+// Anggaran write harian di KEBIJAKAN UPLOAD.
+// --------------------------------------------------------------
+#define LAJU_MIN_MS 2000UL
+#define LAJU_MAX_MS 40000UL
+#define LAJU_STABIL_SAMPEL 6
+#define LAJU_HEARTBEAT_KALI 30                      // 10 s -> 5 menit (= maxSilenceMs lama)
+#define LAJU_HEARTBEAT_MIN_MS 60000UL
+#define LAJU_HEARTBEAT_MAX_MS (15UL * 60 * 1000)
+#define LAJU_JENDELA_TREN_MS 60000UL
+#define LAJU_HORIZON_MENIT 30.0f
+#define LAJU_TAU_MS 60000.0f                        // konstanta waktu EWMA nilai
+#define LAJU_BETA 0.3f                              // EWMA kemiringan (per jendela)
+#define LAJU_DEADBAND_WASPADA 0.5f                  // skala deadband saat alarm/tren
+
+enum KanalLaju : uint8_t {
+  LAJU_PH,
+  LAJU_TDS,
+  LAJU_TURBIDITY,
+  NUM_KANAL_LAJU
+};
+
+enum StatusLaju : uint8_t {
+  LAJU_TENANG,
+  LAJU_KRITIS,   // di band kritis, tidak bergerak
+  LAJU_TREN,     // menuju band kritis
+  LAJU_ALARM     // CUSUM: perubahan mendadak
+};
+
+const char* const STATUS_LAJU_LABEL[] = { "tenang", "kritis", "tren", "alarm" };
+
+struct ParamLaju {
+  const char* nama;
+  float kritisBawah;   // < batas = kritis
+  float kritisAtas;    // > batas = kritis
+  float cusumK;        // drift yang diabaikan per sampel
+  float cusumH;
+};
+
+// Band kritis sesuai FuzzyMamdaniService.php (turbidity jernih tidak kritis)
+const ParamLaju PARAM_LAJU[NUM_KANAL_LAJU] = {
+  { "pH",        6.5f,   9.0f,   0.05f, 0.5f  },
+  { "TDS",       350.0f, 800.0f, 8.0f,  80.0f },
+  { "turbidity", -1.0f,  45.0f,  1.0f,  12.0f }
+};
+
+struct DetektorKanal {
+  bool siap;
+  float ewma;
+  float kemiringan;      // satuan per menit
+  float cusumAtas;
+  float cusumBawah;
+  float ewmaAcuan;       // awal jendela tren
+  unsigned long acuanMillis;
+  unsigned long sampelMillis;
+  StatusLaju status;
+};
+
+DetektorKanal detektorLaju[NUM_KANAL_LAJU] = {};
+uint8_t lajuStabil = 0;
+std::atomic<uint32_t> lajuIntervalMs(uploadInterval);
+std::atomic<bool> lajuAdaptif(true);
+std::atomic<bool> lajuWaspada(false);       // alarm/tren aktif -> deadband dipersempit
+uint32_t lajuAlarm = 0;                     // jumlah alarm CUSUM + tren
+
+StatusLaju perbaruiDetektor(DetektorKanal& d, const ParamLaju& p, float x, unsigned long nowMs) {
+  if (!d.siap) {
+    d = {};
+    d.siap = true;
+    d.ewma = x;
+    d.ewmaAcuan = x;
+    d.acuanMillis = nowMs;
+    d.sampelMillis = nowMs;
+    return d.status = LAJU_TENANG;
+  }
+
+  float dt = (float)(nowMs - d.sampelMillis);
+  d.sampelMillis = nowMs;
+  float r = x - d.ewma;
+  d.cusumAtas = fmaxf(0.0f, d.cusumAtas + r - p.cusumK);
+  d.cusumBawah = fmaxf(0.0f, d.cusumBawah - r - p.cusumK);
+  d.ewma += r * dt / (LAJU_TAU_MS + dt);
+
+  if (nowMs - d.acuanMillis >= LAJU_JENDELA_TREN_MS) {
+    float menit = (nowMs - d.acuanMillis) / 60000.0f;
+    d.kemiringan += LAJU_BETA * ((d.ewma - d.ewmaAcuan) / menit - d.kemiringan);
+    d.ewmaAcuan = d.ewma;
+    d.acuanMillis = nowMs;
+  }
+
+  if (d.cusumAtas > p.cusumH || d.cusumBawah > p.cusumH) {
+    // Level baru jadi acuan, CUSUM mulai dari nol
+    d.cusumAtas = d.cusumBawah = 0;
+    d.ewma = x;
+    return d.status = LAJU_ALARM;
+  }
+
+  bool kritis = x < p.kritisBawah || x > p.kritisAtas;
+  float jarak = 0;
+  if (d.kemiringan < 0 && x >= p.kritisBawah) jarak = x - p.kritisBawah;
+  if (d.kemiringan > 0 && x <= p.kritisAtas) jarak = p.kritisAtas - x;
+  if (jarak > 0 && jarak < fabsf(d.kemiringan) * LAJU_HORIZON_MENIT) return d.status = LAJU_TREN;
+  return d.status = kritis ? LAJU_KRITIS : LAJU_TENANG;
+}
+
+// Dipanggil task sampling setiap sampel selesai
+void perbaruiLaju(const SensorSample& s, unsigned long nowMs) {
+  const float nilai[NUM_KANAL_LAJU] = { s.ph, s.tds, s.turbidity };
+  StatusLaju maks = LAJU_TENANG;
+  for (int i = 0; i < NUM_KANAL_LAJU; i++) {
+    StatusLaju st = perbaruiDetektor(detektorLaju[i], PARAM_LAJU[i], nilai[i], nowMs);
+    if (st > maks) maks = st;
+  }
+
+  if (!lajuAdaptif.load(std::memory_order_relaxed)) {
+    lajuIntervalMs.store(uploadInterval, std::memory_order_relaxed);
+    lajuWaspada.store(false, std::memory_order_relaxed);
+    return;
+  }
+  lajuWaspada.store(maks >= LAJU_TREN, std::memory_order_relaxed);
+  uint32_t interval = lajuIntervalMs.load(std::memory_order_relaxed);
+  if (maks >= LAJU_TREN) {
+    if (interval > LAJU_MIN_MS) lajuAlarm++;
+    interval = LAJU_MIN_MS;
+    lajuStabil = 0;
+  } else if (++lajuStabil >= LAJU_STABIL_SAMPEL) {
+    lajuStabil = 0;
+    interval = interval * 2 < LAJU_MAX_MS ? interval * 2 : LAJU_MAX_MS;
+  }
+  if (maks == LAJU_KRITIS && interval > (uint32_t)uploadInterval) interval = uploadInterval;
+  lajuIntervalMs.store(interval, std::memory_order_relaxed);
+}
+
+uint32_t intervalSampling() {
+  return lajuIntervalMs.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------
+// KEBIJAKAN UPLOAD (REPORT-BY-EXCEPTION)
+// --------------------------------------------------------------
+// Upload hanya jika ada perubahan berarti, supaya kuota write
+// Firestore (lihat OPTIMIZATION_SUMMARY.md) tidak habis saat kolam stabil:
+// - deadband per field: berubah jika |delta| > max(abs, rel * |terakhir|)
+// - lintas ambang kualitas air (zona berubah) atau kategori fuzzy
+//   berubah -> kirim saat itu juga
+// - heartbeat: semua field dikirim jika diam > heartbeatMs() (ikut
+//   kontrol laju; maxSilenceMs jika laju tetap)
+// - anggaran write: token bucket WRITE_BUDGET_HARIAN/hari, kapasitas
+//   WRITE_BUDGET_BURST; WRITE_BUDGET_CADANGAN token terakhir hanya untuk
+//   lintas ambang. Jendela 24 jam mana pun <= budget + burst.
+// Hanya field yang berubah yang masuk updateMask.
+// --------------------------------------------------------------
+enum UploadField : uint8_t {
+  FIELD_PH,
+  FIELD_TDS,
+  FIELD_TURBIDITY,
+  FIELD_ULTRASONIC,
+  FIELD_SALINITAS,
+  NUM_UPLOAD_FIELDS
+};
+
+struct FieldPolicy {
+  const char* name;          // nama field Firestore
+  float absDeadband;
+  float relDeadband;
+  const float* thresholds;   // batas zona kualitas air (naik)
+  uint8_t numThresholds;
+};
+
+// Batas zona sesuai FuzzyMamdaniService.php
+const float PH_THRESHOLDS[] = { 6.5f, 7.5f, 8.5f, 9.0f };
+const float TDS_THRESHOLDS[] = { 350.0f, 800.0f };
+const float TURBIDITY_THRESHOLDS[] = { 20.0f, 45.0f };
+
+// Nama field Firestore (juga dipakai skema serializer payload)
+constexpr char FS_PH_VALUE[] = "pHValue";
+constexpr char FS_TDS_VALUE[] = "TDSValue";
+constexpr char FS_TURBIDITY_VALUE[] = "turbidityValue";
+constexpr char FS_ULTRASONIC_VALUE[] = "ultrasonicValue";
+constexpr char FS_SALINITAS_VALUE[] = "salinitasValue";
+
+const FieldPolicy fieldPolicies[NUM_UPLOAD_FIELDS] = {
+  { FS_PH_VALUE,         0.05f, 0.0f,  PH_THRESHOLDS,        4 },
+  { FS_TDS_VALUE,        10.0f, 0.02f, TDS_THRESHOLDS,       2 },
+  { FS_TURBIDITY_VALUE,  1.0f,  0.05f, TURBIDITY_THRESHOLDS, 2 },
+  { FS_ULTRASONIC_VALUE, 0.5f,  0.01f, nullptr,              0 },
+  { FS_SALINITAS_VALUE,  0.02f, 0.02f, nullptr,              0 }
+};
+
+const unsigned long maxSilenceMs = 5UL * 60 * 1000;  // heartbeat 5 menit
+
+#define WRITE_BUDGET_HARIAN 1440   // write live/hari (target OPTIMIZATION_SUMMARY.md)
+#define WRITE_BUDGET_BURST 120     // ~2 jam rata-rata
+#define WRITE_BUDGET_CADANGAN 20
+
+unsigned long heartbeatMs() {
+  if (!lajuAdaptif.load(std::memory_order_relaxed)) return maxSilenceMs;
+  unsigned long hb = intervalSampling() * LAJU_HEARTBEAT_KALI;
+  if (hb < LAJU_HEARTBEAT_MIN_MS) hb = LAJU_HEARTBEAT_MIN_MS;
+  if (hb > LAJU_HEARTBEAT_MAX_MS) hb = LAJU_HEARTBEAT_MAX_MS;
+  return hb;
+}
+
+enum UploadReason : uint8_t {
+  UPLOAD_SUPPRESSED,
+  UPLOAD_BUDGET,       // ditahan: token anggaran habis
+  UPLOAD_FIRST,
+  UPLOAD_DEADBAND,
+  UPLOAD_THRESHOLD,
+  UPLOAD_HEARTBEAT
+};
+
+const char* const UPLOAD_REASON_LABEL[] = {
+  "ditahan", "anggaran", "pertama", "deadband", "ambang", "heartbeat"
+};
+
+struct UploadDecision {
+  uint8_t fieldMask;   // bit per UploadField
+  bool includeScore;   // waterQualityScore + waterQualityCategory
+  UploadReason reason;
+};
+
+struct UploadPolicyState {
+  bool hasBaseline;
+  float lastSent[NUM_UPLOAD_FIELDS];
+  uint8_t lastZone[NUM_UPLOAD_FIELDS];
+  KategoriAir lastCategory;
+  unsigned long lastSendMillis;
+  float tokenWrite;
+  unsigned long tokenMillis;
+
+  // Statistik untuk memantau penghematan write
+  uint32_t sentWrites;
+  uint32_t suppressedWrites;
+  uint32_t budgetWrites;     // ditahan karena anggaran
+  uint32_t thresholdWrites;
+  uint32_t heartbeatWrites;
+};
+
+UploadPolicyState uploadPolicy = { false, {}, {}, KATEGORI_UNKNOWN, 0, (float)WRITE_BUDGET_BURST, 0, 0, 0, 0, 0, 0 };
+
+uint8_t zonaNilai(const FieldPolicy& policy, float value) {
+  uint8_t zone = 0;
+  while (zone < policy.numThresholds && value >= policy.thresholds[zone]) zone++;
+  return zone;
+}
+
+// Nilai yang bergetar tepat di ambang tidak dihitung lintas zona berulang kali
+#define ZONA_HISTERESIS 0.2f   // x absDeadband
+
+bool dekatAmbang(const FieldPolicy& policy, float value) {
+  for (uint8_t i = 0; i < policy.numThresholds; i++) {
+    if (fabsf(value - policy.thresholds[i]) < policy.absDeadband * ZONA_HISTERESIS) return true;
+  }
+  return false;
+}
+
+bool lewatDeadband(const FieldPolicy& policy, float last, float value, float skala) {
+  float band = policy.relDeadband * fabsf(last);
+  if (band < policy.absDeadband) band = policy.absDeadband;
+  return fabsf(value - last) > band * skala;
+}
+
+void isiTokenWrite(unsigned long nowMs) {
+  float tambah = (nowMs - uploadPolicy.tokenMillis) * (WRITE_BUDGET_HARIAN / 86400000.0f);
+  uploadPolicy.tokenMillis = nowMs;
+  uploadPolicy.tokenWrite = fminf(uploadPolicy.tokenWrite + tambah, (float)WRITE_BUDGET_BURST);
+}
+
+UploadDecision terapkanAnggaran(UploadDecision d, unsigned long nowMs) {
+  if (d.reason == UPLOAD_SUPPRESSED || d.reason == UPLOAD_FIRST) return d;
+  isiTokenWrite(nowMs);
+  float minimal = (d.reason == UPLOAD_THRESHOLD) ? 1.0f : 1.0f + WRITE_BUDGET_CADANGAN;
+  if (uploadPolicy.tokenWrite >= minimal) return d;
+  UploadDecision ditahan = { 0, false, UPLOAD_BUDGET };
+  return ditahan;
+}
+
+UploadDecision putuskanUploadTanpaAnggaran(const float values[NUM_UPLOAD_FIELDS], KategoriAir category, unsigned long nowMs) {
+  const uint8_t allFields = (1 << NUM_UPLOAD_FIELDS) - 1;
+  UploadDecision d = { 0, false, UPLOAD_SUPPRESSED };
+
+  if (!uploadPolicy.hasBaseline) {
+    d.fieldMask = allFields;
+    d.includeScore = true;
+    d.reason = UPLOAD_FIRST;
+    return d;
+  }
+
+  if (nowMs - uploadPolicy.lastSendMillis >= heartbeatMs()) {
+    d.fieldMask = allFields;
+    d.includeScore = true;
+    d.reason = UPLOAD_HEARTBEAT;
+    return d;
+  }
+
+  bool crossed = (category != uploadPolicy.lastCategory);
+  float skala = lajuWaspada.load(std::memory_order_relaxed) ? LAJU_DEADBAND_WASPADA : 1.0f;
+  for (int i = 0; i < NUM_UPLOAD_FIELDS; i++) {
+    const FieldPolicy& policy = fieldPolicies[i];
+    if (zonaNilai(policy, values[i]) != uploadPolicy.lastZone[i] && !dekatAmbang(policy, values[i])) {
+      d.fieldMask |= (1 << i);
+      crossed = true;
+    } else if (lewatDeadband(policy, uploadPolicy.lastSent[i], values[i], skala)) {
+      d.fieldMask |= (1 << i);
+    }
+  }
+
+  // Skor ikut terkirim bila salah satu input fuzzy berubah
+  const uint8_t fuzzyInputs = (1 << FIELD_PH) | (1 << FIELD_TDS) | (1 << FIELD_TURBIDITY);
+  d.includeScore = crossed || (d.fieldMask & fuzzyInputs);
+
+  if (crossed) d.reason = UPLOAD_THRESHOLD;
+  else if (d.fieldMask) d.reason = UPLOAD_DEADBAND;
+  return d;
+}
+
+UploadDecision putuskanUpload(const float values[NUM_UPLOAD_FIELDS], KategoriAir category, unsigned long nowMs) {
+  return terapkanAnggaran(putuskanUploadTanpaAnggaran(values, category, nowMs), nowMs);
+}
+
+// Baseline hanya diperbarui setelah patch sukses, jadi yang gagal dicoba lagi
+void catatUploadTerkirim(const UploadDecision& d, const float values[NUM_UPLOAD_FIELDS], KategoriAir category, unsigned long nowMs) {
+  for (int i = 0; i < NUM_UPLOAD_FIELDS; i++) {
+    if (!(d.fieldMask & (1 << i))) continue;
+    uploadPolicy.lastSent[i] = values[i];
+    uploadPolicy.lastZone[i] = zonaNilai(fieldPolicies[i], values[i]);
+  }
+  if (d.includeScore) uploadPolicy.lastCategory = category;
+  uploadPolicy.hasBaseline = true;
+  uploadPolicy.lastSendMillis = nowMs;
+  isiTokenWrite(nowMs);
+  uploadPolicy.tokenWrite = fmaxf(0.0f, uploadPolicy.tokenWrite - 1.0f);
+
+  uploadPolicy.sentWrites++;
+  if (d.reason == UPLOAD_THRESHOLD) uploadPolicy.thresholdWrites++;
+  if (d.reason == UPLOAD_HEARTBEAT) uploadPolicy.heartbeatWrites++;
+}
+
+void cetakLaju() {
+  bool adaptif = lajuAdaptif.load(std::memory_order_relaxed);
+  Serial.printf("\n=== LAJU %s: sampling %lu s, heartbeat %lu s, %lu alarm ===\n",
+                adaptif ? "ADAPTIF" : "TETAP", (unsigned long)intervalSampling() / 1000,
+                heartbeatMs() / 1000, (unsigned long)lajuAlarm);
+  // Snapshot dari task sampling, cukup untuk diagnosa
+  for (int i = 0; i < NUM_KANAL_LAJU; i++) {
+    const DetektorKanal& d = detektorLaju[i];
+    Serial.printf("%-10s ewma %8.2f  tren %+7.3f/menit  cusum +%.2f/-%.2f  %s\n", PARAM_LAJU[i].nama,
+                  d.ewma, d.kemiringan, d.cusumAtas, d.cusumBawah, STATUS_LAJU_LABEL[d.status]);
+  }
+  Serial.printf("Anggaran   : %.1f token (%d/hari, burst %d), %lu ditahan\n", uploadPolicy.tokenWrite,
+                WRITE_BUDGET_HARIAN, WRITE_BUDGET_BURST, (unsigned long)uploadPolicy.budgetWrites);
+}
+
+// Dipanggil dari perintah serial (task jaringan)
+void perintahLaju(char* args) {
+  while (*args == ' ') args++;
+  if (!strcmp(args, "tetap")) {
+    lajuAdaptif.store(false, std::memory_order_relaxed);
+  } else if (!strcmp(args, "adaptif")) {
+    lajuAdaptif.store(true, std::memory_order_relaxed);
+  } else if (args[0] != '\0') {
+    Serial.println("laju tetap|adaptif");
+    return;
+  }
+  cetakLaju();
+}
+
+// --------------------------------------------------------------
+// SERIALIZER PAYLOAD FIRESTORE (TANPA HEAP)
+// --------------------------------------------------------------
+// Body REST {"fields":{...}} dan updateMask ditulis langsung ke buffer
+// milik pemanggil. Skema dokumen adalah daftar tipe field (template),
+// jadi nama field & tipe nilai Firestore sudah tetap saat compile:
+// tidak ada FirebaseJson, String, maupun parsing path
+// "fields/x/doubleValue". Bit ke-i pada mask = field ke-i di skema.
+// --------------------------------------------------------------
+#define PAYLOAD_DECIMALS 4   // cukup untuk resolusi sensor
+
+class PayloadWriter {
+public:
+  PayloadWriter(char* buf, size_t cap) : buf_(buf), cap_(cap), len_(0), overflow_(cap == 0) {
+    if (cap_) buf_[0] = '\0';
+  }
+
+  void tulis(const char* s, size_t n) {
+    if (overflow_ || len_ + n >= cap_) {
+      overflow_ = true;
+      return;
+    }
+    memcpy(buf_ + len_, s, n);
+    len_ += n;
+    buf_[len_] = '\0';
+  }
+
+  void tulis(const char* s) { tulis(s, strlen(s)); }
+
+  void tulisChar(char c) { tulis(&c, 1); }
+
+  // String JSON dengan escape
+  void tulisString(const char* s) {
+    tulisChar('"');
+    for (; *s; s++) {
+      char c = *s;
+      if (c == '"' || c == '\\') {
+        tulisChar('\\');
+        tulisChar(c);
+      } else if ((uint8_t)c < 0x20) {
+        char esc[8];
+        snprintf(esc, sizeof(esc), "\\u%04x", (unsigned)c);
+        tulis(esc);
+      } else {
+        tulisChar(c);
+      }
+    }
+    tulisChar('"');
+  }
+
+  // Fixed-point dengan integer, bukan printf %f (dtoa newlib memakai heap).
+  // NaN/Infinity ditulis sebagai string sesuai format JSON Firestore.
+  void tulisDouble(double v) {
+    if (v != v) {
+      tulis("\"NaN\"");
+      return;
+    }
+    if (v > 1e300 || v < -1e300) {
+      tulis(v > 0 ? "\"Infinity\"" : "\"-Infinity\"");
+      return;
+    }
+    if (v >= 1e14 || v <= -1e14) {
+      // Di luar jangkauan fixed-point: notasi eksponen
+      int e = (int)floor(log10(fabs(v)));
+      tulisDouble(v / pow(10.0, e));
+      tulisChar('e');
+      if (e < 0) tulisChar('-');
+      tulisUnsigned((uint64_t)(e < 0 ? -e : e));
+      return;
+    }
+
+    const int64_t skala = 10000;  // 10^PAYLOAD_DECIMALS
+    bool negatif = v < 0;
+    int64_t fixed = (int64_t)((negatif ? -v : v) * skala + 0.5);
+    if (negatif && fixed != 0) tulisChar('-');
+    tulisUnsigned((uint64_t)(fixed / skala));
+
+    int64_t pecahan = fixed % skala;
+    if (pecahan == 0) return;
+    char digit[PAYLOAD_DECIMALS + 1];
+    int n = PAYLOAD_DECIMALS;
+    for (int i = PAYLOAD_DECIMALS - 1; i >= 0; i--) {
+      digit[i] = '0' + (char)(pecahan % 10);
+      pecahan /= 10;
+    }
+    while (n > 0 && digit[n - 1] == '0') n--;  // buang nol di belakang
+    tulisChar('.');
+    tulis(digit, n);
+  }
+
+  void tulisUnsigned(uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do {
+      tmp[sizeof(tmp) - 1 - n++] = '0' + (char)(v % 10);
+      v /= 10;
+    } while (v);
+    tulis(tmp + sizeof(tmp) - n, n);
+  }
+
+  void tulisTimestamp(uint32_t epoch) {
+    char ts[24];
+    time_t t = epoch;
+    struct tm tmUtc;
+    gmtime_r(&t, &tmUtc);
+    strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%SZ", &tmUtc);
+    tulisString(ts);
+  }
+
+  // RFC 3339 dengan milidetik: "...T10:00:00.123Z"
+  void tulisTimestampMs(uint64_t epochMs) {
+    char ts[28];
+    time_t t = (time_t)(epochMs / 1000);
+    struct tm tmUtc;
+    gmtime_r(&t, &tmUtc);
+    size_t n = strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", &tmUtc);
+    uint32_t ms = (uint32_t)(epochMs % 1000);
+    ts[n++] = '.';
+    ts[n++] = '0' + (char)(ms / 100);
+    ts[n++] = '0' + (char)(ms / 10 % 10);
+    ts[n++] = '0' + (char)(ms % 10);
+    ts[n++] = 'Z';
+    ts[n] = '\0';
+    tulisString(ts);
+  }
+
+  bool ok() const { return !overflow_; }
+  size_t length() const { return len_; }
+  const char* c_str() const { return buf_; }
+
+private:
+  char* buf_;
+  size_t cap_;
+  size_t len_;
+  bool overflow_;
+};
+
+// Jenis field: Nama = array char global, R = struct sumber nilai
+template<const char* Nama, typename R, float R::*Anggota>
+struct FieldDouble {
+  static const char* nama() { return Nama; }
+  static void tulisNilai(PayloadWriter& w, const R& r) {
+    w.tulis("{\"doubleValue\":");
+    w.tulisDouble(r.*Anggota);
+    w.tulisChar('}');
+  }
+};
+
+template<const char* Nama, typename R, uint32_t R::*Anggota>
+struct FieldTimestamp {
+  static const char* nama() { return Nama; }
+  static void tulisNilai(PayloadWriter& w, const R& r) {
+    w.tulis("{\"timestampValue\":");
+    w.tulisTimestamp(r.*Anggota);
+    w.tulisChar('}');
+  }
+};
+
+template<const char* Nama, typename R, uint64_t R::*Anggota>
+struct FieldTimestampMs {
+  static const char* nama() { return Nama; }
+  static void tulisNilai(PayloadWriter& w, const R& r) {
+    w.tulis("{\"timestampValue\":");
+    w.tulisTimestampMs(r.*Anggota);
+    w.tulisChar('}');
+  }
+};
+
+template<const char* Nama, typename R, uint8_t R::*Anggota>
+struct FieldKategori {
+  static const char* nama() { return Nama; }
+  static void tulisNilai(PayloadWriter& w, const R& r) {
+    uint8_t c = r.*Anggota;
+    w.tulis("{\"stringValue\":");
+    w.tulisString(KATEGORI_LABEL[c <= KATEGORI_EXCELLENT ? c : (uint8_t)KATEGORI_UNKNOWN]);
+    w.tulisChar('}');
+  }
+};
+
+template<const char* Nama, typename R, const char* Nilai>
+struct FieldKonstan {
+  static const char* nama() { return Nama; }
+  static void tulisNilai(PayloadWriter& w, const R&) {
+    w.tulis("{\"stringValue\":");
+    w.tulisString(Nilai);
+    w.tulisChar('}');
+  }
+};
+
+template<const char* Nama, typename R, const char* R::*Anggota>
+struct FieldTeks {
+  static const char* nama() { return Nama; }
+  static void tulisNilai(PayloadWriter& w, const R& r) {
+    w.tulis("{\"stringValue\":");
+    w.tulisString(r.*Anggota);
+    w.tulisChar('}');
+  }
+};
+
+template<const char* Nama, typename R, uint32_t R::*Anggota>
+struct FieldInteger {
+  static const char* nama() { return Nama; }
+  static void tulisNilai(PayloadWriter& w, const R& r) {
+    w.tulis("{\"integerValue\":\"");
+    w.tulisUnsigned(r.*Anggota);
+    w.tulis("\"}");
+  }
+};
+
+// Map {mean, std, min, max} dari akumulator Welford
+template<const char* Nama, typename R, Welford<float> R::*Anggota>
+struct FieldStatistik {
+  static const char* nama() { return Nama; }
+  static void tulisNilai(PayloadWriter& w, const R& r) {
+    const Welford<float>& s = r.*Anggota;
+    w.tulis("{\"mapValue\":{\"fields\":{\"mean\":{\"doubleValue\":");
+    w.tulisDouble(s.mean);
+    w.tulis("},\"std\":{\"doubleValue\":");
+    w.tulisDouble(s.simpangan());
+    w.tulis("},\"min\":{\"doubleValue\":");
+    w.tulisDouble(s.minimum);
+    w.tulis("},\"max\":{\"doubleValue\":");
+    w.tulisDouble(s.maksimum);
+    w.tulis("}}}}");
+  }
+};
+
+// Rekursi daftar field (C++11, tanpa fold expression)
+template<typename R, typename... Fields>
+struct SchemaFields {
+  static const size_t jumlah = 0;
+  static void tulisFields(PayloadWriter&, const R&, uint32_t, uint32_t, bool&) {}
+  static void tulisMask(PayloadWriter&, uint32_t, uint32_t, bool&) {}
+};
+
+template<typename R, typename F, typename... Rest>
+struct SchemaFields<R, F, Rest...> {
+  static const size_t jumlah = 1 + sizeof...(Rest);
+
+  static void tulisFields(PayloadWriter& w, const R& r, uint32_t mask, uint32_t bit, bool& pertama) {
+    if (mask & bit) {
+      if (!pertama) w.tulisChar(',');
+      pertama = false;
+      w.tulisString(F::nama());
+      w.tulisChar(':');
+      F::tulisNilai(w, r);
+    }
+    SchemaFields<R, Rest...>::tulisFields(w, r, mask, bit << 1, pertama);
+  }
+
+  static void tulisMask(PayloadWriter& w, uint32_t mask, uint32_t bit, bool& pertama) {
+    if (mask & bit) {
+      if (!pertama) w.tulisChar(',');
+      pertama = false;
+      w.tulis(F::nama());
+    }
+    SchemaFields<R, Rest...>::tulisMask(w, mask, bit << 1, pertama);
+  }
+};
+
+template<typename R, typename... Fields>
+struct FirestoreSchema {
+  typedef SchemaFields<R, Fields...> Daftar;
+  static const uint32_t SEMUA = (Daftar::jumlah >= 32) ? 0xFFFFFFFFUL : ((1UL << Daftar::jumlah) - 1);
+  static_assert(Daftar::jumlah <= 32, "mask field hanya 32 bit");
+
+  // Return false jika buffer tidak cukup (isi buffer tidak boleh dikirim)
+  static bool tulisBody(const R& r, uint32_t mask, char* buf, size_t cap) {
+    PayloadWriter w(buf, cap);
+    bool pertama = true;
+    w.tulis("{\"fields\":{");
+    Daftar::tulisFields(w, r, mask, 1, pertama);
+    w.tulis("}}");
+    return w.ok();
+  }
+
+  static bool tulisMask(uint32_t mask, char* buf, size_t cap) {
+    PayloadWriter w(buf, cap);
+    bool pertama = true;
+    Daftar::tulisMask(w, mask, 1, pertama);
+    return w.ok();
+  }
+};
+
+// Dokumen sensorRead/dataSensor. Urutan 4 field pertama = UploadField,
+// jadi UploadDecision.fieldMask bisa dipakai langsung sebagai mask.
+// Field trace (seq .. ackAt) selalu ikut di setiap upload.
+struct DataSensorDoc {
+  float ph;
+  float tds;
+  float turbidity;
+  float jarak;
+  float salinitas;
+  float score;
+  uint8_t category;
+  uint32_t seq;
+  uint32_t bootId;
+  uint64_t capturedAt;   // epoch ms, 0 = waktu belum valid (field tidak dikirim)
+  uint64_t uploadedAt;   // epoch ms saat mulai kirim
+  uint32_t ackSeq;       // reading terakhir yang sudah di-ack transport
+  uint64_t ackAt;        // epoch ms ack tersebut
+};
+
+constexpr char FS_WATER_QUALITY_SCORE[] = "waterQualityScore";
+constexpr char FS_WATER_QUALITY_CATEGORY[] = "waterQualityCategory";
+constexpr char FS_SEQ[] = "seq";
+constexpr char FS_BOOT_ID[] = "bootId";
+constexpr char FS_CAPTURED_AT[] = "capturedAt";
+constexpr char FS_UPLOADED_AT[] = "uploadedAt";
+constexpr char FS_ACK_SEQ[] = "ackSeq";
+constexpr char FS_ACK_AT[] = "ackAt";
+
+typedef FirestoreSchema<DataSensorDoc,
+  FieldDouble<FS_PH_VALUE, DataSensorDoc, &DataSensorDoc::ph>,
+  FieldDouble<FS_TDS_VALUE, DataSensorDoc, &DataSensorDoc::tds>,
+  FieldDouble<FS_TURBIDITY_VALUE, DataSensorDoc, &DataSensorDoc::turbidity>,
+  FieldDouble<FS_ULTRASONIC_VALUE, DataSensorDoc, &DataSensorDoc::jarak>,
+  FieldDouble<FS_SALINITAS_VALUE, DataSensorDoc, &DataSensorDoc::salinitas>,
+  FieldDouble<FS_WATER_QUALITY_SCORE, DataSensorDoc, &DataSensorDoc::score>,
+  FieldKategori<FS_WATER_QUALITY_CATEGORY, DataSensorDoc, &DataSensorDoc::category>,
+  FieldInteger<FS_SEQ, DataSensorDoc, &DataSensorDoc::seq>,
+  FieldInteger<FS_BOOT_ID, DataSensorDoc, &DataSensorDoc::bootId>,
+  FieldTimestampMs<FS_CAPTURED_AT, DataSensorDoc, &DataSensorDoc::capturedAt>,
+  FieldTimestampMs<FS_UPLOADED_AT, DataSensorDoc, &DataSensorDoc::uploadedAt>,
+  FieldInteger<FS_ACK_SEQ, DataSensorDoc, &DataSensorDoc::ackSeq>,
+  FieldTimestampMs<FS_ACK_AT, DataSensorDoc, &DataSensorDoc::ackAt>
+> DataSensorSchema;
+
+const uint32_t DATA_SENSOR_SCORE_MASK = (1UL << NUM_UPLOAD_FIELDS) | (1UL << (NUM_UPLOAD_FIELDS + 1));
+
+// Bit field trace (indeks 7..12 di DataSensorSchema)
+enum FieldTrace : uint8_t {
+  FIELD_SEQ = 7,
+  FIELD_BOOT_ID,
+  FIELD_CAPTURED_AT,
+  FIELD_UPLOADED_AT,
+  FIELD_ACK_SEQ,
+  FIELD_ACK_AT
+};
+
+static_assert(DataSensorSchema::Daftar::jumlah == FIELD_ACK_AT + 1, "field trace di akhir DataSensorSchema");
+
+// Timestamp 0 (waktu belum valid) dan ack yang belum ada tidak dikirim
+uint32_t maskTrace(const DataSensorDoc& doc) {
+  uint32_t mask = (1UL << FIELD_SEQ) | (1UL << FIELD_BOOT_ID);
+  if (doc.capturedAt) mask |= 1UL << FIELD_CAPTURED_AT;
+  if (doc.uploadedAt) mask |= 1UL << FIELD_UPLOADED_AT;
+  if (doc.ackSeq) mask |= 1UL << FIELD_ACK_SEQ;
+  if (doc.ackAt) mask |= 1UL << FIELD_ACK_AT;
+  return mask;
+}
+
+#define DATA_SENSOR_BODY_SIZE 704
+#define DATA_SENSOR_MASK_SIZE 192
+
+// --------------------------------------------------------------
+// TRACE READING (SEQ, WAKTU CAPTURE & AKUNTANSI LOSS)
+// --------------------------------------------------------------
+// Setiap reading diberi seq monoton per boot (pasangan bootId + seq
+// unik) dan waktu capture: micros() untuk histogram di device, epoch ms
+// (hanya jika waktu RTC/NTP) untuk backend. Trace ikut ReadingItem
+// sampai upload. Dokumen dataSensor membawa capturedAt, uploadedAt dan
+// ack terakhir, jadi backend bisa memisahkan latensi sensor -> cloud
+// dari pemrosesan Laravel, dan gap/duplikat seq terlihat. Setiap
+// reading berakhir di tepat satu hasil:
+//   dibaca = antrianPenuh + ditahan + anggaran + tidakSiap + gagal
+//            + terkirim + isi readingQueue
+// ack dihitung terpisah (REST: respons 200, MQTT: PUBACK).
+// --------------------------------------------------------------
+struct TraceReading {
+  uint32_t seq;
+  uint32_t captureUs;
+  uint64_t captureEpochMs;   // 0 = waktu belum valid
+};
+
+enum HasilTrace : uint8_t {
+  TRACE_DIBACA,
+  TRACE_ANTRIAN_PENUH,   // dibuang di readingQueue (task sampling)
+  TRACE_DITAHAN,         // report-by-exception
+  TRACE_ANGGARAN,        // token anggaran write habis
+  TRACE_TIDAK_SIAP,      // WiFi/transport belum siap, hanya riwayat/jurnal
+  TRACE_GAGAL,           // kirim gagal -> jurnal
+  TRACE_TERKIRIM,        // REST 200 / masuk outbox MQTT
+  TRACE_ACK,             // REST 200 / PUBACK
+  NUM_HASIL_TRACE
+};
+
+const char* const HASIL_TRACE_LABEL[NUM_HASIL_TRACE] = {
+  "dibaca", "antrianPenuh", "ditahan", "anggaran", "tidakSiap", "gagal", "terkirim", "ack"
+};
+
+struct AckTerakhir {
+  uint32_t seq;
+  uint64_t epochMs;
+};
+
+// Ditulis task sampling, task jaringan dan task esp-mqtt
+std::atomic<uint32_t> hitunganTrace[NUM_HASIL_TRACE];
+uint32_t seqReading = 0;         // ditulis task sampling
+AckTerakhir ackTerakhir = {};
+portMUX_TYPE traceMux = portMUX_INITIALIZER_UNLOCKED;
+
+inline void catatHasil(HasilTrace h) {
+  hitunganTrace[h].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t epochMsSekarang() {
+  if (sumberWaktu < WAKTU_RTC) return 0;
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// Dipanggil task sampling saat reading selesai diakuisisi
+TraceReading mulaiTrace() {
+  TraceReading t = { ++seqReading, (uint32_t)micros(), epochMsSekarang() };
+  catatHasil(TRACE_DIBACA);
+  return t;
+}
+
+// Jalur ack transport aktif (REST: task jaringan, MQTT: task esp-mqtt)
+void catatAck(uint32_t seq, uint32_t captureUs) {
+  catatTahap(TAHAP_E2E, micros() - captureUs);
+  catatHasil(TRACE_ACK);
+  uint64_t ms = epochMsSekarang();
+  portENTER_CRITICAL(&traceMux);
+  if (seq > ackTerakhir.seq) {
+    ackTerakhir.seq = seq;
+    ackTerakhir.epochMs = ms;
+  }
+  portEXIT_CRITICAL(&traceMux);
+}
+
+void isiTraceDoc(DataSensorDoc& doc, const TraceReading& t) {
+  doc.seq = t.seq;
+  doc.bootId = bootId;
+  doc.capturedAt = t.captureEpochMs;
+  doc.uploadedAt = epochMsSekarang();
+  portENTER_CRITICAL(&traceMux);
+  doc.ackSeq = ackTerakhir.seq;
+  doc.ackAt = ackTerakhir.epochMs;
+  portEXIT_CRITICAL(&traceMux);
+}
+
+// --------------------------------------------------------------
+// TRANSPORT TELEMETRI (REST FIRESTORE / MQTT + CBOR)
+// --------------------------------------------------------------
+// Upload pembacaan live lewat tabel fungsi transportAktif. Default REST
+// (patchDocument, sama seperti sebelumnya). Alternatif MQTT: payload
+// CBOR skema tetap, QoS 1, sesi persisten (clean session = 0) sehingga
+// broker menyimpan pesan yang belum di-ack saat koneksi putus. Riwayat,
+// jurnal dan deviceMetrics tetap lewat Firestore REST.
+// Pilih saat runtime dengan perintah serial "transport rest|mqtt".
+// --------------------------------------------------------------
+#define TRANSPORT_MQTT_ENABLED 1
+#define TRANSPORT_DEFAULT_MQTT 0   // 1 = MQTT aktif sejak boot
+
+struct TransportTelemetri {
+  const char* nama;
+  void (*mulai)();
+  bool (*siap)();
+  bool (*kirimSampel)(const DataSensorDoc& doc, uint32_t mask, const TraceReading& trace);
+};
+
+void mulaiRest() {}
+
+bool restSiap() {
+  return Firebase.ready();
+}
+
+bool kirimSampelRest(const DataSensorDoc& doc, uint32_t mask, const TraceReading& trace) {
+  // Body JSON + updateMask hanya untuk field yang berubah
+  char body[DATA_SENSOR_BODY_SIZE];
+  char updateMask[DATA_SENSOR_MASK_SIZE];
+  uint32_t mulaiPayload = siklusSekarang();
+  bool payloadOk = DataSensorSchema::tulisBody(doc, mask, body, sizeof(body)) &&
+                   DataSensorSchema::tulisMask(mask, updateMask, sizeof(updateMask));
+  catatSiklus(TAHAP_PAYLOAD, mulaiPayload);
+  if (!payloadOk) {
+    LOGE(TAG_CLOUD, "✗ Buffer payload tidak cukup!\n");
+    return false;
+  }
+
+  if (!kirimPatch("sensorRead/dataSensor", body, updateMask)) {
+    LOGE(TAG_CLOUD, "✗✗✗ GAGAL KIRIM! ✗✗✗\nError: %s\nHTTP Code: %d\n",
+         fbdo.errorReason().c_str(), (int)fbdo.httpCode());
+    return false;
+  }
+  catatAck(trace.seq, trace.captureUs);
+  LOGI(TAG_CLOUD, "✓✓✓ BERHASIL KIRIM KE FIRESTORE! ✓✓✓\n📊 Field yang dikirim: %s\n", updateMask);
+  return true;
+}
+
+const TransportTelemetri TRANSPORT_REST = { "rest", mulaiRest, restSiap, kirimSampelRest };
+
+#if TRANSPORT_MQTT_ENABLED
+#ifndef MQTT_BROKER_URI
+#define MQTT_BROKER_URI "mqtts://YOUR_MQTT_BROKER:8883"
+#endif
+#define MQTT_USERNAME "YOUR_MQTT_USERNAME"
+#define MQTT_PASSWORD "YOUR_MQTT_PASSWORD"
+#define MQTT_CLIENT_ID "tambaq-esp32"
+#define MQTT_TOPIC_SENSOR "tambaq/esp32/sensor"
+#define MQTT_KEEPALIVE_SEC 60
+#define MQTT_PAYLOAD_SIZE 112
+#define MQTT_PENDING 16              // slot latensi PUBACK; lebih dari ini -> yang tertua tergusur
+
+// Payload CBOR: map {kunci: nilai}, kunci = indeks field di
+// DataSensorSchema (0 pH .. 5 skor: float32, 6 kategori: uint, 7..12
+// trace: uint, timestamp dalam epoch ms), jadi mask report-by-exception
+// dipakai apa adanya. Kunci 16 = epoch (uint), hanya jika waktu sudah
+// akurat. Semua field: 95 byte.
+#define CBOR_KEY_EPOCH 16
+#define CBOR_JUMLAH_FLOAT 6
+
+class CborWriter {
+public:
+  CborWriter(uint8_t* buf, size_t cap) : buf_(buf), cap_(cap), len_(0), overflow_(false) {}
+
+  void kepala(uint8_t major, uint64_t v) {
+    uint8_t m = major << 5;
+    if (v < 24) {
+      byte(m | v);
+    } else if (v <= 0xFF) {
+      byte(m | 24);
+      byte(v);
+    } else if (v <= 0xFFFF) {
+      byte(m | 25);
+      byte(v >> 8);
+      byte(v);
+    } else if (v <= 0xFFFFFFFFULL) {
+      byte(m | 26);
+      for (int s = 24; s >= 0; s -= 8) byte(v >> s);
+    } else {
+      byte(m | 27);
+      for (int s = 56; s >= 0; s -= 8) byte(v >> s);
+    }
+  }
+
+  void tulisMap(uint32_t n) { kepala(5, n); }
+  void tulisUint(uint64_t v) { kepala(0, v); }
+
+  void tulisFloat(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    byte(0xFA);
+    for (int s = 24; s >= 0; s -= 8) byte(bits >> s);
+  }
+
+  bool ok() const { return !overflow_; }
+  size_t length() const { return len_; }
+
+private:
+  void byte(uint64_t b) {
+    if (len_ >= cap_) {
+      overflow_ = true;
+      return;
+    }
+    buf_[len_++] = (uint8_t)b;
+  }
+
+  uint8_t* buf_;
+  size_t cap_;
+  size_t len_;
+  bool overflow_;
+};
+
+// Return panjang payload, 0 jika buffer tidak cukup
+size_t tulisCborSampel(const DataSensorDoc& doc, uint32_t mask, uint32_t epoch, uint8_t* buf, size_t cap) {
+  const float nilai[CBOR_JUMLAH_FLOAT] = { doc.ph, doc.tds, doc.turbidity, doc.jarak, doc.salinitas, doc.score };
+  const uint64_t bulat[] = { doc.category, doc.seq, doc.bootId, doc.capturedAt,
+                             doc.uploadedAt, doc.ackSeq, doc.ackAt };
+  static_assert(CBOR_JUMLAH_FLOAT + sizeof(bulat) / sizeof(bulat[0]) == DataSensorSchema::Daftar::jumlah,
+                "setiap field DataSensorSchema punya nilai CBOR");
+  mask &= DataSensorSchema::SEMUA;
+
+  CborWriter w(buf, cap);
+  w.tulisMap(__builtin_popcount(mask) + (epoch ? 1 : 0));
+  for (int i = 0; i < (int)DataSensorSchema::Daftar::jumlah; i++) {
+    if (!(mask & (1UL << i))) continue;
+    w.tulisUint(i);
+    if (i < CBOR_JUMLAH_FLOAT) {
+      w.tulisFloat(nilai[i]);
+    } else {
+      w.tulisUint(bulat[i - CBOR_JUMLAH_FLOAT]);
+    }
+  }
+  if (epoch) {
+    w.tulisUint(CBOR_KEY_EPOCH);
+    w.tulisUint(epoch);
+  }
+  return w.ok() ? w.length() : 0;
+}
+
+struct MetrikMqtt {
+  uint32_t terkirim;      // masuk outbox esp-mqtt
+  uint32_t ack;           // PUBACK untuk publish yang masih punya slot pending
+  uint32_t tergusur;      // slot pending diambil publish baru sebelum PUBACK
+  uint32_t ackTanpaSlot;  // PUBACK untuk publish yang slotnya sudah tergusur
+  uint32_t gagal;         // outbox penuh / belum terhubung
+  uint32_t koneksi;
+  uint32_t sesiLanjut;    // CONNACK session present (broker menyimpan sesi)
+  uint32_t bytesPayload;
+};
+
+struct PendingMqtt {
+  int msgId;              // -1 = slot kosong
+  uint32_t urutan;        // urutan publish, untuk memilih slot tertua
+  uint32_t mulaiUs;
+  uint32_t seq;
+  uint32_t captureUs;
+};
+
+esp_mqtt_client_handle_t mqttClient = nullptr;
+volatile bool mqttTerhubung = false;
+MetrikMqtt mqttMetrik = {};
+PendingMqtt mqttPending[MQTT_PENDING];   // msgId -> waktu publish, untuk latensi PUBACK
+uint32_t mqttPendingUrutan = 0;
+portMUX_TYPE mqttMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Outbox esp-mqtt bisa menampung lebih banyak publish daripada slot
+// (mis. saat broker putus). Slot kosong dipakai dulu; jika penuh, slot
+// tertua diambil dan dihitung tergusur, sehingga terkirim = ack +
+// tergusur + masih pending, dan PUBACK tanpa slot tidak dihitung ack.
+void catatPendingMqtt(int msgId, uint32_t mulaiUs, const TraceReading& trace) {
+  portENTER_CRITICAL(&mqttMux);
+  int pilih = -1;
+  for (int i = 0; i < MQTT_PENDING; i++) {
+    if (mqttPending[i].msgId < 0) {
+      pilih = i;
+      break;
+    }
+    if (pilih < 0 || (int32_t)(mqttPending[i].urutan - mqttPending[pilih].urutan) < 0) pilih = i;
+  }
+  if (mqttPending[pilih].msgId >= 0) mqttMetrik.tergusur++;
+  mqttPending[pilih].msgId = msgId;
+  mqttPending[pilih].urutan = mqttPendingUrutan++;
+  mqttPending[pilih].mulaiUs = mulaiUs ? mulaiUs : 1;
+  mqttPending[pilih].seq = trace.seq;
+  mqttPending[pilih].captureUs = trace.captureUs;
+  portEXIT_CRITICAL(&mqttMux);
+}
+
+// Return false jika msgId tidak punya slot (sudah tergusur / transport diganti)
+bool ambilPendingMqtt(int msgId, PendingMqtt& out) {
+  bool ada = false;
+  portENTER_CRITICAL(&mqttMux);
+  for (int i = 0; i < MQTT_PENDING; i++) {
+    if (mqttPending[i].msgId == msgId) {
+      out = mqttPending[i];
+      mqttPending[i].msgId = -1;
+      ada = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&mqttMux);
+  return ada;
+}
+
+void kosongkanPendingMqtt() {
+  portENTER_CRITICAL(&mqttMux);
+  for (int i = 0; i < MQTT_PENDING; i++) mqttPending[i].msgId = -1;
+  portEXIT_CRITICAL(&mqttMux);
+}
+
+// Dipanggil task esp-mqtt (satu-satunya penulis TAHAP_MQTT)
+void mqttEvent(void* arg, esp_event_base_t base, int32_t eventId, void* data) {
+  esp_mqtt_event_handle_t e = (esp_mqtt_event_handle_t)data;
+  switch ((esp_mqtt_event_id_t)eventId) {
+    case MQTT_EVENT_CONNECTED:
+      mqttTerhubung = true;
+      mqttMetrik.koneksi++;
+      if (e->session_present) mqttMetrik.sesiLanjut++;
+      break;
+    case MQTT_EVENT_DISCONNECTED:
+      mqttTerhubung = false;
+      break;
+    case MQTT_EVENT_PUBLISHED: {
+      PendingMqtt p;
+      if (ambilPendingMqtt(e->msg_id, p)) {
+        mqttMetrik.ack++;
+        catatTahap(TAHAP_MQTT, micros() - p.mulaiUs);
+        catatAck(p.seq, p.captureUs);
+      } else {
+        mqttMetrik.ackTanpaSlot++;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void mulaiMqtt() {
+  if (mqttClient) return;
+  kosongkanPendingMqtt();
+
+  esp_mqtt_client_config_t cfg = {};
+  cfg.broker.address.uri = MQTT_BROKER_URI;
+  cfg.broker.verification.crt_bundle_attach = esp_crt_bundle_attach;
+  cfg.credentials.client_id = MQTT_CLIENT_ID;
+  cfg.credentials.username = MQTT_USERNAME;
+  cfg.credentials.authentication.password = MQTT_PASSWORD;
+  cfg.session.disable_clean_session = true;
+  cfg.session.keepalive = MQTT_KEEPALIVE_SEC;
+
+  mqttClient = esp_mqtt_client_init(&cfg);
+  esp_mqtt_client_register_event(mqttClient, (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID, mqttEvent, nullptr);
+  esp_mqtt_client_start(mqttClient);
+  LOGI(TAG_MQTT, "📡 MQTT: %s, topic %s\n", MQTT_BROKER_URI, MQTT_TOPIC_SENSOR);
+}
+
+bool mqttSiap() {
+  return mqttTerhubung;
+}
+
+bool kirimSampelMqtt(const DataSensorDoc& doc, uint32_t mask, const TraceReading& trace) {
+  uint8_t payload[MQTT_PAYLOAD_SIZE];
+  uint32_t epoch = sumberWaktu >= WAKTU_RTC ? (uint32_t)time(nullptr) : 0;
+  uint32_t mulaiPayload = siklusSekarang();
+  size_t n = tulisCborSampel(doc, mask, epoch, payload, sizeof(payload));
+  catatSiklus(TAHAP_PAYLOAD, mulaiPayload);
+  if (!n) {
+    LOGE(TAG_MQTT, "✗ Buffer payload CBOR tidak cukup!\n");
+    return false;
+  }
+
+  // Non-blocking: masuk outbox, dikirim & diulang oleh task esp-mqtt
+  uint32_t mulai = micros();
+  int msgId = esp_mqtt_client_enqueue(mqttClient, MQTT_TOPIC_SENSOR, (const char*)payload, n, 1, 0, true);
+  if (msgId < 0) {
+    mqttMetrik.gagal++;
+    LOGE(TAG_MQTT, "✗✗✗ GAGAL KIRIM MQTT (outbox penuh) ✗✗✗\n");
+    return false;
+  }
+
+  catatPendingMqtt(msgId, mulai, trace);
+  mqttMetrik.terkirim++;
+  mqttMetrik.bytesPayload += n;
+  LOGI(TAG_MQTT, "✓ MQTT msg %d: %u byte CBOR (QoS 1)\n", msgId, (unsigned)n);
+  return true;
+}
+
+const TransportTelemetri TRANSPORT_MQTT = { "mqtt", mulaiMqtt, mqttSiap, kirimSampelMqtt };
+#endif
+
+#if TRANSPORT_MQTT_ENABLED && TRANSPORT_DEFAULT_MQTT
+const TransportTelemetri* transportAktif = &TRANSPORT_MQTT;
+#else
+const TransportTelemetri* transportAktif = &TRANSPORT_REST;
+#endif
+
+void cetakTransport() {
+  Serial.printf("Transport   : %s (%s)\n", transportAktif->nama, transportAktif->siap() ? "siap" : "belum siap");
+#if TRANSPORT_MQTT_ENABLED
+  if (mqttClient) {
+    Serial.printf("MQTT        : %lu terkirim, %lu ack, %lu tergusur (%lu ack tanpa slot), %lu gagal, "
+                  "%lu koneksi (%lu sesi lanjut), %lu byte\n",
+                  (unsigned long)mqttMetrik.terkirim, (unsigned long)mqttMetrik.ack,
+                  (unsigned long)mqttMetrik.tergusur, (unsigned long)mqttMetrik.ackTanpaSlot,
+                  (unsigned long)mqttMetrik.gagal, (unsigned long)mqttMetrik.koneksi,
+                  (unsigned long)mqttMetrik.sesiLanjut, (unsigned long)mqttMetrik.bytesPayload);
+  }
+#endif
+}
+
+// Dipanggil dari perintah serial (task jaringan)
+void perintahTransport(char* args) {
+  while (*args == ' ') args++;
+  if (!strcmp(args, "rest")) {
+    transportAktif = &TRANSPORT_REST;
+#if TRANSPORT_MQTT_ENABLED
+    // PUBACK tertunda tidak lagi menulis histogram e2e (penulisnya kini task jaringan)
+    kosongkanPendingMqtt();
+  } else if (!strcmp(args, "mqtt")) {
+    transportAktif = &TRANSPORT_MQTT;
+#endif
+  } else if (args[0] != '\0') {
+    Serial.println("transport rest|mqtt");
+    return;
+  }
+  transportAktif->mulai();
+  cetakTransport();
+}
+
+// --------------------------------------------------------------
+// Blok data per reading (juga payload benchmark "log bench")
+#define LOG_FMT_DATA_SENSOR                         \
+  "\n========== DATA SENSOR ==========\n"          \
+  "pH          : %.2f\n"                           \
+  "TDS         : %.2f ppm\n"                       \
+  "Turbidity   : %.2f NTU\n"                       \
+  "Ultrasonic  : %.2f cm\n"                        \
+  "Salinitas   : %.3f PPT (PSS-78, %.1f C)\n"      \
+  "Skor Fuzzy  : %.2f (%s, rule #%d)\n"            \
+  "=================================\n\n"
+
+// Return false hanya jika kirim gagal (upload ditahan = sukses)
+bool uploadSampel(const SensorSample& sample, const TraceReading& trace) {
+  float ph = sample.ph;
+  float tds = sample.tds;
+  float turb = sample.turbidity;
+  float jarak = sample.jarak;
+  float salinitas = hitungSalinitas(tds);
+
+  // Skor kualitas air dihitung di device, tidak menunggu Laravel
+  FuzzyResult fuzzy = evaluasiKualitasAir(ph, tds, turb);
+
+  // Log (ring biner, diformat task log); diagnostik hanya di build LOG_LEVEL_DEBUG
+  uint32_t mulaiLog = siklusSekarang();
+  LOGI(TAG_SENSOR, LOG_FMT_DATA_SENSOR, ph, tds, turb, jarak, salinitas, suhuAirC,
+       fuzzy.score, KATEGORI_LABEL[fuzzy.category], fuzzy.dominantRule);
+  LOGD(TAG_SENSOR, "Free Heap   : %lu bytes\n"
+                   "Loop Max    : %lu us\n"
+                   "ADC Overflow: %lu\n"
+                   "Echo        : %lu timeout, %lu outlier\n"
+                   "Akuisisi    : jitter tick maks %lu us, siklus maks %lu us\n",
+       (unsigned long)ESP.getFreeHeap(), loopMaxMicros, (unsigned long)adcOverflowCount,
+       (unsigned long)echoTimeoutCount, (unsigned long)echoOutlierCount,
+       (unsigned long)metrikAkuisisi.jitterMaksUs, (unsigned long)metrikAkuisisi.siklusMaksUs);
+  LOGD(TAG_CLOUD, "Koneksi     : %lu request koneksi baru (max %lu ms), %lu reuse\n"
+                  "Transport   : %s (%s)\n"
+                  "Write       : %lu terkirim, %lu ditahan, %lu anggaran (%.1f token)\n"
+                  "Laju        : %lu s (%s)\n",
+       (unsigned long)metrikKoneksi.baru, (unsigned long)metrikKoneksi.baruMsMax,
+       (unsigned long)metrikKoneksi.reused, transportAktif->nama, transportAktif->siap() ? "siap" : "belum siap",
+       (unsigned long)uploadPolicy.sentWrites, (unsigned long)uploadPolicy.suppressedWrites,
+       (unsigned long)uploadPolicy.budgetWrites, uploadPolicy.tokenWrite,
+       (unsigned long)intervalSampling() / 1000, lajuAdaptif.load(std::memory_order_relaxed) ? "adaptif" : "tetap");
+  catatSiklus(TAHAP_LOG, mulaiLog);
+  loopMaxMicros = 0;
+
+  float values[NUM_UPLOAD_FIELDS] = { ph, tds, turb, jarak, salinitas };
+  unsigned long nowMs = millis();
+  UploadDecision decision = putuskanUpload(values, fuzzy.category, nowMs);
+
+  if (decision.reason == UPLOAD_SUPPRESSED) {
+    uploadPolicy.suppressedWrites++;
+    catatHasil(TRACE_DITAHAN);
+    LOGI(TAG_CLOUD, "⏸ Tidak ada perubahan berarti, upload ditahan\n");
+    return true;
+  }
+  if (decision.reason == UPLOAD_BUDGET) {
+    uploadPolicy.budgetWrites++;
+    catatHasil(TRACE_ANGGARAN);
+    LOGW(TAG_CLOUD, "⏸ Anggaran write habis (%.1f token), upload ditahan\n", uploadPolicy.tokenWrite);
+    return true;
+  }
+
+  DataSensorDoc doc = { ph, tds, turb, jarak, salinitas, fuzzy.score, (uint8_t)fuzzy.category, 0, 0, 0, 0, 0, 0 };
+  isiTraceDoc(doc, trace);
+  uint32_t mask = decision.fieldMask | maskTrace(doc);
+  if (decision.includeScore) mask |= DATA_SENSOR_SCORE_MASK;
+
+  LOGI(TAG_CLOUD, "📤 Mengirim via %s (%s), seq %lu...\n", transportAktif->nama,
+       UPLOAD_REASON_LABEL[decision.reason], (unsigned long)trace.seq);
+  catatTahap(TAHAP_ANTRI, micros() - trace.captureUs);
+  if (!transportAktif->kirimSampel(doc, mask, trace)) {
+    catatHasil(TRACE_GAGAL);
+    return false;
+  }
+  catatHasil(TRACE_TERKIRIM);
+  catatUploadTerkirim(decision, values, fuzzy.category, nowMs);
+
+  LOGI(TAG_SENSOR, "\n⏱ Sampling tiap %lu detik...\n\n", (unsigned long)intervalSampling() / 1000);
+  return true;
+}
+
+// --------------------------------------------------------------
+// SNAPSHOT METRIK -> deviceMetrics/esp32
+// --------------------------------------------------------------
+// Ringkasan histogram dikirim tiap METRIK_UPLOAD_INTERVAL (dan bisa
+// dicetak lewat perintah serial "metrik"). Per tahap: n, rata2, p50,
+// p99, max dan bucket tidak kosong sebagai string "bucket:jumlah"
+// (ringkas, 10 tahap muat di satu patch). Nilai p50/p99 adalah batas
+// atas bucket log2, jadi paling banyak 2x nilai sebenarnya. Map trace
+// berisi bootId, seq terakhir dan hitungan hasil reading.
+// --------------------------------------------------------------
+#define METRIK_DOC_PATH "deviceMetrics/esp32"
+#define METRIK_BODY_SIZE 4096
+
+const unsigned long METRIK_UPLOAD_INTERVAL = 10UL * 60UL * 1000UL;  // 10 menit
+
+unsigned long lastMetrikUpload = 0;
+bool metrikDiminta = false;   // "metrik kirim": upload di kesempatan berikutnya
+
+void tulisInteger(PayloadWriter& w, int64_t v) {
+  w.tulis("{\"integerValue\":\"");
+  if (v < 0) w.tulisChar('-');
+  w.tulisUnsigned((uint64_t)(v < 0 ? -v : v));
+  w.tulis("\"}");
+}
+
+void tulisFieldInteger(PayloadWriter& w, const char* nama, int64_t v) {
+  w.tulisString(nama);
+  w.tulisChar(':');
+  tulisInteger(w, v);
+}
+
+void tulisHistogram(PayloadWriter& w, TahapMetrik tahap) {
+  const HistogramTahap& h = histogramTahap[tahap];
+  w.tulisString(TAHAP_LABEL[tahap]);
+  w.tulis(":{\"mapValue\":{\"fields\":{\"unit\":{\"stringValue\":");
+  w.tulisString(TAHAP_SIKLUS[tahap] ? "cycles" : "us");
+  w.tulis("},");
+  tulisFieldInteger(w, "n", h.jumlah);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "mean", h.jumlah ? (int64_t)(h.total / h.jumlah) : 0);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "p50", kuantilHistogram(h, 0.50f));
+  w.tulisChar(',');
+  tulisFieldInteger(w, "p99", kuantilHistogram(h, 0.99f));
+  w.tulisChar(',');
+  tulisFieldInteger(w, "max", h.maks);
+  w.tulis(",\"buckets\":{\"stringValue\":\"");
+  bool pertama = true;
+  for (int b = 0; b < HIST_BUCKETS; b++) {
+    if (!h.bucket[b]) continue;
+    if (!pertama) w.tulisChar(',');
+    pertama = false;
+    w.tulisUnsigned(b);
+    w.tulisChar(':');
+    w.tulisUnsigned(h.bucket[b]);
+  }
+  w.tulis("\"}}}}");
+}
+
+bool tulisBodyMetrik(char* buf, size_t cap, unsigned long nowMs) {
+  const MetrikPerangkat& m = metrikPerangkat;
+  PayloadWriter w(buf, cap);
+  w.tulis("{\"fields\":{");
+  tulisFieldInteger(w, "uptimeSec", nowMs / 1000);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "cpuMhz", getCpuFrequencyMhz());
+  w.tulisChar(',');
+  tulisFieldInteger(w, "heapFree", ESP.getFreeHeap());
+  w.tulisChar(',');
+  tulisFieldInteger(w, "heapMin", m.heapMin);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "rssi", m.rssiTerakhir);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "rssiMin", m.rssiMin);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "rssiMax", m.rssiMax);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "adcOverflow", adcOverflowCount);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "echoTimeout", echoTimeoutCount);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "echoOutlier", echoOutlierCount);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "samplingIntervalMs", intervalSampling());
+  w.tulisChar(',');
+  tulisFieldInteger(w, "writesBudgetHeld", uploadPolicy.budgetWrites);
+  w.tulis(",\"trace\":{\"mapValue\":{\"fields\":{");
+  tulisFieldInteger(w, "bootId", bootId);
+  w.tulisChar(',');
+  tulisFieldInteger(w, "seq", seqReading);
+  for (int h = 0; h < NUM_HASIL_TRACE; h++) {
+    w.tulisChar(',');
+    tulisFieldInteger(w, HASIL_TRACE_LABEL[h], hitunganTrace[h].load(std::memory_order_relaxed));
+  }
+  w.tulis("}}}");
+  for (int t = 0; t < NUM_TAHAP; t++) {
+    w.tulisChar(',');
+    tulisHistogram(w, (TahapMetrik)t);
+  }
+  if (sumberWaktu >= WAKTU_RTC) {
+    w.tulis(",\"updatedAt\":{\"timestampValue\":");
+    w.tulisTimestamp((uint32_t)time(nullptr));
+    w.tulisChar('}');
+  }
+  w.tulis("}}");
+  return w.ok();
+}
+
+bool metrikPerluUpload(unsigned long now) {
+  return metrikDiminta || now - lastMetrikUpload >= METRIK_UPLOAD_INTERVAL;
+}
+
+void uploadMetrik(unsigned long now) {
+  static char body[METRIK_BODY_SIZE];
+  lastMetrikUpload = now;
+  metrikDiminta = false;
+  perbaruiHeapMin();
+
+  if (!tulisBodyMetrik(body, sizeof(body), now)) {
+    LOGE(TAG_CLOUD, "✗ Buffer payload metrik tidak cukup!\n");
+    return;
+  }
+  // Tanpa updateMask: dokumen diganti utuh oleh snapshot terbaru
+  if (kirimPatch(METRIK_DOC_PATH, body, "")) {
+    LOGI(TAG_CLOUD, "📈 Metrik terkirim (%u byte)\n", (unsigned)strlen(body));
+  } else {
+    LOGE(TAG_CLOUD, "✗ Metrik gagal: %s\n", fbdo.errorReason().c_str());
+  }
+}
+
+void cetakMetrik() {
+  uint32_t mhz = getCpuFrequencyMhz();
+  perbaruiHeapMin();
+  Serial.printf("\n=== METRIK HOT-PATH (uptime %lu s, CPU %lu MHz) ===\n",
+                millis() / 1000, (unsigned long)mhz);
+  Serial.println("tahap         n     rata2       p50       p99       max  (us)");
+  for (int t = 0; t < NUM_TAHAP; t++) {
+    const HistogramTahap& h = histogramTahap[t];
+    // Tahap siklus dikonversi ke mikrodetik agar satu kolom satuan
+    float skala = TAHAP_SIKLUS[t] ? 1.0f / mhz : 1.0f;
+    float rata = h.jumlah ? (float)h.total / h.jumlah : 0;
+    Serial.printf("%-8s %8lu %9.2f %9.2f %9.2f %9.2f\n", TAHAP_LABEL[t], (unsigned long)h.jumlah,
+                  rata * skala, kuantilHistogram(h, 0.50f) * skala,
+                  kuantilHistogram(h, 0.99f) * skala, h.maks * skala);
+    if (!h.jumlah) continue;
+    Serial.print("         bucket:");
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+      if (h.bucket[b]) Serial.printf(" %d:%lu", b, (unsigned long)h.bucket[b]);
+    }
+    Serial.println();
+  }
+  const MetrikPerangkat& m = metrikPerangkat;
+  Serial.printf("Heap        : %lu bebas, low-water %lu\n",
+                (unsigned long)ESP.getFreeHeap(), (unsigned long)m.heapMin);
+  Serial.printf("RSSI        : %d dBm (min %d, max %d, %lu sampel)\n",
+                m.rssiTerakhir, m.rssiMin, m.rssiMax, (unsigned long)m.rssiSampel);
+  cetakMetrikKoneksi();
+  Serial.println("=================================\n");
+}
+
+void perintahMetrik(char* args) {
+  while (*args == ' ') args++;
+  if (!strcmp(args, "kirim")) {
+    metrikDiminta = true;
+    Serial.println("✓ Snapshot metrik dikirim saat cloud siap");
+  } else {
+    cetakMetrik();
+  }
+}
+
+// --------------------------------------------------------------
+// BUFFER RIWAYAT + BATCH COMMIT KE sensorHistory
+// --------------------------------------------------------------
+// Sampel riwayat dikumpulkan di ring buffer kapasitas tetap di RTC RAM
+// (RTC_NOINIT_ATTR: bertahan saat soft reset / watchdog), lalu dikirim
+// sekaligus dengan satu documents:commit. Biaya TLS + HTTP dibagi ke
+// banyak sampel. ID dokumen dibentuk dari epoch + sequence, jadi commit
+// ulang setelah gagal menimpa dokumen yang sama (tidak dobel).
+// --------------------------------------------------------------
+#define HISTORY_CAPACITY 64
+#define HISTORY_MAGIC 0x54515231UL   // "TQR1"
+
+const unsigned long historySampleInterval = 60000;  // 1 sampel riwayat / menit
+const uint16_t historyBatchSize = 10;               // flush jika >= 10 sampel
+const uint32_t historyMaxAgeSec = 10 * 60;          // atau sampel tertua > 10 menit
+
+struct HistorySample {
+  uint32_t epoch;       // detik UTC (NTP)
+  uint32_t seq;
+  float ph;
+  float tds;
+  float turbidity;
+  float jarak;
+  float score;
+  uint8_t category;
+};
+
+struct HistoryBuffer {
+  uint32_t magic;
+  uint16_t head;        // index sampel tertua
+  uint16_t count;
+  uint32_t nextSeq;
+  HistorySample items[HISTORY_CAPACITY];
+};
+
+// Didefinisikan di bagian JURNAL OFFLINE
+enum JournalSource : uint16_t {
+  JURNAL_OFFLINE,     // sampel riwayat saat WiFi/Firebase tidak siap
+  JURNAL_LIVE_GAGAL,  // patchDocument gagal
+  JURNAL_OVERFLOW     // tergusur dari buffer RTC yang penuh
+};
+void tulisJurnal(const HistorySample& h, JournalSource source);
+
+RTC_NOINIT_ATTR HistoryBuffer historyBuffer;
+unsigned long lastHistoryMillis = 0;
+uint32_t historyDropped = 0;   // sampel tergusur ke jurnal karena buffer penuh
+
+void initRiwayat() {
+  if (historyBuffer.magic != HISTORY_MAGIC ||
+      historyBuffer.head >= HISTORY_CAPACITY ||
+      historyBuffer.count > HISTORY_CAPACITY) {
+    memset(&historyBuffer, 0, sizeof(historyBuffer));
+    historyBuffer.magic = HISTORY_MAGIC;
+  } else if (historyBuffer.count > 0) {
+    LOGI(TAG_BOOT, "♻ %u sampel riwayat dipulihkan dari RTC RAM\n", historyBuffer.count);
+  }
+}
+
+// Return false jika waktu belum akurat (belum NTP / bukan sisa RTC)
+bool buatRiwayat(const SensorSample& sample, HistorySample& h) {
+  if (sumberWaktu < WAKTU_RTC) return false;
+  time_t now = time(nullptr);
+
+  FuzzyResult fuzzy = evaluasiKualitasAir(sample.ph, sample.tds, sample.turbidity);
+  h.epoch = (uint32_t)now;
+  h.seq = historyBuffer.nextSeq++;
+  h.ph = sample.ph;
+  h.tds = sample.tds;
+  h.turbidity = sample.turbidity;
+  h.jarak = sample.jarak;
+  h.score = fuzzy.score;
+  h.category = fuzzy.category;
+  return true;
+}
+
+void catatRiwayat(const SensorSample& sample) {
+  HistorySample h;
+  if (!buatRiwayat(sample, h)) return;
+
+  if (historyBuffer.count == HISTORY_CAPACITY) {
+    // Buffer penuh: yang tertua dipindah ke jurnal flash
+    tulisJurnal(historyBuffer.items[historyBuffer.head], JURNAL_OVERFLOW);
+    historyBuffer.head = (historyBuffer.head + 1) % HISTORY_CAPACITY;
+    historyBuffer.count--;
+    historyDropped++;
+  }
+
+  uint16_t idx = (historyBuffer.head + historyBuffer.count) % HISTORY_CAPACITY;
+  historyBuffer.items[idx] = h;
+  historyBuffer.count++;
+}
+
+bool riwayatPerluFlush() {
+  if (historyBuffer.count == 0) return false;
+  if (historyBuffer.count >= historyBatchSize) return true;
+
+  uint32_t oldest = historyBuffer.items[historyBuffer.head].epoch;
+  return (uint32_t)time(nullptr) - oldest >= historyMaxAgeSec;
+}
+
+constexpr char FS_TIMESTAMP[] = "timestamp";
+constexpr char FS_PH_VALUE_RIWAYAT[] = "ph_value";
+constexpr char FS_TDS_VALUE_RIWAYAT[] = "tds_value";
+constexpr char FS_TURBIDITY_RIWAYAT[] = "turbidity";
+constexpr char FS_WATER_LEVEL[] = "water_level";
+constexpr char FS_WATER_QUALITY_SCORE_RIWAYAT[] = "water_quality_score";
+constexpr char FS_CATEGORY[] = "category";
+constexpr char FS_SOURCE[] = "source";
+constexpr char SOURCE_ESP32[] = "esp32";
+
+typedef FirestoreSchema<HistorySample,
+  FieldTimestamp<FS_TIMESTAMP, HistorySample, &HistorySample::epoch>,
+  FieldDouble<FS_PH_VALUE_RIWAYAT, HistorySample, &HistorySample::ph>,
+  FieldDouble<FS_TDS_VALUE_RIWAYAT, HistorySample, &HistorySample::tds>,
+  FieldDouble<FS_TURBIDITY_RIWAYAT, HistorySample, &HistorySample::turbidity>,
+  FieldDouble<FS_WATER_LEVEL, HistorySample, &HistorySample::jarak>,
+  FieldDouble<FS_WATER_QUALITY_SCORE_RIWAYAT, HistorySample, &HistorySample::score>,
+  FieldKategori<FS_CATEGORY, HistorySample, &HistorySample::category>,
+  FieldKonstan<FS_SOURCE, HistorySample, SOURCE_ESP32>
+> HistorySchema;
+
+#define HISTORY_BODY_SIZE 448
+
+// Satu dokumen sensorHistory; body disalin ke struct write oleh library
+void tambahWriteRiwayat(std::vector<struct firebase_firestore_document_write_t>& writes,
+                        const HistorySample& h) {
+  char body[HISTORY_BODY_SIZE];
+  uint32_t mulaiPayload = siklusSekarang();
+  bool payloadOk = HistorySchema::tulisBody(h, HistorySchema::SEMUA, body, sizeof(body));
+  catatSiklus(TAHAP_PAYLOAD, mulaiPayload);
+  if (!payloadOk) {
+    LOGE(TAG_CLOUD, "✗ Buffer payload riwayat tidak cukup!\n");
+    return;
+  }
+
+  char docPath[64];
+  snprintf(docPath, sizeof(docPath), "sensorHistory/esp32-%lu-%lu",
+           (unsigned long)h.epoch, (unsigned long)h.seq);
+
+  struct firebase_firestore_document_write_t w;
+  w.type = firebase_firestore_document_write_type_update;
+  w.update_document_content = body;
+  w.update_document_path = docPath;
+  writes.push_back(w);
+}
+
+void flushRiwayat() {
+  uint16_t n = historyBuffer.count;
+  if (n > historyBatchSize) n = historyBatchSize;
+
+  std::vector<struct firebase_firestore_document_write_t>& writes = mulaiCommit();
+  for (uint16_t i = 0; i < n; i++) {
+    tambahWriteRiwayat(writes, historyBuffer.items[(historyBuffer.head + i) % HISTORY_CAPACITY]);
+  }
+
+  LOGI(TAG_CLOUD, "📦 Commit %u sampel riwayat ke sensorHistory...\n", n);
+
+  if (kirimCommit(writes)) {
+    historyBuffer.head = (historyBuffer.head + n) % HISTORY_CAPACITY;
+    historyBuffer.count -= n;
+    LOGI(TAG_CLOUD, "✓ Riwayat terkirim, sisa buffer: %u\n", historyBuffer.count);
+  } else {
+    LOGE(TAG_CLOUD, "✗ Commit riwayat gagal: %s\n", fbdo.errorReason().c_str());
+  }
+}
+
+// --------------------------------------------------------------
+// AGREGAT JENDELA TUMBLING (WELFORD) KE sensorAggregate*
+// --------------------------------------------------------------
+// Setiap sampel live masuk ke akumulator Welford per kanal untuk tiap
+// jendela di JENDELA_AGREGAT (sejajar batas epoch UTC). Jendela yang
+// tutup menjadi satu dokumen count + {mean, std, min, max} per kanal,
+// dikirim lewat commit seperti riwayat. Tren 30 hari = 720 dokumen
+// per jam, bukan ribuan sampel mentah.
+// - bobot sampel = jarak ke sampel sebelumnya, jadi sampling adaptif
+//   (2-40 s) tidak membuat mean condong ke periode tren
+// - ID dokumen = awal jendela, jadi commit ulang tidak dobel
+// - RIWAYAT_MENTAH 0: sampel per menit ke sensorHistory diganti agregat
+//   1 menit (jurnal offline tetap menyimpan sampel mentah)
+// --------------------------------------------------------------
+#define RIWAYAT_MENTAH 1
+#define AGREGAT_OUTBOX 8
+#define AGREGAT_MAGIC 0x54514131UL                 // "TQA1"
+#define AGREGAT_BOBOT_MAKS_MS (2 * LAJU_MAX_MS)    // celah (offline) tidak dihitung penuh
+#define AGREGAT_BATCH 4
+#define AGREGAT_BODY_SIZE 1152
+
+struct JendelaAgregat {
+  uint32_t detik;
+  const char* koleksi;
+  bool kirim;
+};
+
+const JendelaAgregat JENDELA_AGREGAT[] = {
+  { 60,   "sensorAggregate1m",  !RIWAYAT_MENTAH },
+  { 900,  "sensorAggregate15m", true },
+  { 3600, "sensorAggregate1h",  true }
+};
+const uint8_t NUM_JENDELA_AGREGAT = sizeof(JENDELA_AGREGAT) / sizeof(JENDELA_AGREGAT[0]);
+
+// Akumulator jendela yang sedang berjalan sekaligus isi dokumen
+struct AgregatDoc {
+  uint32_t mulai;       // epoch awal jendela
+  uint32_t detik;       // panjang jendela
+  uint32_t jumlah;      // sampel
+  float bobot;          // detik tercakup sampel
+  uint8_t jendela;      // index JENDELA_AGREGAT
+  Welford<float> ph;
+  Welford<float> tds;
+  Welford<float> turbidity;
+  Welford<float> jarak;  // hanya echo valid
+  Welford<float> score;
+};
+
+struct AgregatOutbox {
+  uint32_t magic;
+  uint16_t head;
+  uint16_t count;
+  AgregatDoc items[AGREGAT_OUTBOX];
+};
+
+constexpr char FS_WINDOW_SEC[] = "window_sec";
+constexpr char FS_COUNT[] = "count";
+constexpr char FS_WEIGHT_SEC[] = "weight_sec";
+
+typedef FirestoreSchema<AgregatDoc,
+  FieldTimestamp<FS_TIMESTAMP, AgregatDoc, &AgregatDoc::mulai>,
+  FieldInteger<FS_WINDOW_SEC, AgregatDoc, &AgregatDoc::detik>,
+  FieldInteger<FS_COUNT, AgregatDoc, &AgregatDoc::jumlah>,
+  FieldDouble<FS_WEIGHT_SEC, AgregatDoc, &AgregatDoc::bobot>,
+  FieldStatistik<FS_PH_VALUE_RIWAYAT, AgregatDoc, &AgregatDoc::ph>,
+  FieldStatistik<FS_TDS_VALUE_RIWAYAT, AgregatDoc, &AgregatDoc::tds>,
+  FieldStatistik<FS_TURBIDITY_RIWAYAT, AgregatDoc, &AgregatDoc::turbidity>,
+  FieldStatistik<FS_WATER_LEVEL, AgregatDoc, &AgregatDoc::jarak>,
+  FieldStatistik<FS_WATER_QUALITY_SCORE_RIWAYAT, AgregatDoc, &AgregatDoc::score>,
+  FieldKonstan<FS_SOURCE, AgregatDoc, SOURCE_ESP32>
+> AgregatSchema;
+
+AgregatDoc agregatAktif[NUM_JENDELA_AGREGAT] = {};
+RTC_NOINIT_ATTR AgregatOutbox agregatOutbox;
+unsigned long agregatSampelTerakhir = 0;
+uint32_t agregatTerkirim = 0;
+uint32_t agregatHilang = 0;   // tergusur dari outbox yang penuh
+
+void initAgregat() {
+  if (agregatOutbox.magic != AGREGAT_MAGIC ||
+      agregatOutbox.head >= AGREGAT_OUTBOX ||
+      agregatOutbox.count > AGREGAT_OUTBOX) {
+    memset(&agregatOutbox, 0, sizeof(agregatOutbox));
+    agregatOutbox.magic = AGREGAT_MAGIC;
+  } else if (agregatOutbox.count > 0) {
+    LOGI(TAG_BOOT, "♻ %u agregat dipulihkan dari RTC RAM\n", agregatOutbox.count);
+  }
+}
+
+void tutupJendela(AgregatDoc& a) {
+  if (a.jumlah == 0 || !JENDELA_AGREGAT[a.jendela].kirim) return;
+  a.bobot = a.ph.bobot;
+  if (agregatOutbox.count == AGREGAT_OUTBOX) {
+    agregatOutbox.head = (agregatOutbox.head + 1) % AGREGAT_OUTBOX;
+    agregatOutbox.count--;
+    agregatHilang++;
+  }
+  agregatOutbox.items[(agregatOutbox.head + agregatOutbox.count) % AGREGAT_OUTBOX] = a;
+  agregatOutbox.count++;
+}
+
+void catatAgregat(const SensorSample& sample, unsigned long capturedMillis) {
+  if (sumberWaktu < WAKTU_RTC) return;
+  uint32_t epoch = (uint32_t)time(nullptr) - (millis() - capturedMillis) / 1000;
+
+  unsigned long jedaMs = agregatSampelTerakhir ? capturedMillis - agregatSampelTerakhir : intervalSampling();
+  agregatSampelTerakhir = capturedMillis;
+  if (jedaMs > AGREGAT_BOBOT_MAKS_MS) jedaMs = AGREGAT_BOBOT_MAKS_MS;
+  if (jedaMs == 0) jedaMs = 1;
+  float w = jedaMs / 1000.0f;
+  FuzzyResult fuzzy = evaluasiKualitasAir(sample.ph, sample.tds, sample.turbidity);
+
+  for (uint8_t i = 0; i < NUM_JENDELA_AGREGAT; i++) {
+    AgregatDoc& a = agregatAktif[i];
+    uint32_t mulai = epoch - epoch % JENDELA_AGREGAT[i].detik;
+    if (a.mulai != mulai) {
+      tutupJendela(a);
+      a = AgregatDoc();
+      a.mulai = mulai;
+      a.detik = JENDELA_AGREGAT[i].detik;
+      a.jendela = i;
+    }
+    a.jumlah++;
+    a.ph.tambah(sample.ph, w);
+    a.tds.tambah(sample.tds, w);
+    a.turbidity.tambah(sample.turbidity, w);
+    if (sample.jarak > 0) a.jarak.tambah(sample.jarak, w);
+    a.score.tambah(fuzzy.score, w);
+  }
+}
+
+bool agregatPerluFlush() {
+  if (agregatOutbox.count == 0) return false;
+  if (agregatOutbox.count >= AGREGAT_BATCH) return true;
+
+  const AgregatDoc& tertua = agregatOutbox.items[agregatOutbox.head];
+  return (uint32_t)time(nullptr) - (tertua.mulai + tertua.detik) >= historyMaxAgeSec;
+}
+
+void tambahWriteAgregat(std::vector<struct firebase_firestore_document_write_t>& writes,
+                        const AgregatDoc& a) {
+  char body[AGREGAT_BODY_SIZE];
+  uint32_t mulaiPayload = siklusSekarang();
+  bool payloadOk = AgregatSchema::tulisBody(a, AgregatSchema::SEMUA, body, sizeof(body));
+  catatSiklus(TAHAP_PAYLOAD, mulaiPayload);
+  if (!payloadOk) {
+    LOGE(TAG_CLOUD, "✗ Buffer payload agregat tidak cukup!\n");
+    return;
+  }
+
+  char docPath[64];
+  snprintf(docPath, sizeof(docPath), "%s/esp32-%lu",
+           JENDELA_AGREGAT[a.jendela].koleksi, (unsigned long)a.mulai);
+
+  struct firebase_firestore_document_write_t w;
+  w.type = firebase_firestore_document_write_type_update;
+  w.update_document_content = body;
+  w.update_document_path = docPath;
+  writes.push_back(w);
+}
+
+void flushAgregat() {
+  uint16_t n = agregatOutbox.count;
+  std::vector<struct firebase_firestore_document_write_t>& writes = mulaiCommit();
+  for (uint16_t i = 0; i < n; i++) {
+    tambahWriteAgregat(writes, agregatOutbox.items[(agregatOutbox.head + i) % AGREGAT_OUTBOX]);
+  }
+
+  LOGI(TAG_CLOUD, "📊 Commit %u agregat jendela...\n", n);
+  if (kirimCommit(writes)) {
+    agregatOutbox.head = (agregatOutbox.head + n) % AGREGAT_OUTBOX;
+    agregatOutbox.count -= n;
+    agregatTerkirim += n;
+  } else {
+    LOGE(TAG_CLOUD, "✗ Commit agregat gagal: %s\n", fbdo.errorReason().c_str());
+  }
+}
+
+void cetakAgregat() {
+  Serial.printf("\n=== AGREGAT JENDELA: outbox %u/%u, terkirim %lu, hilang %lu ===\n",
+                agregatOutbox.count, AGREGAT_OUTBOX,
+                (unsigned long)agregatTerkirim, (unsigned long)agregatHilang);
+  for (uint8_t i = 0; i < NUM_JENDELA_AGREGAT; i++) {
+    const AgregatDoc& a = agregatAktif[i];
+    Serial.printf("%-18s %s n=%lu  pH %.2f±%.2f [%.2f..%.2f]  TDS %.0f±%.1f  turb %.1f±%.1f\n",
+                  JENDELA_AGREGAT[i].koleksi, JENDELA_AGREGAT[i].kirim ? "kirim" : "lokal",
+                  (unsigned long)a.jumlah, a.ph.mean, a.ph.simpangan(), a.ph.minimum, a.ph.maksimum,
+                  a.tds.mean, a.tds.simpangan(), a.turbidity.mean, a.turbidity.simpangan());
+  }
+}
+
+// Akurasi & biaya per sampel: Welford float vs jumlah kuadrat float,
+// acuan Welford double. Deret mirip TDS (offset besar, variasi kecil)
+// adalah kasus terburuk rumus jumlah kuadrat.
+void benchAgregat(uint32_t n) {
+  Welford<float> wf = {};
+  Welford<double> wd = {};
+  float jumlah = 0, jumlahKuadrat = 0;
+  uint32_t acak = 12345;
+  auto nilai = [&acak](uint32_t i) {
+    acak = acak * 1664525u + 1013904223u;
+    return 500.0f + 5.0f * sinf(i * 0.001f) + ((acak >> 16) & 0xFF) / 64.0f;
+  };
+
+  uint32_t t0 = siklusSekarang();
+  for (uint32_t i = 0; i < n; i++) wf.tambah(nilai(i), 1.0f);
+  uint32_t siklusWelford = siklusSekarang() - t0;
+
+  acak = 12345;
+  t0 = siklusSekarang();
+  for (uint32_t i = 0; i < n; i++) {
+    float x = nilai(i);
+    jumlah += x;
+    jumlahKuadrat += x * x;
+  }
+  uint32_t siklusNaif = siklusSekarang() - t0;
+
+  acak = 12345;
+  for (uint32_t i = 0; i < n; i++) wd.tambah(nilai(i), 1.0);
+
+  float meanNaif = jumlah / n;
+  float varNaif = jumlahKuadrat / n - meanNaif * meanNaif;
+  double stdAcuan = wd.simpangan();
+  Serial.printf("\n=== BENCH AGREGAT: %lu sampel, %u byte/akumulator, %u byte/jendela ===\n",
+                (unsigned long)n, (unsigned)sizeof(Welford<float>), (unsigned)sizeof(AgregatDoc));
+  Serial.printf("Welford float : %.1f siklus/sampel, mean %.4f, std %.4f (galat %.2e)\n",
+                (double)siklusWelford / n, wf.mean, wf.simpangan(),
+                fabs(wf.simpangan() - stdAcuan) / stdAcuan);
+  Serial.printf("Jumlah kuadrat: %.1f siklus/sampel, mean %.4f, std %.4f (galat %.2e)\n",
+                (double)siklusNaif / n, meanNaif, sqrtf(varNaif > 0 ? varNaif : 0),
+                fabs(sqrtf(varNaif > 0 ? varNaif : 0) - stdAcuan) / stdAcuan);
+  Serial.printf("Acuan double  : mean %.4f, std %.4f\n", wd.mean, stdAcuan);
+}
+
+void perintahAgregat(char* args) {
+  while (*args == ' ') args++;
+  if (!strncmp(args, "bench", 5)) {
+    uint32_t n = strtoul(args + 5, nullptr, 10);
+    benchAgregat(n ? n : 100000);
+  } else if (args[0] != '\0') {
+    Serial.println("agregat [bench <n>]");
+  } else {
+    cetakAgregat();
+  }
+}
+
+// --------------------------------------------------------------
+// KOMPRESI DERET WAKTU (GORILLA, TANPA HEAP)
+// --------------------------------------------------------------
+// Blok sampel terkuantisasi untuk jurnal flash. Sampel pertama blok
+// ditulis utuh, sampel berikutnya:
+// - epoch: delta-of-delta, kode awalan 0 | 10+7 | 110+9 | 1110+12 |
+//   1111+32 bit (interval tetap = 1 bit)
+// - seq: 0 jika seq sebelumnya + 1, selain itu 1+32 bit
+// - pH/TDS/turbidity/jarak: selisih nilai terkuantisasi (zigzag),
+//   kode 0 | 10+4 | 110+8 | 1110+12 | 1111+16 bit nilai utuh
+// - sumber: 0 jika sama, selain itu 1+2 bit
+// Nilai dikuantisasi ke resolusi jurnal, bukan XOR float: noise ADC
+// membuat mantissa float hampir selalu berbeda, selisih integernya kecil.
+// C++ murni (tanpa API Arduino), jadi dekoder yang sama dipakai di PC.
+// --------------------------------------------------------------
+#define NUM_DERET 4   // pH, TDS, turbidity, jarak
+
+struct SampelTerkuantisasi {
+  uint32_t epoch;
+  uint32_t seq;
+  uint16_t nilai[NUM_DERET];   // pH x100, ppm, NTU x10, cm x10
+  uint8_t sumber;              // 2 bit
+};
+
+// Penulis bit MSB-first ke buffer milik pemanggil. Bit yang ditulis
+// menimpa isi lama, jadi tulisan yang dibatalkan (posisi tidak
+// disimpan) tidak meninggalkan sampah.
+class PenulisBit {
+public:
+  PenulisBit(uint8_t* buf, size_t cap, uint32_t posisi)
+      : buf_(buf), capBit_(cap * 8), pos_(posisi), ok_(true) {}
+
+  void tulis(uint32_t nilai, uint8_t nBit) {
+    if (!ok_ || pos_ + nBit > capBit_) {
+      ok_ = false;
+      return;
+    }
+    while (nBit > 0) {
+      uint8_t sisa = 8 - (pos_ & 7);
+      uint8_t ambil = nBit < sisa ? nBit : sisa;
+      uint8_t geser = sisa - ambil;
+      uint8_t mask = (uint8_t)(((1u << ambil) - 1) << geser);
+      uint8_t& b = buf_[pos_ >> 3];
+      b = (uint8_t)((b & ~mask) | (((nilai >> (nBit - ambil)) << geser) & mask));
+      pos_ += ambil;
+      nBit -= ambil;
+    }
+  }
+
+  bool ok() const { return ok_; }
+  uint32_t posisi() const { return pos_; }
+
+private:
+  uint8_t* buf_;
+  uint32_t capBit_;
+  uint32_t pos_;
+  bool ok_;
+};
+
+class PembacaBit {
+public:
+  PembacaBit(const uint8_t* buf, uint32_t nBit) : buf_(buf), total_(nBit), pos_(0), ok_(true) {}
+
+  uint32_t baca(uint8_t nBit) {
+    if (!ok_ || pos_ + nBit > total_) {
+      ok_ = false;
+      return 0;
+    }
+    uint32_t v = 0;
+    while (nBit > 0) {
+      uint8_t sisa = 8 - (pos_ & 7);
+      uint8_t ambil = nBit < sisa ? nBit : sisa;
+      v = (v << ambil) | ((buf_[pos_ >> 3] >> (sisa - ambil)) & ((1u << ambil) - 1));
+      pos_ += ambil;
+      nBit -= ambil;
+    }
+    return v;
+  }
+
+  bool ok() const { return ok_; }
+
+private:
+  const uint8_t* buf_;
+  uint32_t total_;
+  uint32_t pos_;
+  bool ok_;
+};
+
+// Lebar isi per kode awalan (jumlah bit 1 di depan, maks 4)
+const uint8_t LEBAR_DOD[] = { 0, 7, 9, 12, 32 };
+const uint8_t LEBAR_SELISIH[] = { 0, 4, 8, 12, 16 };
+
+void tulisKode(PenulisBit& w, uint8_t k, uint32_t isi, const uint8_t* lebar) {
+  // k bit 1 lalu 0 (awalan terakhir tanpa 0)
+  if (k < 4) {
+    w.tulis(((1u << k) - 1) << 1, k + 1);
+  } else {
+    w.tulis(0xF, 4);
+  }
+  if (lebar[k]) w.tulis(isi, lebar[k]);
+}
+
+uint8_t bacaAwalan(PembacaBit& r) {
+  uint8_t k = 0;
+  while (k < 4 && r.baca(1)) k++;
+  return k;
+}
+
+void tulisDod(PenulisBit& w, int32_t dod) {
+  if (dod == 0) tulisKode(w, 0, 0, LEBAR_DOD);
+  else if (dod >= -63 && dod <= 64) tulisKode(w, 1, dod + 63, LEBAR_DOD);
+  else if (dod >= -255 && dod <= 256) tulisKode(w, 2, dod + 255, LEBAR_DOD);
+  else if (dod >= -2047 && dod <= 2048) tulisKode(w, 3, dod + 2047, LEBAR_DOD);
+  else tulisKode(w, 4, (uint32_t)dod, LEBAR_DOD);
+}
+
+int32_t bacaDod(PembacaBit& r) {
+  uint8_t k = bacaAwalan(r);
+  uint32_t isi = r.baca(LEBAR_DOD[k]);
+  const int32_t OFFSET[] = { 0, 63, 255, 2047, 0 };
+  return (int32_t)isi - OFFSET[k];
+}
+
+void tulisSelisih(PenulisBit& w, uint16_t nilai, uint16_t sebelumnya) {
+  int32_t d = (int32_t)nilai - sebelumnya;
+  uint32_t zz = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+  if (zz == 0) tulisKode(w, 0, 0, LEBAR_SELISIH);
+  else if (zz < 16) tulisKode(w, 1, zz, LEBAR_SELISIH);
+  else if (zz < 256) tulisKode(w, 2, zz, LEBAR_SELISIH);
+  else if (zz < 4096) tulisKode(w, 3, zz, LEBAR_SELISIH);
+  else tulisKode(w, 4, nilai, LEBAR_SELISIH);
+}
+
+uint16_t bacaSelisih(PembacaBit& r, uint16_t sebelumnya) {
+  uint8_t k = bacaAwalan(r);
+  uint32_t isi = r.baca(LEBAR_SELISIH[k]);
+  if (k == 4) return (uint16_t)isi;
+  int32_t d = (int32_t)(isi >> 1) ^ -(int32_t)(isi & 1);
+  return (uint16_t)(sebelumnya + d);
+}
+
+// State encoder satu blok (POD, boleh disimpan di RTC RAM)
+struct KompresorDeret {
+  uint16_t bit;                // panjang data blok
+  uint16_t jumlah;             // sampel dalam blok
+  int32_t deltaEpoch;
+  SampelTerkuantisasi akhir;   // sampel terakhir
+};
+
+// false jika tidak muat: state dan panjang blok tidak berubah
+bool enkodeSampel(KompresorDeret& k, uint8_t* buf, size_t cap, const SampelTerkuantisasi& s) {
+  PenulisBit w(buf, cap, k.bit);
+  int32_t delta = 0;
+  if (k.jumlah == 0) {
+    w.tulis(s.epoch, 32);
+    w.tulis(s.seq, 32);
+    for (int i = 0; i < NUM_DERET; i++) w.tulis(s.nilai[i], 16);
+    w.tulis(s.sumber, 2);
+  } else {
+    delta = (int32_t)(s.epoch - k.akhir.epoch);
+    tulisDod(w, delta - k.deltaEpoch);
+    if (s.seq == k.akhir.seq + 1) {
+      w.tulis(0, 1);
+    } else {
+      w.tulis(1, 1);
+      w.tulis(s.seq, 32);
+    }
+    for (int i = 0; i < NUM_DERET; i++) tulisSelisih(w, s.nilai[i], k.akhir.nilai[i]);
+    if (s.sumber == k.akhir.sumber) {
+      w.tulis(0, 1);
+    } else {
+      w.tulis(1, 1);
+      w.tulis(s.sumber, 2);
+    }
+  }
+  if (!w.ok()) return false;
+
+  k.bit = w.posisi();
+  k.jumlah++;
+  k.deltaEpoch = delta;
+  k.akhir = s;
+  return true;
+}
+
+class DekompresorDeret {
+public:
+  DekompresorDeret(const uint8_t* buf, size_t len, uint16_t jumlah)
+      : r_(buf, len * 8), sisa_(jumlah), pertama_(true), deltaEpoch_(0), akhir_() {}
+
+  // false jika blok habis atau rusak
+  bool berikut(SampelTerkuantisasi& s) {
+    if (sisa_ == 0) return false;
+    if (pertama_) {
+      s.epoch = r_.baca(32);
+      s.seq = r_.baca(32);
+      for (int i = 0; i < NUM_DERET; i++) s.nilai[i] = (uint16_t)r_.baca(16);
+      s.sumber = (uint8_t)r_.baca(2);
+      pertama_ = false;
+    } else {
+      deltaEpoch_ += bacaDod(r_);
+      s.epoch = akhir_.epoch + deltaEpoch_;
+      s.seq = r_.baca(1) ? r_.baca(32) : akhir_.seq + 1;
+      for (int i = 0; i < NUM_DERET; i++) s.nilai[i] = bacaSelisih(r_, akhir_.nilai[i]);
+      s.sumber = r_.baca(1) ? (uint8_t)r_.baca(2) : akhir_.sumber;
+    }
+    if (!r_.ok()) return false;
+    akhir_ = s;
+    sisa_--;
+    return true;
+  }
+
+private:
+  PembacaBit r_;
+  uint16_t sisa_;
+  bool pertama_;
+  int32_t deltaEpoch_;
+  SampelTerkuantisasi akhir_;
+};
+
+// --------------------------------------------------------------
+// JURNAL OFFLINE (STORE-AND-FORWARD DI LITTLEFS)
+// --------------------------------------------------------------
+// Saat offline atau upload gagal, sampel dikompresi (lihat KOMPRESI
+// DERET WAKTU) ke blok terbuka di RTC RAM. Blok yang penuh ditulis ke
+// file segmen /jurnal/<n>.seg sebagai [header 6 byte + CRC16][data].
+// - ~3,7 byte per sampel, bukan record 20 byte: 160 KB menampung
+//   ~30 hari pada 1 sampel/menit, bukan ~5,5 hari
+// - blok terbuka bertahan saat soft reset / watchdog; listrik padam
+//   kehilangan maks JOURNAL_BLOCK_SAMPLES sampel terakhir
+// - append-only; segmen penuh -> buka nomor segmen baru (tidak pernah
+//   menulis ulang file yang sama, LittleFS menyebar wear-nya)
+// - segmen yang sudah terkirim semua dihapus; tidak ada file cursor
+//   yang ditulis berulang. Setelah reboot, sisa segmen dikirim ulang
+//   dari awal - aman karena ID dokumen riwayat idempoten.
+// - jumlah segmen dibatasi; jika penuh segmen tertua dibuang
+// - drain dibatasi JOURNAL_DRAIN_BATCH record per JOURNAL_DRAIN_INTERVAL
+//   agar backlog tidak menghambat upload live
+// --------------------------------------------------------------
+#define JOURNAL_DIR "/jurnal"
+#define JOURNAL_MAGIC 0x324A5154UL        // "TQJ2" (blok terkompresi)
+#define JOURNAL_BLOK_MAGIC 0x424A5154UL   // "TQJB" (blok terbuka di RTC)
+#define JOURNAL_SEGMENT_BYTES 5120
+#define JOURNAL_MAX_SEGMENTS 32           // 160 KB
+#define JOURNAL_BLOCK_BYTES 192
+#define JOURNAL_BLOCK_SAMPLES 32
+#define JOURNAL_RECORD_MENTAH 20          // record TQJ1 lama, pembanding rasio
+#define JOURNAL_DRAIN_BATCH 20
+#define JOURNAL_DRAIN_INTERVAL 5000UL
+
+struct __attribute__((packed)) JournalSegmentHeader {
+  uint32_t magic;
+  uint32_t segment;
+};
+
+struct __attribute__((packed)) JournalBlockHeader {
+  uint16_t bytes;
+  uint16_t count;
+  uint16_t crc;      // CRC16-CCITT data blok
+};
+
+struct JournalBlokTerbuka {
+  uint32_t magic;
+  KompresorDeret enc;
+  uint8_t data[JOURNAL_BLOCK_BYTES];
+};
+
+struct JournalState {
+  bool ready;
+  uint32_t firstSeg;     // segmen tertua yang belum habis dikirim
+  uint32_t lastSeg;      // segmen yang sedang ditulis
+  uint16_t readIdx;      // record terkirim di firstSeg (hanya di RAM)
+  uint32_t pending;      // perkiraan record yang belum terkirim (termasuk blok terbuka)
+  uint32_t written;
+  uint32_t drained;
+  uint32_t dropped;      // record hilang karena segmen tertua dibuang
+  uint32_t crcErrors;
+  uint32_t blokRecord;   // record dalam blok yang sudah ditulis ke flash
+  uint32_t blokBytes;    // byte blok (header + data) yang ditulis ke flash
+  uint64_t siklusEnkode;
+};
+
+JournalState journal = {};
+RTC_NOINIT_ATTR JournalBlokTerbuka blokJurnal;
+unsigned long lastJournalDrainMillis = 0;
+
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+uint16_t kuantisasi(float value, float scale) {
+  float q = value * scale + 0.5f;
+  if (q < 0) return 0;
+  if (q > 65535.0f) return 65535;
+  return (uint16_t)q;
+}
+
+void pathSegmen(uint32_t seg, char* out, size_t len) {
+  snprintf(out, len, JOURNAL_DIR "/%08lu.seg", (unsigned long)seg);
+}
+
+// Jumlah record di segmen (jumlah count header blok); 0 jika format lain
+uint32_t jumlahRecordSegmen(uint32_t seg) {
+  char path[32];
+  pathSegmen(seg, path, sizeof(path));
+  File f = LittleFS.open(path, "r");
+  if (!f) return 0;
+
+  JournalSegmentHeader hdr;
+  uint32_t total = 0;
+  if (f.read((uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == JOURNAL_MAGIC) {
+    size_t pos = sizeof(hdr);
+    JournalBlockHeader blok;
+    while (f.read((uint8_t*)&blok, sizeof(blok)) == sizeof(blok)) {
+      pos += sizeof(blok) + blok.bytes;
+      if (pos > f.size()) break;   // blok terpotong (listrik padam saat menulis)
+      total += blok.count;
+      f.seek(pos);
+    }
+  }
+  f.close();
+  return total;
+}
+
+void resetBlokJurnal() {
+  memset(&blokJurnal, 0, sizeof(blokJurnal));
+  blokJurnal.magic = JOURNAL_BLOK_MAGIC;
+}
+
+void initJurnal() {
+  if (blokJurnal.magic != JOURNAL_BLOK_MAGIC ||
+      blokJurnal.enc.jumlah > JOURNAL_BLOCK_SAMPLES ||
+      blokJurnal.enc.bit > JOURNAL_BLOCK_BYTES * 8) {
+    resetBlokJurnal();
+  }
+
+  if (!LittleFS.begin(true)) {
+    LOGE(TAG_JURNAL, "✗ LittleFS gagal, jurnal offline nonaktif\n");
+    return;
+  }
+  LittleFS.mkdir(JOURNAL_DIR);
+
+  // Cari nomor segmen terkecil & terbesar yang tersisa
+  bool found = false;
+  File dir = LittleFS.open(JOURNAL_DIR);
+  File entry = dir.openNextFile();
+  while (entry) {
+    uint32_t seg = strtoul(entry.name(), nullptr, 10);
+    if (!found || seg < journal.firstSeg) journal.firstSeg = seg;
+    if (!found || seg > journal.lastSeg) journal.lastSeg = seg;
+    found = true;
+    entry = dir.openNextFile();
+  }
+
+  journal.pending = blokJurnal.enc.jumlah;
+  if (found) {
+    for (uint32_t seg = journal.firstSeg; seg <= journal.lastSeg; seg++) {
+      char path[32];
+      pathSegmen(seg, path, sizeof(path));
+      File f = LittleFS.open(path, "r");
+      if (!f) continue;
+      JournalSegmentHeader hdr;
+      bool formatLama = f.read((uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic != JOURNAL_MAGIC;
+      f.close();
+      if (formatLama) {
+        // Segmen record 20 byte (TQJ1) dari firmware lama tidak bisa dibaca lagi
+        LittleFS.remove(path);
+        LOGW(TAG_JURNAL, "✗ Segmen jurnal format lama dibuang: %s\n", path);
+        continue;
+      }
+      journal.pending += jumlahRecordSegmen(seg);
+    }
+  }
+  if (journal.pending > 0) {
+    LOGI(TAG_JURNAL, "♻ Jurnal offline: %lu record menunggu dikirim\n", (unsigned long)journal.pending);
+  }
+  journal.ready = true;
+}
+
+// Tulis blok terbuka ke flash sebagai satu blok segmen
+void tutupBlokJurnal() {
+  if (blokJurnal.enc.jumlah == 0) return;
+
+  JournalBlockHeader blok;
+  blok.bytes = (blokJurnal.enc.bit + 7) / 8;
+  blok.count = blokJurnal.enc.jumlah;
+  blok.crc = crc16(blokJurnal.data, blok.bytes);
+
+  char path[32];
+  pathSegmen(journal.lastSeg, path, sizeof(path));
+  File cek = LittleFS.open(path, "r");
+  size_t ukuran = cek ? cek.size() : 0;
+  cek.close();
+  if (ukuran > 0 && ukuran + sizeof(blok) + blok.bytes > JOURNAL_SEGMENT_BYTES) {
+    journal.lastSeg++;
+    pathSegmen(journal.lastSeg, path, sizeof(path));
+    ukuran = 0;
+  }
+
+  // Batas jumlah segmen: buang yang tertua
+  if (journal.lastSeg - journal.firstSeg >= JOURNAL_MAX_SEGMENTS) {
+    char pathLama[32];
+    uint32_t lost = jumlahRecordSegmen(journal.firstSeg) - journal.readIdx;
+    pathSegmen(journal.firstSeg, pathLama, sizeof(pathLama));
+    LittleFS.remove(pathLama);
+    journal.firstSeg++;
+    journal.readIdx = 0;
+    journal.pending -= lost;
+    journal.dropped += lost;
+  }
+
+  File f = LittleFS.open(path, "a");
+  if (!f) return;
+  if (ukuran == 0) {
+    JournalSegmentHeader hdr = { JOURNAL_MAGIC, journal.lastSeg };
+    f.write((const uint8_t*)&hdr, sizeof(hdr));
+  }
+  f.write((const uint8_t*)&blok, sizeof(blok));
+  f.write(blokJurnal.data, blok.bytes);
+  f.close();
+
+  journal.blokRecord += blok.count;
+  journal.blokBytes += sizeof(blok) + blok.bytes;
+  resetBlokJurnal();
+}
+
+void tulisJurnal(const HistorySample& h, JournalSource source) {
+  if (!journal.ready) return;
+
+  SampelTerkuantisasi s;
+  s.epoch = h.epoch;
+  s.seq = h.seq;
+  s.nilai[0] = kuantisasi(h.ph, 100.0f);
+  s.nilai[1] = kuantisasi(h.tds, 1.0f);
+  s.nilai[2] = kuantisasi(h.turbidity, 10.0f);
+  s.nilai[3] = kuantisasi(h.jarak, 10.0f);
+  s.sumber = (uint8_t)source;
+
+  if (journal.pending == 0 && blokJurnal.enc.jumlah == 0) {
+    // Jurnal kosong: mulai dari segmen yang sedang ditulis
+    journal.firstSeg = journal.lastSeg;
+    journal.readIdx = jumlahRecordSegmen(journal.lastSeg);
+  }
+
+  uint32_t mulai = siklusSekarang();
+  bool muat = blokJurnal.enc.jumlah < JOURNAL_BLOCK_SAMPLES &&
+              enkodeSampel(blokJurnal.enc, blokJurnal.data, sizeof(blokJurnal.data), s);
+  if (!muat) {
+    tutupBlokJurnal();
+    enkodeSampel(blokJurnal.enc, blokJurnal.data, sizeof(blokJurnal.data), s);
+  }
+  journal.siklusEnkode += siklusSekarang() - mulai;
+
+  journal.pending++;
+  journal.written++;
+}
+
+void jurnalDariSampel(const SensorSample& sample, JournalSource source) {
+  HistorySample h;
+  if (!buatRiwayat(sample, h)) return;
+  tulisJurnal(h, source);
+  LOGI(TAG_JURNAL, "💾 Sampel disimpan ke jurnal (%lu menunggu, %lu hilang)\n",
+       (unsigned long)journal.pending, (unsigned long)journal.dropped);
+}
+
+// Panggil f(sampel) untuk tiap record segmen mulai index `dari`, maks
+// `max` record; return jumlah record yang diproses
+template<typename F>
+uint16_t bacaSegmenJurnal(uint32_t seg, uint32_t dari, uint16_t max, F f) {
+  char path[32];
+  pathSegmen(seg, path, sizeof(path));
+  File file = LittleFS.open(path, "r");
+  if (!file) return 0;
+
+  JournalSegmentHeader hdr;
+  if (file.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr) || hdr.magic != JOURNAL_MAGIC) {
+    file.close();
+    return 0;
+  }
+
+  uint16_t n = 0;
+  uint32_t idx = 0;
+  size_t pos = sizeof(hdr);
+  JournalBlockHeader blok;
+  uint8_t data[JOURNAL_BLOCK_BYTES];
+  while (n < max && file.read((uint8_t*)&blok, sizeof(blok)) == sizeof(blok)) {
+    pos += sizeof(blok) + blok.bytes;
+    if (idx + blok.count <= dari) {
+      idx += blok.count;
+      file.seek(pos);
+      continue;
+    }
+    if (blok.bytes > sizeof(data) || file.read(data, blok.bytes) != blok.bytes ||
+        crc16(data, blok.bytes) != blok.crc) {
+      // Blok rusak (mis. listrik padam saat menulis): sisa segmen diabaikan
+      journal.crcErrors++;
+      break;
+    }
+    DekompresorDeret dek(data, blok.bytes, blok.count);
+    SampelTerkuantisasi s;
+    while (n < max && dek.berikut(s)) {
+      if (idx++ < dari) continue;
+      f(s);
+      n++;
+    }
+  }
+  file.close();
+  return n;
+}
+
+void dariTerkuantisasi(const SampelTerkuantisasi& s, HistorySample& h) {
+  h.epoch = s.epoch;
+  h.seq = s.seq;
+  h.ph = s.nilai[0] / 100.0f;
+  h.tds = s.nilai[1];
+  h.turbidity = s.nilai[2] / 10.0f;
+  h.jarak = s.nilai[3] / 10.0f;
+  FuzzyResult fuzzy = evaluasiKualitasAir(h.ph, h.tds, h.turbidity);
+  h.score = fuzzy.score;
+  h.category = fuzzy.category;
+}
+
+// Baca sampai max record dari firstSeg mulai readIdx; return jumlah terbaca
+uint16_t bacaJurnal(HistorySample* out, uint16_t max) {
+  uint16_t i = 0;
+  return bacaSegmenJurnal(journal.firstSeg, journal.readIdx, max, [&](const SampelTerkuantisasi& s) {
+    dariTerkuantisasi(s, out[i++]);
+  });
+}
+
+void hapusSegmenPertama() {
+  char path[32];
+  uint32_t remaining = jumlahRecordSegmen(journal.firstSeg) - journal.readIdx;
+  pathSegmen(journal.firstSeg, path, sizeof(path));
+  LittleFS.remove(path);
+  journal.pending = (journal.pending > remaining) ? journal.pending - remaining : 0;
+  if (journal.firstSeg < journal.lastSeg) journal.firstSeg++;
+  journal.readIdx = 0;
+}
+
+bool jurnalPerluDrain(unsigned long nowMs) {
+  return journal.ready && journal.pending > 0 &&
+         nowMs - lastJournalDrainMillis >= JOURNAL_DRAIN_INTERVAL;
+}
+
+void drainJurnal(unsigned long nowMs) {
+  lastJournalDrainMillis = nowMs;
+  // Sudah online: blok terbuka ditulis dulu agar ikut terkirim
+  tutupBlokJurnal();
+
+  HistorySample batch[JOURNAL_DRAIN_BATCH];
+  uint16_t n = bacaJurnal(batch, JOURNAL_DRAIN_BATCH);
+  if (n == 0) {
+    // Segmen kosong atau rusak: lewati
+    hapusSegmenPertama();
+    return;
+  }
+
+  std::vector<struct firebase_firestore_document_write_t>& writes = mulaiCommit();
+  for (uint16_t i = 0; i < n; i++) tambahWriteRiwayat(writes, batch[i]);
+
+  if (!kirimCommit(writes)) {
+    LOGE(TAG_JURNAL, "✗ Drain jurnal gagal: %s\n", fbdo.errorReason().c_str());
+    return;
+  }
+
+  journal.readIdx += n;
+  journal.pending -= n;
+  journal.drained += n;
+
+  if (journal.readIdx >= jumlahRecordSegmen(journal.firstSeg) &&
+      (journal.firstSeg < journal.lastSeg || journal.pending == 0)) {
+    hapusSegmenPertama();
+  }
+
+  LOGI(TAG_JURNAL, "📤 Jurnal: %u record terkirim, sisa %lu\n", n, (unsigned long)journal.pending);
+}
+
+void cetakJurnal() {
+  uint32_t record = journal.blokRecord;
+  float perRecord = record ? (float)journal.blokBytes / record : 0;
+  Serial.printf("\n=== JURNAL: %lu menunggu (%u di blok RTC), segmen %lu..%lu, hilang %lu, CRC %lu ===\n",
+                (unsigned long)journal.pending, blokJurnal.enc.jumlah,
+                (unsigned long)journal.firstSeg, (unsigned long)journal.lastSeg,
+                (unsigned long)journal.dropped, (unsigned long)journal.crcErrors);
+  Serial.printf("Kompresi : %lu record di flash, %.2f byte/record (record mentah %u byte, rasio %.1fx)\n",
+                (unsigned long)record, perRecord, JOURNAL_RECORD_MENTAH,
+                perRecord > 0 ? JOURNAL_RECORD_MENTAH / perRecord : 0.0f);
+  Serial.printf("Enkode   : %.0f siklus/sampel (%lu sampel)\n",
+                journal.written ? (double)journal.siklusEnkode / journal.written : 0.0,
+                (unsigned long)journal.written);
+}
+
+// Dekode semua segmen ke Serial sebagai CSV (ekspor / debug)
+void dumpJurnal() {
+  Serial.println("epoch,seq,ph,tds,turbidity,jarak,sumber");
+  for (uint32_t seg = journal.firstSeg; seg <= journal.lastSeg; seg++) {
+    bacaSegmenJurnal(seg, 0, 0xFFFF, [](const SampelTerkuantisasi& s) {
+      Serial.printf("%lu,%lu,%.2f,%u,%.1f,%.1f,%u\n", (unsigned long)s.epoch, (unsigned long)s.seq,
+                    s.nilai[0] / 100.0f, s.nilai[1], s.nilai[2] / 10.0f, s.nilai[3] / 10.0f, s.sumber);
+    });
+  }
+}
+
+void perintahJurnal(char* args) {
+  while (*args == ' ') args++;
+  if (!strcmp(args, "dump")) {
+    tutupBlokJurnal();
+    dumpJurnal();
+  } else if (args[0] != '\0') {
+    Serial.println("jurnal [dump]");
+  } else {
+    cetakJurnal();
+  }
+}
+
+// --------------------------------------------------------------
+// SERVER LAN (HTTP + WEBSOCKET) UNTUK OPERATOR DI LOKASI
+// --------------------------------------------------------------
+// Jalur dashboard ESP32 -> Firestore -> Laravel -> browser butuh
+// beberapa detik dan memakan read Firestore. Di jaringan lokal
+// operator bisa membaca ESP32 langsung:
+//   GET /latest  -> JSON pembacaan terakhir
+//   GET /stream  -> WebSocket, satu pesan teks JSON per pembacaan baru
+//   GET /metrics -> teks format Prometheus dari metrik hot-path
+// Socket lwIP non-blocking dilayani task "lan" sendiri, jadi request
+// Firestore yang memblokir task jaringan tidak menahan update lokal.
+// Slot klien dan buffer statis (LAN_MAX_KLIEN); koneksi berikutnya
+// langsung dijawab 503. Task jaringan hanya mendorong sampel ke
+// lanQueue (SPSC), JSON dibangun di task lan. Respons HTTP selalu
+// "Connection: close".
+// --------------------------------------------------------------
+#define LAN_SERVER_ENABLED 1
+
+#if LAN_SERVER_ENABLED
+#ifndef LAN_PORT
+#define LAN_PORT 80
+#endif
+#define LAN_MAX_KLIEN 4
+#define LAN_RX_SIZE 512
+#define LAN_TX_SIZE 4096   // muat respons /metrics (10 tahap + hitungan trace)
+#define LAN_JSON_SIZE 320
+#define LAN_QUEUE_SIZE 4
+#define LAN_POLL_MS 10
+#define LAN_HTTP_TIMEOUT_MS 5000
+#define LAN_TASK_CORE 0
+
+const char WS_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+enum StatusKlien : uint8_t {
+  KLIEN_KOSONG,
+  KLIEN_HTTP,    // menunggu header request lengkap
+  KLIEN_WS,      // WebSocket /stream
+  KLIEN_TUTUP    // kirim sisa tx lalu tutup
+};
+
+struct KlienLan {
+  int fd;
+  StatusKlien status;
+  uint16_t rxLen;
+  uint16_t txLen;
+  uint16_t txSent;
+  unsigned long mulaiMs;
+  char rx[LAN_RX_SIZE];
+  uint8_t tx[LAN_TX_SIZE];
+};
+
+struct SampelLan {
+  SensorSample sample;
+  unsigned long capturedMillis;
+  float salinitas;   // dihitung task jaringan, konteksSalinitas tidak dibaca task lan
+};
+
+KlienLan lanKlien[LAN_MAX_KLIEN];
+SpscQueue<SampelLan, LAN_QUEUE_SIZE> lanQueue;   // task jaringan -> task lan
+int lanListenFd = -1;
+TaskHandle_t lanTaskHandle = nullptr;
+
+char lanLatestJson[LAN_JSON_SIZE];   // hanya ditulis/dibaca task lan
+size_t lanLatestLen = 0;
+char lanBody[LAN_TX_SIZE];           // scratch body respons (task lan)
+
+uint32_t lanDitolak = 0;       // koneksi ditolak karena slot penuh
+uint32_t lanFrameDibuang = 0;  // frame WS dibuang karena tx klien penuh
+
+// Dipanggil task jaringan untuk setiap pembacaan baru
+void kirimKeLan(const SensorSample& sample, unsigned long capturedMillis) {
+  SampelLan s = { sample, capturedMillis, hitungSalinitas(sample.tds) };
+  lanQueue.push(s);   // penuh: klien lambat, sampel ini dilewati
+}
+
+void tutupKlien(KlienLan& k) {
+  if (k.fd >= 0) close(k.fd);
+  k.fd = -1;
+  k.status = KLIEN_KOSONG;
+}
+
+bool antrekanTx(KlienLan& k, const void* data, size_t n) {
+  if (k.txSent > 0) {
+    // Geser sisa yang belum terkirim ke depan buffer
+    memmove(k.tx, k.tx + k.txSent, k.txLen - k.txSent);
+    k.txLen -= k.txSent;
+    k.txSent = 0;
+  }
+  if (k.txLen + n > LAN_TX_SIZE) return false;
+  memcpy(k.tx + k.txLen, data, n);
+  k.txLen += n;
+  return true;
+}
+
+void flushTx(KlienLan& k) {
+  while (k.txSent < k.txLen) {
+    int r = send(k.fd, k.tx + k.txSent, k.txLen - k.txSent, MSG_DONTWAIT);
+    if (r > 0) {
+      k.txSent += r;
+    } else {
+      if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+      tutupKlien(k);
+      return;
+    }
+  }
+  k.txLen = 0;
+  k.txSent = 0;
+  if (k.status == KLIEN_TUTUP) tutupKlien(k);
+}
+
+void kirimResponse(KlienLan& k, const char* status, const char* contentType, const char* body, size_t len) {
+  char header[192];
+  int n = snprintf(header, sizeof(header),
+                   "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+                   "Access-Control-Allow-Origin: *\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n",
+                   status, contentType, (unsigned)len);
+  k.status = KLIEN_TUTUP;
+  if (!antrekanTx(k, header, n) || !antrekanTx(k, body, len)) tutupKlien(k);
+}
+
+// Header frame server (tanpa mask) + payload teks
+void wsKirimTeks(KlienLan& k, const char* data, size_t n) {
+  uint8_t hdr[4];
+  size_t h = 2;
+  hdr[0] = 0x81;  // FIN + opcode teks
+  if (n < 126) {
+    hdr[1] = (uint8_t)n;
+  } else {
+    hdr[1] = 126;
+    hdr[2] = (uint8_t)(n >> 8);
+    hdr[3] = (uint8_t)n;
+    h = 4;
+  }
+  if (k.txLen - k.txSent + h + n > LAN_TX_SIZE) {
+    lanFrameDibuang++;
+    return;
+  }
+  antrekanTx(k, hdr, h);
+  antrekanTx(k, data, n);
+}
+
+void wsKirimKontrol(KlienLan& k, uint8_t opcode, const uint8_t* data, size_t n) {
+  uint8_t hdr[2] = { (uint8_t)(0x80 | opcode), (uint8_t)n };
+  if (antrekanTx(k, hdr, 2)) antrekanTx(k, data, n);
+}
+
+// Header HTTP (case-insensitive); nilai disalin ke out, false jika tidak ada
+bool cariHeader(const char* req, const char* nama, char* out, size_t cap) {
+  size_t n = strlen(nama);
+  for (const char* p = strstr(req, "\r\n"); p; p = strstr(p + 2, "\r\n")) {
+    const char* baris = p + 2;
+    if (strncasecmp(baris, nama, n) != 0 || baris[n] != ':') continue;
+    const char* v = baris + n + 1;
+    while (*v == ' ') v++;
+    size_t len = strcspn(v, "\r\n");
+    if (len >= cap) return false;
+    memcpy(out, v, len);
+    out[len] = '\0';
+    return true;
+  }
+  return false;
+}
+
+void bukaWebSocket(KlienLan& k) {
+  char key[64];
+  if (!cariHeader(k.rx, "Sec-WebSocket-Key", key, sizeof(key))) {
+    const char msg[] = "butuh WebSocket\n";
+    kirimResponse(k, "400 Bad Request", "text/plain", msg, sizeof(msg) - 1);
+    return;
+  }
+
+  char gabung[64 + sizeof(WS_GUID)];
+  snprintf(gabung, sizeof(gabung), "%s%s", key, WS_GUID);
+  uint8_t hash[20];
+  mbedtls_sha1((const unsigned char*)gabung, strlen(gabung), hash);
+  unsigned char accept[32];
+  size_t acceptLen = 0;
+  mbedtls_base64_encode(accept, sizeof(accept), &acceptLen, hash, sizeof(hash));
+
+  char resp[160];
+  int n = snprintf(resp, sizeof(resp),
+                   "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                   "Connection: Upgrade\r\nSec-WebSocket-Accept: %.*s\r\n\r\n",
+                   (int)acceptLen, accept);
+  k.status = KLIEN_WS;
+  k.rxLen = 0;
+  antrekanTx(k, resp, n);
+  if (lanLatestLen) wsKirimTeks(k, lanLatestJson, lanLatestLen);
+}
+
+size_t tulisMetrikTeks(char* buf, size_t cap) {
+  PayloadWriter w(buf, cap);
+  const MetrikPerangkat& m = metrikPerangkat;
+  w.tulis("tambaq_uptime_seconds ");
+  w.tulisUnsigned(millis() / 1000);
+  w.tulis("\ntambaq_cpu_mhz ");
+  w.tulisUnsigned(getCpuFrequencyMhz());
+  w.tulis("\ntambaq_heap_free_bytes ");
+  w.tulisUnsigned(ESP.getFreeHeap());
+  w.tulis("\ntambaq_heap_min_bytes ");
+  w.tulisUnsigned(ESP.getMinFreeHeap());
+  w.tulis("\ntambaq_wifi_rssi_dbm ");
+  if (m.rssiTerakhir < 0) w.tulisChar('-');
+  w.tulisUnsigned(m.rssiTerakhir < 0 ? -m.rssiTerakhir : m.rssiTerakhir);
+  w.tulis("\ntambaq_adc_overflow_total ");
+  w.tulisUnsigned(adcOverflowCount);
+  w.tulis("\ntambaq_echo_timeout_total ");
+  w.tulisUnsigned(echoTimeoutCount);
+  w.tulis("\ntambaq_echo_outlier_total ");
+  w.tulisUnsigned(echoOutlierCount);
+  w.tulis("\ntambaq_writes_sent_total ");
+  w.tulisUnsigned(uploadPolicy.sentWrites);
+  w.tulis("\ntambaq_writes_suppressed_total ");
+  w.tulisUnsigned(uploadPolicy.suppressedWrites);
+  w.tulis("\ntambaq_writes_budget_total ");
+  w.tulisUnsigned(uploadPolicy.budgetWrites);
+  w.tulis("\ntambaq_sampling_interval_ms ");
+  w.tulisUnsigned(intervalSampling());
+  w.tulis("\ntambaq_aggregates_sent_total ");
+  w.tulisUnsigned(agregatTerkirim);
+  w.tulis("\ntambaq_aggregates_dropped_total ");
+  w.tulisUnsigned(agregatHilang);
+  w.tulis("\ntambaq_http_new_connection_requests_total ");
+  w.tulisUnsigned(metrikKoneksi.baru);
+  w.tulis("\ntambaq_http_reused_connection_requests_total ");
+  w.tulisUnsigned(metrikKoneksi.reused);
+  w.tulis("\ntambaq_lan_rejected_total ");
+  w.tulisUnsigned(lanDitolak);
+  w.tulis("\ntambaq_lan_frames_dropped_total ");
+  w.tulisUnsigned(lanFrameDibuang);
+  w.tulis("\ntambaq_reading_seq ");
+  w.tulisUnsigned(seqReading);
+  w.tulisChar('\n');
+  for (int h = 0; h < NUM_HASIL_TRACE; h++) {
+    w.tulis("tambaq_readings_total{outcome=\"");
+    w.tulis(HASIL_TRACE_LABEL[h]);
+    w.tulis("\"} ");
+    w.tulisUnsigned(hitunganTrace[h].load(std::memory_order_relaxed));
+    w.tulisChar('\n');
+  }
+
+  const char* const NAMA[] = { "count", "mean", "p50", "p99", "max" };
+  for (int t = 0; t < NUM_TAHAP; t++) {
+    const HistogramTahap& h = histogramTahap[t];
+    uint64_t nilai[] = { h.jumlah, h.jumlah ? h.total / h.jumlah : 0,
+                         kuantilHistogram(h, 0.50f), kuantilHistogram(h, 0.99f), h.maks };
+    for (int i = 0; i < 5; i++) {
+      w.tulis("tambaq_stage_");
+      w.tulis(NAMA[i]);
+      w.tulis("{stage=\"");
+      w.tulis(TAHAP_LABEL[t]);
+      w.tulis("\",unit=\"");
+      w.tulis(TAHAP_SIKLUS[t] ? "cycles" : "us");
+      w.tulis("\"} ");
+      w.tulisUnsigned(nilai[i]);
+      w.tulisChar('\n');
+    }
+  }
+  return w.ok() ? w.length() : 0;
+}
+
+void prosesHttp(KlienLan& k) {
+  if (!strstr(k.rx, "\r\n\r\n")) {
+    if (k.rxLen >= LAN_RX_SIZE - 1) {
+      const char msg[] = "header terlalu besar\n";
+      kirimResponse(k, "431 Request Header Fields Too Large", "text/plain", msg, sizeof(msg) - 1);
+    }
+    return;
+  }
+
+  if (strncmp(k.rx, "GET ", 4) != 0) {
+    const char msg[] = "hanya GET\n";
+    kirimResponse(k, "405 Method Not Allowed", "text/plain", msg, sizeof(msg) - 1);
+    return;
+  }
+  const char* path = k.rx + 4;
+  size_t pathLen = strcspn(path, " ?");
+
+  if (pathLen == 7 && !strncmp(path, "/latest", 7)) {
+    if (lanLatestLen) {
+      kirimResponse(k, "200 OK", "application/json", lanLatestJson, lanLatestLen);
+    } else {
+      const char msg[] = "{\"error\":\"belum ada pembacaan\"}";
+      kirimResponse(k, "503 Service Unavailable", "application/json", msg, sizeof(msg) - 1);
+    }
+  } else if (pathLen == 7 && !strncmp(path, "/stream", 7)) {
+    bukaWebSocket(k);
+  } else if (pathLen == 8 && !strncmp(path, "/metrics", 8)) {
+    size_t n = tulisMetrikTeks(lanBody, sizeof(lanBody));
+    kirimResponse(k, "200 OK", "text/plain; version=0.0.4", lanBody, n);
+  } else {
+    const char msg[] = "/latest, /stream, /metrics\n";
+    kirimResponse(k, "404 Not Found", "text/plain", msg, sizeof(msg) - 1);
+  }
+}
+
+// Frame dari klien selalu ber-mask; hanya close & ping yang ditanggapi
+void prosesWs(KlienLan& k) {
+  while (k.rxLen >= 2) {
+    uint8_t* rx = (uint8_t*)k.rx;
+    uint8_t opcode = rx[0] & 0x0F;
+    size_t len = rx[1] & 0x7F;
+    size_t hdr = 2;
+    if (len == 126) {
+      if (k.rxLen < 4) return;
+      len = ((size_t)rx[2] << 8) | rx[3];
+      hdr = 4;
+    } else if (len == 127) {
+      tutupKlien(k);
+      return;
+    }
+    if (rx[1] & 0x80) hdr += 4;
+    if (hdr + len > LAN_RX_SIZE - 1) {
+      tutupKlien(k);
+      return;
+    }
+    if (k.rxLen < hdr + len) return;
+
+    uint8_t* payload = rx + hdr;
+    if (rx[1] & 0x80) {
+      const uint8_t* mask = rx + hdr - 4;
+      for (size_t i = 0; i < len; i++) payload[i] ^= mask[i & 3];
+    }
+    if (opcode == 0x8) {
+      wsKirimKontrol(k, 0x8, nullptr, 0);
+      k.status = KLIEN_TUTUP;
+      return;
+    }
+    if (opcode == 0x9 && len <= 125) wsKirimKontrol(k, 0xA, payload, len);
+
+    memmove(rx, rx + hdr + len, k.rxLen - hdr - len);
+    k.rxLen -= hdr + len;
+  }
+}
+
+void bacaKlien(KlienLan& k) {
+  int ruang = LAN_RX_SIZE - 1 - k.rxLen;
+  if (ruang <= 0) return;
+  int r = recv(k.fd, k.rx + k.rxLen, ruang, MSG_DONTWAIT);
+  if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    tutupKlien(k);
+    return;
+  }
+  if (r > 0) {
+    k.rxLen += r;
+    k.rx[k.rxLen] = '\0';
+  }
+}
+
+void terimaKlien(unsigned long now) {
+  for (;;) {
+    int fd = accept(lanListenFd, nullptr, nullptr);
+    if (fd < 0) return;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    KlienLan* slot = nullptr;
+    for (int i = 0; i < LAN_MAX_KLIEN && !slot; i++) {
+      if (lanKlien[i].status == KLIEN_KOSONG) slot = &lanKlien[i];
+    }
+    if (!slot) {
+      const char msg[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+      send(fd, msg, sizeof(msg) - 1, MSG_DONTWAIT);
+      close(fd);
+      lanDitolak++;
+      continue;
+    }
+    slot->fd = fd;
+    slot->status = KLIEN_HTTP;
+    slot->rxLen = 0;
+    slot->txLen = 0;
+    slot->txSent = 0;
+    slot->mulaiMs = now;
+  }
+}
+
+// Nama field sama dengan dokumen sensorRead/dataSensor
+void bangunJsonBacaan(const SampelLan& s) {
+  const SensorSample& sample = s.sample;
+  FuzzyResult fuzzy = evaluasiKualitasAir(sample.ph, sample.tds, sample.turbidity);
+  const char* const NAMA[] = { FS_PH_VALUE, FS_TDS_VALUE, FS_TURBIDITY_VALUE, FS_ULTRASONIC_VALUE,
+                               FS_SALINITAS_VALUE, FS_WATER_QUALITY_SCORE };
+  float nilai[] = { sample.ph, sample.tds, sample.turbidity, sample.jarak,
+                    s.salinitas, fuzzy.score };
+
+  PayloadWriter w(lanLatestJson, sizeof(lanLatestJson));
+  w.tulisChar('{');
+  for (int i = 0; i < 6; i++) {
+    w.tulisString(NAMA[i]);
+    w.tulisChar(':');
+    w.tulisDouble(nilai[i]);
+    w.tulisChar(',');
+  }
+  w.tulisString(FS_WATER_QUALITY_CATEGORY);
+  w.tulisChar(':');
+  w.tulisString(KATEGORI_LABEL[fuzzy.category]);
+  w.tulis(",\"capturedMs\":");
+  w.tulisUnsigned(s.capturedMillis);
+  if (sumberWaktu >= WAKTU_RTC) {
+    w.tulis(",\"timestamp\":");
+    w.tulisTimestamp((uint32_t)time(nullptr));
+  }
+  w.tulisChar('}');
+  lanLatestLen = w.ok() ? w.length() : 0;
+}
+
+void langkahLan() {
+  unsigned long now = millis();
+
+  SampelLan s;
+  while (lanQueue.pop(s)) {
+    bangunJsonBacaan(s);
+    for (int i = 0; i < LAN_MAX_KLIEN; i++) {
+      if (lanKlien[i].status == KLIEN_WS && lanLatestLen) wsKirimTeks(lanKlien[i], lanLatestJson, lanLatestLen);
+    }
+  }
+
+  terimaKlien(now);
+
+  for (int i = 0; i < LAN_MAX_KLIEN; i++) {
+    KlienLan& k = lanKlien[i];
+    if (k.status == KLIEN_KOSONG) continue;
+    if (k.status != KLIEN_TUTUP) bacaKlien(k);
+    if (k.status == KLIEN_HTTP) {
+      prosesHttp(k);
+      if (k.status == KLIEN_HTTP && now - k.mulaiMs >= LAN_HTTP_TIMEOUT_MS) tutupKlien(k);
+    } else if (k.status == KLIEN_WS) {
+      prosesWs(k);
+    }
+    if (k.status != KLIEN_KOSONG) flushTx(k);
+  }
+}
+
+void lanTask(void* arg) {
+  for (;;) {
+    langkahLan();
+    vTaskDelay(pdMS_TO_TICKS(LAN_POLL_MS));
+  }
+}
+
+void initServerLan() {
+  for (int i = 0; i < LAN_MAX_KLIEN; i++) {
+    lanKlien[i].fd = -1;
+    lanKlien[i].status = KLIEN_KOSONG;
+  }
+
+  lanListenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (lanListenFd < 0) {
+    LOGE(TAG_LAN, "✗ Server LAN: socket gagal\n");
+    return;
+  }
+  int satu = 1;
+  setsockopt(lanListenFd, SOL_SOCKET, SO_REUSEADDR, &satu, sizeof(satu));
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(LAN_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(lanListenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lanListenFd, LAN_MAX_KLIEN) < 0) {
+    LOGE(TAG_LAN, "✗ Server LAN: port %d tidak bisa dipakai\n", LAN_PORT);
+    close(lanListenFd);
+    lanListenFd = -1;
+    return;
+  }
+  fcntl(lanListenFd, F_SETFL, fcntl(lanListenFd, F_GETFL, 0) | O_NONBLOCK);
+
+  xTaskCreatePinnedToCore(lanTask, "lan", 4096, nullptr, 1, &lanTaskHandle, LAN_TASK_CORE);
+  LOGI(TAG_LAN, "🌐 Server LAN: http://%s:%d/latest, /stream (WebSocket), /metrics\n",
+       WiFi.localIP().toString().c_str(), LAN_PORT);
+}
+#else
+inline void kirimKeLan(const SensorSample&, unsigned long) {}
+inline void initServerLan() {}
+#endif
+
+// --------------------------------------------------------------
+// LOGGER: STATUS, MODE UART & BENCHMARK
+// --------------------------------------------------------------
+// Biaya per panggilan di jalur panas untuk blok DATA SENSOR:
+// Serial langsung = format + UART tertahan (FIFO 128 byte, sisanya
+// ~87 us/byte pada 115200), LOGI = salin argumen ke ring, LOGD di
+// build LOG_LEVEL_INFO = tidak ada kode sama sekali.
+// --------------------------------------------------------------
+#define LOG_BAUD 115200
+#define LOG_UART_FIFO 128
+
+void cetakLog() {
+  Serial.printf("\n=== LOG: mode %s, level build %c, ring %lu/%u word, %lu record, %lu hilang ===\n",
+                logStat.biner ? "biner" : "teks", LOG_LEVEL_HURUF[LOG_LEVEL < LOG_LEVEL_NONE ? LOG_LEVEL : 3],
+                (unsigned long)logRing.terpakai(), (unsigned)LOG_RING_WORDS,
+                (unsigned long)logStat.record, (unsigned long)logRing.jumlahHilang());
+  Serial.printf("UART     : %lu byte log, kamus %u/%u format\n",
+                (unsigned long)logStat.bytesUart, logStat.jumlahKamus, (unsigned)LOG_KAMUS_MAX);
+}
+
+void benchLog(uint32_t n) {
+  if (n == 0) n = 10000;
+  // Ring dipinjam dari task log: record bench diambil & dibuang di sini
+  flushLog(1000);
+  while (logSibuk.exchange(true, std::memory_order_acquire)) delay(1);
+
+  const float ph = 7.82f, tds = 491.4f, turb = 30.7f, jarak = 40.3f, sal = 0.482f, suhu = 28.5f, skor = 95.0f;
+  const char* kategori = "Excellent";
+  const int rule = 14;
+  char teks[LOG_TEKS_MAX];
+  uint32_t w[LOG_RECORD_MAX_WORDS];
+  uint64_t siklusFormat = 0, siklusRing = 0, siklusBuang = 0;
+  size_t bytesTeks = 0, wordsRecord = 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t t0 = siklusSekarang();
+    int len = snprintf(teks, sizeof(teks), LOG_FMT_DATA_SENSOR, ph, tds, turb, jarak, sal, suhu, skor, kategori, rule);
+    uint32_t t1 = siklusSekarang();
+    LOG_PANGGIL(LOG_LEVEL_INFO, TAG_SENSOR, LOG_FMT_DATA_SENSOR, ph, tds, turb, jarak, sal, suhu, skor, kategori, rule);
+    uint32_t t2 = siklusSekarang();
+    LOG_BUANG(LOG_FMT_DATA_SENSOR, ph, tds, turb, jarak, sal, suhu, skor, kategori, rule);
+    uint32_t t3 = siklusSekarang();
+    siklusFormat += t1 - t0;
+    siklusRing += t2 - t1;
+    siklusBuang += t3 - t2;
+    bytesTeks = len > 0 ? (size_t)len : 0;
+    wordsRecord = logRing.ambil(w);
+  }
+  logSibuk.store(false, std::memory_order_release);
+
+  // Round trip: record terakhir diformat ulang harus sama dengan snprintf
+  const uint8_t* arg = (const uint8_t*)&w[LOG_HEADER_WORDS];
+  char ulang[LOG_TEKS_MAX];
+  formatLog(LOG_FMT_DATA_SENSOR, arg, (wordsRecord - LOG_HEADER_WORDS) * 4, ulang, sizeof(ulang));
+  size_t argBytes = (wordsRecord - LOG_HEADER_WORDS) * 4;
+  size_t tertahan = bytesTeks > LOG_UART_FIFO ? bytesTeks - LOG_UART_FIFO : 0;
+
+  Serial.printf("\n=== BENCH LOG: %lu panggilan, blok DATA SENSOR ===\n", (unsigned long)n);
+  Serial.printf("Serial langsung: %.0f siklus format + %.1f ms UART tertahan (%u byte teks @%d)\n",
+                (double)siklusFormat / n, tertahan * 10000.0 / LOG_BAUD, (unsigned)bytesTeks, LOG_BAUD);
+  Serial.printf("LOGI ke ring   : %.0f siklus (%u byte record, frame biner %u byte)\n",
+                (double)siklusRing / n, (unsigned)(wordsRecord * 4), (unsigned)(8 + argBytes + 5));
+  Serial.printf("LOGD dibuang   : %.0f siklus (hanya overhead timer, level build %c)\n",
+                (double)siklusBuang / n, LOG_LEVEL_HURUF[LOG_LEVEL < LOG_LEVEL_NONE ? LOG_LEVEL : 3]);
+  Serial.printf("Format ulang   : %s\n", strcmp(ulang, teks) ? "BEDA" : "identik");
+}
+
+void perintahLog(char* args) {
+  while (*args == ' ') args++;
+  if (*args == '\0') {
+    cetakLog();
+  } else if (!strcmp(args, "teks")) {
+    logModeDiminta.store(LOG_MODE_TEKS);
+    Serial.println("✓ Log teks");
+  } else if (!strcmp(args, "biner") || !strcmp(args, "kamus")) {
+    // "kamus": kirim ulang kamus format setelah dekoder tersambung
+    logModeDiminta.store(LOG_MODE_BINER);
+    Serial.println("✓ Log biner (dekode: tambaq-sim --dekode-log FILE)");
+  } else if (!strncmp(args, "bench", 5) && (args[5] == ' ' || args[5] == '\0')) {
+    benchLog(strtoul(args + 5, nullptr, 10));
+  } else {
+    Serial.println("log [teks|biner|kamus|bench <n>]");
+  }
+}
+
+// --------------------------------------------------------------
+// KONTROL AKTUATOR LOKAL (HISTERESIS, MIN NYALA/MATI, OVERRIDE)
+// --------------------------------------------------------------
+// Aerator dan pompa tidak lagi menunggu rantai upload -> Laravel
+// ProcessFuzzyLogic -> Firestore (menit). Task sampling mengevaluasi
+// aturan di setiap sampel baru, tepat setelah konversi dan sebelum
+// reading masuk readingQueue, lalu langsung menulis GPIO relay. Latensi
+// akuisisi selesai -> relay = polling task sampling (1 tick) + konversi
+// + fuzzy, dicatat di TAHAP_KONTROL (batas AKTUATOR_LATENSI_MAKS_US).
+// Jalur ini tanpa jaringan, flash, lock maupun heap.
+// - Histeresis: nyala setelah melewati ambangNyala, mati hanya setelah
+//   kembali melewati ambangMati, jadi relay tidak bergetar di ambang
+// - Minimum nyala/mati melindungi motor (juga setelah boot); transisi
+//   yang tertahan diterapkan begitu waktunya lewat, tanpa menunggu sampel
+// - Override lokal "aktuator <nama> on|off|auto" menggantikan keputusan
+//   aturan, tetap tunduk minimum nyala/mati
+// - Nilai tidak valid (NaN, tidak ada rule fuzzy aktif): keputusan ditahan
+// Setiap perubahan masuk aktuasiQueue; task jaringan melaporkan keadaan
+// terakhir per aktuator ke actuatorState/<nama> (satu commit, diulang
+// jika gagal) tanpa pernah menahan jalur kontrol.
+// --------------------------------------------------------------
+#define AKTUATOR_LATENSI_MAKS_US 50000UL
+#define AKTUATOR_QUEUE_SIZE 16
+#define AKTUATOR_LAPOR_ULANG_MS 30000UL
+
+enum IdAktuator : uint8_t {
+  AKTUATOR_AERATOR,
+  AKTUATOR_POMPA,
+  NUM_AKTUATOR
+};
+
+enum SumberAturan : uint8_t {
+  SUMBER_SKOR,
+  SUMBER_PH,
+  SUMBER_TDS,
+  SUMBER_TURBIDITY,
+  NUM_SUMBER_ATURAN
+};
+
+// Nama field dataSensor untuk nilai pemicu (field "source" laporan)
+const char* const SUMBER_ATURAN_FIELD[NUM_SUMBER_ATURAN] = {
+  FS_WATER_QUALITY_SCORE, FS_PH_VALUE, FS_TDS_VALUE, FS_TURBIDITY_VALUE
+};
+
+enum ModeAktuator : uint8_t {
+  MODE_OTOMATIS,
+  MODE_PAKSA_NYALA,
+  MODE_PAKSA_MATI,
+  NUM_MODE_AKTUATOR
+};
+
+const char* const MODE_AKTUATOR_LABEL[NUM_MODE_AKTUATOR] = { "auto", "on", "off" };
+
+enum AlasanAktuasi : uint8_t {
+  ALASAN_BOOT,
+  ALASAN_ATURAN,
+  ALASAN_OVERRIDE,
+  NUM_ALASAN_AKTUASI
+};
+
+const char* const ALASAN_AKTUASI_LABEL[NUM_ALASAN_AKTUASI] = { "boot", "rule", "override" };
+
+struct AturanAktuator {
+  const char* nama;          // juga id dokumen actuatorState
+  uint8_t pin;
+  SumberAturan sumber;
+  bool nyalaDiAtas;          // true: nyala jika nilai > ambangNyala, false: jika < ambangNyala
+  float ambangNyala;
+  float ambangMati;
+  uint32_t minNyalaMs;
+  uint32_t minMatiMs;
+};
+
+// Aerator: skor fuzzy < 50 (Poor/Critical) sampai kembali >= 60.
+// Pompa ganti air: turbidity di atas band kritis (45 NTU) sampai < 35.
+const AturanAktuator ATURAN_AKTUATOR[NUM_AKTUATOR] = {
+  { "aerator", AERATOR_PIN, SUMBER_SKOR,      false, 50.0f, 60.0f, 5UL * 60000,  2UL * 60000 },
+  { "pompa",   POMPA_PIN,   SUMBER_TURBIDITY, true,  45.0f, 35.0f, 10UL * 60000, 5UL * 60000 }
+};
+
+struct StateAktuator {
+  bool nyala;                // level relay saat ini
+  bool inginNyala;           // keputusan aturan terakhir (memori histeresis)
+  uint8_t modeBerlaku;       // mode yang terakhir diterapkan
+  float nilai;               // nilai pemicu terakhir
+  unsigned long ubahMillis;  // relay terakhir berubah
+  uint32_t jumlahUbah;
+  uint32_t ditahan;          // sampel yang transisinya tertahan minimum nyala/mati
+  uint32_t tidakValid;
+};
+
+struct AktuasiItem {
+  uint8_t aktuator;
+  bool nyala;
+  uint8_t mode;
+  uint8_t alasan;
+  float nilai;
+  uint32_t seq;              // reading pemicu, 0 jika bukan dari sampel
+  uint32_t latensiUs;        // akuisisi selesai -> GPIO, 0 jika bukan dari sampel
+  uint32_t jumlahUbah;
+  uint64_t epochMs;          // 0 = waktu belum valid
+};
+
+StateAktuator stateAktuator[NUM_AKTUATOR];          // hanya ditulis task sampling
+std::atomic<uint8_t> modeAktuator[NUM_AKTUATOR];    // ditulis perintah serial
+SpscQueue<AktuasiItem, AKTUATOR_QUEUE_SIZE> aktuasiQueue;
+std::atomic<uint32_t> aktuasiOverflow(0);
+
+inline void tulisRelay(uint8_t pin, bool nyala) {
+  digitalWrite(pin, nyala == (RELAY_AKTIF_TINGGI != 0) ? HIGH : LOW);
+}
+
+// Producer aktuasiQueue: task sampling (dan setup() sebelum task dibuat)
+void laporkanAktuasi(uint8_t i, AlasanAktuasi alasan, uint32_t seq, uint32_t latensiUs, uint64_t epochMs) {
+  const StateAktuator& s = stateAktuator[i];
+  AktuasiItem a = { i, s.nyala, s.modeBerlaku, (uint8_t)alasan, s.nilai, seq, latensiUs, s.jumlahUbah, epochMs };
+  if (!aktuasiQueue.push(a)) aktuasiOverflow.fetch_add(1, std::memory_order_relaxed);
+  LOGI(TAG_AKTUATOR, "⚙ %s %s (%s, mode %s, %s %.2f)\n", ATURAN_AKTUATOR[i].nama, s.nyala ? "NYALA" : "MATI",
+       ALASAN_AKTUASI_LABEL[alasan], MODE_AKTUATOR_LABEL[s.modeBerlaku],
+       SUMBER_ATURAN_FIELD[ATURAN_AKTUATOR[i].sumber], s.nilai);
+}
+
+void initAktuator() {
+  unsigned long now = millis();
+  for (int i = 0; i < NUM_AKTUATOR; i++) {
+    pinMode(ATURAN_AKTUATOR[i].pin, OUTPUT);
+    tulisRelay(ATURAN_AKTUATOR[i].pin, false);
+    StateAktuator& s = stateAktuator[i];
+    s = {};
+    s.nilai = NAN;
+    // Minimum mati juga berlaku sejak boot (reset berulang tidak menyalakan motor terus)
+    s.ubahMillis = now;
+    laporkanAktuasi(i, ALASAN_BOOT, 0, 0, 0);
+  }
+}
+
+// Histeresis: `sebelumnya` = keputusan aturan terakhir
+bool keputusanAturan(const AturanAktuator& a, float x, bool sebelumnya) {
+  if (a.nyalaDiAtas) return sebelumnya ? x >= a.ambangMati : x > a.ambangNyala;
+  return sebelumnya ? x < a.ambangMati : x < a.ambangNyala;
+}
+
+bool keinginanAktuator(uint8_t i, uint8_t mode) {
+  if (mode == MODE_OTOMATIS) return stateAktuator[i].inginNyala;
+  return mode == MODE_PAKSA_NYALA;
+}
+
+// Tulis relay jika minimum nyala/mati sudah lewat; true jika berubah
+bool terapkanAktuator(uint8_t i, bool ingin, unsigned long now) {
+  StateAktuator& s = stateAktuator[i];
+  if (ingin == s.nyala) return false;
+  const AturanAktuator& a = ATURAN_AKTUATOR[i];
+  if (now - s.ubahMillis < (s.nyala ? a.minNyalaMs : a.minMatiMs)) return false;
+  tulisRelay(a.pin, ingin);
+  s.nyala = ingin;
+  s.ubahMillis = now;
+  s.jumlahUbah++;
+  return true;
+}
+
+inline AlasanAktuasi alasanMode(uint8_t mode) {
+  return mode == MODE_OTOMATIS ? ALASAN_ATURAN : ALASAN_OVERRIDE;
+}
+
+// Dipanggil task sampling setiap iterasi (1 tick): mode override baru
+// dan transisi yang selesai tertahan minimum nyala/mati
+void langkahAktuator(unsigned long now) {
+  for (uint8_t i = 0; i < NUM_AKTUATOR; i++) {
+    StateAktuator& s = stateAktuator[i];
+    uint8_t mode = modeAktuator[i].load(std::memory_order_relaxed);
+    bool modeBaru = mode != s.modeBerlaku;
+    s.modeBerlaku = mode;
+    if (terapkanAktuator(i, keinginanAktuator(i, mode), now) || modeBaru) {
+      laporkanAktuasi(i, alasanMode(mode), 0, 0, epochMsSekarang());
+    }
+  }
+}
+
+// Dipanggil task sampling untuk setiap sampel baru, sebelum readingQueue
+void kontrolAktuator(const SensorSample& sample, const TraceReading& trace, unsigned long now) {
+  FuzzyResult fuzzy = evaluasiKualitasAir(sample.ph, sample.tds, sample.turbidity);
+  const float nilai[NUM_SUMBER_ATURAN] = {
+    fuzzy.activeRules ? fuzzy.score : NAN, sample.ph, sample.tds, sample.turbidity
+  };
+  bool ubah[NUM_AKTUATOR];
+  for (uint8_t i = 0; i < NUM_AKTUATOR; i++) {
+    const AturanAktuator& a = ATURAN_AKTUATOR[i];
+    StateAktuator& s = stateAktuator[i];
+    float x = nilai[a.sumber];
+    s.nilai = x;
+    if (x != x) {
+      s.tidakValid++;
+    } else {
+      s.inginNyala = keputusanAturan(a, x, s.inginNyala);
+    }
+    bool ingin = keinginanAktuator(i, s.modeBerlaku);
+    ubah[i] = terapkanAktuator(i, ingin, now);
+    if (!ubah[i] && ingin != s.nyala) s.ditahan++;
+  }
+  uint32_t latensi = micros() - acqSelesaiUs;
+  catatTahap(TAHAP_KONTROL, latensi);
+  if (latensi > AKTUATOR_LATENSI_MAKS_US) {
+    LOGW(TAG_AKTUATOR, "⚠ Latensi sampel -> relay %lu us (batas %lu us)\n", (unsigned long)latensi,
+         (unsigned long)AKTUATOR_LATENSI_MAKS_US);
+  }
+
+  // Log & antrian laporan setelah semua relay ditulis
+  for (uint8_t i = 0; i < NUM_AKTUATOR; i++) {
+    if (ubah[i]) laporkanAktuasi(i, alasanMode(stateAktuator[i].modeBerlaku), trace.seq, latensi, trace.captureEpochMs);
+  }
+}
+
+// Dokumen actuatorState/<nama>; status "on"/"off" sama dengan enum
+// actuators.status di Laravel
+struct AktuatorDoc {
+  const char* status;
+  const char* mode;
+  const char* alasan;
+  const char* sumber;
+  float nilai;
+  uint32_t seq;
+  uint32_t bootId;
+  uint32_t jumlahUbah;
+  uint32_t latensiUs;
+  uint64_t changedAt;    // epoch ms, 0 = waktu belum valid (field tidak dikirim)
+  uint64_t reportedAt;
+};
+
+constexpr char FS_STATUS[] = "status";
+constexpr char FS_MODE[] = "mode";
+constexpr char FS_REASON[] = "reason";
+constexpr char FS_VALUE[] = "value";
+constexpr char FS_SWITCH_COUNT[] = "switchCount";
+constexpr char FS_LATENCY_US[] = "latencyUs";
+constexpr char FS_CHANGED_AT[] = "changedAt";
+constexpr char FS_REPORTED_AT[] = "reportedAt";
+
+typedef FirestoreSchema<AktuatorDoc,
+  FieldTeks<FS_STATUS, AktuatorDoc, &AktuatorDoc::status>,
+  FieldTeks<FS_MODE, AktuatorDoc, &AktuatorDoc::mode>,
+  FieldTeks<FS_REASON, AktuatorDoc, &AktuatorDoc::alasan>,
+  FieldTeks<FS_SOURCE, AktuatorDoc, &AktuatorDoc::sumber>,
+  FieldDouble<FS_VALUE, AktuatorDoc, &AktuatorDoc::nilai>,
+  FieldInteger<FS_SEQ, AktuatorDoc, &AktuatorDoc::seq>,
+  FieldInteger<FS_BOOT_ID, AktuatorDoc, &AktuatorDoc::bootId>,
+  FieldInteger<FS_SWITCH_COUNT, AktuatorDoc, &AktuatorDoc::jumlahUbah>,
+  FieldInteger<FS_LATENCY_US, AktuatorDoc, &AktuatorDoc::latensiUs>,
+  FieldTimestampMs<FS_CHANGED_AT, AktuatorDoc, &AktuatorDoc::changedAt>,
+  FieldTimestampMs<FS_REPORTED_AT, AktuatorDoc, &AktuatorDoc::reportedAt>
+> AktuatorSchema;
+
+#define AKTUATOR_BODY_SIZE 512
+#define AKTUATOR_FIELD_CHANGED_AT 9
+#define AKTUATOR_FIELD_REPORTED_AT 10
+
+static_assert(AktuatorSchema::Daftar::jumlah == AKTUATOR_FIELD_REPORTED_AT + 1, "timestamp di akhir AktuatorSchema");
+
+// Laporan per aktuator, hanya disentuh task jaringan
+struct LaporanAktuator {
+  AktuasiItem terakhir;
+  bool baru;
+};
+
+LaporanAktuator laporanAktuator[NUM_AKTUATOR];
+unsigned long laporAktuatorGagalMs = 0;
+bool laporAktuatorTertunda = false;   // commit terakhir gagal, tunggu AKTUATOR_LAPOR_ULANG_MS
+uint32_t laporAktuatorBatch = 0;
+uint32_t laporAktuatorGagal = 0;
+uint32_t laporAktuatorDigabung = 0;   // aktuasi yang tertimpa sebelum sempat dilaporkan
+
+void tambahWriteAktuator(std::vector<struct firebase_firestore_document_write_t>& writes, const AktuasiItem& a) {
+  AktuatorDoc doc = { a.nyala ? "on" : "off", MODE_AKTUATOR_LABEL[a.mode], ALASAN_AKTUASI_LABEL[a.alasan],
+                      SUMBER_ATURAN_FIELD[ATURAN_AKTUATOR[a.aktuator].sumber], a.nilai, a.seq, bootId,
+                      a.jumlahUbah, a.latensiUs, a.epochMs, epochMsSekarang() };
+  uint32_t mask = AktuatorSchema::SEMUA;
+  if (!doc.changedAt) mask &= ~(1UL << AKTUATOR_FIELD_CHANGED_AT);
+  if (!doc.reportedAt) mask &= ~(1UL << AKTUATOR_FIELD_REPORTED_AT);
+
+  char body[AKTUATOR_BODY_SIZE];
+  if (!AktuatorSchema::tulisBody(doc, mask, body, sizeof(body))) {
+    LOGE(TAG_AKTUATOR, "✗ Buffer payload aktuator tidak cukup!\n");
+    return;
+  }
+  char docPath[40];
+  snprintf(docPath, sizeof(docPath), "actuatorState/%s", ATURAN_AKTUATOR[a.aktuator].nama);
+
+  struct firebase_firestore_document_write_t w;
+  w.type = firebase_firestore_document_write_type_update;
+  w.update_document_content = body;
+  w.update_document_path = docPath;
+  writes.push_back(w);
+}
+
+// Dipanggil task jaringan tiap iterasi; leaf (tanpa cloud) hanya mengosongkan antrian
+void laporAktuator(unsigned long now, bool cloudReady) {
+  AktuasiItem a;
+  while (aktuasiQueue.pop(a)) {
+    LaporanAktuator& l = laporanAktuator[a.aktuator];
+    if (l.baru) laporAktuatorDigabung++;
+    l.terakhir = a;
+    l.baru = true;
+  }
+  if (!cloudReady) return;
+  if (laporAktuatorTertunda && now - laporAktuatorGagalMs < AKTUATOR_LAPOR_ULANG_MS) return;
+
+  std::vector<struct firebase_firestore_document_write_t>& writes = mulaiCommit();
+  for (const LaporanAktuator& l : laporanAktuator) {
+    if (l.baru) tambahWriteAktuator(writes, l.terakhir);
+  }
+  if (writes.empty()) return;
+
+  if (kirimCommit(writes)) {
+    for (LaporanAktuator& l : laporanAktuator) l.baru = false;
+    laporAktuatorTertunda = false;
+    laporAktuatorBatch++;
+  } else {
+    // Keadaan tetap di slot; percobaan berikutnya membawa yang terbaru
+    laporAktuatorTertunda = true;
+    laporAktuatorGagalMs = now;
+    laporAktuatorGagal++;
+    LOGE(TAG_AKTUATOR, "✗ Laporan aktuator gagal: %s\n", fbdo.errorReason().c_str());
+  }
+}
+
+// Nama aktuator ke-i (driver sim); nullptr jika di luar jangkauan
+const char* aktuatorNama(int i) {
+  return i >= 0 && i < NUM_AKTUATOR ? ATURAN_AKTUATOR[i].nama : nullptr;
+}
+
+// Hitungan per label (driver sim); i < 0 untuk hitungan laporan.
+// 0 jika label tidak dikenal
+uint32_t aktuatorHitungan(int i, const char* nama) {
+  if (i < 0 || i >= NUM_AKTUATOR) {
+    if (!strcmp(nama, "batch")) return laporAktuatorBatch;
+    if (!strcmp(nama, "gagal")) return laporAktuatorGagal;
+    if (!strcmp(nama, "digabung")) return laporAktuatorDigabung;
+    if (!strcmp(nama, "overflow")) return aktuasiOverflow.load(std::memory_order_relaxed);
+    if (!strcmp(nama, "antrian")) return aktuasiQueue.size();
+    if (!strcmp(nama, "tertunda")) {
+      uint32_t n = 0;
+      for (const LaporanAktuator& l : laporanAktuator) n += l.baru;
+      return n;
+    }
+    const HistogramTahap& h = histogramTahap[TAHAP_KONTROL];
+    if (!strcmp(nama, "sampel")) return h.jumlah;
+    if (!strcmp(nama, "latensiRata")) return h.jumlah ? (uint32_t)(h.total / h.jumlah) : 0;
+    if (!strcmp(nama, "latensiMaks")) return h.maks;
+    return 0;
+  }
+  const AturanAktuator& a = ATURAN_AKTUATOR[i];
+  const StateAktuator& s = stateAktuator[i];
+  if (!strcmp(nama, "pin")) return a.pin;
+  if (!strcmp(nama, "minNyalaMs")) return a.minNyalaMs;
+  if (!strcmp(nama, "minMatiMs")) return a.minMatiMs;
+  if (!strcmp(nama, "nyala")) return s.nyala;
+  if (!strcmp(nama, "ubah")) return s.jumlahUbah;
+  if (!strcmp(nama, "ditahan")) return s.ditahan;
+  if (!strcmp(nama, "tidakValid")) return s.tidakValid;
+  return 0;
+}
+
+void cetakAktuator() {
+  Serial.println("\n=== AKTUATOR (kontrol lokal) ===");
+  for (int i = 0; i < NUM_AKTUATOR; i++) {
+    const AturanAktuator& a = ATURAN_AKTUATOR[i];
+    const StateAktuator& s = stateAktuator[i];
+    Serial.printf("%-8s: %-5s mode %-4s %s %.2f (nyala %s %.2f, mati %s %.2f), min %lu/%lu s\n",
+                  a.nama, s.nyala ? "NYALA" : "MATI", MODE_AKTUATOR_LABEL[s.modeBerlaku],
+                  SUMBER_ATURAN_FIELD[a.sumber], s.nilai, a.nyalaDiAtas ? ">" : "<", a.ambangNyala,
+                  a.nyalaDiAtas ? "<" : ">=", a.ambangMati, (unsigned long)(a.minNyalaMs / 1000),
+                  (unsigned long)(a.minMatiMs / 1000));
+    Serial.printf("          %lu ubah, %lu sampel tertahan minimum, %lu tidak valid, %lu s sejak ubah\n",
+                  (unsigned long)s.jumlahUbah, (unsigned long)s.ditahan, (unsigned long)s.tidakValid,
+                  (millis() - s.ubahMillis) / 1000);
+  }
+  const HistogramTahap& h = histogramTahap[TAHAP_KONTROL];
+  Serial.printf("Latensi  : %lu sampel, p50 <= %lu us, p99 <= %lu us, max %lu us (batas %lu us)\n",
+                (unsigned long)h.jumlah, (unsigned long)kuantilHistogram(h, 0.50f),
+                (unsigned long)kuantilHistogram(h, 0.99f), (unsigned long)h.maks,
+                (unsigned long)AKTUATOR_LATENSI_MAKS_US);
+  Serial.printf("Laporan  : %lu commit, %lu gagal, %lu digabung, antrian %u, overflow %lu\n",
+                (unsigned long)laporAktuatorBatch, (unsigned long)laporAktuatorGagal,
+                (unsigned long)laporAktuatorDigabung, (unsigned)aktuasiQueue.size(),
+                (unsigned long)aktuasiOverflow.load(std::memory_order_relaxed));
+  Serial.println("=================================\n");
+}
+
+// "aktuator" = status, "aktuator <nama> auto|on|off" = override lokal
+void perintahAktuator(char* args) {
+  while (*args == ' ') args++;
+  if (args[0] == '\0') {
+    cetakAktuator();
+    return;
+  }
+  char* spasi = strchr(args, ' ');
+  int id = -1;
+  int mode = -1;
+  if (spasi) {
+    *spasi = '\0';
+    const char* m = spasi + 1;
+    while (*m == ' ') m++;
+    for (int i = 0; i < NUM_AKTUATOR; i++) {
+      if (!strcmp(args, ATURAN_AKTUATOR[i].nama)) id = i;
+    }
+    for (int k = 0; k < NUM_MODE_AKTUATOR; k++) {
+      if (!strcmp(m, MODE_AKTUATOR_LABEL[k])) mode = k;
+    }
+  }
+  if (id < 0 || mode < 0) {
+    Serial.println("aktuator [aerator|pompa auto|on|off]");
+    return;
+  }
+  // Diterapkan task sampling di iterasi berikutnya (<= 1 tick)
+  modeAktuator[id].store((uint8_t)mode, std::memory_order_relaxed);
+  Serial.printf("✓ %s mode %s\n", ATURAN_AKTUATOR[id].nama, MODE_AKTUATOR_LABEL[mode]);
+}
+
+// --------------------------------------------------------------
+// PERINTAH SERIAL (diproses task jaringan, non-blocking)
+// --------------------------------------------------------------
+#define SERIAL_CMD_MAX 64
+
+char serialCmd[SERIAL_CMD_MAX];
+uint8_t serialCmdLen = 0;
+
+void jalankanPerintah(char* line) {
+  if (!strncmp(line, "kal", 3) && (line[3] == ' ' || line[3] == '\0')) {
+    perintahKalibrasi(line + 3);
+  } else if (!strncmp(line, "suhu ", 5)) {
+    aturSuhuAir(atof(line + 5));
+    Serial.printf("✓ Suhu air %.1f C\n", suhuAirC);
+  } else if (!strncmp(line, "metrik", 6) && (line[6] == ' ' || line[6] == '\0')) {
+    perintahMetrik(line + 6);
+  } else if (!strncmp(line, "transport", 9) && (line[9] == ' ' || line[9] == '\0')) {
+    perintahTransport(line + 9);
+  } else if (!strncmp(line, "laju", 4) && (line[4] == ' ' || line[4] == '\0')) {
+    perintahLaju(line + 4);
+  } else if (!strncmp(line, "fuzzy", 5) && (line[5] == ' ' || line[5] == '\0')) {
+    perintahFuzzy(line + 5);
+  } else if (!strncmp(line, "agregat", 7) && (line[7] == ' ' || line[7] == '\0')) {
+    perintahAgregat(line + 7);
+  } else if (!strncmp(line, "jurnal", 6) && (line[6] == ' ' || line[6] == '\0')) {
+    perintahJurnal(line + 6);
+  } else if (!strncmp(line, "log", 3) && (line[3] == ' ' || line[3] == '\0')) {
+    perintahLog(line + 3);
+  } else if (!strcmp(line, "trace")) {
+    cetakTrace();
+  } else if (!strcmp(line, "espnow")) {
+    cetakEspNow();
+  } else if (!strncmp(line, "aktuator", 8) && (line[8] == ' ' || line[8] == '\0')) {
+    perintahAktuator(line + 8);
+  } else if (line[0] != '\0') {
+    Serial.println("Perintah: kal ..., suhu <C>, metrik [kirim], transport [rest|mqtt], laju [tetap|adaptif], "
+                   "fuzzy bench <n>, agregat [bench <n>], jurnal [dump], log [teks|biner|bench <n>], trace, espnow, "
+                   "aktuator [<nama> auto|on|off]");
+  }
+}
+
+void prosesPerintahSerial() {
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+    if (c == '\r') continue;
+    if (c == '\n') {
+      serialCmd[serialCmdLen] = '\0';
+      serialCmdLen = 0;
+      jalankanPerintah(serialCmd);
+    } else if (serialCmdLen < SERIAL_CMD_MAX - 1) {
+      serialCmd[serialCmdLen++] = c;
+    }
+  }
+}
+
+// --------------------------------------------------------------
+// PIPELINE DUAL-CORE
+// --------------------------------------------------------------
+// Core 1: task sampling (akuisisi + fuzzy input + relay aktuator), tidak
+//         pernah menyentuh jaringan, flash, atau fbdo.
+// Core 0: task jaringan, pemilik tunggal fbdo: upload live, commit
+//         riwayat, jurnal offline dan drain backlog.
+// Keduanya hanya terhubung lewat readingQueue (dan aktuasiQueue untuk
+// laporan relay). Handshake SSL 15-30 detik tidak lagi membekukan
+// sampling; jika antrian penuh, sampel terbaru dibuang dan dihitung di
+// readingOverflow.
+// --------------------------------------------------------------
+#define READING_QUEUE_SIZE 16
+#define SAMPLING_TASK_CORE 1
+#define NETWORK_TASK_CORE 0
+
+struct ReadingItem {
+  SensorSample sample;
+  unsigned long capturedMillis;
+  TraceReading trace;
+};
+
+SpscQueue<ReadingItem, READING_QUEUE_SIZE> readingQueue;
+volatile uint32_t readingOverflow = 0;   // ditulis task sampling
+volatile uint32_t readingHighWater = 0;  // isi antrian tertinggi
+
+// Hitungan hasil trace per label ("antrian" = reading yang belum
+// diproses task jaringan); 0 untuk label yang tidak dikenal
+uint32_t traceHitungan(const char* nama) {
+  if (!strcmp(nama, "antrian")) return readingQueue.size();
+  for (int h = 0; h < NUM_HASIL_TRACE; h++) {
+    if (!strcmp(nama, HASIL_TRACE_LABEL[h])) return hitunganTrace[h].load(std::memory_order_relaxed);
+  }
+  return 0;
+}
+
+void cetakTrace() {
+  uint32_t selesai = readingQueue.size();
+  Serial.printf("\n=== TRACE READING (boot %lu, seq %lu) ===\n", (unsigned long)bootId, (unsigned long)seqReading);
+  for (int h = 0; h < NUM_HASIL_TRACE; h++) {
+    uint32_t n = hitunganTrace[h].load(std::memory_order_relaxed);
+    if (h > TRACE_DIBACA && h < TRACE_ACK) selesai += n;
+    Serial.printf("%-12s: %lu\n", HASIL_TRACE_LABEL[h], (unsigned long)n);
+  }
+  // Setiap reading harus berakhir di tepat satu hasil (atau masih di antrian)
+  uint32_t dibaca = hitunganTrace[TRACE_DIBACA].load(std::memory_order_relaxed);
+  Serial.printf("Antrian     : %u, selisih akuntansi %ld\n", (unsigned)readingQueue.size(),
+                (long)dibaca - (long)selesai);
+  portENTER_CRITICAL(&traceMux);
+  AckTerakhir ack = ackTerakhir;
+  portEXIT_CRITICAL(&traceMux);
+  Serial.printf("Ack terakhir: seq %lu, epoch %llu ms\n", (unsigned long)ack.seq, (unsigned long long)ack.epochMs);
+  Serial.println("=================================\n");
+}
+
+TaskHandle_t samplingTaskHandle = nullptr;
+TaskHandle_t networkTaskHandle = nullptr;
+
+void langkahSampling() {
+  static bool acqPending = false;
+  static bool siklusPertama = true;  // sampel pertama langsung setelah boot
+  unsigned long start = micros();
+  unsigned long now = millis();
+  langkahAktuator(now);
+
+  // Mulai siklus akuisisi; hasilnya dikumpulkan di iterasi berikutnya
+  if (!acqPending && (siklusPertama || now - previousMillis >= intervalSampling())) {
+    siklusPertama = false;
+    previousMillis = now;
+    mulaiAkuisisi();
+    acqPending = true;
+  }
+
+  if (acqPending && akuisisiSelesai()) {
+    acqPending = false;
+    ReadingItem item;
+    item.sample = ambilSampel();
+    item.capturedMillis = now;
+    item.trace = mulaiTrace();
+    kontrolAktuator(item.sample, item.trace, now);
+    perbaruiLaju(item.sample, now);
+    if (!readingQueue.push(item)) {
+      readingOverflow++;
+      catatHasil(TRACE_ANTRIAN_PENUH);
+    }
+
+    uint32_t depth = readingQueue.size();
+    if (depth > readingHighWater) readingHighWater = depth;
+  }
+
+  unsigned long elapsed = micros() - start;
+  if (elapsed > loopMaxMicros) loopMaxMicros = elapsed;
+}
+
+void langkahJaringan() {
+  unsigned long now = millis();
+  prosesPerintahSerial();
+#if TAMBAQ_PERAN == PERAN_LEAF
+  laporAktuator(now, false);
+  langkahLeaf(now);
+  return;
+#endif
+
+  // Cek WiFi (retry tiap 5 detik tanpa delay); sampling tetap jalan
+  bool cloudReady = false;
+  bool wifiTerhubung = WiFi.status() == WL_CONNECTED;
+  if (!wifiTerhubung) {
+    if (now - lastWifiRetryMillis >= wifiRetryInterval) {
+      lastWifiRetryMillis = now;
+      LOGW(TAG_WIFI, "WiFi terputus! Reconnecting...\n");
+      WiFi.reconnect();
+    }
+  } else if (!Firebase.ready()) {
+    // Cek Firebase ready
+    if (now - lastFirebaseWaitLog >= firebaseWaitInterval) {
+      lastFirebaseWaitLog = now;
+      LOGW(TAG_CLOUD, "Firebase belum ready, menunggu...\n");
+    }
+  } else {
+    cloudReady = true;
+    rawatCacheBoot(now);
+  }
+#if TAMBAQ_PERAN == PERAN_GATEWAY
+  langkahGateway(now, cloudReady);
+#endif
+  laporAktuator(now, cloudReady);
+
+  ReadingItem item;
+  if (readingQueue.pop(item)) {
+    const SensorSample& sample = item.sample;
+    kirimKeLan(sample, item.capturedMillis);
+    if (wifiTerhubung) catatRssi(WiFi.RSSI());
+    LOGD(TAG_SENSOR, "\n📥 Antrian: %u/%u tersisa (max %lu, overflow %lu)\n",
+         (unsigned)readingQueue.size(), (unsigned)readingQueue.capacity(),
+         (unsigned long)readingHighWater, (unsigned long)readingOverflow);
+    bool historyDue = (item.capturedMillis - lastHistoryMillis >= historySampleInterval);
+    if (historyDue) lastHistoryMillis = item.capturedMillis;
+    catatAgregat(sample, item.capturedMillis);
+
+    // Live lewat transport aktif (REST: siap = cloudReady); riwayat tetap Firestore
+    bool dijurnal = false;
+    if (wifiTerhubung && transportAktif->siap()) {
+      // Upload live gagal -> simpan ke jurnal agar tidak hilang
+      if (!uploadSampel(sample, item.trace)) {
+        jurnalDariSampel(sample, JURNAL_LIVE_GAGAL);
+        dijurnal = true;
+      } else if (bootTimings.firstUploadMs == 0) {
+        bootTimings.firstUploadMs = millis();
+        LOGI(TAG_BOOT, "⏱ Upload pertama %lu ms setelah boot\n", bootTimings.firstUploadMs);
+      }
+    } else {
+      catatHasil(TRACE_TIDAK_SIAP);
+    }
+    if (cloudReady) {
+      if (historyDue && RIWAYAT_MENTAH) catatRiwayat(sample);
+      if (riwayatPerluFlush()) flushRiwayat();
+      if (agregatPerluFlush()) flushAgregat();
+    } else if (historyDue && !dijurnal) {
+      // Offline: riwayat langsung ke flash
+      jurnalDariSampel(sample, JURNAL_OFFLINE);
+    }
+    return;
+  }
+
+  // Backlog jurnal dikirim bertahap, hanya saat tidak ada sampel live
+  if (cloudReady && jurnalPerluDrain(now)) {
+    drainJurnal(now);
+  } else if (cloudReady && metrikPerluUpload(now)) {
+    uploadMetrik(now);
+  }
+}
+
+void samplingTask(void* arg) {
+  for (;;) {
+    langkahSampling();
+    vTaskDelay(1);
+  }
+}
+
+void networkTask(void* arg) {
+  for (;;) {
+    langkahJaringan();
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+}
+
+void initPipeline() {
+#if TAMBAQ_PERAN != PERAN_LEAF
+  initServerLan();
+  transportAktif->mulai();
+#endif
+  // Stack besar untuk TLS (BearSSL + buffer 8 KB)
+  xTaskCreatePinnedToCore(networkTask, "jaringan", 12288, nullptr, 1, &networkTaskHandle, NETWORK_TASK_CORE);
+  xTaskCreatePinnedToCore(samplingTask, "sampling", 4096, nullptr, 3, &samplingTaskHandle, SAMPLING_TASK_CORE);
+}
+
+// --------------------------------------------------------------
+// ESP-NOW: LEAF -> GATEWAY (FRAME TETAP, DEDUP, BATCH PER KOLAM)
+// --------------------------------------------------------------
+// Satu TLS + sign in per ESP32 tidak skala untuk banyak kolam. Build
+// TAMBAQ_PERAN=PERAN_LEAF hanya sampling: tiap reading dikirim sebagai
+// satu frame 26 byte lewat ESP-NOW (tanpa asosiasi AP, NTP, TLS,
+// Firebase). Frame yang tidak di-ack MAC dikirim ulang maks
+// LEAF_KIRIM_ULANG kali, jadi gateway bisa menerima frame yang sama
+// lebih dari sekali.
+// Build PERAN_GATEWAY = mandiri + menerima frame leaf di channel AP:
+// - callback task WiFi hanya menyalin frame ke frameQueue (SPSC)
+// - task jaringan menyaring per node: (nodeId, bootId, seq) dengan
+//   jendela geser GATEWAY_JENDELA_SEQ seq (seperti anti-replay IPsec),
+//   duplikat & frame basi dibuang, gap seq dihitung sebagai hilang
+// - bootId lebih kecil (NVS leaf terhapus) diterima sebagai reboot
+//   setelah GATEWAY_BOOT_ULANG frame beruntun dengan seq naik; frame
+//   basi tidak memperpanjang umur slot node
+// - reading terbaru per kolam disimpan; tiap GATEWAY_BATCH_MS semua
+//   kolam yang berubah ditulis dengan satu documents:commit ke
+//   sensorRead/kolam-<id> (skema dataSensor, semua field)
+// Leaf tidak punya jam epoch: capturedAt = waktu terima gateway - umur
+// frame. Salinitas & fuzzy dihitung gateway (suhu air gateway).
+// Frame little-endian versi 1:
+//   0 versi | 1 flag | 2 kolam u16 | 4 nodeId u32 (4 byte akhir MAC)
+//   8 bootId u16 | 10 seq u32 | 14 pH x100 | 16 TDS x10
+//   18 turbidity x10 | 20 jarak x10 | 22 umur ms (jenuh) | 24 CRC16
+// --------------------------------------------------------------
+#define FRAME_LEAF_VERSI 1
+#define FRAME_FLAG_ULANG 0x01            // kiriman ulang (ack MAC hilang/gagal)
+#define LEAF_KIRIM_ULANG 3
+#define LEAF_ACK_TIMEOUT_MS 50           // callback kirim tidak datang = gagal
+#define LEAF_JEDA_ULANG_MS 20            // x nomor percobaan
+#define GATEWAY_NODE_MAX 16
+#define GATEWAY_KOLAM_MAX 16
+#define GATEWAY_FRAME_QUEUE 32
+#define GATEWAY_JENDELA_SEQ 32
+#define GATEWAY_BATCH_MS 10000UL
+#define GATEWAY_NODE_KEDALUWARSA_MS 600000UL   // slot node boleh dipakai ulang
+#define GATEWAY_BOOT_ULANG 3             // frame beruntun bootId lain = leaf reboot (NVS terhapus)
+
+struct __attribute__((packed)) FrameLeafWire {
+  uint8_t versi;
+  uint8_t flag;
+  uint16_t kolam;
+  uint32_t nodeId;
+  uint16_t bootId;
+  uint32_t seq;
+  uint16_t ph;
+  uint16_t tds;
+  uint16_t turbidity;
+  uint16_t jarak;
+  uint16_t umurMs;
+  uint16_t crc;       // CRC16-CCITT byte sebelumnya
+};
+static_assert(sizeof(FrameLeafWire) == 26, "layout frame leaf berubah");
+#define FRAME_LEAF_SIZE sizeof(FrameLeafWire)
+
+struct FrameLeaf {
+  uint32_t nodeId;
+  uint32_t seq;
+  uint16_t kolam;
+  uint16_t bootId;
+  uint16_t umurMs;
+  uint8_t flag;
+  float ph;
+  float tds;
+  float turbidity;
+  float jarak;
+};
+
+// Return FRAME_LEAF_SIZE, 0 jika buffer tidak cukup
+size_t tulisFrameLeaf(const FrameLeaf& f, uint8_t* buf, size_t cap) {
+  if (cap < FRAME_LEAF_SIZE) return 0;
+  FrameLeafWire w;
+  w.versi = FRAME_LEAF_VERSI;
+  w.flag = f.flag;
+  w.kolam = f.kolam;
+  w.nodeId = f.nodeId;
+  w.bootId = f.bootId;
+  w.seq = f.seq;
+  w.ph = kuantisasi(f.ph, 100.0f);
+  w.tds = kuantisasi(f.tds, 10.0f);
+  w.turbidity = kuantisasi(f.turbidity, 10.0f);
+  w.jarak = kuantisasi(f.jarak, 10.0f);
+  w.umurMs = f.umurMs;
+  w.crc = crc16((const uint8_t*)&w, offsetof(FrameLeafWire, crc));
+  memcpy(buf, &w, sizeof(w));
+  return sizeof(w);
+}
+
+// false jika panjang, versi atau CRC tidak cocok
+bool bacaFrameLeaf(const uint8_t* buf, size_t len, FrameLeaf& f) {
+  FrameLeafWire w;
+  if (len != sizeof(w)) return false;
+  memcpy(&w, buf, sizeof(w));
+  if (w.versi != FRAME_LEAF_VERSI || w.crc != crc16(buf, offsetof(FrameLeafWire, crc))) return false;
+  f.nodeId = w.nodeId;
+  f.seq = w.seq;
+  f.kolam = w.kolam;
+  f.bootId = w.bootId;
+  f.umurMs = w.umurMs;
+  f.flag = w.flag;
+  f.ph = w.ph / 100.0f;
+  f.tds = w.tds / 10.0f;
+  f.turbidity = w.turbidity / 10.0f;
+  f.jarak = w.jarak / 10.0f;
+  return true;
+}
+
+// ---- Leaf ----
+
+enum StatusKirimLeaf : uint8_t {
+  KIRIM_MENUNGGU,
+  KIRIM_OK,
+  KIRIM_GAGAL
+};
+
+struct LeafState {
+  uint8_t gatewayMac[6];
+  uint32_t nodeId;
+  bool menunggu;              // frame di udara, status belum diproses
+  uint8_t percobaan;
+  unsigned long kirimMs;
+  unsigned long capturedMillis;
+  FrameLeaf frame;
+  TraceReading trace;
+  uint32_t frameKeluar;       // termasuk kiriman ulang
+  uint32_t diulang;
+  uint32_t ack;
+  uint32_t gagal;             // reading yang habis percobaannya
+};
+
+LeafState leaf = {};
+std::atomic<uint8_t> statusKirimLeaf(KIRIM_MENUNGGU);   // ditulis callback task WiFi
+
+void statusKirimEspNow(const uint8_t* mac, esp_now_send_status_t status) {
+  statusKirimLeaf.store(status == ESP_NOW_SEND_SUCCESS ? KIRIM_OK : KIRIM_GAGAL, std::memory_order_release);
+}
+
+void kirimFrameLeaf(unsigned long now) {
+  unsigned long umur = now - leaf.capturedMillis;
+  leaf.frame.umurMs = umur > 0xFFFF ? 0xFFFF : (uint16_t)umur;
+  leaf.frame.flag = leaf.percobaan > 0 ? FRAME_FLAG_ULANG : 0;
+  uint8_t buf[FRAME_LEAF_SIZE];
+  tulisFrameLeaf(leaf.frame, buf, sizeof(buf));
+
+  statusKirimLeaf.store(KIRIM_MENUNGGU, std::memory_order_relaxed);
+  leaf.menunggu = true;
+  leaf.kirimMs = now;
+  leaf.percobaan++;
+  leaf.frameKeluar++;
+  if (esp_now_send(leaf.gatewayMac, buf, sizeof(buf)) != ESP_OK) {
+    statusKirimLeaf.store(KIRIM_GAGAL, std::memory_order_relaxed);
+  }
+}
+
+// Pengganti isi task jaringan: satu frame di udara, reading berikutnya
+// menunggu di readingQueue
+void langkahLeaf(unsigned long now) {
+  if (leaf.menunggu) {
+    uint8_t status = statusKirimLeaf.load(std::memory_order_acquire);
+    if (status == KIRIM_MENUNGGU && now - leaf.kirimMs < LEAF_ACK_TIMEOUT_MS) return;
+    if (status == KIRIM_OK) {
+      leaf.menunggu = false;
+      leaf.ack++;
+      catatAck(leaf.trace.seq, leaf.trace.captureUs);
+      catatHasil(TRACE_TERKIRIM);
+    } else if (leaf.percobaan <= LEAF_KIRIM_ULANG) {
+      if (now - leaf.kirimMs < (unsigned long)LEAF_JEDA_ULANG_MS * leaf.percobaan) return;
+      leaf.diulang++;
+      kirimFrameLeaf(now);
+      return;
+    } else {
+      leaf.menunggu = false;
+      leaf.gagal++;
+      catatHasil(TRACE_GAGAL);
+      LOGW(TAG_ESPNOW, "✗ Frame seq %lu tidak sampai ke gateway setelah %u percobaan\n",
+           (unsigned long)leaf.frame.seq, (unsigned)leaf.percobaan);
+    }
+  }
+
+  ReadingItem item;
+  if (!readingQueue.pop(item)) return;
+  const SensorSample& s = item.sample;
+  FrameLeaf f = { leaf.nodeId, item.trace.seq, KOLAM_ID, (uint16_t)bootId, 0, 0,
+                  s.ph, s.tds, s.turbidity, s.jarak };
+  leaf.frame = f;
+  leaf.trace = item.trace;
+  leaf.capturedMillis = item.capturedMillis;
+  leaf.percobaan = 0;
+  kirimFrameLeaf(now);
+  LOGD(TAG_ESPNOW, "📡 Frame seq %lu -> gateway\n", (unsigned long)f.seq);
+}
+
+// ---- Gateway ----
+
+enum HasilFrame : uint8_t {
+  FRAME_BARU,          // seq tertinggi node -> reading terbaru kolam
+  FRAME_TERLAMBAT,     // belum pernah diterima, tapi lebih lama dari yang terbaru
+  FRAME_DUPLIKAT,
+  FRAME_BASI,          // di luar jendela seq / boot sebelumnya
+  FRAME_TABEL_PENUH,   // node baru, semua slot node masih aktif
+  FRAME_RUSAK,         // panjang / versi / CRC salah
+  NUM_HASIL_FRAME
+};
+
+const char* const HASIL_FRAME_LABEL[NUM_HASIL_FRAME] = {
+  "baru", "terlambat", "duplikat", "basi", "tabelPenuh", "rusak"
+};
+
+struct NodeLeaf {
+  bool aktif;
+  uint32_t nodeId;
+  uint16_t kolam;
+  uint16_t bootId;
+  uint32_t seqTertinggi;
+  uint32_t jendela;          // bit i: seqTertinggi - i sudah diterima
+  uint32_t seqTerendah;      // seq terendah boot ini yang sudah dihitung
+  unsigned long terakhirMs;  // frame terakhir dari boot yang berlaku
+  uint32_t diterima;
+  uint32_t hilang;           // gap seq yang belum terisi
+  uint16_t bootLain;         // bootId kandidat reboot (lebih kecil dari bootId)
+  uint8_t bootLainBeruntun;
+  uint32_t bootLainSeq;
+};
+
+struct SlotKolam {
+  bool aktif;
+  bool baru;                 // ada reading yang belum di-commit
+  uint16_t kolam;
+  FrameLeaf frame;
+  uint64_t capturedAt;       // epoch ms, 0 = jam gateway belum valid
+};
+
+struct FrameMasuk {
+  uint8_t data[FRAME_LEAF_SIZE];
+  unsigned long diterimaMs;
+};
+
+struct GatewayState {
+  NodeLeaf node[GATEWAY_NODE_MAX];
+  SlotKolam kolam[GATEWAY_KOLAM_MAX];
+  uint32_t hasil[NUM_HASIL_FRAME];
+  uint32_t ulang;            // frame berflag kiriman ulang
+  uint32_t digabung;         // reading kolam ditimpa sebelum sempat di-commit
+  uint32_t kolamPenuh;
+  uint32_t batch;
+  uint32_t dokumen;
+  uint32_t batchGagal;
+  unsigned long flushMs;
+};
+
+GatewayState gateway = {};
+SpscQueue<FrameMasuk, GATEWAY_FRAME_QUEUE> frameQueue;
+std::atomic<uint32_t> frameRusakRx(0);        // ditulis callback task WiFi
+std::atomic<uint32_t> frameAntrianPenuh(0);
+
+void terimaEspNow(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+  if (len != (int)FRAME_LEAF_SIZE) {
+    frameRusakRx.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  FrameMasuk m;
+  memcpy(m.data, data, FRAME_LEAF_SIZE);
+  m.diterimaMs = millis();
+  if (!frameQueue.push(m)) frameAntrianPenuh.fetch_add(1, std::memory_order_relaxed);
+}
+
+NodeLeaf* cariNodeLeaf(uint32_t nodeId, unsigned long nowMs) {
+  NodeLeaf* bebas = nullptr;
+  for (NodeLeaf& n : gateway.node) {
+    if (n.aktif && n.nodeId == nodeId) return &n;
+    if (!bebas && (!n.aktif || nowMs - n.terakhirMs >= GATEWAY_NODE_KEDALUWARSA_MS)) bebas = &n;
+  }
+  if (bebas) {
+    memset(bebas, 0, sizeof(*bebas));
+    bebas->aktif = true;
+    bebas->nodeId = nodeId;
+  }
+  return bebas;
+}
+
+HasilFrame saringFrame(const FrameLeaf& f, unsigned long nowMs) {
+  NodeLeaf* n = cariNodeLeaf(f.nodeId, nowMs);
+  if (!n) return FRAME_TABEL_PENUH;
+
+  // bootId mundur: frame tertunda dari boot lama, atau leaf reboot
+  // dengan NVS terhapus. Yang kedua dikenali dari frame beruntun.
+  bool reboot = false;
+  if (n->diterima > 0 && (int16_t)(f.bootId - n->bootId) < 0) {
+    bool lanjut = n->bootLainBeruntun > 0 && f.bootId == n->bootLain;
+    if (lanjut && f.seq <= n->bootLainSeq) return FRAME_BASI;   // kiriman ulang frame kandidat
+    if (!lanjut) {
+      n->bootLain = f.bootId;
+      n->bootLainBeruntun = 0;
+    }
+    n->bootLainSeq = f.seq;
+    if (++n->bootLainBeruntun < GATEWAY_BOOT_ULANG) return FRAME_BASI;
+    reboot = true;
+  }
+  n->bootLainBeruntun = 0;
+  n->terakhirMs = nowMs;
+  n->kolam = f.kolam;
+
+  // Node baru atau leaf reboot: jendela mulai dari frame ini
+  if (n->diterima == 0 || reboot || (int16_t)(f.bootId - n->bootId) > 0) {
+    n->bootId = f.bootId;
+    n->seqTertinggi = f.seq;
+    n->seqTerendah = f.seq;
+    n->jendela = 1;
+    n->diterima++;
+    return FRAME_BARU;
+  }
+
+  if (f.seq > n->seqTertinggi) {
+    uint32_t geser = f.seq - n->seqTertinggi;
+    n->hilang += geser - 1;
+    n->jendela = geser >= GATEWAY_JENDELA_SEQ ? 1 : (n->jendela << geser) | 1;
+    n->seqTertinggi = f.seq;
+    n->diterima++;
+    return FRAME_BARU;
+  }
+  uint32_t mundur = n->seqTertinggi - f.seq;
+  if (mundur >= GATEWAY_JENDELA_SEQ) return FRAME_BASI;
+  uint32_t bit = 1UL << mundur;
+  if (n->jendela & bit) return FRAME_DUPLIKAT;
+  n->jendela |= bit;
+  if (f.seq < n->seqTerendah) {
+    // Lebih tua dari frame pertama boot ini (gateway baru restart, frame
+    // tersusul): gap di bawahnya belum pernah masuk hilang
+    n->hilang += n->seqTerendah - f.seq - 1;
+    n->seqTerendah = f.seq;
+  } else {
+    n->hilang--;
+  }
+  n->diterima++;
+  return FRAME_TERLAMBAT;
+}
+
+void simpanKolam(const FrameLeaf& f, uint64_t capturedAt) {
+  SlotKolam* slot = nullptr;
+  for (SlotKolam& s : gateway.kolam) {
+    if (s.aktif && s.kolam == f.kolam) {
+      slot = &s;
+      break;
+    }
+    if (!slot && !s.aktif) slot = &s;
+  }
+  if (!slot) {
+    gateway.kolamPenuh++;
+    return;
+  }
+  if (slot->aktif && slot->baru) gateway.digabung++;
+  slot->aktif = true;
+  slot->baru = true;
+  slot->kolam = f.kolam;
+  slot->frame = f;
+  slot->capturedAt = capturedAt;
+}
+
+// Satu dokumen sensorRead/kolam-<id>; body disalin ke struct write oleh library
+void tambahWriteKolam(std::vector<struct firebase_firestore_document_write_t>& writes, const SlotKolam& s) {
+  const FrameLeaf& f = s.frame;
+  FuzzyResult fuzzy = evaluasiKualitasAir(f.ph, f.tds, f.turbidity);
+  DataSensorDoc doc = { f.ph, f.tds, f.turbidity, f.jarak, hitungSalinitas(f.tds), fuzzy.score,
+                        (uint8_t)fuzzy.category, f.seq, f.bootId, s.capturedAt, epochMsSekarang(), 0, 0 };
+  uint32_t mask = ((1UL << NUM_UPLOAD_FIELDS) - 1) | DATA_SENSOR_SCORE_MASK | maskTrace(doc);
+
+  char body[DATA_SENSOR_BODY_SIZE];
+  uint32_t mulaiPayload = siklusSekarang();
+  bool payloadOk = DataSensorSchema::tulisBody(doc, mask, body, sizeof(body));
+  catatSiklus(TAHAP_PAYLOAD, mulaiPayload);
+  if (!payloadOk) {
+    LOGE(TAG_ESPNOW, "✗ Buffer payload kolam tidak cukup!\n");
+    return;
+  }
+
+  char docPath[32];
+  snprintf(docPath, sizeof(docPath), "sensorRead/kolam-%u", (unsigned)f.kolam);
+
+  struct firebase_firestore_document_write_t w;
+  w.type = firebase_firestore_document_write_type_update;
+  w.update_document_content = body;
+  w.update_document_path = docPath;
+  writes.push_back(w);
+}
+
+void flushGateway(unsigned long now) {
+  gateway.flushMs = now;
+  std::vector<struct firebase_firestore_document_write_t>& writes = mulaiCommit();
+  for (const SlotKolam& s : gateway.kolam) {
+    if (s.aktif && s.baru) tambahWriteKolam(writes, s);
+  }
+  if (writes.empty()) return;
+
+  uint16_t n = writes.size();
+  LOGI(TAG_ESPNOW, "📦 Commit %u kolam leaf...\n", (unsigned)n);
+  if (kirimCommit(writes)) {
+    for (SlotKolam& s : gateway.kolam) s.baru = false;
+    gateway.batch++;
+    gateway.dokumen += n;
+  } else {
+    // Reading tetap di slot; batch berikutnya membawa yang terbaru
+    gateway.batchGagal++;
+    LOGE(TAG_ESPNOW, "✗ Commit kolam gagal: %s\n", fbdo.errorReason().c_str());
+  }
+}
+
+void langkahGateway(unsigned long now, bool cloudReady) {
+  FrameMasuk m;
+  while (frameQueue.pop(m)) {
+    FrameLeaf f;
+    if (!bacaFrameLeaf(m.data, sizeof(m.data), f)) {
+      gateway.hasil[FRAME_RUSAK]++;
+      continue;
+    }
+    if (f.flag & FRAME_FLAG_ULANG) gateway.ulang++;
+    HasilFrame h = saringFrame(f, m.diterimaMs);
+    gateway.hasil[h]++;
+    if (h != FRAME_BARU) continue;
+    uint64_t epoch = epochMsSekarang();
+    simpanKolam(f, epoch ? epoch - (now - m.diterimaMs) - f.umurMs : 0);
+  }
+  if (cloudReady && now - gateway.flushMs >= GATEWAY_BATCH_MS) flushGateway(now);
+}
+
+void initEspNow() {
+#if TAMBAQ_PERAN == PERAN_LEAF
+  // Radio saja di channel gateway, tanpa asosiasi AP
+  WiFi.mode(WIFI_STA);
+  esp_wifi_set_channel(ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE);
+#endif
+  if (esp_now_init() != ESP_OK) {
+    LOGE(TAG_ESPNOW, "✗ esp_now_init gagal, ESP-NOW nonaktif\n");
+    return;
+  }
+#if TAMBAQ_PERAN == PERAN_LEAF
+  uint8_t mac[6];
+  esp_wifi_get_mac(WIFI_IF_STA, mac);
+  leaf.nodeId = (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5];
+  unsigned int g[6];
+  if (sscanf(ESPNOW_GATEWAY_MAC, "%x:%x:%x:%x:%x:%x", &g[0], &g[1], &g[2], &g[3], &g[4], &g[5]) != 6) {
+    LOGE(TAG_ESPNOW, "✗ ESPNOW_GATEWAY_MAC tidak valid: %s\n", ESPNOW_GATEWAY_MAC);
+    return;
+  }
+  for (int i = 0; i < 6; i++) leaf.gatewayMac[i] = (uint8_t)g[i];
+
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, leaf.gatewayMac, 6);
+  peer.channel = ESPNOW_CHANNEL;
+  peer.ifidx = WIFI_IF_STA;
+  peer.encrypt = false;
+  esp_now_add_peer(&peer);
+  esp_now_register_send_cb(statusKirimEspNow);
+  LOGI(TAG_ESPNOW, "✓ Leaf %08lx kolam %u -> gateway %s (channel %d)\n", (unsigned long)leaf.nodeId,
+       (unsigned)KOLAM_ID, ESPNOW_GATEWAY_MAC, ESPNOW_CHANNEL);
+#else
+  esp_now_register_recv_cb(terimaEspNow);
+  LOGI(TAG_ESPNOW, "✓ Gateway ESP-NOW di channel %d (ESPNOW_CHANNEL leaf harus sama)\n", (int)WiFi.channel());
+#endif
+}
+
+// Hitungan per label (driver sim / perintah espnow); 0 jika tidak dikenal
+uint32_t espnowHitungan(const char* nama) {
+  for (int h = 0; h < NUM_HASIL_FRAME; h++) {
+    if (strcmp(nama, HASIL_FRAME_LABEL[h])) continue;
+    return gateway.hasil[h] + (h == FRAME_RUSAK ? frameRusakRx.load(std::memory_order_relaxed) : 0);
+  }
+  if (!strcmp(nama, "antrianPenuh")) return frameAntrianPenuh.load(std::memory_order_relaxed);
+  if (!strcmp(nama, "ulang")) return gateway.ulang;
+  if (!strcmp(nama, "digabung")) return gateway.digabung;
+  if (!strcmp(nama, "batch")) return gateway.batch;
+  if (!strcmp(nama, "dokumen")) return gateway.dokumen;
+  if (!strcmp(nama, "batchGagal")) return gateway.batchGagal;
+  if (!strcmp(nama, "hilang")) {
+    uint32_t total = 0;
+    for (const NodeLeaf& n : gateway.node) total += n.aktif ? n.hilang : 0;
+    return total;
+  }
+  return 0;
+}
+
+void cetakEspNow() {
+#if TAMBAQ_PERAN == PERAN_LEAF
+  Serial.printf("\n=== ESP-NOW LEAF %08lx (kolam %u, channel %d) ===\n", (unsigned long)leaf.nodeId,
+                (unsigned)KOLAM_ID, ESPNOW_CHANNEL);
+  Serial.printf("Frame       : %lu keluar (%lu ulang), %lu ack, %lu reading gagal\n",
+                (unsigned long)leaf.frameKeluar, (unsigned long)leaf.diulang, (unsigned long)leaf.ack,
+                (unsigned long)leaf.gagal);
+#elif TAMBAQ_PERAN == PERAN_GATEWAY
+  Serial.printf("\n=== ESP-NOW GATEWAY (channel %d) ===\n", (int)WiFi.channel());
+  for (int h = 0; h < NUM_HASIL_FRAME; h++) {
+    Serial.printf("%-12s: %lu\n", HASIL_FRAME_LABEL[h], (unsigned long)espnowHitungan(HASIL_FRAME_LABEL[h]));
+  }
+  Serial.printf("Antrian     : %u, penuh %lu, ulang %lu\n", (unsigned)frameQueue.size(),
+                (unsigned long)espnowHitungan("antrianPenuh"), (unsigned long)gateway.ulang);
+  Serial.printf("Batch       : %lu commit, %lu dokumen, %lu gagal, %lu reading digabung\n",
+                (unsigned long)gateway.batch, (unsigned long)gateway.dokumen,
+                (unsigned long)gateway.batchGagal, (unsigned long)gateway.digabung);
+  unsigned long now = millis();
+  for (const NodeLeaf& n : gateway.node) {
+    if (!n.aktif) continue;
+    Serial.printf("  node %08lx kolam %-3u boot %-5u seq %-7lu diterima %-7lu hilang %-5lu %lu s lalu\n",
+                  (unsigned long)n.nodeId, (unsigned)n.kolam, (unsigned)n.bootId,
+                  (unsigned long)n.seqTertinggi, (unsigned long)n.diterima, (unsigned long)n.hilang,
+                  (now - n.terakhirMs) / 1000);
+  }
+#else
+  Serial.println("ESP-NOW nonaktif (build TAMBAQ_PERAN=PERAN_LEAF / PERAN_GATEWAY)");
+#endif
+  Serial.println("=================================\n");
+}
+
+// --------------------------------------------------------------
+void loop() {
+  // Semua kerja ada di task sampling & jaringan
+  vTaskDelete(NULL);
+}
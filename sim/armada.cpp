@@ -0,0 +1,707 @@
+// --------------------------------------------------------------
+// GENERATOR BEBAN ARMADA: N node ESP32 virtual -> emulator Firestore
+// --------------------------------------------------------------
+// Satu TU dengan firmware (#include kodeesp32.cpp) agar fuzzy,
+// salinitas, kebijakan upload (deadband/heartbeat/anggaran) dan skema
+// payload dataSensor dipakai apa adanya. State kebijakan tiap node
+// ditukar ke global uploadPolicy sebelum setiap keputusan, jadi semua
+// node berjalan di satu thread: event loop epoll, socket non-blocking,
+// satu koneksi keep-alive dan satu request in-flight per node (seperti
+// task jaringan firmware), jam dinding asli. Setiap node menulis
+// sensorRead/esp32-NNNN lewat PATCH REST emulator (HTTP, tanpa TLS,
+// "Authorization: Bearer owner" melewati security rules).
+// --------------------------------------------------------------
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <time.h>
+#include <algorithm>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../kodeesp32.cpp"
+
+// stubs.cpp mencatat latensi langkah untuk driver sim; tidak dipakai di sini
+void simCatatLatensiSampling(uint64_t) {}
+void simCatatLatensiTimer(uint64_t) {}
+
+#define ARMADA_RX_MAX 65536
+#define ARMADA_EPOLL_BATCH 256
+#define ARMADA_CEK_TIMEOUT_US 50000
+
+struct PutusArmada {
+  double mulaiDetik;
+  double durasiDetik;
+  double fraksi;      // bagian node yang ikut putus (0..1]
+  bool aktif;
+};
+
+struct KonfigArmada {
+  int node = 100;
+  double durasiDetik = 300;
+  uint32_t intervalMs = 10000;    // laju tetap firmware
+  uint32_t jitterMs = 500;        // +- per siklus sampling
+  std::string host = "127.0.0.1";
+  int port = 8080;
+  std::string proyek = "demo-tambaq";
+  uint32_t timeoutMs = 10000;
+  bool keepAlive = true;
+  bool serentak = false;          // semua node boot bersamaan
+  uint32_t seed = 1;
+  double laporanDetik = 10;
+  std::vector<PutusArmada> putus;
+};
+
+enum StatusNode : uint8_t {
+  NODE_DIAM,      // tidak ada request
+  NODE_SAMBUNG,   // connect() non-blocking berjalan
+  NODE_KIRIM,     // request belum habis ditulis
+  NODE_TERIMA     // menunggu respons lengkap
+};
+
+enum ErrorArmada : uint8_t {
+  ERR_DITOLAK,    // ECONNREFUSED
+  ERR_KONEKSI,    // connect gagal lainnya
+  ERR_TIMEOUT,
+  ERR_PUTUS,      // EOF/reset sebelum respons lengkap
+  ERR_HTTP_4XX,
+  ERR_HTTP_429,
+  ERR_HTTP_5XX,
+  ERR_OUTAGE,     // request dibatalkan karena node masuk jendela putus
+  NUM_ERR
+};
+
+const char* const ERR_LABEL[NUM_ERR] = {
+  "ditolak", "koneksi", "timeout", "putus", "4xx", "429", "5xx", "outage"
+};
+
+struct ReadingArmada {
+  float nilai[NUM_UPLOAD_FIELDS];
+  FuzzyResult fuzzy;
+  uint32_t seq;
+  uint64_t captureUs;
+  uint64_t captureEpochMs;
+};
+
+struct NodeArmada {
+  char id[24];
+  int fd;
+  StatusNode status;
+  bool putus;
+  bool koneksiBaru;
+  std::mt19937 rng;
+  float rata[4];            // titik tengah pH, TDS, turbidity, jarak
+  float nilai[4];
+  UploadPolicyState policy;
+  uint32_t seq;
+  uint32_t ackSeq;
+  uint64_t ackAt;
+  ReadingArmada antrian[READING_QUEUE_SIZE];
+  uint8_t kepala;
+  uint8_t isi;
+  ReadingArmada kirim;
+  UploadDecision keputusan;
+  std::string tx;
+  size_t txTerkirim;
+  std::string rx;
+  uint64_t mulaiUs;
+  uint64_t sambungUs;
+};
+
+struct StatArmada {
+  uint64_t hasil[NUM_HASIL_TRACE] = {};
+  uint64_t error[NUM_ERR] = {};
+  uint64_t koneksi = 0;
+  uint64_t bytesKeluar = 0;
+  uint64_t bytesMasuk = 0;
+  std::vector<uint64_t> latensiUs;     // mulai request (termasuk connect) -> respons
+  std::vector<uint64_t> sambungUs;
+  std::vector<uint64_t> e2eUs;         // capture -> respons 200
+};
+
+static KonfigArmada konfig;
+static StatArmada stat;
+static std::vector<NodeArmada> armada;
+static int epollFd = -1;
+static sockaddr_in alamatTarget;
+static volatile sig_atomic_t dihentikan = 0;
+
+// Jendela laporan berkala
+static uint64_t jendelaTerkirim = 0;
+static uint64_t jendelaError = 0;
+static std::vector<uint64_t> jendelaLatensi;
+
+static uint64_t usSekarang() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// time()/gettimeofday() diganti jam virtual oleh stubs.cpp; epoch asli lewat clock_gettime
+static uint64_t epochMsAsli() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void pakai(const char* prog) {
+  fprintf(stderr,
+          "Pakai: %s [opsi]\n"
+          "  --node N                jumlah node virtual (default 100)\n"
+          "  --durasi DETIK          lama uji (default 300)\n"
+          "  --interval MS           interval sampling per node (default 10000)\n"
+          "  --jitter MS             jitter +- interval (default 500)\n"
+          "  --target HOST:PORT      emulator Firestore (default $FIRESTORE_EMULATOR_HOST atau 127.0.0.1:8080)\n"
+          "  --proyek ID             project ID emulator (default demo-tambaq)\n"
+          "  --timeout MS            batas satu request (default 10000)\n"
+          "  --putus M:D[:FRAKSI]    node putus mulai detik M selama D detik (default semua), boleh diulang\n"
+          "  --tanpa-keepalive       koneksi baru untuk setiap write\n"
+          "  --serentak              semua node boot & sampling di fase yang sama\n"
+          "  --laporan DETIK         laporan berkala (default 10, 0 = mati)\n"
+          "  --seed N                seed nilai sensor & jitter\n",
+          prog);
+  exit(1);
+}
+
+static bool pisahHostPort(const char* s, std::string& host, int& port) {
+  const char* titikDua = strrchr(s, ':');
+  if (!titikDua) return false;
+  host.assign(s, titikDua - s);
+  port = atoi(titikDua + 1);
+  return !host.empty() && port > 0;
+}
+
+static void parseArgumen(int argc, char** argv) {
+  const char* env = getenv("FIRESTORE_EMULATOR_HOST");
+  if (env && !pisahHostPort(env, konfig.host, konfig.port)) {
+    fprintf(stderr, "FIRESTORE_EMULATOR_HOST tidak valid: %s\n", env);
+    exit(1);
+  }
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    if (!strcmp(a, "--tanpa-keepalive")) {
+      konfig.keepAlive = false;
+      continue;
+    }
+    if (!strcmp(a, "--serentak")) {
+      konfig.serentak = true;
+      continue;
+    }
+    const char* v = (i + 1 < argc) ? argv[++i] : nullptr;
+    if (!v) pakai(argv[0]);
+    if (!strcmp(a, "--node")) {
+      konfig.node = atoi(v);
+    } else if (!strcmp(a, "--durasi")) {
+      konfig.durasiDetik = atof(v);
+    } else if (!strcmp(a, "--interval")) {
+      konfig.intervalMs = (uint32_t)atoi(v);
+    } else if (!strcmp(a, "--jitter")) {
+      konfig.jitterMs = (uint32_t)atoi(v);
+    } else if (!strcmp(a, "--target")) {
+      if (!pisahHostPort(v, konfig.host, konfig.port)) pakai(argv[0]);
+    } else if (!strcmp(a, "--proyek")) {
+      konfig.proyek = v;
+    } else if (!strcmp(a, "--timeout")) {
+      konfig.timeoutMs = (uint32_t)atoi(v);
+    } else if (!strcmp(a, "--putus")) {
+      PutusArmada p = { 0, 0, 1.0, false };
+      if (sscanf(v, "%lf:%lf:%lf", &p.mulaiDetik, &p.durasiDetik, &p.fraksi) < 2) pakai(argv[0]);
+      konfig.putus.push_back(p);
+    } else if (!strcmp(a, "--laporan")) {
+      konfig.laporanDetik = atof(v);
+    } else if (!strcmp(a, "--seed")) {
+      konfig.seed = (uint32_t)atoi(v);
+    } else {
+      pakai(argv[0]);
+    }
+  }
+  if (konfig.node <= 0 || konfig.intervalMs == 0 || konfig.jitterMs >= konfig.intervalMs) pakai(argv[0]);
+}
+
+// --------------------------------------------------------------
+// Sensor: proses Ornstein-Uhlenbeck per node di sekitar titik tengah
+// kolam masing-masing; langkah sebanding dengan deadband firmware,
+// jadi rasio write/reading mengikuti kebijakan upload yang asli.
+// --------------------------------------------------------------
+static const float SIGMA_SENSOR[4] = { 0.02f, 4.0f, 0.6f, 0.2f };
+static const float BALIK_SENSOR = 0.05f;   // laju kembali ke titik tengah per reading
+
+static void mulaiNode(NodeArmada& n, int i) {
+  snprintf(n.id, sizeof(n.id), "esp32-%04d", i + 1);
+  n.fd = -1;
+  n.status = NODE_DIAM;
+  n.putus = false;
+  n.koneksiBaru = false;
+  n.rng.seed(konfig.seed * 7919u + (uint32_t)i);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  n.rata[0] = 7.0f + 1.2f * u(n.rng);
+  n.rata[1] = 300.0f + 400.0f * u(n.rng);
+  n.rata[2] = 5.0f + 35.0f * u(n.rng);
+  n.rata[3] = 30.0f + 50.0f * u(n.rng);
+  for (int k = 0; k < 4; k++) n.nilai[k] = n.rata[k];
+  n.policy = uploadPolicy;   // state awal firmware (belum ada baseline)
+  n.seq = 0;
+  n.ackSeq = 0;
+  n.ackAt = 0;
+  n.kepala = 0;
+  n.isi = 0;
+  n.txTerkirim = 0;
+  n.mulaiUs = 0;
+  n.sambungUs = 0;
+}
+
+static ReadingArmada bacaSensor(NodeArmada& n, uint64_t nowUs) {
+  std::normal_distribution<float> g(0.0f, 1.0f);
+  for (int k = 0; k < 4; k++) {
+    n.nilai[k] += BALIK_SENSOR * (n.rata[k] - n.nilai[k]) + SIGMA_SENSOR[k] * g(n.rng);
+  }
+  ReadingArmada r;
+  r.nilai[FIELD_PH] = n.nilai[0];
+  r.nilai[FIELD_TDS] = n.nilai[1];
+  r.nilai[FIELD_TURBIDITY] = n.nilai[2];
+  r.nilai[FIELD_ULTRASONIC] = n.nilai[3];
+  r.nilai[FIELD_SALINITAS] = hitungSalinitas(n.nilai[1]);
+  r.fuzzy = evaluasiKualitasAir(n.nilai[0], n.nilai[1], n.nilai[2]);
+  r.seq = ++n.seq;
+  r.captureUs = nowUs;
+  r.captureEpochMs = epochMsAsli();
+  return r;
+}
+
+// --------------------------------------------------------------
+// HTTP/1.1 ke emulator
+// --------------------------------------------------------------
+static void tutupKoneksi(NodeArmada& n) {
+  if (n.fd < 0) return;
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, n.fd, nullptr);
+  close(n.fd);
+  n.fd = -1;
+}
+
+static void aturEpoll(NodeArmada& n, uint32_t events) {
+  epoll_event ev = {};
+  ev.events = events;
+  ev.data.u32 = (uint32_t)(&n - &armada[0]);
+  epoll_ctl(epollFd, EPOLL_CTL_MOD, n.fd, &ev);
+}
+
+static void prosesAntrian(NodeArmada& n, uint64_t nowUs);
+
+static void selesaiRequest(NodeArmada& n, uint64_t nowUs, int err, bool tutup) {
+  if (err < 0) {
+    uint64_t lat = nowUs - n.mulaiUs;
+    stat.latensiUs.push_back(lat);
+    stat.e2eUs.push_back(nowUs - n.kirim.captureUs);
+    jendelaLatensi.push_back(lat);
+    jendelaTerkirim++;
+    stat.hasil[TRACE_TERKIRIM]++;
+    stat.hasil[TRACE_ACK]++;
+    // Baseline kebijakan upload hanya maju setelah patch sukses (sama dengan firmware)
+    uploadPolicy = n.policy;
+    catatUploadTerkirim(n.keputusan, n.kirim.nilai, n.kirim.fuzzy.category, (unsigned long)(nowUs / 1000));
+    n.policy = uploadPolicy;
+    n.ackSeq = n.kirim.seq;
+    n.ackAt = epochMsAsli();
+  } else {
+    stat.error[err]++;
+    stat.hasil[TRACE_GAGAL]++;
+    jendelaError++;
+  }
+  if (tutup || err >= 0 || !konfig.keepAlive) tutupKoneksi(n);
+  n.status = NODE_DIAM;
+  n.tx.clear();
+  n.rx.clear();
+  prosesAntrian(n, nowUs);
+}
+
+static void kirimTx(NodeArmada& n, uint64_t nowUs) {
+  while (n.txTerkirim < n.tx.size()) {
+    ssize_t r = send(n.fd, n.tx.data() + n.txTerkirim, n.tx.size() - n.txTerkirim, MSG_NOSIGNAL);
+    if (r > 0) {
+      n.txTerkirim += r;
+      stat.bytesKeluar += r;
+      continue;
+    }
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      aturEpoll(n, EPOLLOUT | EPOLLIN);
+      return;
+    }
+    selesaiRequest(n, nowUs, ERR_PUTUS, true);
+    return;
+  }
+  n.status = NODE_TERIMA;
+  aturEpoll(n, EPOLLIN);
+}
+
+static bool sambung(NodeArmada& n, uint64_t nowUs) {
+  n.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (n.fd < 0) return false;
+  int satu = 1;
+  setsockopt(n.fd, IPPROTO_TCP, TCP_NODELAY, &satu, sizeof(satu));
+  epoll_event ev = {};
+  ev.events = EPOLLOUT | EPOLLIN;
+  ev.data.u32 = (uint32_t)(&n - &armada[0]);
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, n.fd, &ev);
+  stat.koneksi++;
+  n.koneksiBaru = true;
+  n.sambungUs = nowUs;
+  int r = connect(n.fd, (const sockaddr*)&alamatTarget, sizeof(alamatTarget));
+  if (r < 0 && errno != EINPROGRESS) return false;
+  n.status = NODE_SAMBUNG;
+  return true;
+}
+
+// Request PATCH dengan updateMask sebagai query string (format Firebase-ESP-Client)
+static bool bangunRequest(NodeArmada& n) {
+  const ReadingArmada& r = n.kirim;
+  DataSensorDoc doc = { r.nilai[FIELD_PH], r.nilai[FIELD_TDS], r.nilai[FIELD_TURBIDITY], r.nilai[FIELD_ULTRASONIC],
+                        r.nilai[FIELD_SALINITAS], r.fuzzy.score, (uint8_t)r.fuzzy.category,
+                        r.seq, 1, r.captureEpochMs, epochMsAsli(), n.ackSeq, n.ackAt };
+  uint32_t mask = n.keputusan.fieldMask | maskTrace(doc);
+  if (n.keputusan.includeScore) mask |= DATA_SENSOR_SCORE_MASK;
+
+  char body[DATA_SENSOR_BODY_SIZE];
+  char updateMask[DATA_SENSOR_MASK_SIZE];
+  if (!DataSensorSchema::tulisBody(doc, mask, body, sizeof(body)) ||
+      !DataSensorSchema::tulisMask(mask, updateMask, sizeof(updateMask))) return false;
+
+  std::string& tx = n.tx;
+  tx.clear();
+  tx += "PATCH /v1/projects/";
+  tx += konfig.proyek;
+  tx += "/databases/(default)/documents/sensorRead/";
+  tx += n.id;
+  char pemisah = '?';
+  for (const char* f = updateMask; *f;) {
+    const char* koma = strchr(f, ',');
+    size_t len = koma ? (size_t)(koma - f) : strlen(f);
+    tx += pemisah;
+    tx += "updateMask.fieldPaths=";
+    tx.append(f, len);
+    pemisah = '&';
+    f += len + (koma ? 1 : 0);
+  }
+  char header[256];
+  snprintf(header, sizeof(header),
+           " HTTP/1.1\r\nHost: %s:%d\r\nConnection: %s\r\nContent-Type: application/json\r\n"
+           "Authorization: Bearer owner\r\nContent-Length: %zu\r\n\r\n",
+           konfig.host.c_str(), konfig.port, konfig.keepAlive ? "keep-alive" : "close", strlen(body));
+  tx += header;
+  tx += body;
+  n.txTerkirim = 0;
+  return true;
+}
+
+static void mulaiRequest(NodeArmada& n, uint64_t nowUs) {
+  if (!bangunRequest(n)) {
+    fprintf(stderr, "armada: buffer payload tidak cukup (%s seq %u)\n", n.id, n.kirim.seq);
+    stat.hasil[TRACE_GAGAL]++;
+    return;
+  }
+  n.mulaiUs = nowUs;
+  n.koneksiBaru = false;
+  if (n.fd < 0) {
+    if (!sambung(n, nowUs)) {
+      selesaiRequest(n, nowUs, errno == ECONNREFUSED ? ERR_DITOLAK : ERR_KONEKSI, true);
+    }
+    return;
+  }
+  n.status = NODE_KIRIM;
+  kirimTx(n, nowUs);
+}
+
+// Sama dengan langkahJaringan: satu reading per giliran, keputusan saat diproses
+static void prosesAntrian(NodeArmada& n, uint64_t nowUs) {
+  while (n.status == NODE_DIAM && n.isi > 0) {
+    n.kirim = n.antrian[n.kepala];
+    n.kepala = (n.kepala + 1) % READING_QUEUE_SIZE;
+    n.isi--;
+    if (n.putus) {
+      stat.hasil[TRACE_TIDAK_SIAP]++;
+      continue;
+    }
+    uploadPolicy = n.policy;
+    n.keputusan = putuskanUpload(n.kirim.nilai, n.kirim.fuzzy.category, (unsigned long)(nowUs / 1000));
+    if (n.keputusan.reason == UPLOAD_SUPPRESSED) uploadPolicy.suppressedWrites++;
+    if (n.keputusan.reason == UPLOAD_BUDGET) uploadPolicy.budgetWrites++;
+    n.policy = uploadPolicy;
+    if (n.keputusan.reason == UPLOAD_SUPPRESSED) {
+      stat.hasil[TRACE_DITAHAN]++;
+    } else if (n.keputusan.reason == UPLOAD_BUDGET) {
+      stat.hasil[TRACE_ANGGARAN]++;
+    } else {
+      mulaiRequest(n, nowUs);
+    }
+  }
+}
+
+// Respons lengkap: header + Content-Length atau chunked sampai chunk 0
+static bool responsLengkap(const std::string& rx, int& kode, bool& tutup) {
+  size_t akhirHeader = rx.find("\r\n\r\n");
+  if (akhirHeader == std::string::npos) return false;
+  if (sscanf(rx.c_str(), "HTTP/1.%*d %d", &kode) != 1) kode = 0;
+  std::string header = rx.substr(0, akhirHeader);
+  std::transform(header.begin(), header.end(), header.begin(), ::tolower);
+  tutup = header.find("\r\nconnection: close") != std::string::npos;
+  size_t isi = akhirHeader + 4;
+  size_t p = header.find("\r\ncontent-length:");
+  if (p != std::string::npos) {
+    size_t panjang = strtoul(header.c_str() + p + 17, nullptr, 10);
+    return rx.size() >= isi + panjang;
+  }
+  if (header.find("\r\ntransfer-encoding: chunked") != std::string::npos) {
+    return rx.find("\r\n0\r\n\r\n", isi - 2) != std::string::npos;
+  }
+  return kode == 204 || kode == 304;
+}
+
+static void prosesSocket(NodeArmada& n, uint32_t events, uint64_t nowUs) {
+  if (n.status == NODE_SAMBUNG) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(n.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err) {
+      selesaiRequest(n, nowUs, err == ECONNREFUSED ? ERR_DITOLAK : ERR_KONEKSI, true);
+      return;
+    }
+    if (!(events & EPOLLOUT)) return;
+    stat.sambungUs.push_back(nowUs - n.sambungUs);
+    n.status = NODE_KIRIM;
+    kirimTx(n, nowUs);
+    return;
+  }
+  if (n.status == NODE_KIRIM && (events & EPOLLOUT)) {
+    kirimTx(n, nowUs);
+    if (n.status != NODE_TERIMA) return;
+  }
+  if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP))) return;
+
+  char buf[4096];
+  bool eof = false;
+  for (;;) {
+    ssize_t r = recv(n.fd, buf, sizeof(buf), 0);
+    if (r > 0) {
+      stat.bytesMasuk += r;
+      if (n.status == NODE_DIAM) continue;   // data tak diminta pada koneksi idle: buang
+      n.rx.append(buf, r);
+      if (n.rx.size() > ARMADA_RX_MAX) {
+        selesaiRequest(n, nowUs, ERR_PUTUS, true);
+        return;
+      }
+      continue;
+    }
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    eof = true;
+    break;
+  }
+  // EOF/reset: koneksi idle yang ditutup server cukup dilepas
+  if (n.status == NODE_DIAM) {
+    if (eof) tutupKoneksi(n);
+    return;
+  }
+  if (n.status != NODE_TERIMA) {
+    if (eof) selesaiRequest(n, nowUs, ERR_PUTUS, true);
+    return;
+  }
+
+  int kode = 0;
+  bool tutup = false;
+  if (!responsLengkap(n.rx, kode, tutup)) {
+    if (eof) selesaiRequest(n, nowUs, ERR_PUTUS, true);
+    return;
+  }
+  int err = -1;
+  if (kode == 429) err = ERR_HTTP_429;
+  else if (kode >= 500 || kode == 0) err = ERR_HTTP_5XX;
+  else if (kode >= 400) err = ERR_HTTP_4XX;
+  selesaiRequest(n, nowUs, err, tutup || eof);
+}
+
+static void cekTimeout(uint64_t nowUs) {
+  uint64_t batas = (uint64_t)konfig.timeoutMs * 1000;
+  for (NodeArmada& n : armada) {
+    if (n.status != NODE_DIAM && nowUs - n.mulaiUs >= batas) selesaiRequest(n, nowUs, ERR_TIMEOUT, true);
+  }
+}
+
+// Jendela putus: WiFi node hilang, koneksi & request yang berjalan ikut putus
+static void aturPutus(double detik, uint64_t nowUs) {
+  for (PutusArmada& p : konfig.putus) {
+    bool aktif = detik >= p.mulaiDetik && detik < p.mulaiDetik + p.durasiDetik;
+    if (aktif == p.aktif) continue;
+    p.aktif = aktif;
+    int jumlah = (int)(p.fraksi * armada.size() + 0.5);
+    for (int i = 0; i < jumlah; i++) {
+      NodeArmada& n = armada[i];
+      n.putus = aktif;
+      if (!aktif) continue;
+      if (n.status != NODE_DIAM) selesaiRequest(n, nowUs, ERR_OUTAGE, true);
+      tutupKoneksi(n);
+    }
+  }
+}
+
+// --------------------------------------------------------------
+// LAPORAN
+// --------------------------------------------------------------
+static void cetakLatensi(const char* nama, std::vector<uint64_t>& us) {
+  if (us.empty()) {
+    printf("  %-9s (tidak ada sampel)\n", nama);
+    return;
+  }
+  std::sort(us.begin(), us.end());
+  auto p = [&](double q) { return us[(size_t)(q * (us.size() - 1))] / 1000.0; };
+  printf("  %-9s n=%-8zu p50=%8.2f  p90=%8.2f  p99=%8.2f  p99.9=%8.2f  max=%9.2f ms\n",
+         nama, us.size(), p(0.50), p(0.90), p(0.99), p(0.999), us.back() / 1000.0);
+}
+
+static void cetakJendela(double detik, double lebarDetik) {
+  int inflight = 0;
+  for (const NodeArmada& n : armada) inflight += n.status != NODE_DIAM;
+  double p50 = 0, p99 = 0;
+  if (!jendelaLatensi.empty()) {
+    std::sort(jendelaLatensi.begin(), jendelaLatensi.end());
+    p50 = jendelaLatensi[(size_t)(0.50 * (jendelaLatensi.size() - 1))] / 1000.0;
+    p99 = jendelaLatensi[(size_t)(0.99 * (jendelaLatensi.size() - 1))] / 1000.0;
+  }
+  printf("  t=%6.0f s  %8.1f write/s  in-flight %5d  error %6llu  p50 %8.2f ms  p99 %8.2f ms\n",
+         detik, jendelaTerkirim / lebarDetik, inflight, (unsigned long long)jendelaError, p50, p99);
+  fflush(stdout);
+  jendelaTerkirim = 0;
+  jendelaError = 0;
+  jendelaLatensi.clear();
+}
+
+static void cetakRingkasan(double detik) {
+  uint64_t antrian = 0;
+  for (const NodeArmada& n : armada) antrian += n.isi + (n.status != NODE_DIAM);
+  const uint64_t* h = stat.hasil;
+  uint64_t terkirim = h[TRACE_TERKIRIM];
+  uint64_t gagal = h[TRACE_GAGAL];
+  uint64_t totalError = 0;
+  for (int e = 0; e < NUM_ERR; e++) totalError += stat.error[e];
+
+  printf("\n=== ARMADA TAMBAQ: %d node, %.0f s, interval %lu ms +- %lu ms -> %s:%d ===\n",
+         konfig.node, detik, (unsigned long)konfig.intervalMs, (unsigned long)konfig.jitterMs,
+         konfig.host.c_str(), konfig.port);
+  printf("Reading  : dibaca %llu = antrianPenuh %llu + ditahan %llu + anggaran %llu + tidakSiap %llu"
+         " + gagal %llu + terkirim %llu + antrian %llu\n",
+         (unsigned long long)h[TRACE_DIBACA], (unsigned long long)h[TRACE_ANTRIAN_PENUH],
+         (unsigned long long)h[TRACE_DITAHAN], (unsigned long long)h[TRACE_ANGGARAN],
+         (unsigned long long)h[TRACE_TIDAK_SIAP], (unsigned long long)gagal,
+         (unsigned long long)terkirim, (unsigned long long)antrian);
+  printf("Write    : %llu sukses (%.1f write/s, %.1f write/jam/node), %llu gagal (%.2f%%)\n",
+         (unsigned long long)terkirim, terkirim / detik, terkirim * 3600.0 / detik / konfig.node,
+         (unsigned long long)gagal, terkirim + gagal ? 100.0 * gagal / (terkirim + gagal) : 0.0);
+  printf("Error    :");
+  for (int e = 0; e < NUM_ERR; e++) printf(" %s %llu", ERR_LABEL[e], (unsigned long long)stat.error[e]);
+  printf(" (total %llu)\n", (unsigned long long)totalError);
+  uint64_t write = terkirim + gagal;
+  printf("Koneksi  : %llu baru (%.2f per write), %.0f byte keluar + %.0f byte masuk per write\n",
+         (unsigned long long)stat.koneksi, write ? (double)stat.koneksi / write : 0.0,
+         write ? (double)stat.bytesKeluar / write : 0.0, write ? (double)stat.bytesMasuk / write : 0.0);
+  printf("Latensi (jam dinding):\n");
+  cetakLatensi("write", stat.latensiUs);
+  cetakLatensi("connect", stat.sambungUs);
+  cetakLatensi("e2e", stat.e2eUs);
+}
+
+static void hentikan(int) { dihentikan = 1; }
+
+int main(int argc, char** argv) {
+  parseArgumen(argc, argv);
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, hentikan);
+
+  addrinfo petunjuk = {};
+  petunjuk.ai_family = AF_INET;
+  petunjuk.ai_socktype = SOCK_STREAM;
+  addrinfo* hasilDns = nullptr;
+  if (getaddrinfo(konfig.host.c_str(), nullptr, &petunjuk, &hasilDns) != 0 || !hasilDns) {
+    fprintf(stderr, "armada: host %s tidak ditemukan\n", konfig.host.c_str());
+    return 2;
+  }
+  alamatTarget = *(const sockaddr_in*)hasilDns->ai_addr;
+  alamatTarget.sin_port = htons((uint16_t)konfig.port);
+  freeaddrinfo(hasilDns);
+
+  // Satu socket per node
+  rlimit lim;
+  getrlimit(RLIMIT_NOFILE, &lim);
+  lim.rlim_cur = lim.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &lim);
+  if ((rlim_t)konfig.node + 16 > lim.rlim_cur) {
+    fprintf(stderr, "armada: batas file descriptor %llu < %d node\n",
+            (unsigned long long)lim.rlim_cur, konfig.node);
+    return 2;
+  }
+
+  // Firmware dengan laju tetap: interval sampling dari --interval, heartbeat 5 menit
+  initKalibrasi();
+  lajuAdaptif.store(false, std::memory_order_relaxed);
+
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  armada.resize(konfig.node);
+  for (int i = 0; i < konfig.node; i++) mulaiNode(armada[i], i);
+
+  // Jadwal reading: (waktu, node), fase acak kecuali --serentak
+  typedef std::pair<uint64_t, uint32_t> Jadwal;
+  std::priority_queue<Jadwal, std::vector<Jadwal>, std::greater<Jadwal> > jadwal;
+  std::mt19937 rng(konfig.seed);
+  std::uniform_int_distribution<int64_t> jitter(-(int64_t)konfig.jitterMs * 1000, (int64_t)konfig.jitterMs * 1000);
+  std::uniform_int_distribution<uint64_t> fase(0, (uint64_t)konfig.intervalMs * 1000 - 1);
+  uint64_t awalUs = usSekarang();
+  for (int i = 0; i < konfig.node; i++) jadwal.push(Jadwal(awalUs + (konfig.serentak ? 0 : fase(rng)), i));
+
+  uint64_t akhirUs = awalUs + (uint64_t)(konfig.durasiDetik * 1e6);
+  uint64_t laporanUs = (uint64_t)(konfig.laporanDetik * 1e6);
+  uint64_t laporanBerikut = awalUs + laporanUs;
+  uint64_t cekBerikut = awalUs + ARMADA_CEK_TIMEOUT_US;
+  epoll_event events[ARMADA_EPOLL_BATCH];
+  if (laporanUs) printf("Armada %d node -> %s:%d (proyek %s)\n", konfig.node, konfig.host.c_str(),
+                        konfig.port, konfig.proyek.c_str());
+
+  uint64_t nowUs = awalUs;
+  while (!dihentikan && nowUs < akhirUs) {
+    uint64_t tunggu = cekBerikut;
+    if (!jadwal.empty() && jadwal.top().first < tunggu) tunggu = jadwal.top().first;
+    int timeoutMs = tunggu > nowUs ? (int)((tunggu - nowUs + 999) / 1000) : 0;
+    int n = epoll_wait(epollFd, events, ARMADA_EPOLL_BATCH, timeoutMs);
+    nowUs = usSekarang();
+    for (int i = 0; i < n; i++) prosesSocket(armada[events[i].data.u32], events[i].events, nowUs);
+
+    aturPutus((nowUs - awalUs) / 1e6, nowUs);
+    while (!jadwal.empty() && jadwal.top().first <= nowUs) {
+      Jadwal j = jadwal.top();
+      jadwal.pop();
+      NodeArmada& node = armada[j.second];
+      ReadingArmada r = bacaSensor(node, nowUs);
+      stat.hasil[TRACE_DIBACA]++;
+      if (node.isi < READING_QUEUE_SIZE) {
+        node.antrian[(node.kepala + node.isi) % READING_QUEUE_SIZE] = r;
+        node.isi++;
+      } else {
+        stat.hasil[TRACE_ANTRIAN_PENUH]++;
+      }
+      prosesAntrian(node, nowUs);
+      jadwal.push(Jadwal(j.first + konfig.intervalMs * 1000ULL + jitter(rng), j.second));
+    }
+    if (nowUs >= cekBerikut) {
+      cekTimeout(nowUs);
+      cekBerikut = nowUs + ARMADA_CEK_TIMEOUT_US;
+    }
+    if (laporanUs && nowUs >= laporanBerikut) {
+      cetakJendela((nowUs - awalUs) / 1e6, konfig.laporanDetik);
+      laporanBerikut += laporanUs;
+    }
+  }
+
+  cetakRingkasan((nowUs - awalUs) / 1e6);
+  for (NodeArmada& n : armada) tutupKoneksi(n);
+  close(epollFd);
+  return 0;
+}
@@ -0,0 +1,45 @@
+<?php
+
+/**
+ * Grid paritas fuzzy untuk uji "fuzzy" di sim/uji.cpp.
+ *
+ * Menjalankan FuzzyMamdaniService::evaluateWaterQuality pada semua
+ * breakpoint trapesium, titik tengah lereng, dan nilai di luar rentang,
+ * lalu menulis hasilnya sebagai CSV. Jalankan ulang setiap kali fungsi
+ * keanggotaan atau rule base di service berubah:
+ *
+ *   php sim/fuzzy-parity.php > sim/fuzzy-parity.csv
+ */
+
+declare(strict_types=1);
+
+require __DIR__ . '/../app/Services/FuzzyMamdaniService.php';
+
+use App\Services\FuzzyMamdaniService;
+
+$phGrid = [-1.0, 0.0, 5.0, 6.5, 6.85, 7.0, 7.1, 7.2, 7.25, 7.5, 7.75, 8.0, 8.2, 8.25, 8.5, 8.6, 9.0, 14.0, 15.0];
+$turbidityGrid = [0.0, 15.0, 20.0, 22.5, 25.0, 30.0, 35.0, 40.0, 42.5, 45.0, 50.0, 60.0, 150.0];
+$tdsGrid = [0.0, 200.0, 275.0, 300.0, 325.0, 350.0, 400.0, 500.0, 600.0, 700.0, 750.0, 800.0, 1000.0, 3000.0];
+
+$service = new FuzzyMamdaniService();
+
+echo "ph,turbidity,tds,score,kategori,rule_aktif,rule_dominan,kekuatan_dominan\n";
+foreach ($phGrid as $ph) {
+    foreach ($turbidityGrid as $turbidity) {
+        foreach ($tdsGrid as $tds) {
+            $result = $service->evaluateWaterQuality($ph, $tds, $turbidity);
+            $dominant = preg_match('/Dominant Rule #(\d+)/', $result['fuzzy_details'], $m) ? (int) $m[1] : 0;
+            printf(
+                "%s,%s,%s,%.2f,%s,%d,%d,%.6f\n",
+                $ph,
+                $turbidity,
+                $tds,
+                $result['water_quality_score'],
+                $result['category'],
+                $result['active_rules_count'],
+                $dominant,
+                $result['rule_strength']
+            );
+        }
+    }
+}
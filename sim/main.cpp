@@ -0,0 +1,863 @@
+// --------------------------------------------------------------
+// DRIVER SIMULASI HOST: replay trace + benchmark latensi per langkah
+// --------------------------------------------------------------
+// loop() firmware hanya menghapus task-nya sendiri, jadi driver ini
+// memanggil langkahSampling()/langkahJaringan() (isi task FreeRTOS)
+// langsung dengan jam virtual dari sim/stubs.cpp.
+// --------------------------------------------------------------
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+
+void setup();
+void langkahSampling();
+void langkahJaringan();
+void langkahLan() __attribute__((weak));   // hanya ada jika LAN_SERVER_ENABLED
+void langkahLog();
+size_t formatLog(const char* fmt, const uint8_t* arg, size_t argLen, char* out, size_t cap, size_t lebarLong);
+uint16_t crc16(const uint8_t* data, size_t len);
+uint32_t traceHitungan(const char* nama);
+uint32_t kuantilTahap(const char* label, float q);
+uint32_t espnowHitungan(const char* nama);
+const char* aktuatorNama(int i);
+uint32_t aktuatorHitungan(int i, const char* nama);
+uint32_t akuisisiHitungan(const char* nama);
+
+static std::vector<uint64_t> latSampling;
+static std::vector<uint64_t> latTimer;
+static std::vector<uint64_t> latJaringan;
+static std::vector<uint64_t> latKontrol;   // langkah sampling yang mengevaluasi sampel baru
+
+void simCatatLatensiSampling(uint64_t ns) {
+  static uint32_t sampelKontrol = 0;
+  latSampling.push_back(ns);
+  uint32_t n = aktuatorHitungan(-1, "sampel");
+  if (n == sampelKontrol) return;
+  sampelKontrol = n;
+  latKontrol.push_back(ns);
+}
+void simCatatLatensiTimer(uint64_t ns) { latTimer.push_back(ns); }
+
+static uint64_t nsHost() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void pakai(const char* prog) {
+  fprintf(stderr,
+          "Pemakaian: %s [opsi]\n"
+          "  --trace FILE.csv        trace sensor (detik,ph_v,tds_v,turb_v,jarak_cm)\n"
+          "  --durasi DETIK          lama simulasi (default 3600)\n"
+          "  --latensi MS            latensi request Firestore (default 180)\n"
+          "  --jitter MS             jitter +- request (default 60)\n"
+          "  --handshake MS          biaya TLS handshake (default 1200)\n"
+          "  --idle-server MS        server menutup koneksi HTTPS idle (default 240000)\n"
+          "  --gagal P               peluang request gagal 0..1 (default 0)\n"
+          "  --percikan P            peluang echo palsu per ping ultrasonic 0..1 (default 0)\n"
+          "  --putus MULAI:DURASI    WiFi putus (detik), boleh diulang\n"
+          "  --boot dingin|hangat    hangat = cache NVS fast boot terisi\n"
+          "  --seed N                seed RNG noise/jitter\n"
+          "  --perintah DETIK:TEKS   ketik TEKS ke Serial pada detik virtual DETIK\n"
+          "  --mqtt HOST:PORT        broker MQTT lokal (pakai dengan --perintah 0:transport mqtt)\n"
+          "  --waktu-nyata           jam virtual mengikuti jam dinding (tes server LAN)\n"
+          "  --dekode-log FILE       dekode capture UART mode \"log biner\" (- = stdin), tanpa simulasi\n"
+          "  --leaf N[:HILANG[:DUP[:RESET[:TUNDA]]]]\n"
+          "                          N leaf ESP-NOW virtual (build gateway), peluang frame hilang/dobel;\n"
+          "                          leaf pertama reset bootId (NVS terhapus) pada detik RESET;\n"
+          "                          peluang frame tersusul frame berikutnya (0 = urut)\n"
+          "  --fs DIR                image LittleFS di DIR, bertahan antar-run (default direktori sementara)\n"
+          "  -v                      tampilkan Serial firmware\n",
+          prog);
+  exit(1);
+}
+
+static bool muatTrace(const char* path, std::vector<TitikTrace>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char baris[256];
+  while (fgets(baris, sizeof(baris), f)) {
+    TitikTrace t;
+    double detik;
+    int n = 0;
+    if (sscanf(baris, "#kejadian,%lf,%n", &detik, &n) == 1 && n > 0) {
+      Kejadian k;
+      k.detik = detik;
+      k.label = baris + n;
+      k.label.erase(k.label.find_last_not_of("\r\n") + 1);
+      simKonfig.kejadian.push_back(k);
+      continue;
+    }
+    // Baris header / komentar tidak cocok dengan format angka -> dilewati
+    if (sscanf(baris, "%lf,%f,%f,%f,%f", &t.detik, &t.phVolt, &t.tdsVolt, &t.turbVolt, &t.jarakCm) == 5) {
+      out.push_back(t);
+    }
+  }
+  fclose(f);
+  return !out.empty();
+}
+
+// --------------------------------------------------------------
+// LEAF ESP-NOW VIRTUAL (build -DTAMBAQ_PERAN=PERAN_GATEWAY)
+// --------------------------------------------------------------
+// Tiap leaf = satu kolam, reading tiap 10 s +- 0,5 s dengan nilai random
+// walk; frame bisa hilang atau sampai dua kali (ack MAC hilang -> leaf
+// kirim ulang 20-80 ms kemudian). Leaf pertama bisa reset bootId ke 1
+// (NVS terhapus): gateway membuang LEAF_BOOT_ULANG - 1 frame pertama
+// boot baru sebagai basi lalu menerimanya. Dengan TUNDA, frame bisa sampai
+// setelah frame berikutnya; frame pertama tiap leaf selalu tersusul (seperti
+// gateway yang baru restart). Yang dicatat di sini dibandingkan dengan
+// hitungan gateway dan dokumen sensorRead/kolam-<id> di server.
+// --------------------------------------------------------------
+#define LEAF_INTERVAL_US 10000000ULL
+#define LEAF_JITTER_US 500000
+#define LEAF_BATCH_S 10.0   // GATEWAY_BATCH_MS firmware
+#define LEAF_BOOT_ULANG 3   // GATEWAY_BOOT_ULANG firmware
+#define LEAF_BOOT_AWAL 3    // bootId leaf sebelum reset
+#define LEAF_TUNDA_US 15000000ULL   // frame tertunda sampai di antara dua frame berikutnya
+#define AKTUATOR_BATAS_US 50000   // AKTUATOR_LATENSI_MAKS_US firmware
+#define TICK_US 1000               // ACQ_TICK_US firmware
+#define TICK_JITTER_BATAS_US 100   // pulsa trigger 12 us + margin
+// 5 ping berjarak ULTRASONIC_JEDA_US (60 ms) + timeout echo terakhir (30 ms);
+// siklus pertama setelah boot menunggu window ADC terisi (32 sampel ~100 Hz)
+#define SIKLUS_BATAS_US 400000
+
+struct KonfigLeaf {
+  int jumlah = 0;
+  double probHilang = 0.0;
+  double probDobel = 0.0;
+  double resetDetik = 0.0;   // 0 = tidak ada leaf yang reset
+  double probTunda = 0.0;    // hanya leaf yang tidak reset
+};
+
+struct LeafVirtual {
+  uint32_t nodeId;
+  uint16_t kolam;
+  uint16_t bootId;
+  uint32_t seq;
+  uint64_t berikutUs;
+  uint64_t resetUs;        // 0 = tidak reset
+  float nilai[4];
+  // sisi pengirim
+  uint32_t seqTerendah;    // seq terendah boot ini yang diterima gateway
+  uint32_t seqTertinggi;   // seq tertinggi yang sampai
+  uint32_t unik;           // frame berbeda yang diterima gateway
+  uint32_t unikBoot;       // ... sejak boot ini
+  uint32_t gapSelesai;     // gap seq boot sebelumnya
+  uint32_t tolak;          // frame boot baru yang masih akan dibuang gateway
+  uint32_t seqSebelumAkhir;   // seq terakhir yang sampai >= 2 batch sebelum akhir
+};
+
+struct KirimanDobel {
+  uint64_t waktuUs;
+  uint8_t mac[6];
+  uint8_t frame[32];
+  int len;
+  bool basi;               // salinan frame yang dibuang gateway
+  int tunda;               // >= 0: frame asli tertunda dari leafVirtual[tunda], -1: kiriman dobel
+  uint32_t seq;
+};
+
+static KonfigLeaf leafKonfig;
+static std::vector<LeafVirtual> leafVirtual;
+static std::vector<KirimanDobel> kirimanDobel;
+static std::mt19937 rngLeaf;
+static uint64_t leafFrame = 0;      // frame dibuat leaf
+static uint64_t leafHilang = 0;
+static uint64_t leafSampai = 0;     // termasuk kiriman dobel
+static uint64_t leafDobel = 0;
+static uint64_t leafBasi = 0;       // frame boot baru sebelum diterima gateway (termasuk dobel)
+static uint64_t leafTunda = 0;
+static uint64_t leafTersusul = 0;   // frame tertunda yang sampai setelah seq lebih baru
+
+static void macLeaf(const LeafVirtual& l, uint8_t mac[6]) {
+  const uint8_t awal[2] = { 0x24, 0x6F };
+  memcpy(mac, awal, 2);
+  for (int i = 0; i < 4; i++) mac[2 + i] = (uint8_t)(l.nodeId >> (24 - 8 * i));
+}
+
+// Frame unik sampai di gateway (sudah lolos cek bootId)
+static void catatSampai(LeafVirtual& l, uint32_t seq, uint64_t nowUs, uint64_t batasUs) {
+  l.unik++;
+  if (l.unikBoot++ == 0) {
+    l.seqTerendah = seq;
+    l.seqTertinggi = seq;
+  }
+  l.seqTerendah = std::min(l.seqTerendah, seq);
+  l.seqTertinggi = std::max(l.seqTertinggi, seq);
+  if (nowUs + 2 * LEAF_BATCH_S * 1e6 <= batasUs) l.seqSebelumAkhir = l.seqTertinggi;
+}
+
+static void mulaiLeafVirtual() {
+  rngLeaf.seed(simKonfig.seed * 31u + 7u);
+  std::uniform_int_distribution<uint64_t> fase(0, LEAF_INTERVAL_US - 1);
+  for (int i = 0; i < leafKonfig.jumlah; i++) {
+    LeafVirtual l = {};
+    l.nodeId = 0x51A00000u + (uint32_t)i;
+    l.kolam = (uint16_t)(i + 1);
+    l.bootId = LEAF_BOOT_AWAL;
+    l.berikutUs = simSekarangUs() + fase(rngLeaf);
+    if (i == 0 && leafKonfig.resetDetik > 0) l.resetUs = simSekarangUs() + (uint64_t)(leafKonfig.resetDetik * 1e6);
+    l.nilai[0] = 7.6f;
+    l.nilai[1] = 420.0f + 10.0f * i;
+    l.nilai[2] = 12.0f;
+    l.nilai[3] = 45.0f;
+    leafVirtual.push_back(l);
+  }
+}
+
+static void langkahLeafVirtual(uint64_t nowUs, uint64_t batasUs) {
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  std::normal_distribution<float> g(0.0f, 1.0f);
+  std::uniform_int_distribution<int64_t> jitter(-LEAF_JITTER_US, LEAF_JITTER_US);
+  static const float SIGMA[4] = { 0.02f, 3.0f, 0.5f, 0.2f };
+
+  for (LeafVirtual& l : leafVirtual) {
+    if (nowUs < l.berikutUs) continue;
+    l.berikutUs += LEAF_INTERVAL_US + jitter(rngLeaf);
+    for (int k = 0; k < 4; k++) l.nilai[k] += SIGMA[k] * g(rngLeaf);
+    if (l.resetUs && nowUs >= l.resetUs) {
+      // NVS terhapus: bootId mundur ke 1, seq mulai lagi
+      if (l.unikBoot) l.gapSelesai += l.seqTertinggi - l.seqTerendah + 1 - l.unikBoot;
+      l.unikBoot = 0;
+      l.bootId = 1;
+      l.seq = 0;
+      l.resetUs = 0;
+      l.tolak = LEAF_BOOT_ULANG - 1;
+    }
+    l.seq++;
+    leafFrame++;
+    uint8_t mac[6];
+    macLeaf(l, mac);
+    uint8_t frame[32];
+    int len = (int)simTulisFrameLeaf(l.nodeId, l.kolam, l.bootId, l.seq, l.nilai, 0, false, frame, sizeof(frame));
+    if (u(rngLeaf) < leafKonfig.probHilang) {
+      leafHilang++;
+      continue;
+    }
+    bool bolehTunda = leafKonfig.probTunda > 0 && !l.resetUs && l.bootId == LEAF_BOOT_AWAL;
+    if (bolehTunda && (l.seq == 1 || u(rngLeaf) < leafKonfig.probTunda)) {
+      KirimanDobel d;
+      d.waktuUs = nowUs + LEAF_TUNDA_US;
+      memcpy(d.mac, mac, 6);
+      memcpy(d.frame, frame, len);
+      d.len = len;
+      d.basi = false;
+      d.tunda = (int)(&l - &leafVirtual[0]);
+      d.seq = l.seq;
+      kirimanDobel.push_back(d);
+      leafTunda++;
+      continue;
+    }
+    simTerimaEspNow(mac, frame, len);
+    leafSampai++;
+    bool basi = l.tolak > 0;
+    if (basi) {
+      l.tolak--;
+      leafBasi++;
+    } else {
+      catatSampai(l, l.seq, nowUs, batasUs);
+    }
+    if (u(rngLeaf) < leafKonfig.probDobel) {
+      KirimanDobel d;
+      d.waktuUs = nowUs + 20000 + (uint64_t)(60000 * u(rngLeaf));
+      memcpy(d.mac, mac, 6);
+      d.len = (int)simTulisFrameLeaf(l.nodeId, l.kolam, l.bootId, l.seq, l.nilai, 20, true, d.frame,
+                                     sizeof(d.frame));
+      d.basi = basi;
+      d.tunda = -1;
+      d.seq = l.seq;
+      kirimanDobel.push_back(d);
+    }
+  }
+  for (size_t i = 0; i < kirimanDobel.size();) {
+    if (kirimanDobel[i].waktuUs > nowUs) {
+      i++;
+      continue;
+    }
+    const KirimanDobel& d = kirimanDobel[i];
+    simTerimaEspNow(d.mac, d.frame, d.len);
+    leafSampai++;
+    if (d.tunda >= 0) {
+      LeafVirtual& l = leafVirtual[d.tunda];
+      if (l.unikBoot && l.seqTertinggi > d.seq) leafTersusul++;
+      catatSampai(l, d.seq, nowUs, batasUs);
+    } else if (d.basi) leafBasi++;
+    else leafDobel++;
+    kirimanDobel.erase(kirimanDobel.begin() + i);
+  }
+}
+
+static void parseArgumen(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    const char* v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (!strcmp(a, "-v")) {
+      simKonfig.verbose = true;
+      continue;
+    }
+    if (!strcmp(a, "--waktu-nyata")) {
+      simKonfig.waktuNyata = true;
+      continue;
+    }
+    if (!v) pakai(argv[0]);
+    i++;
+    if (!strcmp(a, "--trace")) {
+      if (!muatTrace(v, simKonfig.trace)) {
+        fprintf(stderr, "Trace tidak bisa dibaca: %s\n", v);
+        exit(1);
+      }
+    } else if (!strcmp(a, "--durasi")) {
+      simKonfig.durasiDetik = atof(v);
+    } else if (!strcmp(a, "--latensi")) {
+      simKonfig.requestMs = atof(v);
+    } else if (!strcmp(a, "--jitter")) {
+      simKonfig.jitterMs = atof(v);
+    } else if (!strcmp(a, "--handshake")) {
+      simKonfig.handshakeMs = atof(v);
+    } else if (!strcmp(a, "--idle-server")) {
+      simKonfig.idleServerMs = atof(v);
+    } else if (!strcmp(a, "--gagal")) {
+      simKonfig.probGagal = atof(v);
+    } else if (!strcmp(a, "--percikan")) {
+      simKonfig.probPercikan = atof(v);
+    } else if (!strcmp(a, "--putus")) {
+      JendelaPutus p;
+      if (sscanf(v, "%lf:%lf", &p.mulaiDetik, &p.durasiDetik) != 2) pakai(argv[0]);
+      simKonfig.putus.push_back(p);
+    } else if (!strcmp(a, "--boot")) {
+      simKonfig.bootHangat = !strcmp(v, "hangat");
+    } else if (!strcmp(a, "--perintah")) {
+      const char* titikDua = strchr(v, ':');
+      if (!titikDua) pakai(argv[0]);
+      PerintahSerial p;
+      p.detik = atof(v);
+      p.teks = titikDua + 1;
+      simKonfig.perintah.push_back(p);
+    } else if (!strcmp(a, "--mqtt")) {
+      simKonfig.mqttBroker = v;
+    } else if (!strcmp(a, "--dekode-log")) {
+      simKonfig.dekodeLog = v;
+    } else if (!strcmp(a, "--leaf")) {
+      if (sscanf(v, "%d:%lf:%lf:%lf:%lf", &leafKonfig.jumlah, &leafKonfig.probHilang, &leafKonfig.probDobel,
+                 &leafKonfig.resetDetik, &leafKonfig.probTunda) < 1 ||
+          leafKonfig.jumlah <= 0) pakai(argv[0]);
+    } else if (!strcmp(a, "--fs")) {
+      simKonfig.fsDir = v;
+    } else if (!strcmp(a, "--seed")) {
+      simKonfig.seed = (uint32_t)strtoul(v, nullptr, 10);
+    } else {
+      pakai(argv[0]);
+    }
+  }
+}
+
+static void cetakLatensi(const char* nama, std::vector<uint64_t>& ns) {
+  if (ns.empty()) {
+    printf("  %-10s (tidak ada sampel)\n", nama);
+    return;
+  }
+  std::sort(ns.begin(), ns.end());
+  auto p = [&](double q) { return ns[(size_t)(q * (ns.size() - 1))] / 1000.0; };
+  printf("  %-10s n=%-8zu p50=%8.2f  p90=%8.2f  p99=%8.2f  p99.9=%8.2f  max=%9.2f us\n",
+         nama, ns.size(), p(0.50), p(0.90), p(0.99), p(0.999), ns.back() / 1000.0);
+}
+
+// --------------------------------------------------------------
+// DEKODER LOG BINER (lihat LOGGER ASINKRON di firmware)
+// --------------------------------------------------------------
+// Frame [0xFE jenis panjang payload CRC16] -> "[detik] L TAG pesan";
+// byte di luar frame (jawaban perintah, teks boot ROM) diteruskan apa
+// adanya. Format string dari frame kamus, diformat dengan formatLog()
+// yang sama dengan task log firmware. CRC salah -> geser 1 byte.
+// Lebar %l dari frame 'W' (tanpa frame itu: long 4 byte ESP32).
+// --------------------------------------------------------------
+static int dekodeLog(const std::string& path) {
+  FILE* f = path == "-" ? stdin : fopen(path.c_str(), "rb");
+  if (!f) {
+    fprintf(stderr, "Capture tidak bisa dibaca: %s\n", path.c_str());
+    return 1;
+  }
+  std::vector<uint8_t> d;
+  uint8_t blok[4096];
+  size_t n;
+  while ((n = fread(blok, 1, sizeof(blok), f)) > 0) d.insert(d.end(), blok, blok + n);
+  if (f != stdin) fclose(f);
+
+  std::map<uint16_t, std::string> kamus;
+  std::map<uint8_t, std::string> tag;
+  size_t lebarLong = 4;
+  uint64_t record = 0, crcSalah = 0, tanpaKamus = 0, hilang = 0;
+  bool awalBaris = true;
+  size_t i = 0;
+  while (i < d.size()) {
+    if (d[i] != 0xFE) {
+      putchar(d[i]);
+      awalBaris = d[i++] == '\n';
+      continue;
+    }
+    if (i + 5 > d.size() || i + 5 + d[i + 2] > d.size()) break;   // frame terpotong di akhir capture
+    uint8_t jenis = d[i + 1];
+    size_t len = d[i + 2];
+    const uint8_t* p = &d[i + 3];
+    if (crc16(&d[i + 1], len + 2) != (uint16_t)(p[len] | p[len + 1] << 8)) {
+      crcSalah++;
+      i++;
+      continue;
+    }
+    i += len + 5;
+
+    if (jenis == 'G' && len >= 1) {
+      tag[p[0]] = std::string((const char*)p + 1, len - 1);
+    } else if (jenis == 'W' && len == 1) {
+      if (p[0] == 4 || p[0] == 8) lebarLong = p[0];
+    } else if (jenis == 'K' && len >= 2) {
+      kamus[(uint16_t)(p[0] | p[1] << 8)] = std::string((const char*)p + 2, len - 2);
+    } else if (jenis == 'H' && len == 4) {
+      uint32_t dibuang;
+      memcpy(&dibuang, p, 4);
+      hilang += dibuang;
+      printf("%s⚠ %u log dibuang di perangkat (ring penuh)\n", awalBaris ? "" : "\n", dibuang);
+      awalBaris = true;
+    } else if (jenis == 'R' && len >= 8) {
+      record++;
+      uint16_t id = (uint16_t)(p[0] | p[1] << 8);
+      uint8_t level = p[2];
+      uint32_t ms;
+      memcpy(&ms, p + 4, 4);
+      auto it = kamus.find(id);
+      char teks[2048];
+      if (it == kamus.end()) {
+        tanpaKamus++;
+        snprintf(teks, sizeof(teks), "<format #%u belum diterima, kirim \"log kamus\">\n", id);
+      } else {
+        formatLog(it->second.c_str(), p + 8, len - 8, teks, sizeof(teks), lebarLong);
+      }
+      const std::string& namaTag = tag.count(p[3]) ? tag[p[3]] : std::string("?");
+      for (const char* c = teks; *c; c++) {
+        if (awalBaris && *c != '\n') {
+          printf("[%10.3f] %c %-6s ", ms / 1000.0, level < 4 ? "DIWE"[level] : '?', namaTag.c_str());
+        }
+        putchar(*c);
+        awalBaris = *c == '\n';
+      }
+    }
+  }
+  fflush(stdout);
+  fprintf(stderr, "dekode-log: %llu record, %zu format, %llu CRC salah, %llu tanpa kamus, %llu dibuang perangkat\n",
+          (unsigned long long)record, kamus.size(), (unsigned long long)crcSalah,
+          (unsigned long long)tanpaKamus, (unsigned long long)hilang);
+  return 0;
+}
+
+// --------------------------------------------------------------
+// VALIDASI TRACE: akuntansi hasil reading di device vs server sim
+// --------------------------------------------------------------
+// Setiap reading harus berakhir di tepat satu hasil; jalur REST harus
+// cocok dengan patch dataSensor yang dilihat server (seq tanpa duplikat,
+// gap hanya dari reading yang memang tidak dikirim), dan kuantil e2e
+// device (batas atas bucket log2) harus mengapit latensi jam virtual.
+// --------------------------------------------------------------
+static bool cekTrace(const char* nama, bool ok, const char* rinci) {
+  if (!ok) printf("  ✗ %-22s %s\n", nama, rinci);
+  return ok;
+}
+
+static bool cekKuantilE2e(float q, const std::vector<uint64_t>& sorted) {
+  if (sorted.empty()) return true;
+  uint64_t sim = sorted[(size_t)(q * (sorted.size() - 1))];
+  uint64_t dev = kuantilTahap("e2e", q);
+  char rinci[96];
+  snprintf(rinci, sizeof(rinci), "device %llu us vs sim %llu us",
+           (unsigned long long)dev, (unsigned long long)sim);
+  printf("  e2e p%-3.0f device <= %8llu us, sim %8llu us\n", q * 100,
+         (unsigned long long)dev, (unsigned long long)sim);
+  // capturedAt dibulatkan ke ms: nilai sim bisa lebih besar < 1 ms
+  return cekTrace("kuantil e2e", dev + 1000 >= sim && dev <= 2 * sim, rinci);
+}
+
+static int validasiTrace(uint64_t trigger) {
+  const StatistikJaringan& j = simJaringan;
+  uint64_t dibaca = traceHitungan("dibaca");
+  uint64_t terkirim = traceHitungan("terkirim");
+  uint64_t gagal = traceHitungan("gagal");
+  uint64_t ack = traceHitungan("ack");
+  uint64_t antrian = traceHitungan("antrian");
+  uint64_t tidakKirim = traceHitungan("antrianPenuh") + traceHitungan("ditahan") +
+                        traceHitungan("anggaran") + traceHitungan("tidakSiap");
+  uint64_t hasil = tidakKirim + gagal + terkirim + antrian;
+
+  printf("Trace    : dibaca %llu = antrianPenuh %u + ditahan %u + anggaran %u + tidakSiap %u"
+         " + gagal %llu + terkirim %llu + antrian %llu (ack %llu)\n",
+         (unsigned long long)dibaca, traceHitungan("antrianPenuh"), traceHitungan("ditahan"),
+         traceHitungan("anggaran"), traceHitungan("tidakSiap"), (unsigned long long)gagal,
+         (unsigned long long)terkirim, (unsigned long long)antrian, (unsigned long long)ack);
+  printf("  server : %llu diterima, %llu gagal, %llu duplikat, %llu seq hilang, seq terakhir %u (boot %u)\n",
+         (unsigned long long)j.traceDiterima, (unsigned long long)j.traceGagal,
+         (unsigned long long)j.traceDuplikat, (unsigned long long)j.traceHilang,
+         j.traceSeqTerakhir, j.traceBootId);
+
+  char rinci[96];
+  bool ok = true;
+  snprintf(rinci, sizeof(rinci), "%llu burst vs %llu reading",
+           (unsigned long long)trigger, (unsigned long long)dibaca);
+  ok &= cekTrace("dibaca = burst", trigger >= dibaca && trigger - dibaca <= 1, rinci);
+  snprintf(rinci, sizeof(rinci), "%llu dibaca vs %llu hasil", (unsigned long long)dibaca, (unsigned long long)hasil);
+  ok &= cekTrace("akuntansi hasil", dibaca == hasil, rinci);
+  ok &= cekTrace("seq tanpa trace", j.traceTanpaSeq == 0, "patch dataSensor tanpa seq/bootId");
+  ok &= cekTrace("duplikat", j.traceDuplikat == 0, "seq tidak naik ketat");
+  snprintf(rinci, sizeof(rinci), "%llu gap vs %llu reading tidak terkirim",
+           (unsigned long long)j.traceHilang, (unsigned long long)(dibaca - terkirim));
+  ok &= cekTrace("gap seq", j.traceHilang <= dibaca - terkirim, rinci);
+  if (j.espnowFrame) {
+    // Leaf: terkirim = ack MAC = frame yang sampai; gagal = habis percobaan kirim ulang
+    snprintf(rinci, sizeof(rinci), "device %llu/%llu vs sim %llu",
+             (unsigned long long)terkirim, (unsigned long long)ack, (unsigned long long)j.traceDiterima);
+    ok &= cekTrace("terkirim = sampai", terkirim == j.traceDiterima && ack == terkirim, rinci);
+    snprintf(rinci, sizeof(rinci), "%llu reading gagal vs %llu frame tanpa ack",
+             (unsigned long long)gagal, (unsigned long long)j.espnowGagal);
+    ok &= cekTrace("gagal", gagal * 4 <= j.espnowGagal, rinci);
+    ok &= cekTrace("frame rusak", j.espnowRusak == 0, "frame leaf tidak bisa didekode codec sim");
+  } else if (!j.mqttPublish) {
+    // REST: terkirim = ack = patch sukses; gagal = patch gagal
+    snprintf(rinci, sizeof(rinci), "device %llu/%llu vs server %llu",
+             (unsigned long long)terkirim, (unsigned long long)ack, (unsigned long long)j.traceDiterima);
+    ok &= cekTrace("terkirim = diterima", terkirim == j.traceDiterima && ack == terkirim, rinci);
+    snprintf(rinci, sizeof(rinci), "device %llu vs server %llu",
+             (unsigned long long)gagal, (unsigned long long)j.traceGagal);
+    ok &= cekTrace("gagal", gagal == j.traceGagal, rinci);
+    std::vector<uint64_t> e2e = j.traceE2eUs;
+    std::sort(e2e.begin(), e2e.end());
+    ok &= cekKuantilE2e(0.50f, e2e);
+    ok &= cekKuantilE2e(0.99f, e2e);
+  }
+  printf("  %s\n", ok ? "✓ akuntansi trace cocok" : "✗ akuntansi trace TIDAK cocok");
+  return ok ? 0 : 3;
+}
+
+// Hitungan gateway vs yang dikirim leaf virtual vs dokumen kolam di server
+static int validasiGateway() {
+  const StatistikJaringan& j = simJaringan;
+  uint64_t hasil[6];
+  const char* label[6] = { "baru", "terlambat", "duplikat", "basi", "tabelPenuh", "rusak" };
+  uint64_t diterima = 0;
+  for (int h = 0; h < 6; h++) {
+    hasil[h] = espnowHitungan(label[h]);
+    diterima += hasil[h];
+  }
+  uint64_t antrianPenuh = espnowHitungan("antrianPenuh");
+  uint64_t unik = 0, gap = 0;
+  size_t kolamCocok = 0, kolamDicek = 0;
+  for (const LeafVirtual& l : leafVirtual) {
+    unik += l.unik;
+    gap += l.gapSelesai;
+    if (l.unikBoot) gap += l.seqTertinggi - l.seqTerendah + 1 - l.unikBoot;
+    if (!l.seqSebelumAkhir) continue;
+    kolamDicek++;
+    auto it = j.kolamSeq.find(l.kolam);
+    if (it != j.kolamSeq.end() && it->second.second >= l.seqSebelumAkhir && it->second.second <= l.seqTertinggi) {
+      kolamCocok++;
+    }
+  }
+  uint64_t batch = espnowHitungan("batch");
+  uint64_t dokumen = espnowHitungan("dokumen");
+
+  printf("Gateway  : %d leaf, %llu frame (hilang %llu, dobel %llu, tunda %llu) -> baru %llu + terlambat %llu + duplikat %llu"
+         " + basi %llu + tabelPenuh %llu + rusak %llu, antrian penuh %llu\n",
+         leafKonfig.jumlah, (unsigned long long)leafFrame, (unsigned long long)leafHilang,
+         (unsigned long long)leafDobel, (unsigned long long)leafTunda, (unsigned long long)hasil[0], (unsigned long long)hasil[1],
+         (unsigned long long)hasil[2], (unsigned long long)hasil[3], (unsigned long long)hasil[4],
+         (unsigned long long)hasil[5], (unsigned long long)antrianPenuh);
+  printf("  batch  : %llu commit, %llu dokumen kolam (%.1f frame/dokumen), %u digabung, %u gagal, gap seq %u\n",
+         (unsigned long long)batch, (unsigned long long)dokumen, dokumen ? (double)unik / dokumen : 0.0,
+         espnowHitungan("digabung"), espnowHitungan("batchGagal"), espnowHitungan("hilang"));
+  printf("  server : %llu commit kolam, %llu dokumen, %llu seq mundur, seq terbaru %zu/%zu kolam\n",
+         (unsigned long long)j.kolamCommit, (unsigned long long)j.kolamDokumen,
+         (unsigned long long)j.kolamMundur, kolamCocok, kolamDicek);
+
+  // Frame yang dibuang sebelum disaring (antrian penuh) atau node di luar
+  // GATEWAY_NODE_MAX: hanya batas atas yang bisa dicek
+  bool lengkap = antrianPenuh == 0 && hasil[4] == 0;
+  char rinci[96];
+  bool ok = true;
+  snprintf(rinci, sizeof(rinci), "%llu sampai vs %llu diterima + %llu antrian penuh", (unsigned long long)leafSampai,
+           (unsigned long long)diterima, (unsigned long long)antrianPenuh);
+  ok &= cekTrace("frame diterima", leafSampai == diterima + antrianPenuh, rinci);
+  snprintf(rinci, sizeof(rinci), "%llu dobel vs %llu duplikat", (unsigned long long)leafDobel,
+           (unsigned long long)hasil[2]);
+  ok &= cekTrace("duplikat", lengkap ? leafDobel == hasil[2] : leafDobel >= hasil[2], rinci);
+  snprintf(rinci, sizeof(rinci), "%llu frame sebelum reboot diterima vs %llu basi", (unsigned long long)leafBasi,
+           (unsigned long long)hasil[3]);
+  ok &= cekTrace("bootId mundur", lengkap ? leafBasi == hasil[3] : leafBasi >= hasil[3], rinci);
+  snprintf(rinci, sizeof(rinci), "%llu unik vs %llu baru+terlambat", (unsigned long long)unik,
+           (unsigned long long)(hasil[0] + hasil[1]));
+  ok &= cekTrace("frame unik", lengkap ? unik == hasil[0] + hasil[1] : unik >= hasil[0] + hasil[1], rinci);
+  snprintf(rinci, sizeof(rinci), "%llu tersusul vs %llu terlambat", (unsigned long long)leafTersusul,
+           (unsigned long long)hasil[1]);
+  ok &= cekTrace("frame tersusul", !lengkap || leafTersusul == hasil[1], rinci);
+  snprintf(rinci, sizeof(rinci), "gateway %u vs sim %llu", espnowHitungan("hilang"), (unsigned long long)gap);
+  ok &= cekTrace("gap seq", !lengkap || espnowHitungan("hilang") == gap, rinci);
+  snprintf(rinci, sizeof(rinci), "gateway %llu/%llu vs server %llu/%llu", (unsigned long long)batch,
+           (unsigned long long)dokumen, (unsigned long long)j.kolamCommit, (unsigned long long)j.kolamDokumen);
+  ok &= cekTrace("batch = server", batch == j.kolamCommit && dokumen == j.kolamDokumen, rinci);
+  ok &= cekTrace("seq kolam", j.kolamMundur == 0, "seq dokumen kolam mundur / tanpa trace");
+  snprintf(rinci, sizeof(rinci), "%zu/%zu kolam", kolamCocok, kolamDicek);
+  ok &= cekTrace("kolam terbaru", !lengkap || kolamCocok == kolamDicek, rinci);
+  snprintf(rinci, sizeof(rinci), "%llu commit dalam %.0f s", (unsigned long long)batch, simKonfig.durasiDetik);
+  ok &= cekTrace("satu commit/periode", batch <= simKonfig.durasiDetik / LEAF_BATCH_S + 1, rinci);
+  printf("  %s\n", ok ? "✓ akuntansi gateway cocok" : "✗ akuntansi gateway TIDAK cocok");
+  return ok ? 0 : 3;
+}
+
+// Penjadwal akuisisi: jarak antar tick esp_timer (jam virtual; membesar
+// jika callback menunggu sibuk seperti pulseIn lama), durasi callback
+// (waktu host) harus jauh di bawah satu tick, dan setiap siklus yang
+// dimulai selesai dalam batas burst ultrasonic lalu menjadi reading
+static int validasiAkuisisi() {
+  char rinci[96];
+  bool ok = true;
+  uint32_t tick = akuisisiHitungan("tick");
+  uint32_t jitter = akuisisiHitungan("jitterMaks");
+  uint32_t siklus = akuisisiHitungan("siklus");
+  uint32_t siklusMaks = akuisisiHitungan("siklusMaks");
+  uint32_t dibaca = traceHitungan("dibaca");
+  std::sort(latTimer.begin(), latTimer.end());
+  uint64_t p999 = latTimer.empty() ? 0 : latTimer[(size_t)(0.999 * (latTimer.size() - 1))] / 1000;
+  printf("Akuisisi : %u tick, jitter maks %u us, callback p99.9 %llu us; %u siklus, maks %.1f ms\n", tick,
+         jitter, (unsigned long long)p999, siklus, siklusMaks / 1000.0);
+
+  uint64_t harapanTick = simSekarangUs() / TICK_US;
+  snprintf(rinci, sizeof(rinci), "%u tick dalam %llu ms", tick, (unsigned long long)harapanTick);
+  ok &= cekTrace("tick hilang", tick + 2 >= harapanTick && tick <= harapanTick, rinci);
+  snprintf(rinci, sizeof(rinci), "%u us (batas %u us)", jitter, TICK_JITTER_BATAS_US);
+  ok &= cekTrace("jitter tick", jitter <= TICK_JITTER_BATAS_US, rinci);
+  snprintf(rinci, sizeof(rinci), "p99.9 %llu us (periode %u us)", (unsigned long long)p999, TICK_US);
+  ok &= cekTrace("durasi callback", p999 < TICK_US, rinci);
+  snprintf(rinci, sizeof(rinci), "%u siklus selesai vs %u reading", siklus, dibaca);
+  ok &= cekTrace("siklus selesai", siklus == dibaca || siklus == dibaca + 1, rinci);
+  snprintf(rinci, sizeof(rinci), "maks %u us (batas %u us)", siklusMaks, SIKLUS_BATAS_US);
+  ok &= cekTrace("durasi siklus", siklusMaks <= SIKLUS_BATAS_US, rinci);
+  printf("  %s\n", ok ? "✓ penjadwal dalam batas" : "✗ penjadwal di luar batas");
+  return ok ? 0 : 3;
+}
+
+// Relay dilihat dari pin GPIO stub (bukan state firmware): jumlah ubah,
+// minimum nyala/mati, latensi sampel -> relay dan laporan actuatorState.
+// Jam virtual tidak maju selama komputasi fuzzy/aturan, jadi latensi
+// kontrol device hanya bagian I/O virtual; batas dicek pada bagian itu
+// ditambah waktu host langkah sampling yang mengevaluasi sampel (latKontrol).
+static int validasiAktuator() {
+  const StatistikJaringan& j = simJaringan;
+  char rinci[96];
+  bool ok = true;
+  bool lapor = aktuatorHitungan(-1, "tertunda") == 0 && aktuatorHitungan(-1, "antrian") == 0;
+  for (int i = 0; aktuatorNama(i); i++) {
+    const std::vector<TransisiPin>& t = simTransisiPin((uint8_t)aktuatorHitungan(i, "pin"));
+    uint64_t minNyalaUs = aktuatorHitungan(i, "minNyalaMs") * 1000ULL;
+    uint64_t minMatiUs = aktuatorHitungan(i, "minMatiMs") * 1000ULL;
+    uint64_t nyalaUs = 0, sebelumUs = 0;
+    bool minimumOk = true, nyala = false;
+    for (const TransisiPin& p : t) {
+      uint64_t lama = p.us - sebelumUs;
+      // millis() firmware vs jam us stub: selisih < 1 ms
+      if (lama + 1000 < (nyala ? minNyalaUs : minMatiUs)) minimumOk = false;
+      if (nyala) nyalaUs += lama;
+      nyala = p.level != 0;   // RELAY_AKTIF_TINGGI
+      sebelumUs = p.us;
+    }
+    if (nyala) nyalaUs += simSekarangUs() - sebelumUs;
+    printf("%s %-8s: %zu ubah, nyala %.0f s, %u sampel tertahan minimum, %u tidak valid\n",
+           i ? "         " : "Aktuator :", aktuatorNama(i), t.size(), nyalaUs / 1e6,
+           aktuatorHitungan(i, "ditahan"), aktuatorHitungan(i, "tidakValid"));
+
+    snprintf(rinci, sizeof(rinci), "%s: pin %zu vs device %u", aktuatorNama(i), t.size(), aktuatorHitungan(i, "ubah"));
+    ok &= cekTrace("ubah relay", t.size() == aktuatorHitungan(i, "ubah") && nyala == (aktuatorHitungan(i, "nyala") != 0),
+                   rinci);
+    snprintf(rinci, sizeof(rinci), "%s: nyala/mati lebih pendek dari minimum", aktuatorNama(i));
+    ok &= cekTrace("minimum nyala/mati", minimumOk, rinci);
+    if (lapor) {
+      auto it = j.aktuatorServer.find(aktuatorNama(i));
+      bool cocok = it != j.aktuatorServer.end() && it->second.first == (nyala ? "on" : "off") &&
+                   it->second.second == t.size();
+      snprintf(rinci, sizeof(rinci), "%s: server %s/%u vs relay %s/%zu", aktuatorNama(i),
+               it != j.aktuatorServer.end() ? it->second.first.c_str() : "-",
+               it != j.aktuatorServer.end() ? it->second.second : 0, nyala ? "on" : "off", t.size());
+      ok &= cekTrace("actuatorState", cocok, rinci);
+    }
+    for (size_t k = 0; k < t.size() && k < 6; k++) {
+      printf("  %9.1f s  %s\n", t[k].us / 1e6, t[k].level ? "NYALA" : "MATI");
+    }
+  }
+  uint32_t sampel = aktuatorHitungan(-1, "sampel");
+  uint32_t maks = aktuatorHitungan(-1, "latensiMaks");
+  uint64_t hostMaksUs = latKontrol.empty() ? 0 : *std::max_element(latKontrol.begin(), latKontrol.end()) / 1000;
+  printf("  kontrol: %u sampel, rata2 %u us, p50 <= %u us, p99 <= %u us, max %u us virtual + %llu us host"
+         " (batas %u us)\n",
+         sampel, aktuatorHitungan(-1, "latensiRata"), kuantilTahap("kontrol", 0.50f),
+         kuantilTahap("kontrol", 0.99f), maks, (unsigned long long)hostMaksUs, AKTUATOR_BATAS_US);
+  printf("  laporan: %u commit, %u gagal, %u digabung, overflow %u; server %llu commit, %llu dokumen%s\n",
+         aktuatorHitungan(-1, "batch"), aktuatorHitungan(-1, "gagal"), aktuatorHitungan(-1, "digabung"),
+         aktuatorHitungan(-1, "overflow"), (unsigned long long)j.aktuatorCommit,
+         (unsigned long long)j.aktuatorDokumen, lapor ? "" : " (masih tertunda)");
+
+  snprintf(rinci, sizeof(rinci), "%u sampel kontrol vs %u reading", sampel, traceHitungan("dibaca"));
+  ok &= cekTrace("kontrol tiap sampel", sampel == traceHitungan("dibaca"), rinci);
+  snprintf(rinci, sizeof(rinci), "max %u us virtual + %llu us host (%zu langkah)", maks,
+           (unsigned long long)hostMaksUs, latKontrol.size());
+  ok &= cekTrace("latensi kontrol", (sampel == 0 || !latKontrol.empty()) && maks + hostMaksUs <= AKTUATOR_BATAS_US,
+                 rinci);
+  snprintf(rinci, sizeof(rinci), "device %u vs server %llu", aktuatorHitungan(-1, "batch"),
+           (unsigned long long)j.aktuatorCommit);
+  ok &= cekTrace("laporan = server", aktuatorHitungan(-1, "batch") == j.aktuatorCommit, rinci);
+  ok &= cekTrace("antrian aktuasi", aktuatorHitungan(-1, "overflow") == 0, "aktuasiQueue penuh");
+  printf("  %s\n", ok ? "✓ aktuator cocok" : "✗ aktuator TIDAK cocok");
+  return ok ? 0 : 3;
+}
+
+int main(int argc, char** argv) {
+  parseArgumen(argc, argv);
+  if (!simKonfig.dekodeLog.empty()) return dekodeLog(simKonfig.dekodeLog);
+  signal(SIGPIPE, SIG_IGN);   // klien LAN yang putus tidak boleh mematikan proses
+
+  // Buffer latensi dipesan sebelum baseline heap agar tidak terhitung sebagai heap firmware
+  size_t langkahMs = (size_t)(simKonfig.durasiDetik * 1000) + 1000;
+  latSampling.reserve(langkahMs);
+  latTimer.reserve(langkahMs);
+  latJaringan.reserve(langkahMs / 5);
+  latKontrol.reserve(langkahMs / 2000 + 16);   // sampel paling cepat tiap LAJU_MIN_MS
+  simJaringan.mqttRttNs.reserve(langkahMs / 1000);
+  simMulai(simKonfig.seed);
+  if (simKonfig.bootHangat) simSiapkanBootHangat();
+
+  setup();
+  double setupMs = simSekarangUs() / 1000.0;
+  if (!simPipelineAktif()) {
+    fprintf(stderr, "sim: setup() tidak memulai task pipeline\n");
+    return 2;
+  }
+  simAturTaskSampling(langkahSampling);
+  if (leafKonfig.jumlah) {
+    if (!simGatewayEspNow()) {
+      fprintf(stderr, "sim: --leaf butuh build gateway (-DTAMBAQ_PERAN=PERAN_GATEWAY)\n");
+      return 2;
+    }
+    mulaiLeafVirtual();
+  }
+
+  // Ukur kondisi tunak: alokasi & reading dihitung setelah setup()
+  uint64_t triggerAwal = simJumlahTrigger();
+  StatistikJaringan jaringanAwal = simJaringan;
+  simHitungAlokasi(true);
+
+  uint64_t batasUs = (uint64_t)(simKonfig.durasiDetik * 1e6);
+  size_t perintahBerikut = 0;
+  uint64_t dindingAwal = nsHost();
+  uint64_t virtualAwal = simSekarangUs();
+  uint64_t lanTerakhirUs = 0;
+  while (simSekarangUs() < batasUs) {
+    simMaju(5000);   // vTaskDelay(5 ms) task jaringan
+    if (simKonfig.waktuNyata) {
+      uint64_t virtualNs = (simSekarangUs() - virtualAwal) * 1000;
+      uint64_t dindingNs = nsHost() - dindingAwal;
+      if (virtualNs > dindingNs) usleep((useconds_t)((virtualNs - dindingNs) / 1000));
+    }
+    // Task lan: vTaskDelay(LAN_POLL_MS = 10 ms)
+    if (langkahLan && simSekarangUs() - lanTerakhirUs >= 10000) {
+      lanTerakhirUs = simSekarangUs();
+      langkahLan();
+    }
+    // Output perintah serial ditampilkan selama satu langkah jaringan
+    bool adaPerintah = false;
+    while (perintahBerikut < simKonfig.perintah.size() &&
+           simKonfig.perintah[perintahBerikut].detik * 1e6 <= simSekarangUs()) {
+      simKirimSerial(simKonfig.perintah[perintahBerikut++].teks);
+      adaPerintah = true;
+    }
+    simTampilkanSerial(adaPerintah);
+    // Callback terima ESP-NOW (task WiFi) sebelum task jaringan jalan
+    if (leafKonfig.jumlah) langkahLeafVirtual(simSekarangUs(), batasUs);
+    uint64_t samplingAwal = simNsDalamSampling();
+    uint64_t t0 = nsHost();
+    langkahJaringan();
+    uint64_t dt = nsHost() - t0;
+    // Sampling yang berjalan selama request memblokir bukan biaya langkah ini
+    dt -= simNsDalamSampling() - samplingAwal;
+    latJaringan.push_back(dt);
+    langkahLog();   // task log: teks/frame log langkah ini ikut tampil
+    simTampilkanSerial(false);
+  }
+  simHitungAlokasi(false);
+
+  uint64_t reading = simJumlahTrigger() - triggerAwal;
+  uint64_t bytes = (simJaringan.bytesBody - jaringanAwal.bytesBody) +
+                   (simJaringan.bytesMask - jaringanAwal.bytesMask) +
+                   (simJaringan.bytesPath - jaringanAwal.bytesPath);
+  double perReading = reading ? 1.0 / reading : 0;
+
+  printf("\n=== SIMULASI TAMBAQ (%.0f s virtual, boot %s, trace %s) ===\n",
+         simKonfig.durasiDetik, simKonfig.bootHangat ? "hangat" : "dingin",
+         simKonfig.trace.empty() ? "sintetis" : "file");
+  printf("Boot     : setup() %.0f ms, upload pertama %.0f ms (virtual)\n",
+         setupMs, simJaringan.uploadPertamaMs);
+  printf("Latensi langkah (waktu host):\n");
+  cetakLatensi("sampling", latSampling);
+  cetakLatensi("timer1ms", latTimer);
+  cetakLatensi("jaringan", latJaringan);
+  cetakLatensi("kontrol", latKontrol);
+  printf("Reading  : %llu (ADC overflow %llu)\n",
+         (unsigned long long)reading, (unsigned long long)simAdcOverflow());
+  printf("Heap     : %.2f alokasi/reading, %.1f byte/reading\n",
+         simJumlahAlokasi() * perReading, simBytesAlokasi() * perReading);
+  printf("Jaringan : patch %llu, commit %llu (%llu dokumen), gagal %llu, handshake %llu, reuse %llu\n",
+         (unsigned long long)simJaringan.patch, (unsigned long long)simJaringan.commit,
+         (unsigned long long)simJaringan.dokumenCommit, (unsigned long long)simJaringan.gagal,
+         (unsigned long long)simJaringan.handshake, (unsigned long long)simJaringan.requestReuse);
+  printf("Payload  : %.1f byte/reading (body %llu, mask %llu, path %llu), blokir %.1f s virtual\n",
+         bytes * perReading, (unsigned long long)simJaringan.bytesBody,
+         (unsigned long long)simJaringan.bytesMask, (unsigned long long)simJaringan.bytesPath,
+         simJaringan.virtualMsBlokir / 1000.0);
+
+  // Jalur live: byte aplikasi per upload (tanpa TLS), REST dimodelkan, MQTT asli
+  const StatistikJaringan& j = simJaringan;
+  if (j.restLive) {
+    printf("Live REST: %llu patch, %.0f byte keluar + %.0f byte masuk per upload (HTTP, model)\n",
+           (unsigned long long)j.restLive, (double)j.restBytesKeluar / j.restLive,
+           (double)j.restBytesMasuk / j.restLive);
+  }
+  if (!simKonfig.kejadian.empty()) {
+    uint64_t live = j.restLive - jaringanAwal.restLive;
+    printf("Deteksi  : %llu write live (%.0f/hari), kejadian -> upload kritis pertama:\n",
+           (unsigned long long)live, live * 86400.0 / simKonfig.durasiDetik);
+    for (const Kejadian& k : simKonfig.kejadian) {
+      if (k.deteksiDetik < 0) {
+        printf("  %7.0f s  %-24s tidak terdeteksi\n", k.detik, k.label.c_str());
+      } else {
+        printf("  %7.0f s  %-24s %+.0f s\n", k.detik, k.label.c_str(), k.deteksiDetik - k.detik);
+      }
+    }
+  }
+  if (j.mqttPublish) {
+    std::vector<uint64_t> rtt = j.mqttRttNs;
+    printf("Live MQTT: %llu publish, %llu PUBACK, %llu koneksi, %.0f byte keluar + %.0f byte masuk per publish\n",
+           (unsigned long long)j.mqttPublish, (unsigned long long)j.mqttAck,
+           (unsigned long long)j.mqttKoneksi, (double)j.mqttBytesKeluar / j.mqttPublish,
+           (double)j.mqttBytesMasuk / j.mqttPublish);
+    cetakLatensi("PUBACK", rtt);
+  }
+  if (j.espnowFrame) {
+    printf("ESP-NOW  : %llu frame (%llu tanpa ack), %.1f byte/frame\n", (unsigned long long)j.espnowFrame,
+           (unsigned long long)j.espnowGagal, (double)j.espnowBytes / j.espnowFrame);
+  }
+  int kode = validasiTrace(simJumlahTrigger());
+  if (validasiAkuisisi() != 0) kode = 3;
+  if (leafKonfig.jumlah && validasiGateway() != 0) kode = 3;
+  if (validasiAktuator() != 0) kode = 3;
+  return kode;
+}
@@ -0,0 +1,166 @@
+// Mesin simulasi host: jam virtual, event, model jaringan, trace sensor.
+// Dipakai bersama oleh stubs.cpp (pengganti API) dan main.cpp (driver).
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+struct TitikTrace {
+  double detik;
+  float phVolt;
+  float tdsVolt;
+  float turbVolt;
+  float jarakCm;    // <= 0: tidak ada echo (timeout)
+};
+
+struct JendelaPutus {
+  double mulaiDetik;
+  double durasiDetik;
+};
+
+struct PerintahSerial {
+  double detik;
+  std::string teks;
+};
+
+// Baris "#kejadian,DETIK,LABEL" di trace: saat nilai asli masuk band kritis
+struct Kejadian {
+  double detik;
+  std::string label;
+  double deteksiDetik = -1;   // upload live pertama dengan nilai kritis
+};
+
+struct KonfigSim {
+  double durasiDetik = 3600;
+  uint32_t seed = 1;
+  bool verbose = false;
+  bool bootHangat = false;
+  bool waktuNyata = false;
+
+  // Model jaringan (milidetik virtual)
+  double wifiConnectMs = 2500;
+  double wifiConnectCacheMs = 400;
+  double ntpMs = 800;
+  double signInMs = 1800;
+  double handshakeMs = 1200;
+  double idleServerMs = 240000;   // server menutup koneksi HTTP idle
+  double requestMs = 180;
+  double jitterMs = 60;
+  double probGagal = 0.0;
+  std::vector<JendelaPutus> putus;
+  std::vector<PerintahSerial> perintah;   // baris yang diketik ke Serial
+  std::string mqttBroker;                 // host:port, kosong = dari MQTT_BROKER_URI
+  std::string dekodeLog;                  // --dekode-log: dekode capture lalu keluar
+  std::string fsDir;                      // --fs: image LittleFS di host, kosong = sementara
+
+  // Sensor
+  float noiseAdc = 8.0f;          // sigma noise ADC (kode)
+  double probPercikan = 0.0;      // peluang echo palsu per ping ultrasonic
+  std::vector<TitikTrace> trace;  // kosong = sintetis
+  std::vector<Kejadian> kejadian;
+};
+
+struct StatistikJaringan {
+  uint64_t patch = 0;
+  uint64_t commit = 0;
+  uint64_t gagal = 0;
+  uint64_t handshake = 0;                 // socket TLS baru (selalu handshake penuh)
+  uint64_t requestReuse = 0;              // request lewat socket yang masih terbuka
+  uint64_t bytesBody = 0;
+  uint64_t bytesMask = 0;
+  uint64_t bytesPath = 0;
+  uint64_t dokumenCommit = 0;
+  double virtualMsBlokir = 0;
+  double uploadPertamaMs = -1;
+
+  // Byte aplikasi di kabel (tanpa TLS) untuk jalur live sensorRead/dataSensor.
+  // REST: request/respons HTTP dimodelkan; MQTT: byte socket asli ke broker.
+  uint64_t restLive = 0;
+  uint64_t restBytesKeluar = 0;
+  uint64_t restBytesMasuk = 0;
+  uint64_t mqttPublish = 0;
+  uint64_t mqttAck = 0;
+  uint64_t mqttKoneksi = 0;
+  uint64_t mqttBytesKeluar = 0;
+  uint64_t mqttBytesMasuk = 0;
+  std::vector<uint64_t> mqttRttNs;        // PUBLISH -> PUBACK (jam dinding)
+
+  // Trace sensorRead/dataSensor seperti dilihat server (REST)
+  uint64_t traceDiterima = 0;
+  uint64_t traceGagal = 0;                // patch gagal (reading masuk jurnal)
+  uint64_t traceTanpaSeq = 0;
+  uint64_t traceDuplikat = 0;             // seq tidak naik dalam bootId yang sama
+  uint64_t traceHilang = 0;               // total gap seq
+  uint32_t traceBootId = 0;
+  uint32_t traceSeqTerakhir = 0;
+  std::vector<uint64_t> traceE2eUs;       // capturedAt -> diterima (jam virtual)
+
+  // Build leaf: frame ESP-NOW keluar (termasuk kirim ulang), didekode sim;
+  // frame yang sampai ikut dihitung di trace* di atas
+  uint64_t espnowFrame = 0;
+  uint64_t espnowGagal = 0;               // tanpa ack MAC (putus / --gagal)
+  uint64_t espnowRusak = 0;               // tidak bisa didekode sim
+  uint64_t espnowBytes = 0;
+
+  // Build gateway: dokumen sensorRead/kolam-<id> yang sukses di-commit
+  uint64_t kolamCommit = 0;
+  uint64_t kolamDokumen = 0;
+  uint64_t kolamMundur = 0;               // seq kolam tidak naik dalam bootId yang sama
+  std::map<uint32_t, std::pair<uint32_t, uint32_t> > kolamSeq;   // kolam -> (bootId, seq)
+
+  // Dokumen actuatorState/<nama> yang sukses di-commit
+  uint64_t aktuatorCommit = 0;
+  uint64_t aktuatorDokumen = 0;
+  std::map<std::string, std::pair<std::string, uint32_t> > aktuatorServer;   // nama -> (status, switchCount)
+
+  // Dokumen sensorHistory/<id> yang sukses di-commit -> berapa kali ditulis
+  std::map<std::string, uint32_t> riwayatServer;
+};
+
+// Perubahan level pin GPIO selain TRIG (relay aktuator), jam virtual
+struct TransisiPin {
+  uint64_t us;
+  uint8_t level;
+};
+
+extern KonfigSim simKonfig;
+extern StatistikJaringan simJaringan;
+
+uint64_t simSekarangUs();
+void simMaju(uint64_t us);                // majukan jam, jalankan timer/ISR/task sampling
+void simAturTaskSampling(void (*langkah)());
+bool simPipelineAktif();
+uint64_t simJumlahTrigger();              // jumlah burst ultrasonic = jumlah reading
+const std::vector<TransisiPin>& simTransisiPin(uint8_t pin);
+uint64_t simAdcOverflow();
+
+// Penghitung alokasi heap (malloc/new) selama simHitungAlokasi aktif
+void simHitungAlokasi(bool aktif);
+uint64_t simJumlahAlokasi();
+uint64_t simBytesAlokasi();
+
+// Waktu host yang dipakai langkah sampling di dalam simMaju (dikurangkan
+// dari latensi langkah jaringan saat request memblokir secara virtual)
+uint64_t simNsDalamSampling();
+void simCatatLatensiSampling(uint64_t ns);
+void simCatatLatensiTimer(uint64_t ns);
+
+// Path LittleFS firmware -> path file di host (lihat LittleFS.h)
+std::string simPathFs(const char* path);
+
+void simMulai(uint32_t seed);             // seed RNG + baseline heap host (sebelum setup())
+void simSiapkanBootHangat();
+void simTutupSocketTls();                 // socket fbdo mati (RST/NAT) atau soft reset
+
+// Input Serial (dibaca prosesPerintahSerial); output Serial ditampilkan
+// jika verbose atau selama simTampilkanSerial(true)
+void simKirimSerial(const std::string& baris);
+void simTampilkanSerial(bool tampil);
+
+// ESP-NOW: codec frame leaf kedua (layout di kodeesp32.cpp) untuk leaf
+// virtual; simTerimaEspNow memanggil callback terima gateway
+size_t simTulisFrameLeaf(uint32_t nodeId, uint16_t kolam, uint16_t bootId, uint32_t seq,
+                         const float nilai[4], uint16_t umurMs, bool ulang, uint8_t* buf, size_t cap);
+bool simGatewayEspNow();
+void simTerimaEspNow(const uint8_t mac[6], const uint8_t* data, int len);
@@ -0,0 +1,1541 @@
+// --------------------------------------------------------------
+// PENGGANTI API ARDUINO / ESP-IDF / FIREBASE UNTUK SIMULASI HOST
+// --------------------------------------------------------------
+// Semua waktu adalah waktu virtual (mikrodetik sejak boot). delay() dan
+// request Firestore memajukan jam lewat simMaju(), yang juga menjalankan
+// esp_timer, ISR echo, dan langkah task sampling (core lain di ESP32),
+// jadi request yang memblokir tidak menghentikan sampling.
+// --------------------------------------------------------------
+#include "sim.h"
+#include "Arduino.h"
+#include "WiFi.h"
+#include "Firebase_ESP_Client.h"
+#include "addons/TokenHelper.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_sntp.h"
+#include "Preferences.h"
+#include "LittleFS.h"
+#include "esp_adc/adc_continuous.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/base64.h"
+#include "mqtt_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_now.h"
+#include "lwip/sockets.h"
+#include <netdb.h>
+#include <netinet/tcp.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <malloc.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <queue>
+#include <random>
+
+KonfigSim simKonfig;
+StatistikJaringan simJaringan;
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+FirebaseClass Firebase;
+LittleFSFS LittleFS;
+
+#define SIM_EPOCH_AWAL 1760000000L   // waktu "sebenarnya" saat boot
+#define SIM_HEAP_TOTAL 320000UL
+#define SIM_ECHO_DELAY_US 450        // trigger -> rising edge HC-SR04
+#define SIM_CM_PER_US 0.034645f      // kecepatan suara 25 C (= suhu air default firmware)
+
+// --------------------------------------------------------------
+// ALOKASI HEAP
+// --------------------------------------------------------------
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+extern "C" void __libc_free(void*);
+
+static bool hitungAlokasi = false;
+static uint64_t jumlahAlokasi = 0;
+static uint64_t bytesAlokasi = 0;
+static int64_t heapHidup = 0;
+static int64_t heapHidupMaks = 0;
+static int64_t heapAwal = 0;        // heap runtime host sebelum setup()
+
+static void catatAlokasi(void* p) {
+  if (!p) return;
+  size_t n = malloc_usable_size(p);
+  heapHidup += n;
+  if (heapHidup > heapHidupMaks) heapHidupMaks = heapHidup;
+  if (hitungAlokasi) {
+    jumlahAlokasi++;
+    bytesAlokasi += n;
+  }
+}
+
+extern "C" void* malloc(size_t n) {
+  void* p = __libc_malloc(n);
+  catatAlokasi(p);
+  return p;
+}
+
+extern "C" void* calloc(size_t n, size_t m) {
+  void* p = __libc_calloc(n, m);
+  catatAlokasi(p);
+  return p;
+}
+
+extern "C" void* realloc(void* old, size_t n) {
+  if (old) heapHidup -= malloc_usable_size(old);
+  void* p = __libc_realloc(old, n);
+  catatAlokasi(p);
+  return p;
+}
+
+extern "C" void free(void* p) {
+  if (p) heapHidup -= malloc_usable_size(p);
+  __libc_free(p);
+}
+
+void simHitungAlokasi(bool aktif) { hitungAlokasi = aktif; }
+uint64_t simJumlahAlokasi() { return jumlahAlokasi; }
+uint64_t simBytesAlokasi() { return bytesAlokasi; }
+
+// --------------------------------------------------------------
+// JAM VIRTUAL, TIMER, EVENT
+// --------------------------------------------------------------
+enum JenisEvent { EVENT_ECHO_NAIK, EVENT_ECHO_TURUN, EVENT_NTP, EVENT_MQTT_PUBACK };
+
+struct Event {
+  uint64_t us;
+  JenisEvent jenis;
+  int arg;
+  bool operator>(const Event& o) const { return us > o.us; }
+};
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void* arg;
+  uint64_t periodUs;
+  uint64_t nextUs;
+};
+
+static uint64_t nowUs = 0;
+static std::priority_queue<Event, std::vector<Event>, std::greater<Event> > events;
+static std::vector<esp_timer*> timers;
+static void (*langkahSampling)() = nullptr;
+static bool pipelineAktif = false;
+static uint64_t samplingNextUs = 0;
+static uint64_t faseTickUs = 0;
+static uint64_t nsDalamSampling = 0;
+static int kedalamanMaju = 0;
+static std::mt19937 rng(1);
+
+static uint64_t nsHost() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void prosesEvent(const Event& e);
+static void prosesPubackMqtt(int msgId);
+
+void simMulai(uint32_t seed) {
+  rng.seed(seed);
+  // Tick FreeRTOS dan esp_timer dari kristal yang sama: fase tetap per boot
+  faseTickUs = (uint64_t)(seed * 2654435761UL % 1000);
+  heapAwal = heapHidup;
+  heapHidupMaks = heapHidup;
+}
+
+uint64_t simSekarangUs() { return nowUs; }
+bool simPipelineAktif() { return pipelineAktif; }
+uint64_t simNsDalamSampling() { return nsDalamSampling; }
+
+void simAturTaskSampling(void (*langkah)()) {
+  langkahSampling = langkah;
+  samplingNextUs = nowUs + faseTickUs;
+}
+
+void simMaju(uint64_t us) {
+  uint64_t target = nowUs + us;
+  kedalamanMaju++;
+  for (;;) {
+    uint64_t next = target + 1;
+    if (!events.empty() && events.top().us < next) next = events.top().us;
+    for (esp_timer* t : timers) {
+      if (t->periodUs && t->nextUs < next) next = t->nextUs;
+    }
+    bool adaSampling = pipelineAktif && langkahSampling;
+    if (adaSampling && samplingNextUs < next) next = samplingNextUs;
+    if (next > target) break;
+    if (next > nowUs) nowUs = next;
+
+    while (!events.empty() && events.top().us <= nowUs) {
+      Event e = events.top();
+      events.pop();
+      prosesEvent(e);
+    }
+    for (esp_timer* t : timers) {
+      if (t->periodUs && t->nextUs <= nowUs) {
+        t->nextUs += t->periodUs;
+        uint64_t t0 = nsHost();
+        t->callback(t->arg);
+        simCatatLatensiTimer(nsHost() - t0);
+      }
+    }
+    // Task sampling: vTaskDelay(1) = 1 tick (1 ms)
+    if (adaSampling && samplingNextUs <= nowUs) {
+      samplingNextUs = nowUs + 1000;
+      uint64_t t0 = nsHost();
+      langkahSampling();
+      uint64_t dt = nsHost() - t0;
+      nsDalamSampling += dt;
+      simCatatLatensiSampling(dt);
+    }
+  }
+  if (target > nowUs) nowUs = target;
+  kedalamanMaju--;
+}
+
+uint32_t getCpuFrequencyMhz() { return 240; }
+uint32_t esp_cpu_get_cycle_count() { return (uint32_t)(nsHost() * 240 / 1000); }
+
+unsigned long millis() { return (unsigned long)(nowUs / 1000); }
+unsigned long micros() { return (unsigned long)nowUs; }
+int64_t esp_timer_get_time() { return (int64_t)nowUs; }
+
+void delay(unsigned long ms) { simMaju((uint64_t)ms * 1000); }
+
+// Dipanggil di dalam callback timer: cukup geser jam, tanpa memproses event
+void delayMicroseconds(unsigned int us) { nowUs += us; }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  esp_timer* t = new esp_timer();
+  t->callback = args->callback;
+  t->arg = args->arg;
+  t->periodUs = 0;
+  t->nextUs = 0;
+  timers.push_back(t);
+  *out = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+  timer->periodUs = periodUs;
+  timer->nextUs = nowUs + periodUs;
+  return ESP_OK;
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char* name, uint32_t stack,
+                                   void* arg, int prio, TaskHandle_t* handle, int core) {
+  // Task tidak dijalankan sebagai thread; driver memanggil langkah* langsung
+  pipelineAktif = true;
+  if (handle) *handle = (TaskHandle_t)fn;
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) { simMaju((uint64_t)ticks * 1000); }
+void vTaskDelete(TaskHandle_t handle) {}
+
+// --------------------------------------------------------------
+// WAKTU (time()/gettimeofday()/settimeofday() libc diganti jam virtual)
+// --------------------------------------------------------------
+static bool waktuValid = false;
+static int64_t epochOffset = 0;     // epoch = offset + detik sejak boot
+static sntp_sync_time_cb_t sntpCallback = nullptr;
+static bool ntpTerjadwal = false;
+
+extern "C" time_t time(time_t* out) {
+  time_t t = waktuValid ? (time_t)(epochOffset + (int64_t)(nowUs / 1000000)) : (time_t)(nowUs / 1000000);
+  if (out) *out = t;
+  return t;
+}
+
+extern "C" int gettimeofday(struct timeval* __restrict tv, void* __restrict tz) {
+  tv->tv_sec = time(nullptr);
+  tv->tv_usec = (suseconds_t)(nowUs % 1000000);
+  return 0;
+}
+
+extern "C" int settimeofday(const struct timeval* tv, const struct timezone* tz) {
+  epochOffset = (int64_t)tv->tv_sec - (int64_t)(nowUs / 1000000);
+  waktuValid = true;
+  return 0;
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec,
+                const char* server1, const char* server2, const char* server3) {
+  if (ntpTerjadwal) return;
+  ntpTerjadwal = true;
+  events.push(Event{ nowUs + (uint64_t)(simKonfig.ntpMs * 1000), EVENT_NTP });
+}
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) { sntpCallback = callback; }
+
+// --------------------------------------------------------------
+// TRACE SENSOR
+// --------------------------------------------------------------
+static TitikTrace titikSintetis(double s) {
+  // Kolam sehat (kalibrasi default: pH ~7.8, TDS ~490 ppm, 30 NTU) dengan
+  // variasi lambat + lonjakan keruh (~42 NTU, belum kritis) tiap 20 menit
+  TitikTrace t;
+  t.detik = s;
+  t.phVolt = 3.06f + 0.005f * (float)sin(2 * M_PI * s / 900.0);
+  t.tdsVolt = 1.30f + 0.05f * (float)sin(2 * M_PI * s / 1800.0);
+  t.turbVolt = (fmod(s, 1200.0) < 60.0) ? 1.9f : 2.31f;
+  t.jarakCm = 40.0f + 2.0f * (float)sin(2 * M_PI * s / 3600.0);
+  return t;
+}
+
+static TitikTrace titikTrace(double s) {
+  const std::vector<TitikTrace>& tr = simKonfig.trace;
+  if (tr.empty()) return titikSintetis(s);
+  if (s <= tr.front().detik) return tr.front();
+  if (s >= tr.back().detik) return tr.back();
+
+  size_t lo = 0, hi = tr.size() - 1;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (tr[mid].detik <= s) lo = mid; else hi = mid;
+  }
+  const TitikTrace& a = tr[lo];
+  const TitikTrace& b = tr[hi];
+  float f = (float)((s - a.detik) / (b.detik - a.detik));
+  TitikTrace t;
+  t.detik = s;
+  t.phVolt = a.phVolt + f * (b.phVolt - a.phVolt);
+  t.tdsVolt = a.tdsVolt + f * (b.tdsVolt - a.tdsVolt);
+  t.turbVolt = a.turbVolt + f * (b.turbVolt - a.turbVolt);
+  t.jarakCm = a.jarakCm;   // jarak <= 0 (timeout) tidak diinterpolasi
+  return t;
+}
+
+// --------------------------------------------------------------
+// GPIO + ULTRASONIC
+// --------------------------------------------------------------
+#define SIM_NUM_PINS 40
+
+static uint8_t pinLevel[SIM_NUM_PINS];
+static void (*pinIsr[SIM_NUM_PINS])(void);
+static int pinTrigger = -1;
+static int pinEcho = -1;
+static uint64_t jumlahTrigger = 0;
+static uint64_t triggerTerakhirUs = 0;
+
+static std::vector<TransisiPin> transisiPin[SIM_NUM_PINS];
+
+uint64_t simJumlahTrigger() { return jumlahTrigger; }
+
+const std::vector<TransisiPin>& simTransisiPin(uint8_t pin) {
+  static const std::vector<TransisiPin> kosong;
+  return pin < SIM_NUM_PINS ? transisiPin[pin] : kosong;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  // TRIG = output pertama, ECHO = input digital pertama (HC-SR04)
+  if (mode == OUTPUT && pinTrigger < 0) pinTrigger = pin;
+  if (mode == INPUT && pinEcho < 0) pinEcho = pin;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= SIM_NUM_PINS) return;
+  bool turun = pinLevel[pin] == HIGH && val == LOW;
+  if (pin != pinTrigger && pinLevel[pin] != val) transisiPin[pin].push_back(TransisiPin{ nowUs, val });
+  pinLevel[pin] = val;
+  if (pin != pinTrigger || !turun) return;
+
+  // Ping dalam satu burst (jeda < 1 s) dihitung satu reading
+  if (jumlahTrigger == 0 || nowUs - triggerTerakhirUs > 1000000) jumlahTrigger++;
+  triggerTerakhirUs = nowUs;
+  float jarak = titikTrace(nowUs / 1e6).jarakCm;
+  if (jarak <= 0) return;
+  // Percikan: pantulan palsu lebih dekat dari permukaan air
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  if (u(rng) < simKonfig.probPercikan) jarak *= 0.2f + 0.7f * u(rng);
+  uint64_t naik = nowUs + SIM_ECHO_DELAY_US;
+  events.push(Event{ naik, EVENT_ECHO_NAIK });
+  events.push(Event{ naik + (uint64_t)(jarak * 2 / SIM_CM_PER_US), EVENT_ECHO_TURUN });
+}
+
+int digitalRead(uint8_t pin) { return pin < SIM_NUM_PINS ? pinLevel[pin] : LOW; }
+int digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+  if (pin < SIM_NUM_PINS) pinIsr[pin] = isr;
+}
+
+static void ubahEcho(uint8_t level) {
+  if (pinEcho < 0) return;
+  pinLevel[pinEcho] = level;
+  if (pinIsr[pinEcho]) pinIsr[pinEcho]();
+}
+
+static void prosesEvent(const Event& e) {
+  switch (e.jenis) {
+    case EVENT_ECHO_NAIK:
+      ubahEcho(HIGH);
+      break;
+    case EVENT_ECHO_TURUN:
+      ubahEcho(LOW);
+      break;
+    case EVENT_MQTT_PUBACK:
+      prosesPubackMqtt(e.arg);
+      break;
+    case EVENT_NTP: {
+      epochOffset = SIM_EPOCH_AWAL;
+      waktuValid = true;
+      struct timeval tv = { (time_t)time(nullptr), 0 };
+      if (sntpCallback) sntpCallback(&tv);
+      break;
+    }
+  }
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// --------------------------------------------------------------
+// ADC CONTINUOUS (DMA)
+// --------------------------------------------------------------
+// GPIO -> kanal ADC1 ESP32. Kolom trace: GPIO35 = pH, 34 = TDS, 33 = turbidity.
+struct adc_continuous_ctx_t {
+  uint32_t maxStoreSampel;
+  uint32_t freqHz;
+  std::vector<uint8_t> pola;
+  size_t polaIdx;
+  uint64_t mulaiUs;
+  uint64_t diproduksi;    // total konversi sejak start
+  uint64_t tertunda;      // konversi di pool DMA, belum dibaca
+  adc_continuous_callback_t onOverflow;
+  void* userData;
+  bool jalan;
+};
+
+static const int ADC1_GPIO[8] = { 36, 37, 38, 39, 32, 33, 34, 35 };
+static uint64_t adcOverflow = 0;
+
+uint64_t simAdcOverflow() { return adcOverflow; }
+
+esp_err_t adc_continuous_io_to_channel(int ioNum, adc_unit_t* unit, adc_channel_t* channel) {
+  for (int ch = 0; ch < 8; ch++) {
+    if (ADC1_GPIO[ch] == ioNum) {
+      *unit = ADC_UNIT_1;
+      *channel = (adc_channel_t)ch;
+      return ESP_OK;
+    }
+  }
+  return ESP_FAIL;
+}
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t* cfg, adc_continuous_handle_t* out) {
+  adc_continuous_ctx_t* h = new adc_continuous_ctx_t();
+  h->maxStoreSampel = cfg->max_store_buf_size / SOC_ADC_DIGI_RESULT_BYTES;
+  *out = h;
+  return ESP_OK;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t h, const adc_continuous_config_t* cfg) {
+  h->freqHz = cfg->sample_freq_hz;
+  h->pola.clear();
+  for (uint32_t i = 0; i < cfg->pattern_num; i++) h->pola.push_back(cfg->adc_pattern[i].channel);
+  return ESP_OK;
+}
+
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t h,
+                                                  const adc_continuous_evt_cbs_t* cbs, void* userData) {
+  h->onOverflow = cbs->on_pool_ovf;
+  h->userData = userData;
+  return ESP_OK;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t h) {
+  h->mulaiUs = nowUs;
+  h->jalan = true;
+  return ESP_OK;
+}
+
+static uint16_t kodeAdc(const TitikTrace& t, uint8_t kanal) {
+  float volt = 0;
+  switch (ADC1_GPIO[kanal & 7]) {
+    case 35: volt = t.phVolt; break;
+    case 34: volt = t.tdsVolt; break;
+    case 33: volt = t.turbVolt; break;
+  }
+  std::normal_distribution<float> noise(0.0f, simKonfig.noiseAdc);
+  float kode = volt / 3.3f * 4095.0f + noise(rng);
+  if (kode < 0) kode = 0;
+  if (kode > 4095) kode = 4095;
+  return (uint16_t)kode;
+}
+
+esp_err_t adc_continuous_read(adc_continuous_handle_t h, uint8_t* buf, uint32_t maxLen,
+                              uint32_t* outLen, uint32_t timeoutMs) {
+  *outLen = 0;
+  if (!h->jalan || h->pola.empty()) return ESP_ERR_TIMEOUT;
+
+  uint64_t seharusnya = (nowUs - h->mulaiUs) * h->freqHz / 1000000;
+  h->tertunda += seharusnya - h->diproduksi;
+  h->diproduksi = seharusnya;
+  if (h->tertunda > h->maxStoreSampel) {
+    // Pool DMA penuh: konversi lama dibuang seperti di hardware
+    h->tertunda = h->maxStoreSampel;
+    adcOverflow++;
+    if (h->onOverflow) h->onOverflow(h, nullptr, h->userData);
+  }
+  if (h->tertunda == 0) return ESP_ERR_TIMEOUT;
+
+  TitikTrace t = titikTrace(nowUs / 1e6);
+  uint32_t n = maxLen / SOC_ADC_DIGI_RESULT_BYTES;
+  if (n > h->tertunda) n = (uint32_t)h->tertunda;
+  for (uint32_t i = 0; i < n; i++) {
+    uint8_t kanal = h->pola[h->polaIdx];
+    h->polaIdx = (h->polaIdx + 1) % h->pola.size();
+    adc_digi_output_data_t d;
+    d.type1.channel = kanal;
+    d.type1.data = kodeAdc(t, kanal);
+    memcpy(buf + i * SOC_ADC_DIGI_RESULT_BYTES, &d, SOC_ADC_DIGI_RESULT_BYTES);
+  }
+  h->tertunda -= n;
+  *outLen = n * SOC_ADC_DIGI_RESULT_BYTES;
+  return ESP_OK;
+}
+
+// --------------------------------------------------------------
+// SERIAL / ESP
+// --------------------------------------------------------------
+static std::string serialMasuk;
+static size_t serialPos = 0;
+static bool serialTampil = false;
+
+void simKirimSerial(const std::string& baris) {
+  serialMasuk.erase(0, serialPos);
+  serialPos = 0;
+  serialMasuk += baris;
+  serialMasuk += '\n';
+}
+
+void simTampilkanSerial(bool tampil) { serialTampil = tampil; }
+
+size_t HardwareSerial::printf(const char* fmt, ...) {
+  char buf[512];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (simKonfig.verbose || serialTampil) fputs(buf, stdout);
+  return n > 0 ? (size_t)n : 0;
+}
+
+size_t HardwareSerial::print(const char* s) { return printf("%s", s); }
+size_t HardwareSerial::print(int v) { return printf("%d", v); }
+size_t HardwareSerial::print(unsigned long v) { return printf("%lu", v); }
+size_t HardwareSerial::print(double v, int digits) { return printf("%.*f", digits, v); }
+size_t HardwareSerial::println() { return printf("\n"); }
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+  if (simKonfig.verbose || serialTampil) fwrite(buf, 1, n, stdout);
+  return n;
+}
+int HardwareSerial::available() { return (int)(serialMasuk.size() - serialPos); }
+int HardwareSerial::read() { return serialPos < serialMasuk.size() ? (uint8_t)serialMasuk[serialPos++] : -1; }
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", a_, b_, c_, d_);
+  return String(buf);
+}
+
+uint32_t EspClass::getFreeHeap() { return (uint32_t)(SIM_HEAP_TOTAL - (heapHidup - heapAwal)); }
+uint32_t EspClass::getMinFreeHeap() { return (uint32_t)(SIM_HEAP_TOTAL - (heapHidupMaks - heapAwal)); }
+
+void EspClass::restart() {
+  fprintf(stderr, "sim: ESP.restart() pada %.3f s virtual\n", nowUs / 1e6);
+  exit(3);
+}
+
+// --------------------------------------------------------------
+// WIFI
+// --------------------------------------------------------------
+static bool wifiTerhubung = false;
+static bool wifiMenunggu = false;
+static uint64_t wifiSiapUs = 0;
+static uint8_t simBssid[6] = { 0x02, 0x54, 0x51, 0x00, 0x00, 0x01 };
+static const int32_t SIM_CHANNEL = 6;
+
+// Socket TLS fbdo ke Firestore: ditutup server setelah idle
+// (idleServerMs), ikut mati saat WiFi putus, dan hilang saat soft reset
+// (simTutupSocketTls). Tanpa cache sesi di klien, setiap socket baru =
+// handshake penuh.
+static bool tlsTerhubung = false;
+static uint64_t tlsTerakhirUs = 0;
+
+static bool tlsHidup() {
+  if (tlsTerhubung && nowUs - tlsTerakhirUs >= (uint64_t)(simKonfig.idleServerMs * 1000)) tlsTerhubung = false;
+  return tlsTerhubung;
+}
+
+void simTutupSocketTls() { tlsTerhubung = false; }
+
+static bool sedangPutus() {
+  double s = nowUs / 1e6;
+  for (const JendelaPutus& p : simKonfig.putus) {
+    if (s >= p.mulaiDetik && s < p.mulaiDetik + p.durasiDetik) return true;
+  }
+  return false;
+}
+
+static void jadwalkanWiFi(double ms) {
+  wifiMenunggu = true;
+  wifiSiapUs = nowUs + (uint64_t)(ms * 1000);
+}
+
+void WiFiClass::begin(const char* ssid, const char* pass, int32_t channel,
+                      const uint8_t* bssid, bool connect) {
+  bool cocok = bssid && channel == SIM_CHANNEL && memcmp(bssid, simBssid, 6) == 0;
+  jadwalkanWiFi(cocok ? simKonfig.wifiConnectCacheMs : simKonfig.wifiConnectMs);
+}
+
+void WiFiClass::reconnect() {
+  if (!wifiTerhubung && !wifiMenunggu) jadwalkanWiFi(simKonfig.wifiConnectCacheMs);
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+  wifiTerhubung = false;
+  tlsTerhubung = false;
+  wifiMenunggu = false;
+  return true;
+}
+
+int WiFiClass::status() {
+  if (sedangPutus()) {
+    wifiTerhubung = false;
+    tlsTerhubung = false;
+    wifiMenunggu = false;
+  } else if (wifiMenunggu && nowUs >= wifiSiapUs) {
+    wifiMenunggu = false;
+    wifiTerhubung = true;
+  }
+  return wifiTerhubung ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+String WiFiClass::SSID() { return String("sim-ap"); }
+IPAddress WiFiClass::localIP() { return IPAddress(192, 168, 1, 50); }
+IPAddress WiFiClass::gatewayIP() { return IPAddress(192, 168, 1, 1); }
+IPAddress WiFiClass::dnsIP() { return IPAddress(192, 168, 1, 1); }
+int8_t WiFiClass::RSSI() { return -62; }
+uint8_t* WiFiClass::BSSID() { return wifiTerhubung ? simBssid : nullptr; }
+int32_t WiFiClass::channel() { return SIM_CHANNEL; }
+
+// --------------------------------------------------------------
+// FIREBASE (model latensi/kegagalan)
+// --------------------------------------------------------------
+static bool sudahLogin = false;
+static int httpCodeTerakhir = 0;
+static const char* errorTerakhir = "";
+static FirebaseConfig* simConfig = nullptr;
+
+void tokenStatusCallback(TokenInfo info) {
+  if (info.status == token_status_ready) Serial.printf("Token info: type = id token, status = ready\n");
+}
+
+void FirebaseClass::begin(FirebaseConfig* config, FirebaseAuth* auth) { simConfig = config; }
+
+static void tokenSiap(FirebaseConfig* config, size_t expire) {
+  sudahLogin = true;
+  config->signer.tokens.id_token = "sim-id-token";
+  config->signer.tokens.refresh_token = "sim-refresh-token";
+  config->signer.tokens.expires = (unsigned long)time(nullptr) + expire;
+  if (config->token_status_callback) {
+    TokenInfo info;
+    info.type = 0;
+    info.status = token_status_ready;
+    config->token_status_callback(info);
+  }
+}
+
+bool FirebaseClass::signUp(FirebaseConfig* config, FirebaseAuth* auth, const char* email, const char* password) {
+  if (WiFi.status() != WL_CONNECTED) {
+    config->signer.signupError.message = "WiFi tidak terhubung";
+    return false;
+  }
+  simMaju((uint64_t)(simKonfig.signInMs * 1000));
+  tokenSiap(config, 3600);
+  return true;
+}
+
+void FirebaseClass::setIdToken(FirebaseConfig* config, const char* idToken, size_t expire, const char* refreshToken) {
+  sudahLogin = true;
+  config->signer.tokens.id_token = idToken;
+  config->signer.tokens.refresh_token = refreshToken;
+  config->signer.tokens.expires = (unsigned long)time(nullptr) + expire;
+}
+
+bool FirebaseClass::ready() { return sudahLogin && WiFi.status() == WL_CONNECTED; }
+
+bool FirebaseData::httpConnected() { return WiFi.status() == WL_CONNECTED && tlsHidup(); }
+int FirebaseData::httpCode() { return httpCodeTerakhir; }
+String FirebaseData::errorReason() { return String(errorTerakhir); }
+
+// Satu request HTTPS: handshake jika koneksi belum ada, lalu latensi +- jitter
+static bool simRequest() {
+  if (WiFi.status() != WL_CONNECTED) {
+    tlsTerhubung = false;
+    httpCodeTerakhir = -4;
+    errorTerakhir = "not connected";
+    return false;
+  }
+
+  double ms = 0;
+  if (!tlsHidup()) {
+    ms += simKonfig.handshakeMs;
+    simJaringan.handshake++;
+  } else {
+    simJaringan.requestReuse++;
+  }
+  std::uniform_real_distribution<double> jitter(-simKonfig.jitterMs, simKonfig.jitterMs);
+  ms += simKonfig.requestMs + jitter(rng);
+  if (ms < 1) ms = 1;
+  simJaringan.virtualMsBlokir += ms;
+  simMaju((uint64_t)(ms * 1000));
+
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  if (sedangPutus() || u(rng) < simKonfig.probGagal) {
+    tlsTerhubung = false;
+    simJaringan.gagal++;
+    httpCodeTerakhir = -3;
+    errorTerakhir = "response read timed out";
+    return false;
+  }
+  tlsTerhubung = true;
+  tlsTerakhirUs = nowUs;
+  httpCodeTerakhir = 200;
+  errorTerakhir = "";
+  return true;
+}
+
+// Model byte HTTP/1.1 request patchDocument (format Firebase-ESP-Client):
+// updateMask sebagai query string, ID token ~950 byte di Authorization.
+// Respons: perkiraan header Google (~450) + dokumen lengkap yang
+// dikembalikan Firestore (~550).
+#define SIM_ID_TOKEN_BYTES 950
+#define SIM_REST_RESPONS_BYTES 1000
+
+static uint64_t bytesRequestRest(const char* documentPath, const char* content, const char* updateMask) {
+  // "PATCH /v1/projects/<id>/databases/(default)/documents/<path>?updateMask.fieldPaths=a&... HTTP/1.1"
+  uint64_t n = strlen("PATCH /v1/projects/YOUR_FIREBASE_PROJECT_ID/databases/(default)/documents/") +
+               strlen(documentPath) + strlen(" HTTP/1.1\r\n");
+  const char* f = updateMask;
+  while (*f) {
+    const char* koma = strchr(f, ',');
+    size_t len = koma ? (size_t)(koma - f) : strlen(f);
+    n += 1 + strlen("updateMask.fieldPaths=") + len;   // '?' atau '&'
+    f += len + (koma ? 1 : 0);
+  }
+  char header[192];
+  n += snprintf(header, sizeof(header),
+                "Host: firestore.googleapis.com\r\nConnection: keep-alive\r\n"
+                "Content-Type: application/json\r\nContent-Length: %zu\r\nAuthorization: Bearer \r\n\r\n",
+                strlen(content));
+  return n + SIM_ID_TOKEN_BYTES + strlen(content);
+}
+
+static bool nilaiField(const char* body, const char* nama, double& out) {
+  char kunci[48];
+  snprintf(kunci, sizeof(kunci), "\"%s\":{\"doubleValue\":", nama);
+  const char* p = strstr(body, kunci);
+  if (!p) return false;
+  out = atof(p + strlen(kunci));
+  return true;
+}
+
+// Band kritis FuzzyMamdaniService.php: kejadian terdeteksi saat dashboard
+// pertama kali menerima nilai kritis. Nilai terukur bisa masuk band sebelum
+// awal kejadian nominal (galat kalibrasi/ADC), jadi upload sejak
+// SIM_KEJADIAN_JENDELA_S sebelumnya ikut dihitung (latensi negatif).
+#define SIM_KEJADIAN_JENDELA_S 600
+
+static void catatDeteksi(const char* body) {
+  double v;
+  bool kritis = (nilaiField(body, "pHValue", v) && (v < 6.5 || v > 9.0)) ||
+                (nilaiField(body, "TDSValue", v) && (v < 350 || v > 800)) ||
+                (nilaiField(body, "turbidityValue", v) && v > 45);
+  if (!kritis) return;
+  for (Kejadian& k : simKonfig.kejadian) {
+    if (k.deteksiDetik < 0 && nowUs >= (k.detik - SIM_KEJADIAN_JENDELA_S) * 1e6) k.deteksiDetik = nowUs / 1e6;
+  }
+}
+
+static bool integerField(const char* body, const char* nama, uint64_t& out) {
+  char kunci[48];
+  snprintf(kunci, sizeof(kunci), "\"%s\":{\"integerValue\":\"", nama);
+  const char* p = strstr(body, kunci);
+  if (!p) return false;
+  out = strtoull(p + strlen(kunci), nullptr, 10);
+  return true;
+}
+
+// "YYYY-MM-DDTHH:MM:SS.mmmZ" -> epoch ms
+static bool timestampMsField(const char* body, const char* nama, uint64_t& out) {
+  char kunci[48];
+  snprintf(kunci, sizeof(kunci), "\"%s\":{\"timestampValue\":\"", nama);
+  const char* p = strstr(body, kunci);
+  if (!p) return false;
+  struct tm t = {};
+  unsigned ms = 0;
+  if (sscanf(p + strlen(kunci), "%d-%d-%dT%d:%d:%d.%uZ", &t.tm_year, &t.tm_mon, &t.tm_mday,
+             &t.tm_hour, &t.tm_min, &t.tm_sec, &ms) != 7) return false;
+  t.tm_year -= 1900;
+  t.tm_mon -= 1;
+  out = (uint64_t)timegm(&t) * 1000 + ms;
+  return true;
+}
+
+// Sisi "server": seq per bootId harus naik ketat; gap = reading yang tidak
+// sampai, latensi capture -> diterima diukur dengan jam virtual
+static void catatSeqTrace(uint64_t boot, uint64_t seq) {
+  simJaringan.traceDiterima++;
+  if (boot != simJaringan.traceBootId) {
+    simJaringan.traceBootId = (uint32_t)boot;
+    simJaringan.traceSeqTerakhir = 0;
+  }
+  if (seq <= simJaringan.traceSeqTerakhir) {
+    simJaringan.traceDuplikat++;
+  } else {
+    simJaringan.traceHilang += seq - simJaringan.traceSeqTerakhir - 1;
+    simJaringan.traceSeqTerakhir = (uint32_t)seq;
+  }
+}
+
+static void catatTrace(const char* body, bool ok) {
+  uint64_t seq, boot, captured;
+  if (!integerField(body, "seq", seq) || !integerField(body, "bootId", boot)) {
+    simJaringan.traceTanpaSeq++;
+    return;
+  }
+  if (!ok) {
+    simJaringan.traceGagal++;
+    return;
+  }
+  catatSeqTrace(boot, seq);
+  if (waktuValid && timestampMsField(body, "capturedAt", captured)) {
+    uint64_t epochUs = (uint64_t)(epochOffset * 1000000 + (int64_t)nowUs);
+    simJaringan.traceE2eUs.push_back(epochUs - captured * 1000);
+  }
+}
+
+bool FB_Firestore::patchDocument(FirebaseData* fbdo, const char* projectId, const char* databaseId,
+                                 const char* documentPath, const char* content, const char* updateMask) {
+  simJaringan.patch++;
+  simJaringan.bytesPath += strlen(documentPath);
+  simJaringan.bytesBody += strlen(content);
+  simJaringan.bytesMask += strlen(updateMask);
+  bool live = !strcmp(documentPath, "sensorRead/dataSensor");
+  if (live) {
+    catatDeteksi(content);
+    simJaringan.restLive++;
+    simJaringan.restBytesKeluar += bytesRequestRest(documentPath, content, updateMask);
+    simJaringan.restBytesMasuk += SIM_REST_RESPONS_BYTES;
+  }
+  bool ok = simRequest();
+  if (live) catatTrace(content, ok);
+  if (ok && simJaringan.uploadPertamaMs < 0) simJaringan.uploadPertamaMs = nowUs / 1000.0;
+  return ok;
+}
+
+// Gateway: seq tiap dokumen sensorRead/kolam-<id> harus naik per bootId leaf
+static void catatKolam(const std::vector<struct firebase_firestore_document_write_t>& writes) {
+  bool adaKolam = false;
+  for (const firebase_firestore_document_write_t& w : writes) {
+    unsigned kolam;
+    uint64_t seq, boot;
+    if (sscanf(w.update_document_path.c_str(), "sensorRead/kolam-%u", &kolam) != 1) continue;
+    adaKolam = true;
+    simJaringan.kolamDokumen++;
+    const char* body = w.update_document_content.c_str();
+    if (!integerField(body, "seq", seq) || !integerField(body, "bootId", boot)) {
+      simJaringan.kolamMundur++;
+      continue;
+    }
+    auto it = simJaringan.kolamSeq.find(kolam);
+    if (it != simJaringan.kolamSeq.end() && it->second.first == boot && seq <= it->second.second) {
+      simJaringan.kolamMundur++;
+    }
+    simJaringan.kolamSeq[kolam] = std::make_pair((uint32_t)boot, (uint32_t)seq);
+  }
+  if (adaKolam) simJaringan.kolamCommit++;
+}
+
+static void catatAktuator(const std::vector<struct firebase_firestore_document_write_t>& writes) {
+  bool adaAktuator = false;
+  for (const firebase_firestore_document_write_t& w : writes) {
+    char nama[32];
+    if (sscanf(w.update_document_path.c_str(), "actuatorState/%31s", nama) != 1) continue;
+    adaAktuator = true;
+    simJaringan.aktuatorDokumen++;
+    const char* body = w.update_document_content.c_str();
+    const char* kunci = "\"status\":{\"stringValue\":\"";
+    const char* p = strstr(body, kunci);
+    std::string status = p ? std::string(p + strlen(kunci), strcspn(p + strlen(kunci), "\"")) : "";
+    uint64_t ubah = 0;
+    integerField(body, "switchCount", ubah);
+    simJaringan.aktuatorServer[nama] = std::make_pair(status, (uint32_t)ubah);
+  }
+  if (adaAktuator) simJaringan.aktuatorCommit++;
+}
+
+bool FB_Firestore::commitDocument(FirebaseData* fbdo, const char* projectId, const char* databaseId,
+                                  std::vector<struct firebase_firestore_document_write_t> writes,
+                                  const char* transaction) {
+  simJaringan.commit++;
+  simJaringan.dokumenCommit += writes.size();
+  for (const firebase_firestore_document_write_t& w : writes) {
+    simJaringan.bytesPath += w.update_document_path.size();
+    simJaringan.bytesBody += w.update_document_content.size();
+  }
+  bool ok = simRequest();
+  if (ok) {
+    catatKolam(writes);
+    catatAktuator(writes);
+    for (const firebase_firestore_document_write_t& w : writes) {
+      if (!w.update_document_path.compare(0, 14, "sensorHistory/")) simJaringan.riwayatServer[w.update_document_path]++;
+    }
+  }
+  return ok;
+}
+
+// --------------------------------------------------------------
+// ESP-NOW
+// --------------------------------------------------------------
+// Leaf: esp_now_send mendekode frame dengan codec kedua di bawah (bukan
+// milik firmware) lalu langsung memanggil callback kirim; frame hilang
+// selama --putus (gateway tidak terjangkau) dan dengan peluang --gagal.
+// Gateway: frame dari leaf virtual driver masuk lewat simTerimaEspNow.
+// --------------------------------------------------------------
+uint16_t crc16(const uint8_t* data, size_t len);   // kodeesp32.cpp
+
+#define SIM_FRAME_LEAF_SIZE 26
+#define SIM_FRAME_LEAF_VERSI 1
+
+static const uint8_t SIM_MAC_STA[6] = { 0x24, 0x6F, 0x28, 0x51, 0x00, 0x01 };
+static esp_now_recv_cb_t cbTerimaEspNow = nullptr;
+static esp_now_send_cb_t cbKirimEspNow = nullptr;
+
+static void tulisLe(uint8_t* p, uint32_t v, int n) {
+  for (int i = 0; i < n; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t bacaLe(const uint8_t* p, int n) {
+  uint32_t v = 0;
+  for (int i = 0; i < n; i++) v |= (uint32_t)p[i] << (8 * i);
+  return v;
+}
+
+static uint16_t kuantisasiSim(float v, float skala) {
+  float q = v * skala + 0.5f;
+  return q < 0 ? 0 : q > 65535.0f ? 65535 : (uint16_t)q;
+}
+
+size_t simTulisFrameLeaf(uint32_t nodeId, uint16_t kolam, uint16_t bootId, uint32_t seq,
+                         const float nilai[4], uint16_t umurMs, bool ulang, uint8_t* buf, size_t cap) {
+  if (cap < SIM_FRAME_LEAF_SIZE) return 0;
+  static const float SKALA[4] = { 100.0f, 10.0f, 10.0f, 10.0f };
+  buf[0] = SIM_FRAME_LEAF_VERSI;
+  buf[1] = ulang ? 0x01 : 0x00;
+  tulisLe(buf + 2, kolam, 2);
+  tulisLe(buf + 4, nodeId, 4);
+  tulisLe(buf + 8, bootId, 2);
+  tulisLe(buf + 10, seq, 4);
+  for (int i = 0; i < 4; i++) tulisLe(buf + 14 + 2 * i, kuantisasiSim(nilai[i], SKALA[i]), 2);
+  tulisLe(buf + 22, umurMs, 2);
+  tulisLe(buf + 24, crc16(buf, 24), 2);
+  return SIM_FRAME_LEAF_SIZE;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second) { return ESP_OK; }
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6]) {
+  memcpy(mac, SIM_MAC_STA, 6);
+  return ESP_OK;
+}
+
+esp_err_t esp_now_init() { return ESP_OK; }
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer) { return ESP_OK; }
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  cbTerimaEspNow = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+  cbKirimEspNow = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_send(const uint8_t* peer, const uint8_t* data, size_t len) {
+  if (len > ESP_NOW_MAX_DATA_LEN) return ESP_FAIL;
+  simJaringan.espnowFrame++;
+  simJaringan.espnowBytes += len;
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  bool sampai = !sedangPutus() && u(rng) >= simKonfig.probGagal;
+  if (!sampai) {
+    simJaringan.espnowGagal++;
+  } else if (len != SIM_FRAME_LEAF_SIZE || data[0] != SIM_FRAME_LEAF_VERSI ||
+             bacaLe(data + 24, 2) != crc16(data, 24)) {
+    simJaringan.espnowRusak++;
+  } else {
+    catatSeqTrace(bacaLe(data + 8, 2), bacaLe(data + 10, 4));
+    if (simJaringan.uploadPertamaMs < 0) simJaringan.uploadPertamaMs = nowUs / 1000.0;
+  }
+  if (cbKirimEspNow) cbKirimEspNow(peer, sampai ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+  return ESP_OK;
+}
+
+bool simGatewayEspNow() { return cbTerimaEspNow != nullptr; }
+
+void simTerimaEspNow(const uint8_t mac[6], const uint8_t* data, int len) {
+  uint8_t src[6], dst[6];
+  memcpy(src, mac, 6);
+  memcpy(dst, SIM_MAC_STA, 6);
+  esp_now_recv_info_t info = { src, dst, nullptr };
+  if (cbTerimaEspNow) cbTerimaEspNow(&info, data, len);
+}
+
+// --------------------------------------------------------------
+// NVS (Preferences) DI MEMORI
+// --------------------------------------------------------------
+static std::map<std::string, std::map<std::string, std::vector<uint8_t> > > nvs;
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  ns_ = name;
+  return true;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  const uint8_t* p = (const uint8_t*)value;
+  nvs[ns_][key].assign(p, p + len);
+  return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  auto& tabel = nvs[ns_];
+  auto it = tabel.find(key);
+  if (it == tabel.end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+int32_t Preferences::getInt(const char* key, int32_t def) {
+  int32_t v;
+  return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : def;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t def) {
+  uint32_t v;
+  return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : def;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+  return putBytes(key, value, strlen(value));
+}
+
+String Preferences::getString(const char* key, const String& def) {
+  auto& tabel = nvs[ns_];
+  auto it = tabel.find(key);
+  if (it == tabel.end()) return def;
+  return String(std::string(it->second.begin(), it->second.end()));
+}
+
+// Isi cache fast boot seolah perangkat baru saja restart (watchdog)
+void simSiapkanBootHangat() {
+  Preferences p;
+  p.begin("fastboot", false);
+  p.putBytes("bssid", simBssid, sizeof(simBssid));
+  p.putInt("channel", SIM_CHANNEL);
+  p.putUInt("epoch", (uint32_t)SIM_EPOCH_AWAL);
+  p.putString("idToken", "sim-id-token");
+  p.putString("refresh", "sim-refresh-token");
+  p.putUInt("tokExp", (uint32_t)SIM_EPOCH_AWAL + 3000);
+
+  // Waktu sistem bertahan di RTC saat software reset
+  epochOffset = SIM_EPOCH_AWAL;
+  waktuValid = true;
+}
+
+// --------------------------------------------------------------
+// LITTLEFS DI DIREKTORI HOST
+// --------------------------------------------------------------
+// Path firmware "/jurnal/x.seg" -> <akar>/jurnal/x.seg. Akar = --fs DIR
+// (image bertahan antar-run, seperti flash setelah reboot) atau
+// direktori sementara yang dihapus saat proses selesai. Tulisan langsung
+// ke file (pwrite), tanpa cache: file yang dipotong/dirusak dari luar
+// terlihat apa adanya oleh pembacaan berikutnya.
+// --------------------------------------------------------------
+struct SimFsFd {
+  int fd;
+  explicit SimFsFd(int f) : fd(f) {}
+  ~SimFsFd() { ::close(fd); }
+};
+
+static std::string fsAkar;
+static bool fsSementara = false;
+
+// String path host & snapshot direktori adalah pembukuan stub, bukan
+// heap firmware: jangan ikut dihitung simHitungAlokasi
+struct JedaHitungAlokasi {
+  bool lama;
+  JedaHitungAlokasi() : lama(hitungAlokasi) { hitungAlokasi = false; }
+  ~JedaHitungAlokasi() { hitungAlokasi = lama; }
+};
+
+static int hapusEntriFs(const char* path, const struct stat*, int, struct FTW*) { return ::remove(path); }
+
+static void hapusFsSementara() {
+  if (fsSementara) nftw(fsAkar.c_str(), hapusEntriFs, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static const std::string& akarFs() {
+  if (fsAkar.empty()) {
+    if (!simKonfig.fsDir.empty()) {
+      fsAkar = simKonfig.fsDir;
+      ::mkdir(fsAkar.c_str(), 0755);
+    } else {
+      char templat[] = "/tmp/tambaq-fs-XXXXXX";
+      if (!mkdtemp(templat)) {
+        perror("mkdtemp");
+        exit(1);
+      }
+      fsAkar = templat;
+      fsSementara = true;
+      atexit(hapusFsSementara);
+    }
+  }
+  return fsAkar;
+}
+
+std::string simPathFs(const char* path) { return akarFs() + path; }
+
+static std::string namaDasar(const std::string& path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+size_t File::size() const {
+  struct stat st;
+  if (!fd_ || fstat(fd_->fd, &st) != 0) return 0;
+  return (size_t)st.st_size;
+}
+
+size_t File::read(uint8_t* buf, size_t len) {
+  if (!fd_) return 0;
+  ssize_t n = pread(fd_->fd, buf, len, (off_t)pos_);
+  if (n <= 0) return 0;
+  pos_ += n;
+  return (size_t)n;
+}
+
+size_t File::write(const uint8_t* buf, size_t len) {
+  if (!fd_) return 0;
+  ssize_t n = pwrite(fd_->fd, buf, len, (off_t)pos_);
+  if (n <= 0) return 0;
+  pos_ += n;
+  return (size_t)n;
+}
+
+bool File::seek(size_t pos) {
+  if (!fd_ || pos > size()) return false;
+  pos_ = pos;
+  return true;
+}
+
+// Seperti LittleFS: hanya file biasa, urutan entri tidak dijamin
+// (di sini urut nama agar run sim deterministik)
+File File::openNextFile() {
+  JedaHitungAlokasi jeda;
+  File f;
+  while (dir_ && dirIdx_ < isiDir_.size()) {
+    std::string path = path_ + "/" + isiDir_[dirIdx_++];
+    f = LittleFS.open(path.c_str(), "r");
+    if (f.fd_) return f;
+  }
+  return File();
+}
+
+bool LittleFSFS::begin(bool formatOnFail) {
+  struct stat st;
+  return stat(akarFs().c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool LittleFSFS::mkdir(const char* path) {
+  JedaHitungAlokasi jeda;
+  return ::mkdir(simPathFs(path).c_str(), 0755) == 0;
+}
+
+bool LittleFSFS::remove(const char* path) {
+  JedaHitungAlokasi jeda;
+  return unlink(simPathFs(path).c_str()) == 0;
+}
+
+bool LittleFSFS::exists(const char* path) {
+  JedaHitungAlokasi jeda;
+  struct stat st;
+  return stat(simPathFs(path).c_str(), &st) == 0;
+}
+
+File LittleFSFS::open(const char* path, const char* mode) {
+  JedaHitungAlokasi jeda;
+  File f;
+  f.path_ = path;
+  f.name_ = namaDasar(path);
+  std::string host = simPathFs(path);
+
+  struct stat st;
+  if (stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    DIR* d = opendir(host.c_str());
+    if (!d) return File();
+    while (struct dirent* e = readdir(d)) {
+      if (e->d_name[0] != '.') f.isiDir_.push_back(e->d_name);
+    }
+    closedir(d);
+    std::sort(f.isiDir_.begin(), f.isiDir_.end());
+    f.dir_ = true;
+    return f;
+  }
+
+  int flag = mode[0] == 'r' ? O_RDONLY : O_RDWR | O_CREAT | (mode[0] == 'w' ? O_TRUNC : 0);
+  int fd = ::open(host.c_str(), flag, 0644);
+  if (fd < 0) return File();
+  f.fd_ = std::make_shared<SimFsFd>(fd);
+  f.pos_ = mode[0] == 'a' ? f.size() : 0;
+  return f;
+}
+
+// --------------------------------------------------------------
+// MBEDTLS (SHA-1 + base64 untuk handshake WebSocket)
+// --------------------------------------------------------------
+static uint32_t rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+int mbedtls_sha1(const unsigned char* input, size_t ilen, unsigned char output[20]) {
+  uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+  std::vector<uint8_t> msg(input, input + ilen);
+  uint64_t bits = (uint64_t)ilen * 8;
+  msg.push_back(0x80);
+  while (msg.size() % 64 != 56) msg.push_back(0);
+  for (int i = 7; i >= 0; i--) msg.push_back((uint8_t)(bits >> (i * 8)));
+
+  for (size_t off = 0; off < msg.size(); off += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      const uint8_t* p = &msg[off + i * 4];
+      w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+    for (int i = 16; i < 80; i++) w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+      else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+      else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+      else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+      uint32_t t = rotl(a, 5) + f + e + k + w[i];
+      e = d; d = c; c = rotl(b, 30); b = a; a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+  }
+  for (int i = 0; i < 5; i++) {
+    output[i * 4] = (uint8_t)(h[i] >> 24);
+    output[i * 4 + 1] = (uint8_t)(h[i] >> 16);
+    output[i * 4 + 2] = (uint8_t)(h[i] >> 8);
+    output[i * 4 + 3] = (uint8_t)h[i];
+  }
+  return 0;
+}
+
+int mbedtls_base64_encode(unsigned char* dst, size_t dlen, size_t* olen,
+                          const unsigned char* src, size_t slen) {
+  static const char ABJAD[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t perlu = (slen + 2) / 3 * 4;
+  *olen = perlu + 1;
+  if (dlen < perlu + 1) return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+  size_t o = 0;
+  for (size_t i = 0; i < slen; i += 3) {
+    uint32_t v = (uint32_t)src[i] << 16;
+    if (i + 1 < slen) v |= (uint32_t)src[i + 1] << 8;
+    if (i + 2 < slen) v |= src[i + 2];
+    dst[o++] = ABJAD[(v >> 18) & 63];
+    dst[o++] = ABJAD[(v >> 12) & 63];
+    dst[o++] = i + 1 < slen ? ABJAD[(v >> 6) & 63] : '=';
+    dst[o++] = i + 2 < slen ? ABJAD[v & 63] : '=';
+  }
+  dst[o] = '\0';
+  *olen = o;
+  return 0;
+}
+
+// --------------------------------------------------------------
+// ESP-MQTT: klien MQTT 3.1.1 ke broker lokal (socket asli)
+// --------------------------------------------------------------
+#define SIM_MQTT_RETRY_US 10000000ULL   // reconnect_timeout_ms esp-mqtt
+
+#define SIM_MQTT_OUTBOX 8                // outbox_limit (pesan QoS 1 belum di-ack)
+#define SIM_MQTT_PAKET 160
+
+struct PesanOutbox {
+  int msgId;                             // 0 = kosong
+  size_t len;
+  uint8_t paket[SIM_MQTT_PAKET];
+};
+
+struct esp_mqtt_client {
+  char uri[96], clientId[64], username[64], password[64];
+  bool cleanSession;
+  int keepalive;
+  esp_event_handler_t handler;
+  void* handlerArg;
+  int fd;
+  bool terhubung;
+  bool pernahCoba;
+  uint64_t cobaTerakhirUs;
+  uint16_t nextId;
+  PesanOutbox outbox[SIM_MQTT_OUTBOX];
+};
+
+static esp_mqtt_client* klienMqtt = nullptr;
+
+esp_err_t esp_crt_bundle_attach(void* conf) { return ESP_OK; }
+
+static void salinString(char* dst, size_t cap, const char* src) {
+  snprintf(dst, cap, "%s", src ? src : "");
+}
+
+static void kirimEventMqtt(esp_mqtt_client* c, esp_mqtt_event_id_t id, int msgId, int sesi) {
+  if (!c->handler) return;
+  esp_mqtt_event_t e = {};
+  e.event_id = id;
+  e.client = c;
+  e.msg_id = msgId;
+  e.session_present = sesi;
+  c->handler(c->handlerArg, "MQTT_EVENTS", id, &e);
+}
+
+static size_t tulisPanjangMqtt(uint8_t* out, size_t n) {
+  size_t i = 0;
+  do {
+    uint8_t b = n % 128;
+    n /= 128;
+    if (n) b |= 0x80;
+    out[i++] = b;
+  } while (n);
+  return i;
+}
+
+static size_t tulisStringMqtt(uint8_t* out, const char* s) {
+  size_t n = strlen(s);
+  out[0] = (uint8_t)(n >> 8);
+  out[1] = (uint8_t)n;
+  memcpy(out + 2, s, n);
+  return 2 + n;
+}
+
+static bool kirimSemua(esp_mqtt_client* c, const uint8_t* pkt, size_t len) {
+  size_t off = 0;
+  while (off < len) {
+    ssize_t r = send(c->fd, pkt + off, len - off, MSG_NOSIGNAL);
+    if (r <= 0) return false;
+    off += r;
+  }
+  simJaringan.mqttBytesKeluar += len;
+  return true;
+}
+
+// Baca satu paket kontrol (CONNACK/PUBACK muat di buffer kecil); false jika timeout/putus
+static bool bacaPaketMqtt(esp_mqtt_client* c, uint8_t& tipe, uint8_t* isi, size_t cap, size_t& len) {
+  uint8_t b;
+  if (recv(c->fd, &b, 1, MSG_WAITALL) != 1) return false;
+  tipe = b;
+  size_t n = 0, kali = 1, hdr = 1;
+  do {
+    if (recv(c->fd, &b, 1, MSG_WAITALL) != 1) return false;
+    n += (b & 127) * kali;
+    kali *= 128;
+    hdr++;
+  } while (b & 0x80);
+  if (n > cap) return false;
+  if (n && recv(c->fd, isi, n, MSG_WAITALL) != (ssize_t)n) return false;
+  len = n;
+  simJaringan.mqttBytesMasuk += hdr + n;
+  return true;
+}
+
+static void putusMqtt(esp_mqtt_client* c) {
+  if (c->fd >= 0) close(c->fd);
+  c->fd = -1;
+  if (c->terhubung) {
+    c->terhubung = false;
+    kirimEventMqtt(c, MQTT_EVENT_DISCONNECTED, 0, 0);
+  }
+}
+
+// Kirim PUBLISH lalu tunggu PUBACK (jam dinding). Event PUBLISHED dijadwalkan
+// di jam virtual setelah RTT yang sama, seperti task esp-mqtt yang asinkron.
+static bool publishDanTunggu(esp_mqtt_client* c, PesanOutbox& m) {
+  uint64_t t0 = nsHost();
+  simJaringan.mqttPublish++;
+  if (!kirimSemua(c, m.paket, m.len)) return false;
+  for (;;) {
+    uint8_t tipe, isi[8];
+    size_t len;
+    if (!bacaPaketMqtt(c, tipe, isi, sizeof(isi), len)) return false;
+    if ((tipe >> 4) == 4 && len >= 2 && ((isi[0] << 8) | isi[1]) == m.msgId) break;
+  }
+  uint64_t rtt = nsHost() - t0;
+  simJaringan.mqttRttNs.push_back(rtt);
+  simJaringan.mqttAck++;
+  events.push(Event{ nowUs + rtt / 1000 + 1, EVENT_MQTT_PUBACK, m.msgId });
+  m.msgId = 0;
+  return true;
+}
+
+static bool hubungkanMqtt(esp_mqtt_client* c) {
+  c->pernahCoba = true;
+  c->cobaTerakhirUs = nowUs;
+
+  // mqtt(s)://host:port, atau --mqtt host:port dari driver. TLS tidak disimulasikan.
+  char alamat[96];
+  const char* skema = strstr(c->uri, "://");
+  salinString(alamat, sizeof(alamat), !simKonfig.mqttBroker.empty() ? simKonfig.mqttBroker.c_str()
+                                      : skema ? skema + 3 : c->uri);
+  const char* port = "1883";
+  char* titikDua = strrchr(alamat, ':');
+  if (titikDua) {
+    *titikDua = '\0';
+    port = titikDua + 1;
+  }
+
+  struct addrinfo hints = {};
+  struct addrinfo* res = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(alamat, port, &hints, &res) != 0) return false;
+  c->fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct timeval tv = { 2, 0 };
+  setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  int satu = 1;
+  setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &satu, sizeof(satu));
+  bool ok = connect(c->fd, res->ai_addr, res->ai_addrlen) == 0;
+  freeaddrinfo(res);
+  if (!ok) {
+    putusMqtt(c);
+    return false;
+  }
+
+  uint8_t isi[256];
+  size_t n = tulisStringMqtt(isi, "MQTT");
+  isi[n++] = 4;   // protocol level 3.1.1
+  uint8_t flags = c->cleanSession ? 0x02 : 0;
+  if (c->username[0]) flags |= 0x80;
+  if (c->password[0]) flags |= 0x40;
+  isi[n++] = flags;
+  isi[n++] = (uint8_t)(c->keepalive >> 8);
+  isi[n++] = (uint8_t)c->keepalive;
+  n += tulisStringMqtt(isi + n, c->clientId);
+  if (c->username[0]) n += tulisStringMqtt(isi + n, c->username);
+  if (c->password[0]) n += tulisStringMqtt(isi + n, c->password);
+
+  uint8_t pkt[264];
+  pkt[0] = 0x10;
+  size_t h = 1 + tulisPanjangMqtt(pkt + 1, n);
+  memcpy(pkt + h, isi, n);
+
+  uint8_t tipe, ack[4];
+  size_t len;
+  if (!kirimSemua(c, pkt, h + n) || !bacaPaketMqtt(c, tipe, ack, sizeof(ack), len) ||
+      (tipe >> 4) != 2 || len < 2 || ack[1] != 0) {
+    fprintf(stderr, "sim: MQTT CONNECT ke %s:%s ditolak/gagal\n", alamat, port);
+    putusMqtt(c);
+    return false;
+  }
+  c->terhubung = true;
+  simJaringan.mqttKoneksi++;
+  kirimEventMqtt(c, MQTT_EVENT_CONNECTED, 0, ack[0] & 1);
+
+  // Pesan QoS 1 yang belum di-ack dikirim ulang dengan flag DUP
+  for (PesanOutbox& m : c->outbox) {
+    if (!m.msgId) continue;
+    m.paket[0] |= 0x08;
+    if (!publishDanTunggu(c, m)) {
+      putusMqtt(c);
+      return false;
+    }
+  }
+  return true;
+}
+
+static void prosesPubackMqtt(int msgId) {
+  if (klienMqtt) kirimEventMqtt(klienMqtt, MQTT_EVENT_PUBLISHED, msgId, 0);
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t* cfg) {
+  esp_mqtt_client* c = new esp_mqtt_client();
+  salinString(c->uri, sizeof(c->uri), cfg->broker.address.uri);
+  salinString(c->clientId, sizeof(c->clientId), cfg->credentials.client_id);
+  // Placeholder kredensial tidak dikirim ke broker lokal
+  if (cfg->credentials.username && strncmp(cfg->credentials.username, "YOUR_", 5) != 0) {
+    salinString(c->username, sizeof(c->username), cfg->credentials.username);
+    salinString(c->password, sizeof(c->password), cfg->credentials.authentication.password);
+  }
+  c->cleanSession = !cfg->session.disable_clean_session;
+  c->keepalive = cfg->session.keepalive ? cfg->session.keepalive : 120;
+  c->fd = -1;
+  c->nextId = 1;
+  klienMqtt = c;
+  return c;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t c, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void* arg) {
+  c->handler = handler;
+  c->handlerArg = arg;
+  return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t c) {
+  hubungkanMqtt(c);
+  return ESP_OK;
+}
+
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t c, const char* topic, const char* data,
+                            int len, int qos, int retain, bool store) {
+  if (!c->terhubung && (!c->pernahCoba || nowUs - c->cobaTerakhirUs >= SIM_MQTT_RETRY_US)) hubungkanMqtt(c);
+  if (!c->terhubung && !store) return -1;
+
+  PesanOutbox* m = nullptr;
+  for (PesanOutbox& o : c->outbox) {
+    if (!o.msgId) {
+      m = &o;
+      break;
+    }
+  }
+  size_t panjang = 2 + strlen(topic) + 2 + len;
+  if (!m || panjang + 5 > SIM_MQTT_PAKET) return -1;
+
+  int msgId = c->nextId++;
+  if (c->nextId == 0) c->nextId = 1;
+  m->msgId = msgId;
+  m->paket[0] = 0x32;   // PUBLISH QoS 1
+  size_t n = 1 + tulisPanjangMqtt(m->paket + 1, panjang);
+  n += tulisStringMqtt(m->paket + n, topic);
+  m->paket[n++] = (uint8_t)(msgId >> 8);
+  m->paket[n++] = (uint8_t)msgId;
+  memcpy(m->paket + n, data, len);
+  m->len = n + len;
+  if (c->terhubung && !publishDanTunggu(c, *m)) putusMqtt(c);
+  if (simJaringan.uploadPertamaMs < 0) simJaringan.uploadPertamaMs = nowUs / 1000.0;
+  return msgId;
+}
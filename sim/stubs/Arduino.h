@@ -0,0 +1,113 @@
+// Pengganti Arduino core untuk build simulasi host (lihat sim/README.md).
+// Hanya API yang dipakai kodeesp32.cpp; implementasi di sim/stubs.cpp.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <string>
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define CHANGE 0x03
+#define RISING 0x01
+#define FALLING 0x02
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+uint32_t getCpuFrequencyMhz();
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec,
+                const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  const char* c_str() const { return s_.c_str(); }
+  size_t length() const { return s_.size(); }
+  String operator+(const String& o) const { return String(s_ + o.s_); }
+  friend String operator+(const char* a, const String& b) { return String(std::string(a) + b.s_); }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+
+private:
+  std::string s_;
+};
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : a_(a), b_(b), c_(c), d_(d) {}
+  String toString() const;
+
+private:
+  uint8_t a_, b_, c_, d_;
+};
+
+class HardwareSerial {
+public:
+  void begin(unsigned long baud) {}
+  int available();
+  int read();
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* s);
+  size_t print(const String& s) { return print(s.c_str()); }
+  size_t print(int v);
+  size_t print(unsigned long v);
+  size_t print(double v, int digits = 2);
+  size_t print(const IPAddress& ip) { return print(ip.toString()); }
+  size_t println();
+  size_t write(const uint8_t* buf, size_t n);
+  template<typename T>
+  size_t println(const T& v) { return print(v) + println(); }
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  void restart();
+};
+
+extern EspClass ESP;
+
+// FreeRTOS: task tidak dijalankan; driver simulasi memanggil langkah* langsung
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdPASS 1
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char* name, uint32_t stack,
+                                   void* arg, int prio, TaskHandle_t* handle, int core);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t handle);
+
+// Satu thread: critical section tidak perlu mengunci apa pun
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
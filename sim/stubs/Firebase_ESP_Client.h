@@ -0,0 +1,82 @@
+// Pengganti Firebase_ESP_Client: request Firestore tidak keluar ke jaringan,
+// latensi/kegagalan diatur model jaringan simulasi (sim/stubs.cpp).
+#pragma once
+#include "Arduino.h"
+#include <vector>
+
+enum firebase_firestore_document_write_type {
+  firebase_firestore_document_write_type_undefined,
+  firebase_firestore_document_write_type_update
+};
+
+struct firebase_firestore_document_write_t {
+  firebase_firestore_document_write_type type;
+  std::string update_document_content;
+  std::string update_document_path;
+};
+
+enum token_status {
+  token_status_uninitialized,
+  token_status_on_initialize,
+  token_status_on_signing,
+  token_status_on_request,
+  token_status_on_refresh,
+  token_status_ready,
+  token_status_error
+};
+
+struct TokenInfo {
+  int type;
+  token_status status;
+  struct { String message; } error;
+};
+
+typedef void (*TokenStatusCallback)(TokenInfo);
+
+struct FirebaseConfig {
+  String api_key;
+  TokenStatusCallback token_status_callback;
+  struct {
+    unsigned long serverResponse, socketConnection, sslHandshake;
+    unsigned long rtdbKeepAlive, rtdbStreamReconnect, rtdbStreamError;
+  } timeout;
+  struct {
+    struct { String message; } signupError;
+    struct { std::string id_token, refresh_token; unsigned long expires; } tokens;
+  } signer;
+};
+
+struct FirebaseAuth {
+  struct { String email, password; } user;
+};
+
+class FirebaseData {
+public:
+  void setBSSLBufferSize(int rx, int tx) {}
+  void setResponseSize(int size) {}
+  void keepAlive(int idle, int interval, int count) {}
+  bool httpConnected();
+  int httpCode();
+  String errorReason();
+};
+
+class FB_Firestore {
+public:
+  bool patchDocument(FirebaseData* fbdo, const char* projectId, const char* databaseId,
+                     const char* documentPath, const char* content, const char* updateMask);
+  bool commitDocument(FirebaseData* fbdo, const char* projectId, const char* databaseId,
+                      std::vector<struct firebase_firestore_document_write_t> writes,
+                      const char* transaction);
+};
+
+class FirebaseClass {
+public:
+  FB_Firestore Firestore;
+  void begin(FirebaseConfig* config, FirebaseAuth* auth);
+  void reconnectWiFi(bool reconnect) {}
+  bool signUp(FirebaseConfig* config, FirebaseAuth* auth, const char* email, const char* password);
+  void setIdToken(FirebaseConfig* config, const char* idToken, size_t expire, const char* refreshToken = "");
+  bool ready();
+};
+
+extern FirebaseClass Firebase;
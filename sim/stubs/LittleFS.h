@@ -0,0 +1,43 @@
+// LittleFS di atas direktori host: tiap file firmware = satu file asli
+// (lihat simPathFs di sim.h), jadi isi flash bisa dipotong/dirusak dari
+// luar dan bertahan antar-run dengan --fs DIR
+#pragma once
+#include "Arduino.h"
+#include <memory>
+#include <vector>
+
+struct SimFsFd;
+
+class File {
+public:
+  File() {}
+  explicit operator bool() const { return fd_ != nullptr || dir_; }
+  size_t size() const;
+  size_t read(uint8_t* buf, size_t len);
+  size_t write(const uint8_t* buf, size_t len);
+  bool seek(size_t pos);
+  void close() { fd_.reset(); }
+  const char* name() const { return name_.c_str(); }
+  File openNextFile();
+
+private:
+  friend class LittleFSFS;
+  std::shared_ptr<SimFsFd> fd_;
+  std::string name_;
+  std::string path_;
+  size_t pos_ = 0;
+  bool dir_ = false;
+  std::vector<std::string> isiDir_;   // snapshot entri saat open()
+  size_t dirIdx_ = 0;
+};
+
+class LittleFSFS {
+public:
+  bool begin(bool formatOnFail = false);
+  bool mkdir(const char* path);
+  bool remove(const char* path);
+  bool exists(const char* path);
+  File open(const char* path, const char* mode = "r");
+};
+
+extern LittleFSFS LittleFS;
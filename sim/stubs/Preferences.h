@@ -0,0 +1,20 @@
+// NVS di memori (hilang saat proses selesai; --boot hangat mengisi awal)
+#pragma once
+#include "Arduino.h"
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false);
+  void end() {}
+  size_t putBytes(const char* key, const void* value, size_t len);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t putInt(const char* key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+  int32_t getInt(const char* key, int32_t def = 0);
+  size_t putUInt(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  uint32_t getUInt(const char* key, uint32_t def = 0);
+  size_t putString(const char* key, const char* value);
+  String getString(const char* key, const String& def = String());
+
+private:
+  std::string ns_;
+};
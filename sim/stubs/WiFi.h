@@ -0,0 +1,26 @@
+#pragma once
+#include "Arduino.h"
+
+#define WIFI_STA 1
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class WiFiClass {
+public:
+  void mode(int m) {}
+  void begin(const char* ssid, const char* pass, int32_t channel = 0,
+             const uint8_t* bssid = nullptr, bool connect = true);
+  void reconnect();
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  int status();
+  String SSID();
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress dnsIP();
+  int8_t RSSI();
+  uint8_t* BSSID();
+  int32_t channel();
+};
+
+extern WiFiClass WiFi;
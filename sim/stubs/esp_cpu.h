@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+// Siklus CPU 240 MHz dari jam host (bukan jam virtual): tahap CPU terukur nyata
+uint32_t esp_cpu_get_cycle_count();
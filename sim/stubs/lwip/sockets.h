@@ -0,0 +1,10 @@
+// Build host memakai socket POSIX asli: server LAN bisa dites dengan curl
+#pragma once
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <strings.h>
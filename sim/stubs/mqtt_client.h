@@ -0,0 +1,55 @@
+// esp-mqtt (IDF) versi host: MQTT 3.1.1 asli lewat TCP (tanpa TLS) ke broker
+// lokal, mis. `mosquitto -p 1883`. PUBACK ditunggu sinkron agar RTT terukur.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_timer.h"
+
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void* arg, esp_event_base_t base, int32_t eventId, void* data);
+#define ESP_EVENT_ANY_ID -1
+
+typedef enum {
+  MQTT_EVENT_ANY = -1,
+  MQTT_EVENT_ERROR = 0,
+  MQTT_EVENT_CONNECTED,
+  MQTT_EVENT_DISCONNECTED,
+  MQTT_EVENT_SUBSCRIBED,
+  MQTT_EVENT_UNSUBSCRIBED,
+  MQTT_EVENT_PUBLISHED,
+  MQTT_EVENT_DATA
+} esp_mqtt_event_id_t;
+
+typedef struct esp_mqtt_client* esp_mqtt_client_handle_t;
+
+typedef struct {
+  esp_mqtt_event_id_t event_id;
+  esp_mqtt_client_handle_t client;
+  int msg_id;
+  int session_present;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t* esp_mqtt_event_handle_t;
+
+typedef struct {
+  struct {
+    struct { const char* uri; } address;
+    struct { esp_err_t (*crt_bundle_attach)(void* conf); } verification;
+  } broker;
+  struct {
+    const char* client_id;
+    const char* username;
+    struct { const char* password; } authentication;
+  } credentials;
+  struct {
+    bool disable_clean_session;
+    int keepalive;
+  } session;
+} esp_mqtt_client_config_t;
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t* config);
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void* arg);
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client);
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client, const char* topic, const char* data,
+                            int len, int qos, int retain, bool store);
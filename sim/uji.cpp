@@ -0,0 +1,1122 @@
+// --------------------------------------------------------------
+// UJI KERNEL FIRMWARE: fungsi murni vs acuan independen
+// --------------------------------------------------------------
+// Satu TU dengan firmware (#include kodeesp32.cpp, seperti armada.cpp)
+// agar kernel internal (ring ADC, statistik window, ...) dipanggil
+// apa adanya. Acuan ditulis ulang di sini dengan double dan algoritme
+// paling sederhana, bukan disalin dari firmware. Setiap cek mencetak
+// satu baris; ada yang gagal -> exit code 3.
+// --------------------------------------------------------------
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../kodeesp32.cpp"
+#include "sim.h"
+
+// stubs.cpp mencatat latensi langkah untuk driver sim; tidak dipakai di sini
+void simCatatLatensiSampling(uint64_t) {}
+void simCatatLatensiTimer(uint64_t) {}
+
+static bool cekUji(const char* nama, bool ok, const char* rinci) {
+  printf("  %s %-28s %s\n", ok ? "✓" : "✗", nama, rinci);
+  return ok;
+}
+
+static bool dekat(double a, double b, double tolAbs, double tolRel) {
+  return fabs(a - b) <= tolAbs + tolRel * fabs(b);
+}
+
+// --------------------------------------------------------------
+// RING ADC: window terbaru + cek ulang head setelah menyalin
+// --------------------------------------------------------------
+// Penulis menulis nilai berurutan (h & 0xFFF), jadi window yang sah
+// selalu berurutan. Thread penulis menimpa ring terus-menerus selama
+// pembaca menyalin: window yang dikembalikan adcRingWindow tidak boleh
+// sobek. Salinan tanpa cek ulang dihitung sebagai pembanding (bukti
+// penulis memang menimpa di tengah salinan).
+// --------------------------------------------------------------
+static bool windowBerurutan(const uint16_t* w, int n) {
+  for (int i = 1; i < n; i++) {
+    if (w[i] != ((w[i - 1] + 1) & 0xFFF)) return false;
+  }
+  return true;
+}
+
+static bool ujiAdcRing() {
+  char rinci[128];
+  bool ok = true;
+  static AdcRing ring;
+  uint16_t w[ADC_WINDOW];
+  uint16_t buf0[ADC_RING_SIZE];
+
+  // Deterministik: kurang dari satu window, lalu setelah ring berputar
+  ring.head.store(0);
+  for (int i = 0; i < 10; i++) adcRingPush(ring, (uint16_t)i);
+  int n = adcRingWindow(ring, w, ADC_WINDOW);
+  snprintf(rinci, sizeof(rinci), "n=%d, w[0]=%u, w[9]=%u", n, w[0], w[9]);
+  ok &= cekUji("window parsial", n == 10 && w[0] == 0 && w[9] == 9, rinci);
+
+  for (int i = 10; i < 1000; i++) adcRingPush(ring, (uint16_t)(i & 0xFFF));
+  n = adcRingWindow(ring, w, ADC_WINDOW);
+  snprintf(rinci, sizeof(rinci), "n=%d, %u..%u", n, w[0], w[n - 1]);
+  ok &= cekUji("window setelah berputar", n == ADC_WINDOW && w[0] == 1000 - ADC_WINDOW &&
+                                              w[ADC_WINDOW - 1] == 999 && windowBerurutan(w, n), rinci);
+
+  // Window maksimal: slot head boleh sedang ditulis, jadi ring - 1
+  n = adcRingWindow(ring, buf0, ADC_RING_SIZE);
+  snprintf(rinci, sizeof(rinci), "n=%d (ring %d)", n, ADC_RING_SIZE);
+  ok &= cekUji("window maksimal", n == ADC_RING_SIZE - 1 && windowBerurutan(buf0, n), rinci);
+
+  // Penulis bebas vs pembaca, window normal dan window maksimal (satu
+  // slot sisa: tulisan selama salin langsung membuat percobaan ditolak)
+  const int UKURAN[2] = { ADC_WINDOW, ADC_RING_SIZE - 1 };
+  for (int u = 0; u < 2; u++) {
+    int m = UKURAN[u];
+    uint16_t buf[ADC_RING_SIZE];
+    std::atomic<bool> berhenti(false);
+    ring.head.store(0);
+    for (int i = 0; i < ADC_RING_SIZE; i++) adcRingPush(ring, (uint16_t)i);
+    std::thread penulis([&]() {
+      uint32_t v = ADC_RING_SIZE;
+      while (!berhenti.load(std::memory_order_relaxed)) adcRingPush(ring, (uint16_t)(v++ & 0xFFF));
+    });
+    uint32_t sah = 0, sobek = 0, ditolak = 0, naifSobek = 0;
+    for (uint32_t i = 0; i < 1000000; i++) {
+      n = adcRingWindow(ring, buf, m);
+      if (n == 0) {
+        ditolak++;
+      } else if (n == m && windowBerurutan(buf, n)) {
+        sah++;
+      } else {
+        sobek++;
+      }
+      // Pembanding: salinan yang sama tanpa cek ulang head
+      uint32_t h = ring.head.load(std::memory_order_acquire);
+      for (int k = 0; k < m; k++) buf[k] = ring.buf[(h - m + k) & (ADC_RING_SIZE - 1)];
+      if (!windowBerurutan(buf, m)) naifSobek++;
+    }
+    berhenti.store(true);
+    penulis.join();
+    char nama[40];
+    snprintf(nama, sizeof(nama), "tertimpa saat salin (n=%d)", m);
+    snprintf(rinci, sizeof(rinci), "%u sah, %u ditolak 3x, %u sobek; tanpa cek ulang %u sobek", sah, ditolak,
+             sobek, naifSobek);
+    ok &= cekUji(nama, sobek == 0 && sah > 0, rinci);
+  }
+  return ok;
+}
+
+// --------------------------------------------------------------
+// STATISTIK WINDOW & WELFORD vs acuan double dua-lintasan
+// --------------------------------------------------------------
+struct AcuanStatistik {
+  double mean, trimmedMean, median, stddev;
+};
+
+static AcuanStatistik acuanStatistik(std::vector<uint16_t> d, double trim) {
+  AcuanStatistik a = { 0, 0, 0, 0 };
+  size_t n = d.size();
+  std::sort(d.begin(), d.end());
+  for (uint16_t v : d) a.mean += v;
+  a.mean /= n;
+  double ss = 0;
+  for (uint16_t v : d) ss += (v - a.mean) * (v - a.mean);
+  a.stddev = n > 1 ? sqrt(ss / (n - 1)) : 0;
+  a.median = n % 2 ? d[n / 2] : (d[n / 2 - 1] + d[n / 2]) / 2.0;
+  // Potong floor(n x trim) di tiap sisi, minimal satu sampel tersisa
+  size_t k = (size_t)(n * trim);
+  while (k > 0 && 2 * k >= n) k--;
+  double s = 0;
+  for (size_t i = k; i < n - k; i++) s += d[i];
+  a.trimmedMean = s / (n - 2 * k);
+  return a;
+}
+
+static bool ujiStatistik() {
+  char rinci[160];
+  bool ok = true;
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.0f, 25.0f);
+  std::uniform_int_distribution<int> acak(0, 4095);
+  uint32_t kasus = 0, salah = 0;
+  double galatMaks = 0;
+  for (int iter = 0; iter < 20000; iter++) {
+    int n = 1 + iter % ADC_RING_SIZE;
+    float pusat = (float)acak(rng);
+    std::vector<uint16_t> d(n);
+    for (int i = 0; i < n; i++) {
+      float v = iter % 5 == 0 ? (float)acak(rng)                            // seragam penuh
+                : iter % 5 == 1 ? pusat                                       // semua sama
+                : iter % 5 == 2 ? (i % 7 == 0 ? 4095.0f : pusat + noise(rng))  // pencilan
+                                : pusat + noise(rng);
+      d[i] = (uint16_t)std::min(4095.0f, std::max(0.0f, roundf(v)));
+    }
+    std::vector<uint16_t> salin = d;
+    WindowStats st = hitungStatistik(salin.data(), n, ADC_TRIM_FRACTION);
+    AcuanStatistik a = acuanStatistik(d, ADC_TRIM_FRACTION);
+    bool cocok = st.n == n && dekat(st.mean, a.mean, 1e-2, 1e-5) && dekat(st.stddev, a.stddev, 1e-2, 1e-3) &&
+                 st.median == (float)a.median && dekat(st.trimmedMean, a.trimmedMean, 1e-2, 1e-6) &&
+                 std::is_sorted(salin.begin(), salin.end());
+    galatMaks = std::max(galatMaks, fabs(st.stddev - a.stddev));
+    kasus++;
+    if (!cocok && ++salah <= 3) {
+      printf("    n=%d: mean %.4f/%.4f std %.4f/%.4f median %.1f/%.1f trim %.4f/%.4f\n", n, st.mean, a.mean,
+             st.stddev, a.stddev, st.median, a.median, st.trimmedMean, a.trimmedMean);
+    }
+  }
+  snprintf(rinci, sizeof(rinci), "%u window n=1..%d, %u beda, galat std maks %.2e", kasus, ADC_RING_SIZE, salah,
+           galatMaks);
+  ok &= cekUji("hitungStatistik", salah == 0, rinci);
+
+  // Welford berbobot: deret mirip TDS (offset besar, variasi kecil), bobot detik
+  std::uniform_real_distribution<double> bobot(1.0, 40.0);
+  Welford<float> wf = {};
+  Welford<double> wd = {};
+  std::vector<double> x, w;
+  for (int i = 0; i < 100000; i++) {
+    double v = 500.0 + 5.0 * sin(i * 0.01) + noise(rng) * 0.1;
+    double b = bobot(rng);
+    wf.tambah((float)v, (float)b);
+    wd.tambah(v, b);
+    x.push_back((float)v);
+    w.push_back((float)b);
+  }
+  double sw = 0, sx = 0, minimum = x[0], maksimum = x[0];
+  for (size_t i = 0; i < x.size(); i++) {
+    sw += w[i];
+    sx += w[i] * x[i];
+    minimum = std::min(minimum, x[i]);
+    maksimum = std::max(maksimum, x[i]);
+  }
+  double mean = sx / sw, ss = 0;
+  for (size_t i = 0; i < x.size(); i++) ss += w[i] * (x[i] - mean) * (x[i] - mean);
+  double sd = sqrt(ss / sw);
+  snprintf(rinci, sizeof(rinci), "mean %.5f vs %.5f, std %.5f vs %.5f", wd.mean, mean, wd.simpangan(), sd);
+  ok &= cekUji("Welford<double>", dekat(wd.mean, mean, 0, 1e-9) && dekat(wd.simpangan(), sd, 0, 1e-6), rinci);
+  snprintf(rinci, sizeof(rinci), "mean %.5f, std %.5f (galat %.1e), min/maks %s", wf.mean, wf.simpangan(),
+           fabs(wf.simpangan() - sd) / sd, wf.minimum == (float)minimum && wf.maksimum == (float)maksimum ? "sama" : "BEDA");
+  ok &= cekUji("Welford<float>", dekat(wf.mean, mean, 0, 1e-5) && dekat(wf.simpangan(), sd, 0, 5e-3) &&
+                                     wf.minimum == (float)minimum && wf.maksimum == (float)maksimum && wf.n == x.size(),
+               rinci);
+  return ok;
+}
+
+// --------------------------------------------------------------
+// PARITAS FUZZY vs FuzzyMamdaniService.php
+// --------------------------------------------------------------
+// sim/fuzzy-parity.csv dihasilkan sim/fuzzy-parity.php dari service
+// Laravel. Skor float vs double PHP boleh beda 1 digit terakhir, jadi
+// kategori hanya boleh beda jika skor tepat di ambang; rule dominan
+// hanya boleh beda jika kekuatannya seri di firmware.
+// --------------------------------------------------------------
+static float kekuatanRule(float ph, float tds, float turbidity, int rule) {
+  int p = (rule - 1) / 9, t = (rule - 1) / 3 % 3, d = (rule - 1) % 3;
+  return std::min(trapezoidMF(ph, PH_MF[p]), std::min(trapezoidMF(turbidity, TURBIDITY_MF[t]), trapezoidMF(tds, TDS_MF[d])));
+}
+
+static bool dekatAmbang(float skor) {
+  const float AMBANG[] = { 30, 50, 70, 85 };
+  for (float a : AMBANG) {
+    if (fabsf(skor - a) <= 0.011f) return true;
+  }
+  return false;
+}
+
+static bool ujiFuzzy() {
+  char rinci[160];
+  FILE* f = fopen("sim/fuzzy-parity.csv", "r");
+  if (!f) return cekUji("grid PHP", false, "sim/fuzzy-parity.csv tidak ada (jalankan dari root repo)");
+  char baris[160];
+  uint32_t titik = 0, salah = 0, seri = 0;
+  fgets(baris, sizeof(baris), f);   // header
+  while (fgets(baris, sizeof(baris), f)) {
+    float ph, turbidity, tds, skor, kekuatan;
+    char kategori[16];
+    int aktif, dominan;
+    if (sscanf(baris, "%f,%f,%f,%f,%15[^,],%d,%d,%f", &ph, &turbidity, &tds, &skor, kategori, &aktif, &dominan,
+               &kekuatan) != 8) {
+      continue;
+    }
+    titik++;
+    FuzzyResult r = evaluasiKualitasAir(ph, tds, turbidity);
+    bool skorOk = fabsf(r.score - skor) <= 0.011f;
+    bool kategoriOk = !strcmp(KATEGORI_LABEL[r.category], kategori) || dekatAmbang(skor);
+    bool dominanOk = r.dominantRule == dominan;
+    if (!dominanOk && dominan > 0 && fabsf(kekuatanRule(ph, tds, turbidity, dominan) - r.dominantStrength) <= 1e-5f) {
+      dominanOk = true;
+      seri++;
+    }
+    bool ok = skorOk && kategoriOk && r.activeRules == aktif && dominanOk &&
+              fabsf(r.dominantStrength - kekuatan) <= 1e-5f;
+    if (!ok && ++salah <= 5) {
+      printf("    pH %g turb %g TDS %g: skor %.2f/%.2f %s/%s aktif %u/%d dominan #%u/#%d (%.6f/%.6f)\n", ph, turbidity,
+             tds, r.score, skor, KATEGORI_LABEL[r.category], kategori, r.activeRules, aktif, r.dominantRule, dominan,
+             r.dominantStrength, kekuatan);
+    }
+  }
+  fclose(f);
+  snprintf(rinci, sizeof(rinci), "%u titik, %u beda (%u rule dominan seri)", titik, salah, seri);
+  return cekUji("grid PHP", titik > 0 && salah == 0, rinci);
+}
+
+// --------------------------------------------------------------
+// SALINITAS PSS-78 vs acuan double (dengan suku tekanan)
+// --------------------------------------------------------------
+// Acuan ditulis ulang dari Fofonoff & Millard (UNESCO 1983) termasuk
+// koreksi tekanan Rp, lalu dicek terhadap nilai uji UNESCO sebelum
+// dipakai. Firmware (tekanan 0) harus memberi S = 35 tepat di
+// C(35, T, 0) untuk suhu berapa pun, mengikuti acuan di 1..40000 ppm
+// dan 0..40 C, dan kontinu di batas koreksi Hill (S = 2).
+// --------------------------------------------------------------
+static double rtAcuan(double t) {
+  return 0.6766097 + 2.00564e-2 * t + 1.104259e-4 * t * t - 6.9698e-7 * t * t * t + 1.0031e-9 * t * t * t * t;
+}
+
+static double sal78Acuan(double r, double t, double p) {
+  static const double A[6] = { 0.0080, -0.1692, 25.3851, 14.0941, -7.0261, 2.7081 };
+  static const double B[6] = { 0.0005, -0.0056, -0.0066, -0.0375, 0.0636, -0.0144 };
+  double rp = 1 + p * (2.070e-5 - 6.370e-10 * p + 3.989e-15 * p * p) /
+                  (1 + 3.426e-2 * t + 4.464e-4 * t * t + (4.215e-1 - 3.107e-3 * t) * r);
+  double rt = r / (rp * rtAcuan(t));
+  if (rt <= 0) return 0;
+  double dt = t - 15, ft = dt / (1 + 0.0162 * dt);
+  double s = 0;
+  for (int i = 0; i < 6; i++) s += (A[i] + ft * B[i]) * pow(rt, i / 2.0);
+  if (s < 2) {
+    double x = 400 * rt, y = 100 * rt;
+    s -= A[0] / (1 + 1.5 * x + x * x) + B[0] * ft / (1 + sqrt(y) + y + y * sqrt(y));
+  }
+  return s;
+}
+
+// TDS firmware (25 C, EC = 2 x TDS) -> rasio konduktivitas R di suhu t
+static double rasioDariTds(double tds, double t, double alpha) {
+  return tds * SALINITAS_EC_PER_TDS * (1 + alpha * (t - 25)) / PSS78_C35_US_CM;
+}
+
+static bool ujiSalinitas() {
+  char rinci[200];
+  bool ok = true;
+  const float ALPHA = 0.02f;
+
+  double uji40 = sal78Acuan(1.888091, 40, 10000), uji35 = sal78Acuan(1, 15, 0);
+  snprintf(rinci, sizeof(rinci), "S(1.888091, 40, 10000) = %.4f, S(1, 15, 0) = %.4f", uji40, uji35);
+  ok &= cekUji("acuan vs nilai uji UNESCO", fabs(uji40 - 40) < 1e-4 && fabs(uji35 - 35) < 1e-4, rinci);
+
+  // C(T) = C(35,15,0) x rt(T) -> S = 35 (jumlah koefisien b = 0)
+  double galat35 = 0;
+  const float SUHU35[4] = { 5.0f, 15.0f, 25.0f, 32.0f };
+  for (float t : SUHU35) {
+    aturKonteksSalinitas(t, ALPHA);
+    double tds = PSS78_C35_US_CM * rtAcuan(t) / (SALINITAS_EC_PER_TDS * (1 + ALPHA * (t - 25)));
+    galat35 = std::max(galat35, fabs(hitungSalinitas((float)tds) - 35.0));
+  }
+  snprintf(rinci, sizeof(rinci), "galat maks %.5f PPT pada 5/15/25/32 C", galat35);
+  ok &= cekUji("S = 35 di C(35, T, 0)", galat35 < 2e-3, rinci);
+
+  double galat = 0, galatHill = 0, tdsGalat = 0, tGalat = 0;
+  for (int t = 0; t <= 40; t += 2) {
+    aturKonteksSalinitas((float)t, ALPHA);
+    for (double tds = 1; tds <= 40000; tds *= 1.01) {
+      double acuan = sal78Acuan(rasioDariTds(tds, t, ALPHA), t, 0);
+      double e = fabs(hitungSalinitas((float)tds) - acuan);
+      if (acuan < 2) galatHill = std::max(galatHill, e);
+      if (e > galat) {
+        galat = e;
+        tdsGalat = tds;
+        tGalat = t;
+      }
+    }
+  }
+  snprintf(rinci, sizeof(rinci), "galat maks %.2e PPT (%.0f ppm, %.0f C), daerah Hill %.2e", galat, tdsGalat, tGalat,
+           galatHill);
+  ok &= cekUji("float vs acuan 1..40000 ppm", galat < 1e-3, rinci);
+
+  // Daerah Hill (< 2 PPT): naik monoton dari 0, tanpa loncatan di S = 2
+  aturKonteksSalinitas(28.0f, ALPHA);
+  bool monoton = hitungSalinitas(0) == 0;
+  float lalu = 0, batas = 0;
+  for (float tds = 1; tds <= 4000; tds += 1) {
+    float s = hitungSalinitas(tds);
+    monoton &= s > lalu;
+    if (lalu < 2 && s >= 2) batas = tds;
+    lalu = s;
+  }
+  float loncat = hitungSalinitas(batas) - hitungSalinitas(batas - 0.01f);
+  snprintf(rinci, sizeof(rinci), "S(1 ppm) = %.5f, S = 2 di %.0f ppm, loncatan %.2e", hitungSalinitas(1), batas, loncat);
+  ok &= cekUji("Hill < 2 PPT", monoton && batas > 0 && fabs(loncat) < 1e-3 && hitungSalinitas(1) < 0.01f, rinci);
+
+  // Rumus lama (test-salinity.php: TDS x 0.57 / 1000) di rentang kolam
+  aturKonteksSalinitas(25.0f, ALPHA);
+  double rasioMaks = 0;
+  const float TDS_KOLAM[4] = { 200.0f, 500.0f, 1000.0f, 3000.0f };
+  for (float tds : TDS_KOLAM) rasioMaks = std::max(rasioMaks, tds * 0.57 / 1000 / hitungSalinitas(tds));
+  snprintf(rinci, sizeof(rinci), "500 ppm 25 C: PSS-78 %.3f, K=0.57 %.3f PPT; lama/PSS-78 maks %.2f",
+           hitungSalinitas(500), 500 * 0.57 / 1000, rasioMaks);
+  ok &= cekUji("vs rumus lama K=0.57", rasioMaks < 0.7, rinci);
+  return ok;
+}
+
+// --------------------------------------------------------------
+// KERNEL KALIBRASI: LUT fixed-point vs referensi float
+// --------------------------------------------------------------
+// Window ADC diisi konstan (kode v) lalu berselang-seling v/v+1
+// (trimmed mean & median v+0.5, jalur pecahan Q4), kemudian bacaPH/
+// bacaTDS/bacaTurbidity dibandingkan dengan phReferensi/tdsReferensi/
+// turbidityReferensi pada input yang sama. Profil: dua preset, pH satu
+// titik (slope), dan profil 3 titik pH + 4 titik turbidity yang menekuk.
+// TDS diuji pada beberapa suhu (kompensasi Q14); input terkompensasi di
+// atas kode 4096 dijepit ke ujung tabel. Jarak dengan Q20.
+// Toleransi kurva titik = galat interpolasi linear di tekukan
+// (|beda slope| x langkah / 4) + pembulatan tabel & input Q4; TDS
+// (polinom halus) 1 ppm = resolusi jurnal.
+// --------------------------------------------------------------
+struct GalatKernel {
+  double ph, tds, turbidity;
+};
+
+// Batas galat LUT dengan langkah `langkah` kode untuk kurva titik t
+// (x dalam satuan kodePerX kode ADC), skala output `skala`
+static double batasLut(const TitikKalibrasi* t, uint8_t n, double kodePerX, int langkah, double skala) {
+  double slopeMaks = 0, tekukMaks = 0, slopeLalu = 0;
+  for (uint8_t i = 1; i < n; i++) {
+    double slope = (t[i].y - t[i - 1].y) / ((t[i].x - t[i - 1].x) * kodePerX);
+    slopeMaks = std::max(slopeMaks, fabs(slope));
+    if (i > 1) tekukMaks = std::max(tekukMaks, fabs(slope - slopeLalu));
+    slopeLalu = slope;
+  }
+  return tekukMaks * langkah / 4 + 2.0 / skala + slopeMaks / (1 << ADC_Q_BITS);
+}
+
+static void isiWindowAdc(AdcChannelIndex idx, uint16_t a, uint16_t b) {
+  for (int i = 0; i < ADC_WINDOW; i++) adcRingPush(adcRings[idx], (i & 1) ? b : a);
+}
+
+static GalatKernel galatKernel(const ProfilKalibrasi& p, float suhuC) {
+  profilKalibrasi = p;
+  bangunKernel();
+  aturSuhuAir(suhuC);
+  const KernelSet& k = *kernelAktif.load();
+  float koef = 1.0f + p.tdsAlpha * (suhuC - 25.0f);
+  GalatKernel g = { 0, 0, 0 };
+  for (int setengah = 0; setengah < 2; setengah++) {
+    for (int v = 0; v + setengah <= 4095; v++) {
+      uint16_t b = (uint16_t)(v + setengah);
+      isiWindowAdc(ADC_IDX_PH, v, b);
+      isiWindowAdc(ADC_IDX_TDS, v, b);
+      isiWindowAdc(ADC_IDX_TURBIDITY, v, b);
+      float adc = v + 0.5f * setengah;
+      g.ph = std::max(g.ph, fabs(bacaPH(k) - (double)phReferensi(p, adc)));
+      float adcKomp = std::min(adc / koef, 4096.0f);
+      g.tds = std::max(g.tds, fabs(bacaTDS(k) - (double)tdsReferensi(p, adcKeVolt(adcKomp))));
+      g.turbidity = std::max(g.turbidity, fabs(bacaTurbidity(k) - (double)turbidityReferensi(p, adc)));
+    }
+  }
+  return g;
+}
+
+static bool ujiKalibrasi() {
+  char rinci[160];
+  bool ok = true;
+
+  ProfilKalibrasi profil[4];
+  const char* namaProfil[4] = { "preset lama", "preset baru", "pH 1 titik", "3 pH + 4 turb" };
+  presetKalibrasi(profil[0], false);
+  presetKalibrasi(profil[1], true);
+  presetKalibrasi(profil[2], true);
+  profil[2].nPh = 1;
+  presetKalibrasi(profil[3], false);
+  profil[3].nPh = 3;
+  profil[3].ph[0] = { 1.80f, 9.18f };
+  profil[3].ph[1] = { 2.50f, 6.86f };
+  profil[3].ph[2] = { 3.10f, 4.01f };
+  profil[3].nTurb = 4;
+  profil[3].turb[0] = { 200.0f, 1000.0f };
+  profil[3].turb[1] = { 1200.0f, 300.0f };
+  profil[3].turb[2] = { 2600.0f, 40.0f };
+  profil[3].turb[3] = { 3900.0f, 0.0f };
+
+  const float SUHU[3] = { 15.0f, 25.0f, 35.0f };
+  for (int i = 0; i < 4; i++) {
+    GalatKernel maks = { 0, 0, 0 };
+    for (float suhu : SUHU) {
+      GalatKernel g = galatKernel(profil[i], suhu);
+      maks.ph = std::max(maks.ph, g.ph);
+      maks.tds = std::max(maks.tds, g.tds);
+      maks.turbidity = std::max(maks.turbidity, g.turbidity);
+    }
+    const ProfilKalibrasi& p = profil[i];
+    double batasPh = p.nPh == 1 ? 2.0 / 1000 + fabs(ADC_VREF / ADC_MAX_CODE / p.phSlope) / (1 << ADC_Q_BITS)
+                                : batasLut(p.ph, p.nPh, ADC_MAX_CODE / ADC_VREF, 1 << 5, 1000);
+    double batasTurb = batasLut(p.turb, p.nTurb, 1.0, 1 << 4, 100);
+    snprintf(rinci, sizeof(rinci), "galat maks pH %.4f (<%.4f), TDS %.3f ppm, turbidity %.3f NTU (<%.3f)", maks.ph,
+             batasPh, maks.tds, maks.turbidity, batasTurb);
+    ok &= cekUji(namaProfil[i], maks.ph <= batasPh && maks.tds <= 1.0 && maks.turbidity <= batasTurb, rinci);
+  }
+
+  // Jarak: durasi echo x Q20 vs kecepatan suara float
+  double galatJarak = 0;
+  for (float suhu : SUHU) {
+    aturSuhuAir(suhu);
+    double cmPerUs = (331.3 + 0.606 * suhu) * 1e-4 / 2;
+    for (long us = 100; us <= 30000; us += 7) {
+      ultrasonicTask.durationUs = us;
+      galatJarak = std::max(galatJarak, fabs(bacaUltrasonic() - us * cmPerUs) / (us * cmPerUs));
+    }
+  }
+  snprintf(rinci, sizeof(rinci), "galat relatif maks %.2e", galatJarak);
+  ok &= cekUji("jarak Q20", galatJarak <= 5e-5, rinci);
+
+  // Dua "kal" berturut-turut saat task sampling sedang konversi: rebuild
+  // kedua menimpa buffer yang masih dipinjam, jadi harus menunggu
+  presetKalibrasi(profilKalibrasi, false);
+  bangunKernel();
+  std::atomic<int> tahap(0);
+  bool utuh = true;
+  std::thread pembaca([&]() {
+    const KernelSet* k = pinjamKernel();
+    KernelPH salinan = k->ph;
+    tahap.store(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    utuh = memcmp(&salinan, &k->ph, sizeof(salinan)) == 0;
+    tahap.store(2);
+    kembalikanKernel();
+  });
+  while (tahap.load() == 0) std::this_thread::yield();
+  presetKalibrasi(profilKalibrasi, true);
+  bangunKernel();
+  profilKalibrasi = profil[3];   // beda dari tabel yang dipinjam
+  bangunKernel();
+  bool menunggu = tahap.load() == 2;
+  pembaca.join();
+  KernelPH acuan;
+  acuan.bangun([](float adc) { return phReferensi(profilKalibrasi, adc); });
+  bool akhir = memcmp(&acuan, &kernelAktif.load()->ph, sizeof(acuan)) == 0;
+  snprintf(rinci, sizeof(rinci), "tabel pembaca %s, rebuild kedua %s, kernel akhir %s", utuh ? "utuh" : "TERTIMPA",
+           menunggu ? "menunggu" : "TIDAK menunggu", akhir ? "= profil terakhir" : "SALAH");
+  ok &= cekUji("rebuild saat dibaca", utuh && menunggu && akhir, rinci);
+
+  // Key NVS: ID 12 karakter pas di batas, ID aktif terlalu panjang -> preset
+  Preferences prefs;
+  presetKalibrasi(profilKalibrasi, false);
+  strcpy(profilKalibrasi.probeId, "kolam-A12345");
+  bool simpan = simpanProfil();
+  initKalibrasi();
+  bool muat = !strcmp(profilKalibrasi.probeId, "kolam-A12345");
+  prefs.begin(KAL_NAMESPACE, false);
+  prefs.putString("aktif", "kolam-A12345-cadangan-lama");
+  prefs.end();
+  initKalibrasi();
+  bool preset = !strcmp(profilKalibrasi.probeId, "default");
+  char key[KAL_KEY_LEN];
+  keyProfil(key, sizeof(key), "kolam-A12345-cadangan-lama");
+  snprintf(rinci, sizeof(rinci), "simpan %d, muat %d, ID panjang -> '%s', key '%s'", simpan, muat,
+           profilKalibrasi.probeId, key);
+  ok &= cekUji("profil NVS", simpan && muat && preset && strlen(key) == 2 + KAL_PROBE_ID_LEN, rinci);
+  return ok;
+}
+
+// --------------------------------------------------------------
+// PAYLOAD FIRESTORE: serializer skema tanpa heap
+// --------------------------------------------------------------
+// tulisBody/tulisMask menulis ke buffer stack pemanggil; selama
+// simHitungAlokasi aktif tidak boleh ada satu pun malloc/new. Nilai
+// dipilih terpanjang (angka besar, timestamp, semua field) agar jalur
+// eksponen dan semua jenis field ikut lewat. Pembanding FirebaseJson
+// tidak bisa diukur di host (library hanya ada di toolchain Arduino):
+// dari struktur library diperkirakan ~8 alokasi per field (node JSON,
+// key, token path "fields/x/doubleValue"), jadi ~100 per body
+// dataSensor ditambah realloc saat serialisasi ke String.
+// --------------------------------------------------------------
+static bool jsonSeimbang(const char* s) {
+  int kurawal = 0;
+  bool string = false;
+  for (; *s; s++) {
+    if (string) {
+      if (*s == '\\' && s[1]) s++;
+      else if (*s == '"') string = false;
+    } else if (*s == '"') {
+      string = true;
+    } else if (*s == '{') {
+      kurawal++;
+    } else if (*s == '}' && --kurawal < 0) {
+      return false;
+    }
+  }
+  return kurawal == 0 && !string;
+}
+
+static bool ujiPayload() {
+  char rinci[160];
+  bool ok = true;
+  const uint32_t N = 200000;
+
+  DataSensorDoc doc = {};
+  doc.ph = 14.0f;
+  doc.tds = 123456.789f;
+  doc.turbidity = 3.4e15f;
+  doc.jarak = -0.0001f;
+  doc.salinitas = 35.1234f;
+  doc.score = 99.99f;
+  doc.category = 3;
+  doc.seq = 0xFFFFFFFFUL;
+  doc.bootId = 0xFFFFFFFFUL;
+  doc.capturedAt = 1760000000123ULL;
+  doc.uploadedAt = 1760000000456ULL;
+  doc.ackSeq = 0xFFFFFFFEUL;
+  doc.ackAt = 1760000000789ULL;
+  HistorySample h = { 0xFFFFFFFFUL, 0xFFFFFFFFUL, 14.0f, 123456.789f, 3.4e15f, -0.0001f, 99.99f, 3 };
+
+  char body[DATA_SENSOR_BODY_SIZE];
+  char mask[DATA_SENSOR_MASK_SIZE];
+  char bodyRiwayat[HISTORY_BODY_SIZE];
+  // Pemanasan: gmtime_r/strftime pertama di glibc memuat data zona waktu
+  // sekali (malloc); newlib di ESP32 tidak
+  bool tulisOk = DataSensorSchema::tulisBody(doc, DataSensorSchema::SEMUA, body, sizeof(body));
+  simHitungAlokasi(true);
+  uint64_t alokasiAwal = simJumlahAlokasi();
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < N; i++) {
+    doc.seq = i;
+    tulisOk &= DataSensorSchema::tulisBody(doc, DataSensorSchema::SEMUA, body, sizeof(body));
+    tulisOk &= DataSensorSchema::tulisMask(DataSensorSchema::SEMUA, mask, sizeof(mask));
+  }
+  double usPerBody = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / N;
+  for (uint32_t i = 0; i < N; i++) {
+    h.seq = i;
+    tulisOk &= HistorySchema::tulisBody(h, HistorySchema::SEMUA, bodyRiwayat, sizeof(bodyRiwayat));
+  }
+  uint64_t alokasi = simJumlahAlokasi() - alokasiAwal;
+  simHitungAlokasi(false);
+
+  snprintf(rinci, sizeof(rinci), "%lu body+mask dataSensor & %lu body riwayat: %llu alokasi, %.2f us/body",
+           (unsigned long)N, (unsigned long)N, (unsigned long long)alokasi, usPerBody);
+  ok &= cekUji("tulisBody tanpa heap", tulisOk && alokasi == 0, rinci);
+
+  snprintf(rinci, sizeof(rinci), "dataSensor %zu/%d byte, mask %zu/%d, riwayat %zu/%d", strlen(body),
+           DATA_SENSOR_BODY_SIZE, strlen(mask), DATA_SENSOR_MASK_SIZE, strlen(bodyRiwayat), HISTORY_BODY_SIZE);
+  ok &= cekUji("body terpanjang muat", tulisOk && jsonSeimbang(body) && jsonSeimbang(bodyRiwayat), rinci);
+
+  // Buffer kurang satu byte: harus ditolak, bukan terpotong diam-diam
+  size_t panjang = strlen(body);
+  bool ditolak = !DataSensorSchema::tulisBody(doc, DataSensorSchema::SEMUA, body, panjang);
+  snprintf(rinci, sizeof(rinci), "cap %zu untuk body %zu byte", panjang, panjang);
+  ok &= cekUji("buffer kurang ditolak", ditolak, rinci);
+  return ok;
+}
+
+// --------------------------------------------------------------
+// ANTRIAN SPSC: dua std::thread, urutan & isi item utuh
+// --------------------------------------------------------------
+// Producer mendorong item berurutan {seq, ~seq, seq x konstanta};
+// consumer harus menerima seq 0, 1, 2, ... tanpa loncat/dobel, dan
+// tiap item utuh (bukan campuran dua slot). Antrian kecil (2) memaksa
+// penuh/kosong bergantian terus; 16 = ukuran readingQueue. Saat
+// penuh/kosong thread yield (host bisa hanya punya satu core).
+// --------------------------------------------------------------
+struct ItemUji {
+  uint64_t seq;
+  uint64_t balik;
+  uint64_t kali;
+};
+
+template <size_t N>
+static bool stressSpsc(uint64_t jumlah) {
+  static SpscQueue<ItemUji, N> q;
+  std::atomic<uint64_t> penuh(0);
+  std::thread producer([&] {
+    uint64_t tolak = 0;
+    for (uint64_t i = 0; i < jumlah; i++) {
+      ItemUji it = { i, ~i, i * 0x9E3779B97F4A7C15ULL };
+      while (!q.push(it)) {
+        tolak++;
+        std::this_thread::yield();
+      }
+    }
+    penuh.store(tolak);
+  });
+
+  uint64_t harap = 0, salahUrut = 0, sobek = 0, kosong = 0, lebih = 0;
+  ItemUji it;
+  while (harap < jumlah) {
+    if (q.size() > N) lebih++;
+    if (!q.pop(it)) {
+      kosong++;
+      std::this_thread::yield();
+      continue;
+    }
+    if (it.balik != ~it.seq || it.kali != it.seq * 0x9E3779B97F4A7C15ULL) sobek++;
+    if (it.seq != harap) salahUrut++;
+    harap = it.seq + 1;
+  }
+  producer.join();
+  bool sisa = q.pop(it);
+
+  char nama[40], rinci[160];
+  snprintf(nama, sizeof(nama), "2 thread, N=%u", (unsigned)N);
+  snprintf(rinci, sizeof(rinci), "%llu item, %llu salah urut, %llu sobek; penuh %llu x, kosong %llu x",
+           (unsigned long long)jumlah, (unsigned long long)salahUrut, (unsigned long long)sobek,
+           (unsigned long long)penuh.load(), (unsigned long long)kosong);
+  return cekUji(nama, salahUrut == 0 && sobek == 0 && lebih == 0 && !sisa, rinci);
+}
+
+static bool ujiSpsc() {
+  bool ok = true;
+  ok &= stressSpsc<2>(2000000);
+  ok &= stressSpsc<READING_QUEUE_SIZE>(5000000);
+  return ok;
+}
+
+// --------------------------------------------------------------
+// JURNAL OFFLINE di atas LittleFS berbasis file host
+// --------------------------------------------------------------
+// Tiap kasus mulai dari /jurnal kosong. "Reboot" = state RAM jurnal
+// hilang, blok terbuka di RTC dan file segmen bertahan. Yang diterima
+// server dibaca dari simJaringan.riwayatServer (ID dokumen -> berapa
+// kali di-commit). Listrik padam / flash rusak disimulasikan dengan
+// memotong atau membalik byte file segmen langsung di host.
+// --------------------------------------------------------------
+#define UJI_EPOCH_AWAL 1760000000UL
+
+static HistorySample sampelUji(uint32_t seq, std::mt19937& rng) {
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  HistorySample h = {};
+  h.epoch = UJI_EPOCH_AWAL + seq * 60;
+  h.seq = seq;
+  h.ph = 7.2f + 0.05f * noise(rng);
+  h.tds = 420.0f + 4.0f * noise(rng);
+  h.turbidity = 18.0f + 0.5f * noise(rng);
+  h.jarak = 35.0f + 0.3f * noise(rng);
+  return h;
+}
+
+static std::string idRiwayat(uint32_t seq) {
+  char id[64];
+  snprintf(id, sizeof(id), "sensorHistory/esp32-%lu-%lu", (unsigned long)(UJI_EPOCH_AWAL + seq * 60),
+           (unsigned long)seq);
+  return id;
+}
+
+static void rebootJurnal() {
+  journal = {};
+  lastJournalDrainMillis = 0;
+  initJurnal();
+}
+
+static void kosongkanJurnal() {
+  File dir = LittleFS.open(JOURNAL_DIR);
+  std::vector<std::string> path;
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) path.push_back(std::string(JOURNAL_DIR "/") + f.name());
+  for (const std::string& p : path) LittleFS.remove(p.c_str());
+  resetBlokJurnal();
+  simJaringan.riwayatServer.clear();
+  rebootJurnal();
+}
+
+static void tulisSampelUji(uint32_t dari, uint32_t sampai, std::mt19937& rng) {
+  for (uint32_t seq = dari; seq < sampai; seq++) tulisJurnal(sampelUji(seq, rng), JURNAL_OFFLINE);
+}
+
+// Drain sampai pending habis; batas iterasi agar bug akuntansi tidak hang
+static uint32_t drainSemua() {
+  uint32_t iterasi = 0;
+  while (journal.pending > 0 && iterasi++ < 100000) drainJurnal(millis());
+  return iterasi;
+}
+
+// Dokumen seq [dari, sampai) masing-masing diterima tepat `kali` kali
+static bool diterimaServer(uint32_t dari, uint32_t sampai, uint32_t kali) {
+  for (uint32_t seq = dari; seq < sampai; seq++) {
+    auto it = simJaringan.riwayatServer.find(idRiwayat(seq));
+    if (it == simJaringan.riwayatServer.end() || it->second != kali) return false;
+  }
+  return true;
+}
+
+static uint32_t jumlahFileSegmen() {
+  File dir = LittleFS.open(JOURNAL_DIR);
+  uint32_t n = 0;
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) n++;
+  return n;
+}
+
+// Offset data blok ke-`blok` di segmen (header segmen, lalu [header blok][data])
+static long offsetDataBlok(uint32_t seg, int blok) {
+  char path[32];
+  pathSegmen(seg, path, sizeof(path));
+  FILE* f = fopen(simPathFs(path).c_str(), "rb");
+  if (!f) return -1;
+  long pos = sizeof(JournalSegmentHeader);
+  JournalBlockHeader h;
+  for (int i = 0; fseek(f, pos, SEEK_SET) == 0 && fread(&h, sizeof(h), 1, f) == 1; i++) {
+    if (i == blok) break;
+    pos += sizeof(h) + h.bytes;
+  }
+  fclose(f);
+  return pos + sizeof(JournalBlockHeader);
+}
+
+static bool ujiJurnal() {
+  char rinci[200];
+  bool ok = true;
+  std::mt19937 rng(11);
+  typedef std::chrono::steady_clock Jam;
+
+  WiFi.begin("sim-ap", "sim");
+  simMaju(5000000);
+  if (!cekUji("WiFi sim", WiFi.status() == WL_CONNECTED, "")) return false;
+
+  // Throughput tulis (enkode + append flash) dan drain (baca + commit)
+  kosongkanJurnal();
+  const uint32_t N = 20000;
+  Jam::time_point t0 = Jam::now();
+  tulisSampelUji(0, N, rng);
+  tutupBlokJurnal();
+  double detikTulis = std::chrono::duration<double>(Jam::now() - t0).count();
+  uint32_t bytesFlash = journal.blokBytes;
+  t0 = Jam::now();
+  uint32_t iterasi = drainSemua();
+  double detikDrain = std::chrono::duration<double>(Jam::now() - t0).count();
+  snprintf(rinci, sizeof(rinci), "tulis %.0f sampel/s (%.0f KB/s flash), drain %.0f record/s (%lu commit)",
+           N / detikTulis, bytesFlash / detikTulis / 1024, N / detikDrain, (unsigned long)iterasi);
+  ok &= cekUji("throughput tulis/drain", journal.pending == 0 && journal.drained == N && journal.dropped == 0 &&
+                                            simJaringan.riwayatServer.size() == N && diterimaServer(0, N, 1),
+               rinci);
+
+  // Blok terakhir terpotong (listrik padam saat append): blok utuh terkirim
+  kosongkanJurnal();
+  tulisSampelUji(0, 3 * JOURNAL_BLOCK_SAMPLES, rng);
+  tutupBlokJurnal();
+  char path[32];
+  pathSegmen(journal.lastSeg, path, sizeof(path));
+  struct stat st;
+  stat(simPathFs(path).c_str(), &st);
+  if (truncate(simPathFs(path).c_str(), st.st_size - 5) != 0) return cekUji("blok terpotong", false, "truncate");
+  rebootJurnal();
+  uint32_t pendingBoot = journal.pending;
+  drainSemua();
+  snprintf(rinci, sizeof(rinci), "pending setelah boot %lu, terkirim %lu, segmen tersisa %lu",
+           (unsigned long)pendingBoot, (unsigned long)journal.drained, (unsigned long)jumlahFileSegmen());
+  ok &= cekUji("blok terpotong", pendingBoot == 2 * JOURNAL_BLOCK_SAMPLES && journal.pending == 0 &&
+                                     simJaringan.riwayatServer.size() == 2 * JOURNAL_BLOCK_SAMPLES &&
+                                     diterimaServer(0, 2 * JOURNAL_BLOCK_SAMPLES, 1) && jumlahFileSegmen() == 0,
+               rinci);
+
+  // CRC salah di blok ke-3 segmen pertama: sisa segmen itu dilewati,
+  // segmen berikutnya tetap terkirim dan pending tidak menggantung
+  kosongkanJurnal();
+  uint32_t total = 0;
+  while (journal.lastSeg == journal.firstSeg) {
+    tulisSampelUji(total, total + JOURNAL_BLOCK_SAMPLES, rng);
+    total += JOURNAL_BLOCK_SAMPLES;
+  }
+  tutupBlokJurnal();
+  uint32_t seg0 = journal.firstSeg;
+  uint32_t recordSeg0 = jumlahRecordSegmen(seg0);
+  pathSegmen(seg0, path, sizeof(path));
+  FILE* f = fopen(simPathFs(path).c_str(), "r+b");
+  long pos = offsetDataBlok(seg0, 2);
+  int c = f ? (fseek(f, pos, SEEK_SET), fgetc(f)) : EOF;
+  if (c == EOF) return cekUji("CRC rusak", false, "segmen tidak bisa dibuka");
+  fseek(f, pos, SEEK_SET);
+  fputc(c ^ 0x5A, f);
+  fclose(f);
+  rebootJurnal();
+  drainSemua();
+  uint32_t utuh = 2 * JOURNAL_BLOCK_SAMPLES;
+  snprintf(rinci, sizeof(rinci), "%lu record, segmen pertama %lu (%lu utuh), CRC error %lu, terkirim %lu",
+           (unsigned long)total, (unsigned long)recordSeg0, (unsigned long)utuh,
+           (unsigned long)journal.crcErrors, (unsigned long)journal.drained);
+  ok &= cekUji("CRC rusak dilewati", journal.crcErrors > 0 && journal.pending == 0 &&
+                                         journal.drained == total - (recordSeg0 - utuh) &&
+                                         diterimaServer(0, utuh, 1) && diterimaServer(recordSeg0, total, 1) &&
+                                         simJaringan.riwayatServer.size() == journal.drained,
+               rinci);
+
+  // Batas segmen: yang terbuang tepat segmen tertua, akuntansi utuh
+  kosongkanJurnal();
+  const uint32_t M = 50000;
+  tulisSampelUji(0, M, rng);
+  tutupBlokJurnal();
+  uint32_t segmen = jumlahFileSegmen();
+  uint32_t dropped = journal.dropped;
+  uint32_t pending = journal.pending;
+  drainSemua();
+  snprintf(rinci, sizeof(rinci), "%lu segmen (maks %d), %lu hilang, %lu terkirim", (unsigned long)segmen,
+           JOURNAL_MAX_SEGMENTS, (unsigned long)dropped, (unsigned long)journal.drained);
+  ok &= cekUji("batas segmen", segmen <= JOURNAL_MAX_SEGMENTS && dropped > 0 && dropped + pending == M &&
+                                   journal.drained == pending && simJaringan.riwayatServer.size() == pending &&
+                                   diterimaServer(dropped, M, 1),
+               rinci);
+
+  // Reboot di tengah drain: sisa segmen dikirim ulang dari awal (ID
+  // idempoten), blok terbuka di RTC ikut bertahan
+  kosongkanJurnal();
+  tulisSampelUji(0, 100, rng);
+  drainJurnal(millis());
+  drainJurnal(millis());
+  tulisSampelUji(100, 110, rng);
+  rebootJurnal();
+  pendingBoot = journal.pending;
+  drainSemua();
+  snprintf(rinci, sizeof(rinci), "pending setelah boot %lu, %zu dokumen, %lu terkirim ulang", (unsigned long)pendingBoot,
+           simJaringan.riwayatServer.size(), (unsigned long)(2 * JOURNAL_DRAIN_BATCH));
+  ok &= cekUji("reboot kirim ulang", pendingBoot == 110 && journal.pending == 0 &&
+                                         simJaringan.riwayatServer.size() == 110 &&
+                                         diterimaServer(0, 2 * JOURNAL_DRAIN_BATCH, 2) &&
+                                         diterimaServer(2 * JOURNAL_DRAIN_BATCH, 110, 1),
+               rinci);
+  return ok;
+}
+
+// --------------------------------------------------------------
+// ARGUMEN LOG 64-BIT
+// logArgs -> formatLog harus sama dengan snprintf untuk long, size_t
+// dan (u)int64_t di host LP64; record ESP32 (long 4 byte) tetap
+// terbaca dengan lebarLong = 4.
+// --------------------------------------------------------------
+template <typename... A>
+static bool cocokLog(const char* fmt, const A&... args) {
+  LogArgs a;
+  logArgs(a, args...);
+  char hasil[128], acuan[128];
+  formatLog(fmt, a.buf, a.len, hasil, sizeof(hasil));
+  snprintf(acuan, sizeof(acuan), fmt, args...);
+  if (strcmp(hasil, acuan) == 0) return true;
+  fprintf(stderr, "    \"%s\" != \"%s\"\n", hasil, acuan);
+  return false;
+}
+
+static bool ujiLog() {
+  bool ok = true;
+  char rinci[200];
+
+  bool cocok = true;
+  cocok &= cocokLog("%lld %llu %llx", (long long)INT64_MIN, (unsigned long long)UINT64_MAX,
+                    (unsigned long long)0x123456789ABCDEF0ULL);
+  cocok &= cocokLog("%ld|%lu|%zu", (long)-5000000000LL, (unsigned long)ULONG_MAX, (size_t)12345678901ULL);
+  cocok &= cocokLog("%" PRId64 " %" PRIu64 " %s %.2f %d", (int64_t)-1, (uint64_t)1ULL << 40, "ok", 7.25, -3);
+  cocok &= cocokLog("%lu ms, %u, %lld", (unsigned long)4000000000UL, 7u, 0LL);
+  snprintf(rinci, sizeof(rinci), "sizeof(long) %u, %%ll/%%l/%%z sama dengan snprintf", (unsigned)sizeof(long));
+  ok &= cekUji("argumen 64-bit", cocok, rinci);
+
+  // Record dari ESP32: %lu 4 byte, %llu 8 byte
+  uint8_t buf[12];
+  uint32_t v32 = 4000000000u;
+  uint64_t v64 = 1ULL << 40;
+  memcpy(buf, &v32, 4);
+  memcpy(buf + 4, &v64, 8);
+  char teks[64];
+  formatLog("%lu %llu", buf, sizeof(buf), teks, sizeof(teks), 4);
+  ok &= cekUji("record long 4 byte", strcmp(teks, "4000000000 1099511627776") == 0, teks);
+
+  // Argumen 8 byte yang tidak muat dibuang utuh, bukan setengah
+  LogArgs a;
+  logArg(a, 9u);
+  while (a.len + 8 <= LOG_ARG_MAX) logArg(a, (uint64_t)a.len);
+  size_t sebelum = a.len;
+  logArg(a, (uint64_t)UINT64_MAX);
+  bool utuh = a.len == sebelum;
+  logArg(a, 1u);
+  uint32_t akhir = 0;
+  memcpy(&akhir, a.buf + a.len - 4, 4);
+  snprintf(rinci, sizeof(rinci), "%u byte terisi dari %d, word terakhir %u", (unsigned)a.len, LOG_ARG_MAX,
+           (unsigned)akhir);
+  ok &= cekUji("argumen penuh", utuh && a.len == LOG_ARG_MAX && akhir == 1, rinci);
+  return ok;
+}
+
+// --------------------------------------------------------------
+// SLOT PUBACK MQTT
+// Outbox menampung lebih banyak publish daripada MQTT_PENDING (broker
+// putus): slot tertua tergusur, PUBACK-nya tidak dihitung ack, dan
+// terkirim = ack + tergusur tetap berlaku setelah semua PUBACK datang.
+// --------------------------------------------------------------
+static void publishUji(int msgId) {
+  TraceReading t = { (uint32_t)msgId, (uint32_t)micros(), 0 };
+  catatPendingMqtt(msgId, micros(), t);
+  mqttMetrik.terkirim++;
+}
+
+static void pubackUji(int msgId) {
+  esp_mqtt_event_t e = {};
+  e.event_id = MQTT_EVENT_PUBLISHED;
+  e.msg_id = msgId;
+  mqttEvent(NULL, NULL, MQTT_EVENT_PUBLISHED, &e);
+}
+
+static bool ujiMqtt() {
+  char rinci[200];
+  std::mt19937 rng(16);
+  mqttMetrik = MetrikMqtt();
+  memset(&histogramTahap[TAHAP_MQTT], 0, sizeof(HistogramTahap));
+  kosongkanPendingMqtt();
+
+  // Terhubung: PUBACK datang sebelum publish berikutnya, slot tidak habis
+  const int LANCAR = 4 * MQTT_PENDING;
+  for (int id = 1; id <= LANCAR; id++) {
+    publishUji(id);
+    pubackUji(id);
+  }
+  // Putus: publish menumpuk di outbox, lalu semua PUBACK datang acak
+  const int TUMPUK = 3 * MQTT_PENDING + 5;
+  std::vector<int> ids;
+  for (int id = LANCAR + 1; id <= LANCAR + TUMPUK; id++) {
+    publishUji(id);
+    ids.push_back(id);
+  }
+  std::shuffle(ids.begin(), ids.end(), rng);
+  for (int id : ids) pubackUji(id);
+  pubackUji(LANCAR + TUMPUK + 1);   // PUBACK untuk msgId yang tak pernah dilacak
+
+  bool kosong = true;
+  for (int i = 0; i < MQTT_PENDING; i++) kosong &= mqttPending[i].msgId < 0;
+  uint32_t tergusur = TUMPUK - MQTT_PENDING;
+  snprintf(rinci, sizeof(rinci), "%lu terkirim, %lu ack, %lu tergusur, %lu ack tanpa slot, %lu sampel TAHAP_MQTT",
+           (unsigned long)mqttMetrik.terkirim, (unsigned long)mqttMetrik.ack, (unsigned long)mqttMetrik.tergusur,
+           (unsigned long)mqttMetrik.ackTanpaSlot, (unsigned long)histogramTahap[TAHAP_MQTT].jumlah);
+  return cekUji("slot tergusur", kosong && mqttMetrik.tergusur == tergusur &&
+                                     mqttMetrik.ack == (uint32_t)(LANCAR + MQTT_PENDING) &&
+                                     mqttMetrik.ack + mqttMetrik.tergusur == mqttMetrik.terkirim &&
+                                     mqttMetrik.ackTanpaSlot == tergusur + 1 &&
+                                     histogramTahap[TAHAP_MQTT].jumlah == mqttMetrik.ack,
+                rinci);
+}
+
+// --------------------------------------------------------------
+// KONEKSI HTTPS: BARU VS REUSE
+// metrikKoneksi dibandingkan dengan yang dilihat server stub (socket
+// TLS baru = handshake penuh, sisanya reuse) di tiap fase: idle
+// singkat/lama, socket putus, WiFi reconnect, soft reset.
+// --------------------------------------------------------------
+struct FaseKoneksi {
+  const char* nama;
+  uint32_t baru;
+  uint32_t reused;
+};
+
+static void requestKoneksi(int n) {
+  for (int i = 0; i < n; i++) {
+    if (i % 2) {
+      std::vector<struct firebase_firestore_document_write_t>& w = mulaiCommit();
+      w.push_back(firebase_firestore_document_write_t());
+      w.back().type = firebase_firestore_document_write_type_update;
+      w.back().update_document_path = "ujiKoneksi/commit";
+      w.back().update_document_content = "{\"fields\":{}}";
+      kirimCommit(w);
+    } else {
+      kirimPatch("ujiKoneksi/patch", "{\"fields\":{}}", "");
+    }
+  }
+}
+
+static bool cekFaseKoneksi(const FaseKoneksi& f, const MetrikKoneksi& m0, uint64_t hs0, uint64_t reuse0,
+                           uint32_t histo0) {
+  char rinci[200];
+  uint32_t baru = metrikKoneksi.baru - m0.baru;
+  uint32_t reused = metrikKoneksi.reused - m0.reused;
+  uint64_t hs = simJaringan.handshake - hs0;
+  uint64_t reuse = simJaringan.requestReuse - reuse0;
+  uint32_t histo = histogramTahap[TAHAP_BARU].jumlah - histo0;
+  snprintf(rinci, sizeof(rinci), "baru %u/%u, reuse %u/%u (device/harapan), server %llu handshake penuh, %llu reuse",
+           (unsigned)baru, (unsigned)f.baru, (unsigned)reused, (unsigned)f.reused, (unsigned long long)hs,
+           (unsigned long long)reuse);
+  return cekUji(f.nama, baru == f.baru && reused == f.reused && hs == baru && reuse == reused && histo == baru,
+                rinci);
+}
+
+static bool ujiKoneksi() {
+  bool ok = true;
+  uint64_t idleUs = (uint64_t)(simKonfig.idleServerMs * 1000);
+  WiFi.begin("sim-ap", "sim");
+  simMaju(5000000);
+  if (!cekUji("WiFi sim", WiFi.status() == WL_CONNECTED, "")) return false;
+  simTutupSocketTls();
+
+  static const FaseKoneksi FASE[] = {
+    { "koneksi pertama", 1, 3 },
+    { "idle singkat", 0, 4 },
+    { "idle lama", 1, 3 },
+    { "socket putus", 1, 3 },
+    { "WiFi reconnect", 1, 3 },
+    { "soft reset", 1, 3 },
+  };
+  for (int fase = 0; fase < 6; fase++) {
+    switch (fase) {
+      case 1:
+        simMaju(idleUs / 2);
+        break;
+      case 2:
+        simMaju(idleUs + 1000000);
+        break;
+      case 3:
+        simTutupSocketTls();   // RST dari server / NAT
+        break;
+      case 4:
+        WiFi.disconnect();
+        WiFi.begin("sim-ap", "sim");
+        simMaju(5000000);
+        break;
+      case 5:
+        // fbdo dibuat ulang dan RAM bersih; tanpa cache sesi -> handshake penuh
+        simTutupSocketTls();
+        metrikKoneksi = MetrikKoneksi();
+        break;
+    }
+    MetrikKoneksi m0 = metrikKoneksi;
+    uint64_t hs0 = simJaringan.handshake, reuse0 = simJaringan.requestReuse;
+    uint32_t histo0 = histogramTahap[TAHAP_BARU].jumlah;
+    requestKoneksi(4);
+    ok &= cekFaseKoneksi(FASE[fase], m0, hs0, reuse0, histo0);
+  }
+  return ok;
+}
+
+// --------------------------------------------------------------
+struct Uji {
+  const char* nama;
+  bool (*jalankan)();
+};
+
+static const Uji DAFTAR_UJI[] = {
+  { "adc", ujiAdcRing },
+  { "statistik", ujiStatistik },
+  { "fuzzy", ujiFuzzy },
+  { "salinitas", ujiSalinitas },
+  { "kalibrasi", ujiKalibrasi },
+  { "payload", ujiPayload },
+  { "spsc", ujiSpsc },
+  { "log", ujiLog },
+  { "mqtt", ujiMqtt },
+  { "koneksi", ujiKoneksi },
+  { "jurnal", ujiJurnal },
+};
+
+int main(int argc, char** argv) {
+  bool semuaOk = true;
+  int dijalankan = 0;
+  for (const Uji& u : DAFTAR_UJI) {
+    bool dipilih = argc == 1;
+    for (int i = 1; i < argc; i++) dipilih |= !strcmp(argv[i], u.nama);
+    if (!dipilih) continue;
+    printf("[%s]\n", u.nama);
+    semuaOk &= u.jalankan();
+    dijalankan++;
+  }
+  if (!dijalankan) {
+    fprintf(stderr, "Pemakaian: %s [uji...]\n  uji:", argv[0]);
+    for (const Uji& u : DAFTAR_UJI) fprintf(stderr, " %s", u.nama);
+    fprintf(stderr, "\n");
+    return 1;
+  }
+  printf("%s\n", semuaOk ? "✓ semua uji lulus" : "✗ ada uji gagal");
+  return semuaOk ? 0 : 3;
+}
@@ -0,0 +1,50 @@
+// Antrian SPSC untuk kodeesp32.cpp; header terpisah agar bisa diuji
+// di PC tanpa firmware
+#pragma once
+#include <stddef.h>
+#include <atomic>
+
+// --------------------------------------------------------------
+// ANTRIAN SPSC LOCK-FREE (wait-free, satu producer satu consumer)
+// --------------------------------------------------------------
+// Template murni C++ (hanya <atomic>), jadi diuji di PC dengan
+// std::thread (uji "spsc" di sim/uji.cpp). push() hanya dari
+// producer, pop() hanya dari consumer. Index head/tail terus
+// bertambah; slot = index & (N - 1).
+// --------------------------------------------------------------
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N harus pangkat 2");
+
+public:
+  SpscQueue() : head(0), tail(0) {}
+
+  // Producer: false jika penuh (item tidak ditulis)
+  bool push(const T& item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) return false;
+    buf[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: false jika kosong
+  bool pop(T& out) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) return false;
+    out = buf[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity() { return N; }
+
+private:
+  T buf[N];
+  std::atomic<size_t> head;  // ditulis producer
+  std::atomic<size_t> tail;  // ditulis consumer
+};